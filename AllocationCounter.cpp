@@ -0,0 +1,125 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// Only incremented, never read in the hot path, so relaxed ordering is enough
+static std::atomic<uint64_t> sAllocations{ 0 };
+
+uint64_t AllocationCounter::allocations()
+{
+    return sAllocations.load(std::memory_order_relaxed);
+}
+
+// Replacement of the global allocation functions.
+// The nothrow and array versions of the standard library end up in these.
+void *operator new(std::size_t size)
+{
+    sAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+    if (void *memory = std::malloc(size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+// Over-aligned types come here instead. The memory can't come from malloc, so the aligned
+// deletes have to be replaced along with them.
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    sAllocations.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    // aligned_alloc wants a multiple of the alignment
+    size = (size + align - 1) & ~(align - 1);
+    if (size == 0)
+        size = align;
+#ifdef _WIN32
+    if (void *memory = _aligned_malloc(size, align))
+        return memory;
+#else
+    if (void *memory = std::aligned_alloc(align, size))
+        return memory;
+#endif
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return ::operator new(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    try {
+        return ::operator new(size, alignment);
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return ::operator new(size, alignment, std::nothrow);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+void operator delete[](void *memory, std::align_val_t alignment) noexcept
+{
+    ::operator delete(memory, alignment);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t alignment) noexcept
+{
+    ::operator delete(memory, alignment);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t alignment) noexcept
+{
+    ::operator delete(memory, alignment);
+}
+
+void operator delete(void *memory, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    ::operator delete(memory, alignment);
+}
+
+void operator delete[](void *memory, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    ::operator delete(memory, alignment);
+}
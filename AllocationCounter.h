@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts calls to the global operator new (the replacement lives in AllocationCounter.cpp).
+// RenderWindow takes the difference across a frame to get allocations per frame.
+namespace AllocationCounter
+{
+    uint64_t allocations();
+}
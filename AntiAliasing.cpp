@@ -0,0 +1,38 @@
+#include "AntiAliasing.h"
+
+bool antiAliasingFromName(const QString &name, AntiAliasing &mode)
+{
+    const QString lower = name.toLower();
+    for (AntiAliasing candidate : { AntiAliasing::Off, AntiAliasing::Msaa2, AntiAliasing::Msaa4,
+                                    AntiAliasing::Msaa8, AntiAliasing::Fxaa }) {
+        if (lower == QLatin1String(antiAliasingName(candidate))) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *antiAliasingName(AntiAliasing mode)
+{
+    switch (mode) {
+    case AntiAliasing::Off:   return "off";
+    case AntiAliasing::Msaa2: return "msaa2";
+    case AntiAliasing::Msaa4: return "msaa4";
+    case AntiAliasing::Msaa8: return "msaa8";
+    case AntiAliasing::Fxaa:  return "fxaa";
+    }
+    return "unknown";
+}
+
+int antiAliasingSamples(AntiAliasing mode)
+{
+    switch (mode) {
+    case AntiAliasing::Msaa2: return 2;
+    case AntiAliasing::Msaa4: return 4;
+    case AntiAliasing::Msaa8: return 8;
+    case AntiAliasing::Off:
+    case AntiAliasing::Fxaa:  break;
+    }
+    return 1;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QString>
+
+// How the scene's edges are smoothed, chosen per machine with --aa.
+//
+// MSAA multiplies the color and depth attachments by the sample count, their memory and the
+// bandwidth of every pixel drawn. FXAA finds edges by their contrast in the finished image and
+// blends across them, in the pass that copies the offscreen scene target into the swap chain:
+// one full-screen triangle and the target's memory, whatever the sample count would have been.
+// Temporal accumulation (TemporalAA) goes on top of any of them.
+enum class AntiAliasing {
+    Off,
+    Msaa2,
+    Msaa4,
+    Msaa8,
+    Fxaa
+};
+
+// "off", "msaa2", "msaa4", "msaa8" or "fxaa". False for anything else, mode is left alone then.
+bool antiAliasingFromName(const QString &name, AntiAliasing &mode);
+const char *antiAliasingName(AntiAliasing mode);
+// Samples the mode asks for, 1 without MSAA
+int antiAliasingSamples(AntiAliasing mode);
@@ -0,0 +1,148 @@
+#include "Benchmark.h"
+#include <algorithm>
+
+void FrameBenchmark::start(int frames)
+{
+    mFramesWanted = qMax(frames, 0);
+    mFrames.clear();
+    mFrames.reserve(mFramesWanted);
+}
+
+bool FrameBenchmark::addFrame(const FrameStats &stats)
+{
+    if (!isRunning())
+        return false;
+
+    mFrames.append(stats);
+    return mFrames.size() == mFramesWanted;
+}
+
+// Formats one timing column of the collected frames
+static QString timingLine(const char *name, QVector<double> values)
+{
+    if (values.isEmpty())
+        return QString();
+
+    std::sort(values.begin(), values.end());
+    double sum = 0.0;
+    for (double v : values)
+        sum += v;
+
+    const int p95Index = qMin(int(values.size() * 0.95), int(values.size()) - 1);
+    return QString::asprintf("  %-10s avg %8.3f ms   min %8.3f ms   max %8.3f ms   p95 %8.3f ms\n",
+                             name, sum / values.size(), values.first(), values.last(), values[p95Index]);
+}
+
+double FrameBenchmark::averageRecordMs() const
+{
+    if (mFrames.isEmpty())
+        return 0.0;
+    double sum = 0.0;
+    for (const FrameStats &stats : mFrames)
+        sum += stats.recordMs;
+    return sum / mFrames.size();
+}
+
+QString FrameBenchmark::recordScalingReport(const QVector<int> &threadCounts, const QVector<double> &recordMs)
+{
+    QString text = QStringLiteral("Recording scaling:\n  threads   record avg   speedup\n");
+    const double baseline = recordMs.isEmpty() ? 0.0 : recordMs.first();
+    for (int i = 0; i < qMin(threadCounts.size(), recordMs.size()); ++i) {
+        const double speedup = recordMs[i] > 0.0 ? baseline / recordMs[i] : 0.0;
+        text += QString::asprintf("  %7d   %7.3f ms   %6.2fx\n", threadCounts[i], recordMs[i], speedup);
+    }
+    return text;
+}
+
+QString FrameBenchmark::report() const
+{
+    if (mFrames.isEmpty())
+        return QStringLiteral("Benchmark: no frames recorded\n");
+
+    QVector<double> frame, sim, cull, record, resize;
+    double drawCalls = 0.0;
+    double descriptorBinds = 0.0, pipelineBinds = 0.0, vertexBinds = 0.0, skippedBinds = 0.0;
+    double culled = 0.0;
+    double occluded = 0.0;
+    double graphPasses = 0.0, graphBarriers = 0.0;
+    double renderScale = 0.0;
+    float minRenderScale = 1.0f;
+    for (const FrameStats &stats : mFrames) {
+        frame.append(stats.frameMs);
+        sim.append(stats.simMs);
+        cull.append(stats.cullMs);
+        record.append(stats.recordMs);
+        drawCalls += stats.drawCalls;
+        descriptorBinds += stats.descriptorBinds;
+        pipelineBinds += stats.pipelineBinds;
+        vertexBinds += stats.vertexBinds;
+        skippedBinds += stats.skippedBinds;
+        culled += stats.culled;
+        occluded += stats.occluded;
+        graphPasses += stats.graphPasses;
+        graphBarriers += stats.graphBarriers;
+        renderScale += stats.renderScale;
+        minRenderScale = qMin(minRenderScale, stats.renderScale);
+        if (stats.resizeMs > 0.0)
+            resize.append(stats.resizeMs);
+    }
+
+    const FrameStats &last = mFrames.last();
+    QString text;
+    text += QString::asprintf("Benchmark: %d frames, %u collectibles, %u NPCs, %u houses, %u record threads\n",
+                              int(mFrames.size()), last.collectibles, last.npcs, last.houses, last.recordThreads);
+    text += timingLine("frame", frame);
+    text += timingLine("sim", sim);
+    text += timingLine("cull", cull);
+    text += timingLine("record", record);
+    text += QString::asprintf("  draw calls avg %.1f per frame\n", drawCalls / mFrames.size());
+    text += QString::asprintf("  binds avg %.1f descriptor, %.1f pipeline, %.1f vertex buffer, %.1f skipped per frame\n",
+                              descriptorBinds / mFrames.size(), pipelineBinds / mFrames.size(),
+                              vertexBinds / mFrames.size(), skippedBinds / mFrames.size());
+    text += QString::asprintf("  culled avg %.1f of %u objects per frame, %.1f of them occluded\n",
+                              culled / mFrames.size(), last.cullTested, occluded / mFrames.size());
+    text += QString::asprintf("  render graph avg %.1f passes, %.1f barriers per frame\n",
+                              graphPasses / mFrames.size(), graphBarriers / mFrames.size());
+    // Dynamic resolution, only when it lowered the resolution during the run
+    if (minRenderScale < 1.0f)
+        text += QString::asprintf("  render scale avg %.2f, min %.2f\n", renderScale / mFrames.size(), minRenderScale);
+    // Post-process AA has GPU lines of its own below (upscale, taa), MSAA shows in the scene's
+    // regions - compare with a run with --aa off
+    text += QString::asprintf("  anti-aliasing %s%s, %.1f MB of attachments\n", last.antiAliasing,
+                              last.temporalAA ? " + taa" : "", last.antiAliasingBytes / (1024.0 * 1024.0));
+    // Resize to the next frame submitted, no line unless the window was resized during the run
+    text += timingLine("resize", resize);
+
+    // GPU timings - frames before the first query results came back are skipped
+    QVector<double> gpuFrame;
+    QVector<double> gpuRegions[GPU_REGION_COUNT];
+    double vertexInvocations[GPU_REGION_COUNT] = {};
+    double fragmentInvocations[GPU_REGION_COUNT] = {};
+    for (const FrameStats &stats : mFrames) {
+        if (!stats.gpu.valid)
+            continue;
+        gpuFrame.append(stats.gpu.frameMs);
+        for (int i = 0; i < GPU_REGION_COUNT; ++i) {
+            if (!stats.gpu.regions[i].recorded)
+                continue;
+            gpuRegions[i].append(stats.gpu.regions[i].ms);
+            vertexInvocations[i] += stats.gpu.regions[i].vertexInvocations;
+            fragmentInvocations[i] += stats.gpu.regions[i].fragmentInvocations;
+        }
+    }
+    if (gpuFrame.isEmpty()) {
+        text += QStringLiteral("  gpu        no timestamp results\n");
+        return text;
+    }
+    text += timingLine("gpu frame", gpuFrame);
+    for (int i = 0; i < GPU_REGION_COUNT; ++i) {
+        const int count = gpuRegions[i].size();
+        if (count == 0)
+            continue;
+        QString line = timingLine(GpuProfiler::regionName(GpuRegion(i)), gpuRegions[i]);
+        line.chop(1);
+        line += QString::asprintf("   vs %.0f   fs %.0f\n", vertexInvocations[i] / count, fragmentInvocations[i] / count);
+        text += line;
+    }
+    return text;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QVector>
+#include <QString>
+#include "FrameStats.h"
+
+// Collects FrameStats for a fixed number of frames and summarizes them.
+// Used with the --benchmark-frames command line option.
+class FrameBenchmark
+{
+public:
+    // Starts collecting, 0 frames turns the benchmark off
+    void start(int frames);
+
+    bool isRunning() const { return mFramesWanted > 0 && mFrames.size() < mFramesWanted; }
+
+    // Adds one frame. Returns true when this was the last frame of the run.
+    bool addFrame(const FrameStats &stats);
+
+    // Human readable summary: average, min, max and 95th percentile of each timing
+    QString report() const;
+
+    double averageRecordMs() const;
+
+    // Table of recording time per thread count, from one run per count
+    static QString recordScalingReport(const QVector<int> &threadCounts, const QVector<double> &recordMs);
+
+private:
+    int mFramesWanted = 0;
+    QVector<FrameStats> mFrames;
+};
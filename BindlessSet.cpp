@@ -0,0 +1,208 @@
+#include "BindlessSet.h"
+#include <QVulkanFunctions>
+#include <algorithm>
+#include <cstring>
+#include "DeletionQueue.h"
+#include "Log.h"
+
+
+void BindlessSet::init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions,
+                       const VkDescriptorBufferInfo *camera, const std::vector<Material> &materials,
+                       uint32_t transformCapacity)
+{
+    mWindow = window;
+    mDeviceFunctions = deviceFunctions;
+    VkDevice dev = mWindow->device();
+    const uint32_t frameCount = uint32_t(mWindow->concurrentFrameCount());
+    for (uint32_t frame = 0; frame < frameCount; ++frame)
+        mCamera[frame] = camera[frame];
+
+    VkDescriptorSetLayoutBinding bindings[3] = {
+        { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr },
+        { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr },
+        { 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr }
+    };
+    VkDescriptorSetLayoutCreateInfo layoutInfo;
+    memset(&layoutInfo, 0, sizeof(layoutInfo));
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings = bindings;
+    VkResult err = mDeviceFunctions->vkCreateDescriptorSetLayout(dev, &layoutInfo, nullptr, &mSetLayout);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create bindless descriptor set layout: %d", err);
+
+    VkDescriptorPoolSize poolSizes[2] = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frameCount * 2 }
+    };
+    VkDescriptorPoolCreateInfo poolInfo;
+    memset(&poolInfo, 0, sizeof(poolInfo));
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = frameCount;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    err = mDeviceFunctions->vkCreateDescriptorPool(dev, &poolInfo, nullptr, &mDescriptorPool);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create bindless descriptor pool: %d", err);
+
+    VkDescriptorSetLayout layouts[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
+    VkDescriptorSet sets[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
+    std::fill(layouts, layouts + frameCount, mSetLayout);
+    VkDescriptorSetAllocateInfo allocInfo;
+    memset(&allocInfo, 0, sizeof(allocInfo));
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = mDescriptorPool;
+    allocInfo.descriptorSetCount = frameCount;
+    allocInfo.pSetLayouts = layouts;
+    err = mDeviceFunctions->vkAllocateDescriptorSets(dev, &allocInfo, sets);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to allocate bindless descriptor sets: %d", err);
+    for (uint32_t frame = 0; frame < frameCount; ++frame)
+        mFrames[frame].set = sets[frame];
+
+    mMaterialCount = uint32_t(qMax<size_t>(materials.size(), 1));
+    createBuffer(mMaterials, mMaterialCount * sizeof(Material));
+    memcpy(mMaterials.mapped, materials.data(), materials.size() * sizeof(Material));
+
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        createTransformBuffer(int(frame), qMax(transformCapacity, 1u));
+        writeSet(int(frame));
+    }
+
+    LOG_INFO(Vulkan, "Bindless descriptor sets: {} materials, room for {} transforms", materials.size(),
+             mFrames[0].transformCapacity);
+}
+
+void BindlessSet::release()
+{
+    if (!mWindow)
+        return;
+    VkDevice dev = mWindow->device();
+
+    // Destroying the pool frees its sets
+    if (mDescriptorPool)
+        mDeviceFunctions->vkDestroyDescriptorPool(dev, mDescriptorPool, nullptr);
+    if (mSetLayout)
+        mDeviceFunctions->vkDestroyDescriptorSetLayout(dev, mSetLayout, nullptr);
+    mDescriptorPool = VK_NULL_HANDLE;
+    mSetLayout = VK_NULL_HANDLE;
+
+    destroyBuffer(mMaterials);
+    for (FrameResources &resources : mFrames) {
+        destroyBuffer(resources.transforms);
+        resources.transformCapacity = 0;
+        resources.set = VK_NULL_HANDLE;
+    }
+    mWindow = nullptr;
+}
+
+bool BindlessSet::reserveTransforms(int frame, uint32_t count, DeletionQueue &deletionQueue)
+{
+    FrameResources &resources = mFrames[frame];
+    if (count <= resources.transformCapacity)
+        return false;
+
+    // The frames that used the old buffer may still be in flight, the other slots grow on their turn
+    Buffer &transforms = resources.transforms;
+    mDeviceFunctions->vkUnmapMemory(mWindow->device(), transforms.memory);
+    deletionQueue.destroyBuffer(transforms.buffer);
+    deletionQueue.freeMemory(transforms.memory);
+    transforms = Buffer();
+    createTransformBuffer(frame, qMax(count, resources.transformCapacity * 2));
+    writeSet(frame);
+
+    LOG_INFO(Vulkan, "Bindless transforms of frame slot {} grown to {}", frame, resources.transformCapacity);
+    return true;
+}
+
+void BindlessSet::setTransform(int frame, uint32_t index, const QMatrix4x4 &model)
+{
+    Q_ASSERT(index < mFrames[frame].transformCapacity);
+    float *transforms = static_cast<float *>(mFrames[frame].transforms.mapped);
+    memcpy(transforms + size_t(index) * 16, model.constData(), TRANSFORM_SIZE);
+}
+
+void BindlessSet::createBuffer(Buffer &buffer, VkDeviceSize size)
+{
+    VkDevice dev = mWindow->device();
+
+    VkBufferCreateInfo bufferInfo;
+    memset(&bufferInfo, 0, sizeof(bufferInfo));
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    VkResult err = mDeviceFunctions->vkCreateBuffer(dev, &bufferInfo, nullptr, &buffer.buffer);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create bindless buffer: %d", err);
+
+    VkMemoryRequirements memReq;
+    mDeviceFunctions->vkGetBufferMemoryRequirements(dev, buffer.buffer, &memReq);
+
+    // Host coherent as well, QVulkanWindow picks it that way
+    const uint32_t memoryIndex = mWindow->hostVisibleMemoryIndex();
+    if (!(memReq.memoryTypeBits & (1u << memoryIndex)))
+        qFatal("Bindless buffer can not use memory type %u", memoryIndex);
+
+    VkMemoryAllocateInfo allocInfo;
+    memset(&allocInfo, 0, sizeof(allocInfo));
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReq.size;
+    allocInfo.memoryTypeIndex = memoryIndex;
+    err = mDeviceFunctions->vkAllocateMemory(dev, &allocInfo, nullptr, &buffer.memory);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to allocate bindless buffer memory: %d", err);
+
+    err = mDeviceFunctions->vkBindBufferMemory(dev, buffer.buffer, buffer.memory, 0);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to bind bindless buffer memory: %d", err);
+
+    err = mDeviceFunctions->vkMapMemory(dev, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.mapped);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to map bindless buffer: %d", err);
+}
+
+void BindlessSet::destroyBuffer(Buffer &buffer)
+{
+    VkDevice dev = mWindow->device();
+    if (buffer.mapped)
+        mDeviceFunctions->vkUnmapMemory(dev, buffer.memory);
+    if (buffer.buffer)
+        mDeviceFunctions->vkDestroyBuffer(dev, buffer.buffer, nullptr);
+    if (buffer.memory)
+        mDeviceFunctions->vkFreeMemory(dev, buffer.memory, nullptr);
+    buffer = Buffer();
+}
+
+void BindlessSet::createTransformBuffer(int frame, uint32_t capacity)
+{
+    FrameResources &resources = mFrames[frame];
+    createBuffer(resources.transforms, capacity * TRANSFORM_SIZE);
+    resources.transformCapacity = capacity;
+    // Identity in every row, so an index nobody wrote yet draws at the origin instead of nowhere
+    const QMatrix4x4 identity;
+    for (uint32_t index = 0; index < capacity; ++index)
+        setTransform(frame, index, identity);
+}
+
+void BindlessSet::writeSet(int frame)
+{
+    const FrameResources &resources = mFrames[frame];
+    const VkDescriptorBufferInfo buffers[3] = {
+        mCamera[frame],
+        { resources.transforms.buffer, 0, VK_WHOLE_SIZE },
+        { mMaterials.buffer, 0, VK_WHOLE_SIZE }
+    };
+
+    VkWriteDescriptorSet writes[3];
+    memset(writes, 0, sizeof(writes));
+    for (uint32_t binding = 0; binding < 3; ++binding) {
+        writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[binding].dstSet = resources.set;
+        writes[binding].dstBinding = binding;
+        writes[binding].descriptorCount = 1;
+        writes[binding].descriptorType = binding == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+                                                      : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[binding].pBufferInfo = &buffers[binding];
+    }
+    mDeviceFunctions->vkUpdateDescriptorSets(mWindow->device(), 3, writes, 0, nullptr);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QMatrix4x4>
+#include <QVulkanWindow>
+#include <cstdint>
+#include <vector>
+
+class DeletionQueue;
+
+// The one descriptor set color.vert draws everything with, one per frame slot:
+//
+//   binding 0  uniform buffer, the camera's view-projection matrix
+//   binding 1  storage buffer, model matrices, indexed by the draw's transform
+//   binding 2  storage buffer, materials, indexed by the draw's material
+//
+// A draw only pushes the two indices (DrawIndices), so a command buffer binds the set
+// once and new objects need a row in the buffers instead of descriptor sets of their own.
+// The transforms are written by the CPU into host visible memory of the frame slot being
+// recorded, the materials don't change and all slots share them.
+class BindlessSet
+{
+public:
+    // Same layout as struct Material in color.vert
+    struct Material {
+        float tint[4];      // Multiplies the vertex color
+    };
+    // Push constant of every draw
+    struct DrawIndices {
+        uint32_t transform;
+        uint32_t material;
+    };
+    // Bytes setTransform() writes
+    static constexpr VkDeviceSize TRANSFORM_SIZE = 16 * sizeof(float);
+
+    // camera holds the view-projection uniform of each frame slot
+    void init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions, const VkDescriptorBufferInfo *camera,
+              const std::vector<Material> &materials, uint32_t transformCapacity);
+    void release();
+
+    bool isInitialized() const { return mSetLayout != VK_NULL_HANDLE; }
+    VkDescriptorSetLayout layout() const { return mSetLayout; }
+    VkDescriptorSet set(int frame) const { return mFrames[frame].set; }
+
+    // Makes room for count transforms in the buffer of a frame slot that isn't in flight. When it
+    // has to grow, the old buffer goes to deletionQueue and the slot's set is rewritten, which
+    // invalidates command buffers recorded with it: returns true then.
+    bool reserveTransforms(int frame, uint32_t count, DeletionQueue &deletionQueue);
+    uint32_t transformCapacity(int frame) const { return mFrames[frame].transformCapacity; }
+    // Safe to call from several threads as long as they write different indices
+    void setTransform(int frame, uint32_t index, const QMatrix4x4 &model);
+
+private:
+    struct Buffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void *mapped = nullptr;
+    };
+    struct FrameResources {
+        Buffer transforms;
+        uint32_t transformCapacity = 0;
+        VkDescriptorSet set = VK_NULL_HANDLE;
+    };
+
+    void createBuffer(Buffer &buffer, VkDeviceSize size);
+    void destroyBuffer(Buffer &buffer);
+    void createTransformBuffer(int frame, uint32_t capacity);
+    void writeSet(int frame);
+
+    QVulkanWindow *mWindow = nullptr;
+    QVulkanDeviceFunctions *mDeviceFunctions = nullptr;
+    VkDescriptorBufferInfo mCamera[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT] = {};
+
+    Buffer mMaterials;
+    uint32_t mMaterialCount = 0;
+    FrameResources mFrames[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
+
+    VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+};
@@ -0,0 +1,121 @@
+#include "DeletionQueue.h"
+#include <QVulkanFunctions>
+#include "Log.h"
+
+void DeletionQueue::init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions)
+{
+    mWindow = window;
+    mDeviceFunctions = deviceFunctions;
+    mFrame = 0;
+}
+
+void DeletionQueue::release()
+{
+    if (!mWindow)
+        return;
+    for (const Entry &entry : mEntries)
+        destroy(entry);
+    mEntries.clear();
+    mWindow = nullptr;
+}
+
+void DeletionQueue::beginFrame()
+{
+    mFrame++;
+    // Frames up to this one are done: the fence of its frame slot has been waited for
+    const uint64_t frameCount = uint64_t(mWindow->concurrentFrameCount());
+    if (mFrame < frameCount)
+        return;
+    const uint64_t retiredFrame = mFrame - frameCount;
+
+    size_t destroyed = 0;
+    while (!mEntries.empty() && mEntries.front().frame <= retiredFrame) {
+        destroy(mEntries.front());
+        mEntries.pop_front();
+        destroyed++;
+    }
+    if (destroyed > 0)
+        LOG_DEBUG(Vulkan, "Deletion queue: destroyed {} objects retired in frame {} or before, {} waiting",
+                  destroyed, retiredFrame, mEntries.size());
+}
+
+void DeletionQueue::destroyBuffer(VkBuffer buffer)
+{
+    Entry entry;
+    entry.buffer = buffer;
+    if (buffer)
+        push(entry, Type::Buffer);
+}
+
+void DeletionQueue::freeMemory(VkDeviceMemory memory)
+{
+    Entry entry;
+    entry.memory = memory;
+    if (memory)
+        push(entry, Type::Memory);
+}
+
+void DeletionQueue::destroyImage(VkImage image)
+{
+    Entry entry;
+    entry.image = image;
+    if (image)
+        push(entry, Type::Image);
+}
+
+void DeletionQueue::destroyImageView(VkImageView view)
+{
+    Entry entry;
+    entry.view = view;
+    if (view)
+        push(entry, Type::ImageView);
+}
+
+void DeletionQueue::destroyFramebuffer(VkFramebuffer framebuffer)
+{
+    Entry entry;
+    entry.framebuffer = framebuffer;
+    if (framebuffer)
+        push(entry, Type::Framebuffer);
+}
+
+void DeletionQueue::destroyCommandPool(VkCommandPool pool)
+{
+    Entry entry;
+    entry.commandPool = pool;
+    if (pool)
+        push(entry, Type::CommandPool);
+}
+
+void DeletionQueue::push(Entry &entry, Type type)
+{
+    entry.frame = mFrame;
+    entry.type = type;
+    mEntries.push_back(entry);
+}
+
+void DeletionQueue::destroy(const Entry &entry)
+{
+    VkDevice dev = mWindow->device();
+    switch (entry.type) {
+    case Type::Buffer:
+        mDeviceFunctions->vkDestroyBuffer(dev, entry.buffer, nullptr);
+        break;
+    case Type::Memory:
+        mDeviceFunctions->vkFreeMemory(dev, entry.memory, nullptr);
+        break;
+    case Type::Image:
+        mDeviceFunctions->vkDestroyImage(dev, entry.image, nullptr);
+        break;
+    case Type::ImageView:
+        mDeviceFunctions->vkDestroyImageView(dev, entry.view, nullptr);
+        break;
+    case Type::Framebuffer:
+        mDeviceFunctions->vkDestroyFramebuffer(dev, entry.framebuffer, nullptr);
+        break;
+    case Type::CommandPool:
+        // Frees its command buffers with it
+        mDeviceFunctions->vkDestroyCommandPool(dev, entry.commandPool, nullptr);
+        break;
+    }
+}
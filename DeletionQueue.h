@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QVulkanWindow>
+#include <cstdint>
+#include <deque>
+
+// Vulkan objects that are no longer needed but may still be in use by frames in flight.
+//
+// Each object is stamped with the frame it was retired in. That frame, and the ones before,
+// may have recorded commands using it. beginFrame() destroys it once QVulkanWindow has waited
+// for that frame's fence, concurrentFrameCount() frames later. So objects can be replaced while
+// rendering without vkDeviceWaitIdle. Other queues are not tracked: what the streaming uploader
+// still copies into must not be retired.
+//
+// Render thread only.
+class DeletionQueue
+{
+public:
+    ~DeletionQueue() { release(); }
+
+    void init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions);
+    // Destroys everything still queued, the device has to be idle
+    void release();
+
+    // Start of a frame, once QVulkanWindow has waited for the frame slot's fence
+    void beginFrame();
+    uint64_t frame() const { return mFrame; }
+
+    // Retired in the current frame. Null handles are ignored.
+    void destroyBuffer(VkBuffer buffer);
+    void freeMemory(VkDeviceMemory memory);
+    void destroyImage(VkImage image);
+    void destroyImageView(VkImageView view);
+    void destroyFramebuffer(VkFramebuffer framebuffer);
+    void destroyCommandPool(VkCommandPool pool);
+
+    size_t size() const { return mEntries.size(); }
+
+private:
+    enum class Type : uint8_t {
+        Buffer,
+        Memory,
+        Image,
+        ImageView,
+        Framebuffer,
+        CommandPool,
+    };
+    struct Entry {
+        uint64_t frame;
+        Type type;
+        union {
+            VkBuffer buffer;
+            VkDeviceMemory memory;
+            VkImage image;
+            VkImageView view;
+            VkFramebuffer framebuffer;
+            VkCommandPool commandPool;
+        };
+    };
+
+    void push(Entry &entry, Type type);
+    void destroy(const Entry &entry);
+
+    QVulkanWindow *mWindow = nullptr;
+    QVulkanDeviceFunctions *mDeviceFunctions = nullptr;
+    uint64_t mFrame = 0;
+    std::deque<Entry> mEntries;     // Oldest first, so the destroyable ones are at the front
+};
@@ -0,0 +1,137 @@
+#include "FrameScheduler.h"
+#include <QGuiApplication>
+#include <QWindow>
+#include <QEvent>
+#include <algorithm>
+
+FrameScheduler::FrameScheduler(QWindow *window)
+    : QObject(window), mWindow(window)
+{
+    mThrottleTimer.setSingleShot(true);
+    connect(&mThrottleTimer, &QTimer::timeout, this, &FrameScheduler::requestFrame);
+
+    // Going to the background or coming back changes the frame rate
+    connect(qGuiApp, &QGuiApplication::applicationStateChanged, this, [this]() { markDirty(Focus); });
+
+    // Expose and resize arrive as events on the window
+    mWindow->installEventFilter(this);
+    mClock.start();
+}
+
+void FrameScheduler::setContinuous(bool continuous)
+{
+    mContinuous = continuous;
+    if (continuous)
+        requestFrame();
+}
+
+void FrameScheduler::markDirty(uint32_t flags)
+{
+    mDirtyFlags |= flags;
+    requestFrame();
+}
+
+int FrameScheduler::beginFrame()
+{
+    mFramePending = false;
+    mThrottleTimer.stop();
+    mLastDirtyFlags = mDirtyFlags;
+    mDirtyFlags = 0;
+    mFramesRendered++;
+
+    const qint64 nowNs = mClock.nsecsElapsed();
+    const double elapsedMs = (nowNs - mLastFrameNs) / 1.0e6;
+    mLastFrameNs = nowNs;
+
+    // The simulation only advances while it was running - a scene that was idle
+    // (or paused in the background) continues where it stopped
+    if (!mAnimating) {
+        mSimulationAccumulatorMs = 0.0;
+        return 0;
+    }
+
+    mSimulationAccumulatorMs += elapsedMs;
+    int steps = int(mSimulationAccumulatorMs / SIMULATION_STEP_MS);
+    mSimulationAccumulatorMs -= steps * SIMULATION_STEP_MS;
+    if (steps > MAX_SIMULATION_STEPS) {
+        steps = MAX_SIMULATION_STEPS;
+        mSimulationAccumulatorMs = 0.0;
+    }
+    return steps;
+}
+
+void FrameScheduler::endFrame(bool animating)
+{
+    // Starting to animate: measure the first step from now, not from an idle frame long ago
+    if (animating && !mAnimating)
+        mLastFrameNs = mClock.nsecsElapsed();
+    mAnimating = animating;
+
+    // Hidden or minimized - nothing until the expose event
+    if (!mWindow->isExposed())
+        return;
+
+    // Changed during this frame (door opened, item collected, ...) or always on
+    if (mDirtyFlags != 0 || mContinuous) {
+        requestFrame();
+        return;
+    }
+
+    if (mAnimating) {
+        if (isForeground())
+            requestFrame();             // Full rate, paced by the swap chain
+        else
+            scheduleAt(mUnfocusedFps);
+        return;
+    }
+
+    // Nothing moves and nothing changed - the last presented image is still correct
+    scheduleAt(mIdleFps);
+}
+
+bool FrameScheduler::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == mWindow) {
+        switch (event->type()) {
+        case QEvent::Expose:
+            // A request made just before the window was hidden may never have turned into a frame
+            mFramePending = false;
+            if (mWindow->isExposed())
+                markDirty(Expose);
+            break;
+        case QEvent::Resize:
+            markDirty(Resize);
+            break;
+        case QEvent::FocusIn:
+        case QEvent::FocusOut:
+            markDirty(Focus);
+            break;
+        default:
+            break;
+        }
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void FrameScheduler::requestFrame()
+{
+    // requestUpdate() coalesces on its own, this only saves the calls
+    if (mFramePending || !mWindow->isExposed())
+        return;
+    mFramePending = true;
+    mThrottleTimer.stop();
+    mWindow->requestUpdate();
+}
+
+void FrameScheduler::scheduleAt(int fps)
+{
+    if (fps <= 0)
+        return;
+    if (!mThrottleTimer.isActive())
+        mThrottleTimer.start(std::max(1, 1000 / fps));
+}
+
+bool FrameScheduler::isForeground() const
+{
+    return QGuiApplication::applicationState() == Qt::ApplicationActive;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <cstdint>
+
+QT_FORWARD_DECLARE_CLASS(QWindow)
+
+// Decides when the next frame is rendered, instead of always calling requestUpdate().
+//
+// Frames are requested when something changed (markDirty) or while the simulation
+// is animating. With nothing to do no frame is recorded or presented at all, apart
+// from an optional low idle rate that keeps the Performance tab alive.
+// While the application is in the background an animating scene drops to a low rate,
+// and while the window is hidden nothing is rendered until it is exposed again.
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Why a frame is needed - only used for statistics and debug output
+    enum DirtyFlag : uint32_t {
+        Input      = 1 << 0,
+        Simulation = 1 << 1,
+        Resize     = 1 << 2,
+        Scene      = 1 << 3,
+        Expose     = 1 << 4,
+        Focus      = 1 << 5,
+        Converge   = 1 << 6     // Nothing changed, temporal AA is still blending the image at rest
+    };
+
+    // Fixed simulation step - NPC movement is tuned per 60 Hz step
+    static constexpr double SIMULATION_STEP_MS = 1000.0 / 60.0;
+    // At most this many steps are caught up after a long frame
+    static constexpr int MAX_SIMULATION_STEPS = 8;
+
+    explicit FrameScheduler(QWindow *window);
+
+    // Frames per second while nothing changes (0 = no frames at all)
+    void setIdleFps(int fps) { mIdleFps = fps; }
+    int idleFps() const { return mIdleFps; }
+    // Frames per second for an animating scene while the application is not active (0 = pause)
+    void setUnfocusedFps(int fps) { mUnfocusedFps = fps; }
+    int unfocusedFps() const { return mUnfocusedFps; }
+    // Render every frame no matter what, used by the benchmark
+    void setContinuous(bool continuous);
+
+    // Something visible changed - render a frame soon
+    void markDirty(uint32_t flags);
+
+    // Renderer calls this at the start of a frame. Returns how many fixed simulation
+    // steps have passed since the previous frame (0 if the scene wasn't animating).
+    int beginFrame();
+    // Renderer calls this at the end of a frame and tells if the simulation is still moving
+    void endFrame(bool animating);
+
+    // Frames rendered since start, and the reasons for the latest one
+    uint64_t framesRendered() const { return mFramesRendered; }
+    uint32_t lastDirtyFlags() const { return mLastDirtyFlags; }
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    void requestFrame();
+    void scheduleAt(int fps);
+    bool isForeground() const;
+
+    QWindow *mWindow;
+    QTimer mThrottleTimer;          // Single shot, used for the idle and unfocused rates
+    QElapsedTimer mClock;
+
+    int mIdleFps = 2;
+    int mUnfocusedFps = 10;
+    bool mContinuous = false;
+
+    bool mFramePending = false;     // requestUpdate() was called and the frame hasn't started yet
+    bool mAnimating = false;        // Last frame said the simulation keeps moving
+    uint32_t mDirtyFlags = 0;       // Collected since the last frame started
+    uint32_t mLastDirtyFlags = 0;   // What the current/last frame was rendered for
+
+    double mSimulationAccumulatorMs = 0.0;
+    qint64 mLastFrameNs = 0;
+    uint64_t mFramesRendered = 0;
+};
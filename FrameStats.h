@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include "GpuProfiler.h"
+
+// Numbers RenderWindow collects for one frame.
+// Times are CPU milliseconds measured inside startNextFrame().
+struct FrameStats
+{
+    uint64_t frameIndex = 0;
+
+    double frameMs = 0.0;       // Whole startNextFrame()
+    double simMs = 0.0;         // Game logic: NPCs, collisions, door and scene checks
+    double cullMs = 0.0;        // Visibility culling (0 while nothing is culled)
+    double recordMs = 0.0;      // Command buffer recording
+    uint32_t recordThreads = 1; // Threads that recorded this frame
+    float renderScale = 1.0f;   // Scene resolution relative to the swap chain, below 1 with dynamic resolution
+    const char *antiAliasing = "off";   // Mode, see AntiAliasing.h
+    bool temporalAA = false;
+    uint64_t antiAliasingBytes = 0;     // Attachment memory the anti-aliasing adds, estimated from the formats
+
+    uint32_t drawCalls = 0;
+    uint32_t descriptorBinds = 0;   // vkCmdBindDescriptorSets calls
+    uint32_t pipelineBinds = 0;     // Pipeline switches between the moving objects
+    uint32_t vertexBinds = 0;       // Vertex and index buffer binds of the render queues
+    uint32_t skippedBinds = 0;      // Vertex buffer binds the render queues left out, the mesh was bound already
+    uint32_t cullTested = 0;        // Objects tested against the camera frustum
+    uint32_t culled = 0;            // ... of which were outside and not drawn
+    uint32_t occluded = 0;          // ... of the culled ones, hidden behind houses
+    uint32_t graphPasses = 0;       // Render graph passes recorded, the culled ones not counted
+    uint32_t graphBarriers = 0;     // Pipeline barriers the render graph placed between them
+    uint64_t uniformBytes = 0;      // Bytes of the camera uniform and the transform rows written this frame
+    uint64_t uploadBytes = 0;       // Streaming uploads that became usable this frame
+    double resizeMs = 0.0;          // Swap chain released for a resize to this frame submitted, 0 unless it is the first after one
+    uint64_t allocations = 0;       // Heap allocations (operator new) during the frame
+    uint64_t vramBytes = 0;         // Device-local memory in use, 0 if the driver can't tell
+
+    // GPU side, from the profiler. These are the newest results available,
+    // which belong to the frame that used this frame slot last time
+    GpuFrameTimings gpu;
+
+    // Live entity counts
+    uint32_t collectibles = 0;  // Not yet collected, outdoor + indoor
+    uint32_t npcs = 0;
+    uint32_t houses = 0;
+};
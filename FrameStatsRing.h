@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "FrameStats.h"
+
+// Lock-free ring of the most recent FrameStats.
+// One writer (RenderWindow, once per frame) and any number of readers (the
+// Performance tab). Each slot has a sequence number that is odd while the slot
+// is being written, so a reader can tell when it raced with the writer and
+// simply skips that frame instead of waiting.
+class FrameStatsRing
+{
+public:
+    static constexpr int CAPACITY = 512;   // Power of two
+
+    void push(const FrameStats &stats)
+    {
+        const uint64_t index = mWriteIndex.load(std::memory_order_relaxed);
+        Slot &slot = mSlots[index & (CAPACITY - 1)];
+
+        const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);   // Odd: being written
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.stats = stats;
+        slot.sequence.store(sequence + 2, std::memory_order_release);   // Even: done
+
+        mWriteIndex.store(index + 1, std::memory_order_release);
+    }
+
+    // Copies up to maxCount of the newest frames into out, oldest first.
+    // Returns how many frames were copied.
+    int readLatest(FrameStats *out, int maxCount) const
+    {
+        const uint64_t end = mWriteIndex.load(std::memory_order_acquire);
+        const uint64_t available = end < uint64_t(CAPACITY - 1) ? end : uint64_t(CAPACITY - 1);
+        const uint64_t wanted = available < uint64_t(maxCount) ? available : uint64_t(maxCount);
+
+        int copied = 0;
+        for (uint64_t index = end - wanted; index < end; ++index) {
+            const Slot &slot = mSlots[index & (CAPACITY - 1)];
+            const uint32_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before & 1)
+                continue;
+            out[copied] = slot.stats;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != before)
+                continue;   // Overwritten while copying
+            ++copied;
+        }
+        return copied;
+    }
+
+    // Total number of frames pushed so far
+    uint64_t framesWritten() const { return mWriteIndex.load(std::memory_order_acquire); }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence{ 0 };
+        FrameStats stats;
+    };
+
+    Slot mSlots[CAPACITY];
+    std::atomic<uint64_t> mWriteIndex{ 0 };
+};
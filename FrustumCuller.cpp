@@ -0,0 +1,182 @@
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE 1
+#endif
+
+// Radius of the padding spheres: d >= -radius fails for every plane
+static const float NEVER_VISIBLE_RADIUS = -1.0e30f;
+
+MeshBounds MeshBounds::fromBox(const QVector3D &min, const QVector3D &max)
+{
+    MeshBounds bounds;
+    bounds.min = min;
+    bounds.max = max;
+    bounds.center = (min + max) * 0.5f;
+    bounds.radius = (max - min).length() * 0.5f;
+    return bounds;
+}
+
+MeshBounds MeshBounds::fromVertices(const float *vertices, size_t vertexCount, size_t strideFloats)
+{
+    if (vertexCount == 0)
+        return MeshBounds();
+
+    QVector3D min(vertices[0], vertices[1], vertices[2]);
+    QVector3D max = min;
+    for (size_t i = 1; i < vertexCount; ++i) {
+        const float *position = vertices + i * strideFloats;
+        for (int axis = 0; axis < 3; ++axis) {
+            min[axis] = std::min(min[axis], position[axis]);
+            max[axis] = std::max(max[axis], position[axis]);
+        }
+    }
+
+    // The box center isn't always the best sphere center, but it is close enough
+    // for these meshes - the radius is still the exact distance to the farthest vertex
+    MeshBounds bounds = fromBox(min, max);
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float *position = vertices + i * strideFloats;
+        radiusSquared = std::max(radiusSquared, (QVector3D(position[0], position[1], position[2]) - bounds.center).lengthSquared());
+    }
+    bounds.radius = std::sqrt(radiusSquared);
+    return bounds;
+}
+
+MeshBounds MeshBounds::united(const MeshBounds &other) const
+{
+    const QVector3D unitedMin(std::min(min.x(), other.min.x()), std::min(min.y(), other.min.y()),
+                              std::min(min.z(), other.min.z()));
+    const QVector3D unitedMax(std::max(max.x(), other.max.x()), std::max(max.y(), other.max.y()),
+                              std::max(max.z(), other.max.z()));
+    MeshBounds bounds = fromBox(unitedMin, unitedMax);
+    // Both spheres have to fit into the new one
+    bounds.radius = std::max((center - bounds.center).length() + radius,
+                             (other.center - bounds.center).length() + other.radius);
+    return bounds;
+}
+
+Frustum Frustum::fromViewProjection(const QMatrix4x4 &m)
+{
+    // Clip space position = m * v, a point is inside when -w <= x, y, z <= w.
+    // Each plane is the fourth row plus or minus one of the others.
+    Frustum frustum;
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int column = 0; column < 4; ++column) {
+            frustum.planes[axis * 2][column] = m(3, column) + m(axis, column);        // Left, bottom, near
+            frustum.planes[axis * 2 + 1][column] = m(3, column) - m(axis, column);    // Right, top, far
+        }
+    }
+
+    // Normalized planes give real distances, so the sphere radius can be compared to them
+    for (float *plane : frustum.planes) {
+        const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (length > 0.0f) {
+            for (int i = 0; i < 4; ++i)
+                plane[i] /= length;
+        }
+    }
+    return frustum;
+}
+
+bool Frustum::intersectsSphere(const QVector3D &center, float radius) const
+{
+    for (const float *plane : planes) {
+        if (plane[0] * center.x() + plane[1] * center.y() + plane[2] * center.z() + plane[3] < -radius)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersectsBox(const QVector3D &min, const QVector3D &max) const
+{
+    // Only the corner farthest along the plane normal has to be tested
+    for (const float *plane : planes) {
+        const float x = plane[0] >= 0.0f ? max.x() : min.x();
+        const float y = plane[1] >= 0.0f ? max.y() : min.y();
+        const float z = plane[2] >= 0.0f ? max.z() : min.z();
+        if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+void SphereBounds::resize(size_t count)
+{
+    mCount = count;
+    const size_t padded = (count + 3) & ~size_t(3);
+    mX.resize(padded);
+    mY.resize(padded);
+    mZ.resize(padded);
+    mRadius.resize(padded);
+    for (size_t i = count; i < padded; ++i) {
+        mX[i] = mY[i] = mZ[i] = 0.0f;
+        mRadius[i] = NEVER_VISIBLE_RADIUS;
+    }
+}
+
+size_t FrustumCuller::cull(const Frustum &frustum, const SphereBounds &bounds, std::vector<uint32_t> &visible)
+{
+    const size_t padded = bounds.paddedSize();
+    // Every index is written, the count only moves on for visible ones - no branches per sphere.
+    // Shrinking doesn't free anything, so after the first frame this never allocates.
+    if (visible.size() < padded)
+        visible.resize(padded);
+    uint32_t *out = visible.data();
+    size_t count = 0;
+
+    const float *xs = bounds.x();
+    const float *ys = bounds.y();
+    const float *zs = bounds.z();
+    const float *radii = bounds.radius();
+
+#ifdef FRUSTUM_CULLER_SSE
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int p = 0; p < 6; ++p) {
+        planeX[p] = _mm_set1_ps(frustum.planes[p][0]);
+        planeY[p] = _mm_set1_ps(frustum.planes[p][1]);
+        planeZ[p] = _mm_set1_ps(frustum.planes[p][2]);
+        planeW[p] = _mm_set1_ps(frustum.planes[p][3]);
+    }
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    for (size_t i = 0; i < padded; i += 4) {
+        const __m128 x = _mm_loadu_ps(xs + i);
+        const __m128 y = _mm_loadu_ps(ys + i);
+        const __m128 z = _mm_loadu_ps(zs + i);
+        const __m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(radii + i), signMask);
+
+        // A lane is outside as soon as one plane has it further out than its radius
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p) {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(planeX[p], x), planeW[p]);
+            distance = _mm_add_ps(distance, _mm_mul_ps(planeY[p], y));
+            distance = _mm_add_ps(distance, _mm_mul_ps(planeZ[p], z));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+        }
+        const int insideMask = ~_mm_movemask_ps(outside);
+
+        const uint32_t base = uint32_t(i);
+        out[count] = base;
+        count += insideMask & 1;
+        out[count] = base + 1;
+        count += (insideMask >> 1) & 1;
+        out[count] = base + 2;
+        count += (insideMask >> 2) & 1;
+        out[count] = base + 3;
+        count += (insideMask >> 3) & 1;
+    }
+#else
+    for (size_t i = 0; i < padded; ++i) {
+        out[count] = uint32_t(i);
+        count += frustum.intersectsSphere(QVector3D(xs[i], ys[i], zs[i]), radii[i]) ? 1 : 0;
+    }
+#endif
+
+    visible.resize(count);
+    return count;
+}
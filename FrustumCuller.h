@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bounds of a mesh in its own model space: axis aligned box and the sphere around it
+struct MeshBounds
+{
+    QVector3D min;
+    QVector3D max;
+    QVector3D center;       // Sphere center, the middle of the box
+    float radius = 0.0f;
+
+    static MeshBounds fromBox(const QVector3D &min, const QVector3D &max);
+    // Interleaved vertex data with the position in the first three floats of each vertex
+    static MeshBounds fromVertices(const float *vertices, size_t vertexCount, size_t strideFloats);
+    // Bounds around both meshes, for objects drawn from several buffers (house walls and roof)
+    MeshBounds united(const MeshBounds &other) const;
+};
+
+// The six planes of a view-projection matrix, normalized, inside is a*x + b*y + c*z + d >= 0
+struct Frustum
+{
+    float planes[6][4] = {};
+
+    // Gribb/Hartmann plane extraction. Uses the OpenGL depth range the projection is built
+    // with, which is a little larger than what Vulkan clips - never culls anything visible.
+    static Frustum fromViewProjection(const QMatrix4x4 &viewProjection);
+
+    bool intersectsSphere(const QVector3D &center, float radius) const;
+    bool intersectsBox(const QVector3D &min, const QVector3D &max) const;
+};
+
+// World space bounding spheres of many instances as a structure of arrays,
+// so the culler tests four of them with each SSE instruction.
+// The arrays are padded to a multiple of four with spheres that are never visible.
+class SphereBounds
+{
+public:
+    void resize(size_t count);
+    size_t size() const { return mCount; }
+
+    void set(size_t index, const QVector3D &center, float radius)
+    {
+        mX[index] = center.x();
+        mY[index] = center.y();
+        mZ[index] = center.z();
+        mRadius[index] = radius;
+    }
+    void setCenter(size_t index, const QVector3D &center)
+    {
+        mX[index] = center.x();
+        mY[index] = center.y();
+        mZ[index] = center.z();
+    }
+
+    const float *x() const { return mX.data(); }
+    const float *y() const { return mY.data(); }
+    const float *z() const { return mZ.data(); }
+    const float *radius() const { return mRadius.data(); }
+    size_t paddedSize() const { return mX.size(); }
+
+private:
+    size_t mCount = 0;
+    std::vector<float> mX;
+    std::vector<float> mY;
+    std::vector<float> mZ;
+    std::vector<float> mRadius;
+};
+
+namespace FrustumCuller {
+
+// Writes the indices of all spheres inside or touching the frustum to visible, in
+// ascending order, and returns how many there are. visible keeps its capacity between calls.
+size_t cull(const Frustum &frustum, const SphereBounds &bounds, std::vector<uint32_t> &visible);
+
+} // namespace FrustumCuller
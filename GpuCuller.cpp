@@ -0,0 +1,532 @@
+#include "GpuCuller.h"
+#include <QVulkanFunctions>
+#include <QFile>
+#include <algorithm>
+#include <cstring>
+#include "Log.h"
+
+// Push constants of cull.comp
+struct CullConstants {
+    float planes[6][4];
+    uint32_t instanceCount;
+    uint32_t commandCount;
+    uint32_t mode;          // 0 = cull and count, 1 = place and compact the draw commands, 2 = place the instances
+    uint32_t occlusion;
+    float lod[4];           // Eye position and lodScale
+};
+
+uint32_t GpuCuller::addMesh(const PackedMesh &packed, const MeshBounds &bounds)
+{
+    Q_ASSERT(mMeshes.size() < MAX_MESHES);
+
+    MeshInfo mesh;
+    memset(&mesh, 0, sizeof(mesh));
+    mesh.sphere[0] = bounds.center.x();
+    mesh.sphere[1] = bounds.center.y();
+    mesh.sphere[2] = bounds.center.z();
+    mesh.sphere[3] = bounds.radius;
+    mesh.firstCommand = uint32_t(mCommandTemplate.size());
+    mesh.levelCount = uint32_t(std::min<size_t>(packed.levels.size(), MAX_LEVELS));
+
+    const uint32_t firstIndex = uint32_t(mIndices.size());
+    for (uint32_t level = 0; level < mesh.levelCount; ++level) {
+        VkDrawIndexedIndirectCommand command;
+        command.indexCount = packed.levels[level].indexCount;
+        command.instanceCount = 0;
+        command.firstIndex = firstIndex + packed.levels[level].firstIndex;
+        command.vertexOffset = int32_t(mVertices.size());
+        command.firstInstance = 0;      // The cull places the command's range every frame
+        mCommandTemplate.push_back(command);
+        mesh.errors[level] = packed.levels[level].error;
+    }
+    mMeshes.push_back(mesh);
+
+    mVertices.insert(mVertices.end(), packed.vertices.begin(), packed.vertices.end());
+    mIndices.insert(mIndices.end(), packed.indices.begin(), packed.indices.end());
+    return uint32_t(mMeshes.size() - 1);
+}
+
+void GpuCuller::init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions,
+                     const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache,
+                     const VkDescriptorBufferInfo *viewProjection, const VkDescriptorImageInfo &depthPyramid)
+{
+    mWindow = window;
+    mDeviceFunctions = deviceFunctions;
+    if (mCommandTemplate.empty())
+        return;
+
+    // Several commands in one call need multiDrawIndirect, otherwise each command gets its own call
+    QVulkanInstance *inst = mWindow->vulkanInstance();
+    VkPhysicalDeviceFeatures features;
+    inst->functions()->vkGetPhysicalDeviceFeatures(mWindow->physicalDevice(), &features);
+    mMultiDrawIndirect = features.multiDrawIndirect == VK_TRUE;
+
+    // The count variant comes from VK_KHR_draw_indirect_count, requested by VulkanWindow
+    mDrawIndexedIndirectCount = nullptr;
+    if (mMultiDrawIndirect
+            && mWindow->supportedDeviceExtensions().contains(QByteArrayLiteral("VK_KHR_draw_indirect_count"))) {
+        auto getDeviceProcAddr = reinterpret_cast<PFN_vkGetDeviceProcAddr>(inst->getInstanceProcAddr("vkGetDeviceProcAddr"));
+        if (getDeviceProcAddr) {
+            mDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+                        getDeviceProcAddr(mWindow->device(), "vkCmdDrawIndexedIndirectCountKHR"));
+        }
+    }
+
+    // The commands' ranges of the visible list are placed by the cull every frame
+    mInstanceCapacity = uint32_t(std::max<size_t>(mInstances.size(), 1));
+
+    createBuffer(mVertexBuffer, mVertices.size() * sizeof(PackedVertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, true);
+    memcpy(mVertexBuffer.mapped, mVertices.data(), mVertices.size() * sizeof(PackedVertex));
+    createBuffer(mIndexBuffer, mIndices.size() * sizeof(uint16_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, true);
+    memcpy(mIndexBuffer.mapped, mIndices.data(), mIndices.size() * sizeof(uint16_t));
+    createBuffer(mMeshBuffer, mMeshes.size() * sizeof(MeshInfo), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true);
+    memcpy(mMeshBuffer.mapped, mMeshes.data(), mMeshes.size() * sizeof(MeshInfo));
+
+    const VkDeviceSize commandBytes = mCommandTemplate.size() * sizeof(VkDrawIndexedIndirectCommand);
+    for (int frame = 0; frame < mWindow->concurrentFrameCount(); ++frame) {
+        FrameResources &resources = mFrames[frame];
+        createBuffer(resources.instances, VkDeviceSize(mInstanceCapacity) * sizeof(Instance),
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true);
+        // Host visible so the counts can be read back for the statistics
+        createBuffer(resources.commands, commandBytes,
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+                     | VK_BUFFER_USAGE_TRANSFER_DST_BIT, true);
+        memset(resources.commands.mapped, 0, size_t(commandBytes));
+        createBuffer(resources.drawCommands, commandBytes,
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, false);
+        createBuffer(resources.drawCount, 3 * sizeof(uint32_t),
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+                     | VK_BUFFER_USAGE_TRANSFER_DST_BIT, true);
+        memset(resources.drawCount.mapped, 0, 3 * sizeof(uint32_t));
+        createBuffer(resources.visible, VkDeviceSize(mInstanceCapacity) * sizeof(uint32_t),
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false);
+        createBuffer(resources.instanceCommands, VkDeviceSize(mInstanceCapacity) * sizeof(uint32_t),
+                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false);
+    }
+    for (std::vector<DirtyRange> &ranges : mDirty) {
+        ranges.clear();
+        ranges.reserve(MAX_DIRTY_RANGES + 1);
+    }
+    markInstancesDirty();
+
+    createPipelines(pipelineTemplate, pipelineCache);
+    createDescriptorSets(viewProjection, depthPyramid);
+
+    LOG_INFO(Render, "GPU culling: {} meshes, {} draw commands, {} instances, draw count {}, multi draw {}",
+             mMeshes.size(), mCommandTemplate.size(), mInstances.size(), hasDrawCount(), mMultiDrawIndirect);
+}
+
+void GpuCuller::release()
+{
+    if (!mWindow)
+        return;
+    VkDevice dev = mWindow->device();
+
+    if (mComputePipeline)
+        mDeviceFunctions->vkDestroyPipeline(dev, mComputePipeline, nullptr);
+    mDrawPipelines.release();
+    if (mComputeLayout)
+        mDeviceFunctions->vkDestroyPipelineLayout(dev, mComputeLayout, nullptr);
+    if (mDrawLayout)
+        mDeviceFunctions->vkDestroyPipelineLayout(dev, mDrawLayout, nullptr);
+    // Destroying the pool frees its sets
+    if (mDescriptorPool)
+        mDeviceFunctions->vkDestroyDescriptorPool(dev, mDescriptorPool, nullptr);
+    if (mComputeSetLayout)
+        mDeviceFunctions->vkDestroyDescriptorSetLayout(dev, mComputeSetLayout, nullptr);
+    if (mDrawSetLayout)
+        mDeviceFunctions->vkDestroyDescriptorSetLayout(dev, mDrawSetLayout, nullptr);
+    mComputePipeline = VK_NULL_HANDLE;
+    mComputeLayout = mDrawLayout = VK_NULL_HANDLE;
+    mDescriptorPool = VK_NULL_HANDLE;
+    mComputeSetLayout = mDrawSetLayout = VK_NULL_HANDLE;
+
+    destroyBuffer(mVertexBuffer);
+    destroyBuffer(mIndexBuffer);
+    destroyBuffer(mMeshBuffer);
+    for (FrameResources &resources : mFrames) {
+        destroyBuffer(resources.instances);
+        destroyBuffer(resources.commands);
+        destroyBuffer(resources.drawCommands);
+        destroyBuffer(resources.drawCount);
+        destroyBuffer(resources.visible);
+        destroyBuffer(resources.instanceCommands);
+        resources.computeSet = resources.drawSet = VK_NULL_HANDLE;
+    }
+    mWindow = nullptr;
+}
+
+void GpuCuller::markInstancesDirty(size_t first, size_t count)
+{
+    const size_t end = first + std::min(count, mInstances.size() - std::min(first, mInstances.size()));
+    if (first >= end)
+        return;
+
+    for (std::vector<DirtyRange> &ranges : mDirty) {
+        // Merged with every range it overlaps or touches
+        DirtyRange merged = { first, end };
+        for (size_t i = 0; i < ranges.size();) {
+            if (ranges[i].first <= merged.end && merged.first <= ranges[i].end) {
+                merged.first = std::min(merged.first, ranges[i].first);
+                merged.end = std::max(merged.end, ranges[i].end);
+                ranges[i] = ranges.back();
+                ranges.pop_back();
+            } else {
+                ++i;
+            }
+        }
+        ranges.push_back(merged);
+        if (ranges.size() > MAX_DIRTY_RANGES) {
+            for (const DirtyRange &range : ranges) {
+                merged.first = std::min(merged.first, range.first);
+                merged.end = std::max(merged.end, range.end);
+            }
+            ranges.assign(1, merged);
+        }
+    }
+}
+
+void GpuCuller::recordCull(VkCommandBuffer cb, const Frustum &frustum, bool occlusion, const QVector3D &eye,
+                           float lodScale)
+{
+    if (!isInitialized())
+        return;
+    const int frame = mWindow->currentFrame();
+    FrameResources &resources = mFrames[frame];
+
+    // The last use of this slot has finished (QVulkanWindow waited for its fence), so its counts are final
+    const VkDrawIndexedIndirectCommand *counted = static_cast<const VkDrawIndexedIndirectCommand *>(resources.commands.mapped);
+    mLastVisible = 0;
+    for (size_t command = 0; command < mCommandTemplate.size(); ++command)
+        mLastVisible += counted[command].instanceCount;
+    mLastTested = static_cast<const uint32_t *>(resources.drawCount.mapped)[1];
+    mLastOccluded = static_cast<const uint32_t *>(resources.drawCount.mapped)[2];
+
+    uint32_t instanceCount = uint32_t(mInstances.size());
+    if (instanceCount > mInstanceCapacity) {
+        LOG_WARNING_LIMITED(Render, 1, "GPU culling: {} instances, buffers only hold {}", instanceCount, mInstanceCapacity);
+        instanceCount = mInstanceCapacity;
+    }
+    // Only what changed since this slot was used last - moving NPCs, a collected collectible
+    Instance *uploaded = static_cast<Instance *>(resources.instances.mapped);
+    for (const DirtyRange &range : mDirty[frame]) {
+        const size_t end = std::min(range.end, size_t(instanceCount));
+        if (range.first < end)
+            memcpy(uploaded + range.first, mInstances.data() + range.first, (end - range.first) * sizeof(Instance));
+    }
+    mDirty[frame].clear();
+
+    // Instance counts back to 0, and no instances tested or occluded yet
+    const uint32_t zeroCounts[3] = { 0, 0, 0 };
+    mDeviceFunctions->vkCmdUpdateBuffer(cb, resources.commands.buffer, 0,
+                                        mCommandTemplate.size() * sizeof(VkDrawIndexedIndirectCommand),
+                                        mCommandTemplate.data());
+    mDeviceFunctions->vkCmdUpdateBuffer(cb, resources.drawCount.buffer, 0, sizeof(zeroCounts), zeroCounts);
+
+    VkMemoryBarrier barrier;
+    memset(&barrier, 0, sizeof(barrier));
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    mDeviceFunctions->vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                           0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    CullConstants constants;
+    memcpy(constants.planes, frustum.planes, sizeof(constants.planes));
+    constants.instanceCount = instanceCount;
+    constants.commandCount = uint32_t(mCommandTemplate.size());
+    constants.mode = 0;
+    constants.occlusion = occlusion ? 1 : 0;
+    constants.lod[0] = eye.x();
+    constants.lod[1] = eye.y();
+    constants.lod[2] = eye.z();
+    constants.lod[3] = lodScale;
+
+    mDeviceFunctions->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, mComputePipeline);
+    mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, mComputeLayout, 0, 1,
+                                              &resources.computeSet, 0, nullptr);
+    mDeviceFunctions->vkCmdPushConstants(cb, mComputeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    if (instanceCount > 0)
+        mDeviceFunctions->vkCmdDispatch(cb, (instanceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    // All instance counts are final before the commands are placed and compacted
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    mDeviceFunctions->vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                           0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    constants.mode = 1;
+    mDeviceFunctions->vkCmdPushConstants(cb, mComputeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    mDeviceFunctions->vkCmdDispatch(cb, 1, 1, 1);
+
+    // ... and the ranges before the instances go into them
+    mDeviceFunctions->vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                           0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    constants.mode = 2;
+    mDeviceFunctions->vkCmdPushConstants(cb, mComputeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    if (instanceCount > 0)
+        mDeviceFunctions->vkCmdDispatch(cb, (instanceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+}
+
+uint32_t GpuCuller::recordDraw(VkCommandBuffer cb, PipelineVariants::Features features)
+{
+    if (!isInitialized())
+        return 0;
+    const FrameResources &resources = mFrames[mWindow->currentFrame()];
+    const uint32_t commandCount = uint32_t(mCommandTemplate.size());
+
+    mDeviceFunctions->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mDrawPipelines.pipeline(features));
+    mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mDrawLayout, 0, 1,
+                                              &resources.drawSet, 0, nullptr);
+    VkDeviceSize vertexOffset = 0;
+    mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mVertexBuffer.buffer, &vertexOffset);
+    mDeviceFunctions->vkCmdBindIndexBuffer(cb, mIndexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
+
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    if (hasDrawCount()) {
+        mDrawIndexedIndirectCount(cb, resources.drawCommands.buffer, 0, resources.drawCount.buffer, 0, commandCount, stride);
+        return 1;
+    }
+    // Without the count the compacted list may end in stale commands - draw every
+    // command in place instead, the empty ones draw nothing
+    if (mMultiDrawIndirect) {
+        mDeviceFunctions->vkCmdDrawIndexedIndirect(cb, resources.commands.buffer, 0, commandCount, stride);
+        return 1;
+    }
+    for (uint32_t command = 0; command < commandCount; ++command)
+        mDeviceFunctions->vkCmdDrawIndexedIndirect(cb, resources.commands.buffer, command * stride, 1, stride);
+    return commandCount;
+}
+
+void GpuCuller::createBuffer(Buffer &buffer, VkDeviceSize size, VkBufferUsageFlags usage, bool hostVisible)
+{
+    VkDevice dev = mWindow->device();
+    buffer.size = size;
+
+    VkBufferCreateInfo bufferInfo;
+    memset(&bufferInfo, 0, sizeof(bufferInfo));
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    VkResult err = mDeviceFunctions->vkCreateBuffer(dev, &bufferInfo, nullptr, &buffer.buffer);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create GPU culling buffer: %d", err);
+
+    VkMemoryRequirements memReq;
+    mDeviceFunctions->vkGetBufferMemoryRequirements(dev, buffer.buffer, &memReq);
+
+    // Both indices are picked by QVulkanWindow, the host visible one is also host coherent
+    const uint32_t memoryIndex = hostVisible ? mWindow->hostVisibleMemoryIndex() : mWindow->deviceLocalMemoryIndex();
+    if (!(memReq.memoryTypeBits & (1u << memoryIndex)))
+        qFatal("GPU culling buffer can not use memory type %u", memoryIndex);
+
+    VkMemoryAllocateInfo allocInfo;
+    memset(&allocInfo, 0, sizeof(allocInfo));
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReq.size;
+    allocInfo.memoryTypeIndex = memoryIndex;
+    err = mDeviceFunctions->vkAllocateMemory(dev, &allocInfo, nullptr, &buffer.memory);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to allocate GPU culling buffer memory: %d", err);
+
+    err = mDeviceFunctions->vkBindBufferMemory(dev, buffer.buffer, buffer.memory, 0);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to bind GPU culling buffer memory: %d", err);
+
+    if (hostVisible) {
+        err = mDeviceFunctions->vkMapMemory(dev, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.mapped);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to map GPU culling buffer: %d", err);
+    }
+}
+
+void GpuCuller::destroyBuffer(Buffer &buffer)
+{
+    VkDevice dev = mWindow->device();
+    if (buffer.mapped)
+        mDeviceFunctions->vkUnmapMemory(dev, buffer.memory);
+    if (buffer.buffer)
+        mDeviceFunctions->vkDestroyBuffer(dev, buffer.buffer, nullptr);
+    if (buffer.memory)
+        mDeviceFunctions->vkFreeMemory(dev, buffer.memory, nullptr);
+    buffer = Buffer();
+}
+
+void GpuCuller::createPipelines(const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache)
+{
+    VkDevice dev = mWindow->device();
+
+    // Compute: instances, meshes, commands, visible list, compacted commands, draw count,
+    // then the depth pyramid and the camera for the occlusion test, then each instance's command
+    VkDescriptorSetLayoutBinding computeBindings[9];
+    for (uint32_t binding = 0; binding < 6; ++binding)
+        computeBindings[binding] = { binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+    computeBindings[6] = { 6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+    computeBindings[7] = { 7, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+    computeBindings[8] = { 8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+    VkDescriptorSetLayoutCreateInfo layoutInfo;
+    memset(&layoutInfo, 0, sizeof(layoutInfo));
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 9;
+    layoutInfo.pBindings = computeBindings;
+    VkResult err = mDeviceFunctions->vkCreateDescriptorSetLayout(dev, &layoutInfo, nullptr, &mComputeSetLayout);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create culling descriptor set layout: %d", err);
+
+    // Drawing: camera uniform, instances, visible list
+    VkDescriptorSetLayoutBinding drawBindings[3] = {
+        { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr },
+        { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr },
+        { 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr }
+    };
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings = drawBindings;
+    err = mDeviceFunctions->vkCreateDescriptorSetLayout(dev, &layoutInfo, nullptr, &mDrawSetLayout);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create instanced draw descriptor set layout: %d", err);
+
+    VkPushConstantRange cullConstantsRange = { VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants) };
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo;
+    memset(&pipelineLayoutInfo, 0, sizeof(pipelineLayoutInfo));
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &mComputeSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &cullConstantsRange;
+    err = mDeviceFunctions->vkCreatePipelineLayout(dev, &pipelineLayoutInfo, nullptr, &mComputeLayout);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create culling pipeline layout: %d", err);
+
+    // The instance transform comes from the storage buffer, no push constants
+    pipelineLayoutInfo.pSetLayouts = &mDrawSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pPushConstantRanges = nullptr;
+    err = mDeviceFunctions->vkCreatePipelineLayout(dev, &pipelineLayoutInfo, nullptr, &mDrawLayout);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create instanced draw pipeline layout: %d", err);
+
+    VkShaderModule cullShader = createShader(QStringLiteral(":/cull_comp.spv"));
+    VkComputePipelineCreateInfo computeInfo;
+    memset(&computeInfo, 0, sizeof(computeInfo));
+    computeInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    computeInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computeInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computeInfo.stage.module = cullShader;
+    computeInfo.stage.pName = "main";
+    computeInfo.layout = mComputeLayout;
+    err = mDeviceFunctions->vkCreateComputePipelines(dev, pipelineCache, 1, &computeInfo, nullptr, &mComputePipeline);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create culling pipeline: %d", err);
+
+    // Same state as the normal pipeline, only the vertex shader and the layout differ
+    VkGraphicsPipelineCreateInfo pipelineInfo = pipelineTemplate;
+    pipelineInfo.layout = mDrawLayout;
+    mDrawPipelines.init(mWindow, mDeviceFunctions, pipelineInfo, pipelineCache,
+                        QStringLiteral(":/instanced_vert.spv"), QStringLiteral(":/color_frag.spv"));
+    mDrawPipelines.prepare(PipelineVariants::Fog);
+
+    if (cullShader)
+        mDeviceFunctions->vkDestroyShaderModule(dev, cullShader, nullptr);
+}
+
+void GpuCuller::createDescriptorSets(const VkDescriptorBufferInfo *viewProjection, const VkDescriptorImageInfo &depthPyramid)
+{
+    VkDevice dev = mWindow->device();
+    const uint32_t frameCount = uint32_t(mWindow->concurrentFrameCount());
+
+    VkDescriptorPoolSize poolSizes[3] = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount * 2 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frameCount * 9 },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount }
+    };
+    VkDescriptorPoolCreateInfo poolInfo;
+    memset(&poolInfo, 0, sizeof(poolInfo));
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = frameCount * 2;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes = poolSizes;
+    VkResult err = mDeviceFunctions->vkCreateDescriptorPool(dev, &poolInfo, nullptr, &mDescriptorPool);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create GPU culling descriptor pool: %d", err);
+
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        FrameResources &resources = mFrames[frame];
+        VkDescriptorSetLayout layouts[2] = { mComputeSetLayout, mDrawSetLayout };
+        VkDescriptorSet sets[2];
+        VkDescriptorSetAllocateInfo allocInfo;
+        memset(&allocInfo, 0, sizeof(allocInfo));
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = mDescriptorPool;
+        allocInfo.descriptorSetCount = 2;
+        allocInfo.pSetLayouts = layouts;
+        err = mDeviceFunctions->vkAllocateDescriptorSets(dev, &allocInfo, sets);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to allocate GPU culling descriptor sets: %d", err);
+        resources.computeSet = sets[0];
+        resources.drawSet = sets[1];
+
+        const VkDescriptorBufferInfo computeBuffers[6] = {
+            { resources.instances.buffer, 0, VK_WHOLE_SIZE },
+            { mMeshBuffer.buffer, 0, VK_WHOLE_SIZE },
+            { resources.commands.buffer, 0, VK_WHOLE_SIZE },
+            { resources.visible.buffer, 0, VK_WHOLE_SIZE },
+            { resources.drawCommands.buffer, 0, VK_WHOLE_SIZE },
+            { resources.drawCount.buffer, 0, VK_WHOLE_SIZE }
+        };
+        const VkDescriptorBufferInfo drawBuffers[3] = {
+            viewProjection[frame],
+            { resources.instances.buffer, 0, VK_WHOLE_SIZE },
+            { resources.visible.buffer, 0, VK_WHOLE_SIZE }
+        };
+
+        const VkDescriptorBufferInfo instanceCommands = { resources.instanceCommands.buffer, 0, VK_WHOLE_SIZE };
+
+        VkWriteDescriptorSet writes[12];
+        memset(writes, 0, sizeof(writes));
+        for (uint32_t i = 0; i < 9; ++i) {
+            const bool compute = i < 6;
+            const uint32_t binding = compute ? i : i - 6;
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = compute ? resources.computeSet : resources.drawSet;
+            writes[i].dstBinding = binding;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = (!compute && binding == 0) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+                                                                   : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[i].pBufferInfo = compute ? &computeBuffers[binding] : &drawBuffers[binding];
+        }
+        // The occlusion test's pyramid and camera, and the instances' commands after the other compute bindings
+        for (uint32_t i = 9; i < 12; ++i) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = resources.computeSet;
+            writes[i].dstBinding = i - 3;
+            writes[i].descriptorCount = 1;
+        }
+        writes[9].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[9].pImageInfo = &depthPyramid;
+        writes[10].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        writes[10].pBufferInfo = &viewProjection[frame];
+        writes[11].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[11].pBufferInfo = &instanceCommands;
+        mDeviceFunctions->vkUpdateDescriptorSets(dev, 12, writes, 0, nullptr);
+    }
+}
+
+VkShaderModule GpuCuller::createShader(const QString &name)
+{
+    QFile file(name);
+    if (!file.open(QIODevice::ReadOnly))
+        qFatal("Failed to read shader %s", qPrintable(name));
+    const QByteArray blob = file.readAll();
+
+    VkShaderModuleCreateInfo shaderInfo;
+    memset(&shaderInfo, 0, sizeof(shaderInfo));
+    shaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderInfo.codeSize = size_t(blob.size());
+    shaderInfo.pCode = reinterpret_cast<const uint32_t *>(blob.constData());
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    VkResult err = mDeviceFunctions->vkCreateShaderModule(mWindow->device(), &shaderInfo, nullptr, &shaderModule);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create shader module %s: %d", qPrintable(name), err);
+    return shaderModule;
+}
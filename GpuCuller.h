@@ -0,0 +1,156 @@
+#pragma once
+
+#include <QVulkanWindow>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FrustumCuller.h"
+#include "MeshOptimizer.h"
+#include "PipelineVariants.h"
+
+// GPU driven drawing of many instances.
+//
+// A compute pass (cull.comp) tests every instance's bounding sphere against the
+// frustum and the depth pyramid of the occluders (HiZPyramid), picks the level of detail
+// from the instance's distance and counts the survivors into one VkDrawIndexedIndirectCommand
+// per mesh and level. A second tiny dispatch gives each command its range of the visible index
+// list from a prefix sum over the counts, moves the non-empty commands to the front and writes
+// their count, which vkCmdDrawIndexedIndirectCountKHR reads when the driver has it. A third
+// writes the survivors into their command's range. Every instance is in one command at most, so
+// the visible list needs an entry per instance, not per instance and command. The vertex shader
+// (instanced.vert) fetches its instance through the visible list.
+//
+// The CPU only uploads instances that changed and records the same handful of
+// commands every frame, no matter how many instances there are.
+class GpuCuller
+{
+public:
+    static constexpr uint32_t WORKGROUP_SIZE = 256;     // local_size_x in cull.comp
+    static constexpr uint32_t MAX_MESHES = 8;
+    static constexpr uint32_t MAX_LEVELS = 4;           // Levels of detail per mesh, the errors are a vec4 in cull.comp
+    static constexpr uint32_t HIDDEN = 0xffffffffu;     // Mesh index of an instance that is never drawn
+    // MAX_COMMANDS in cull.comp, a workgroup keeps a count of each
+    static constexpr uint32_t MAX_COMMANDS = MAX_MESHES * MAX_LEVELS;
+    static_assert(MAX_COMMANDS <= WORKGROUP_SIZE, "Every command's count is cleared by one invocation");
+
+    // One object - same layout as struct Instance in cull.comp and instanced.vert
+    struct Instance {
+        float position[3];
+        float scale;
+        uint32_t mesh;
+        uint32_t padding[3];
+    };
+
+    // All meshes go into one vertex and one index buffer, so every draw shares the bindings.
+    // Vertices are packed like everywhere else, each level of the mesh gets its own draw
+    // command. Call before init(), returns the mesh index.
+    uint32_t addMesh(const PackedMesh &packed, const MeshBounds &bounds);
+
+    // The graphics pipelines are made from pipelineTemplate with the instanced vertex shader and
+    // this class' layout, one per feature set like the renderer's own. viewProjection holds the camera uniform of each frame slot.
+    // Buffers are sized for the instances() present at this point.
+    void init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions,
+              const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache,
+              const VkDescriptorBufferInfo *viewProjection, const VkDescriptorImageInfo &depthPyramid);
+    void release();
+
+    uint32_t meshCount() const { return uint32_t(mMeshes.size()); }
+    bool isInitialized() const { return mComputePipeline != VK_NULL_HANDLE; }
+    // vkCmdDrawIndexedIndirectCountKHR is used, otherwise all commands are drawn and empty ones cost nothing
+    bool hasDrawCount() const { return mDrawIndexedIndirectCount != nullptr; }
+
+    // Instances on the CPU side. After changing some call markInstancesDirty() with their range,
+    // every frame slot then uploads that range the next time it is used - all instances without one.
+    std::vector<Instance> &instances() { return mInstances; }
+    void markInstancesDirty(size_t first = 0, size_t count = SIZE_MAX);
+
+    // Outside the render pass: uploads instances, resets the draw commands and culls.
+    // With occlusion the depth pyramid has to be built earlier in the same command buffer.
+    // The results are compute shader writes, the render graph makes them visible to the draw
+    // (indirect and vertex shader reads) and to the CPU (host reads).
+    // lodScale is the size in pixels of one unit at distance 1, divided by the error in pixels
+    // a level may have. The GPU keeps no levels between frames, so there is no hysteresis.
+    void recordCull(VkCommandBuffer cb, const Frustum &frustum, bool occlusion, const QVector3D &eye, float lodScale);
+    // Inside the render pass: draws everything that survived with the pipeline variant of features.
+    // Returns the number of draw calls recorded.
+    uint32_t recordDraw(VkCommandBuffer cb, PipelineVariants::Features features);
+
+    // Counted by the GPU when this frame slot was used last time
+    uint32_t lastTestedCount() const { return mLastTested; }
+    uint32_t lastVisibleCount() const { return mLastVisible; }
+    uint32_t lastOccludedCount() const { return mLastOccluded; }    // Inside the frustum but hidden
+
+private:
+    // Same layout as struct Mesh in cull.comp
+    struct MeshInfo {
+        float sphere[4];                // Model space center and radius
+        uint32_t firstCommand;          // Command of level 0, the coarser levels follow
+        uint32_t levelCount;
+        uint32_t padding[2];
+        float errors[MAX_LEVELS];       // Model space error of each level
+    };
+
+    // Instances [first, end) a frame slot still has to upload
+    struct DirtyRange {
+        size_t first;
+        size_t end;
+    };
+    // Separate ranges per slot, so a collected collectible doesn't stretch the moving NPCs'
+    // range over every instance in between. Beyond this many they are merged into one.
+    static constexpr size_t MAX_DIRTY_RANGES = 8;
+
+    struct Buffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void *mapped = nullptr;             // Host visible buffers stay mapped
+        VkDeviceSize size = 0;
+    };
+    // Per frame slot, written by the GPU while other slots are in flight
+    struct FrameResources {
+        Buffer instances;       // Instance array, uploaded from mInstances
+        Buffer commands;        // One draw command per mesh and level, instance counts filled in by the cull pass
+        Buffer drawCommands;    // The non-empty commands, moved to the front
+        Buffer drawCount;       // Number of drawCommands, then the number of instances tested and occluded
+        Buffer visible;         // Visible instance indices, one range per command, an entry per instance
+        Buffer instanceCommands;    // Command each instance was counted into by the cull, for placing it
+        VkDescriptorSet computeSet = VK_NULL_HANDLE;
+        VkDescriptorSet drawSet = VK_NULL_HANDLE;
+    };
+
+    void createBuffer(Buffer &buffer, VkDeviceSize size, VkBufferUsageFlags usage, bool hostVisible);
+    void destroyBuffer(Buffer &buffer);
+    void createPipelines(const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache);
+    void createDescriptorSets(const VkDescriptorBufferInfo *viewProjection, const VkDescriptorImageInfo &depthPyramid);
+    VkShaderModule createShader(const QString &name);
+
+    QVulkanWindow *mWindow = nullptr;
+    QVulkanDeviceFunctions *mDeviceFunctions = nullptr;
+    PFN_vkCmdDrawIndexedIndirectCountKHR mDrawIndexedIndirectCount = nullptr;
+    bool mMultiDrawIndirect = false;
+
+    // Meshes, packed while they are added
+    std::vector<PackedVertex> mVertices;
+    std::vector<uint16_t> mIndices;
+    std::vector<MeshInfo> mMeshes;
+    std::vector<VkDrawIndexedIndirectCommand> mCommandTemplate;     // One per mesh and level, instance counts 0
+
+    std::vector<Instance> mInstances;
+    uint32_t mInstanceCapacity = 0;
+    std::vector<DirtyRange> mDirty[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
+    uint32_t mLastTested = 0;
+    uint32_t mLastVisible = 0;
+    uint32_t mLastOccluded = 0;
+
+    Buffer mVertexBuffer;
+    Buffer mIndexBuffer;
+    Buffer mMeshBuffer;
+    FrameResources mFrames[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
+
+    VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mComputeSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mDrawSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout mComputeLayout = VK_NULL_HANDLE;
+    VkPipelineLayout mDrawLayout = VK_NULL_HANDLE;
+    VkPipeline mComputePipeline = VK_NULL_HANDLE;
+    PipelineVariants mDrawPipelines;
+};
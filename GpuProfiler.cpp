@@ -0,0 +1,242 @@
+#include "GpuProfiler.h"
+#include <QVulkanFunctions>
+#include <QDebug>
+#include <QVector>
+#include <cstring>
+
+// Pipeline statistics we ask for. Results come back in bit order: vertex, clipping, fragment
+static const VkQueryPipelineStatisticFlags STATISTICS_FLAGS =
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+void GpuProfiler::init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions)
+{
+    mWindow = window;
+    mDeviceFunctions = deviceFunctions;
+    mLastTimings = GpuFrameTimings();
+    mActiveRegion = -1;
+
+    QVulkanFunctions *functions = mWindow->vulkanInstance()->functions();
+    VkPhysicalDevice physicalDevice = mWindow->physicalDevice();
+    const VkPhysicalDeviceLimits &limits = mWindow->physicalDeviceProperties()->limits;
+
+    // Timestamps are only usable if the graphics queue family has valid bits
+    uint32_t queueFamilyCount = 0;
+    functions->vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    QVector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    functions->vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    const uint32_t validBits = queueFamilies.value(mWindow->graphicsQueueFamilyIndex()).timestampValidBits;
+
+    if (validBits == 0 || limits.timestampPeriod <= 0.0f) {
+        qWarning() << "GPU profiler: timestamps are not supported on the graphics queue";
+        return;
+    }
+    mTimestampPeriodNs = limits.timestampPeriod;
+    mTimestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+    // QVulkanWindow enables every supported core feature (except robustBufferAccess),
+    // so pipeline statistics work whenever the device reports the feature
+    VkPhysicalDeviceFeatures features;
+    functions->vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+    const bool statistics = features.pipelineStatisticsQuery == VK_TRUE;
+
+    VkDevice dev = mWindow->device();
+    const int concurrentFrameCount = mWindow->concurrentFrameCount();
+    for (int i = 0; i < concurrentFrameCount; ++i) {
+        VkQueryPoolCreateInfo poolInfo;
+        memset(&poolInfo, 0, sizeof(poolInfo));
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = TIMESTAMP_QUERY_COUNT;
+        VkResult err = mDeviceFunctions->vkCreateQueryPool(dev, &poolInfo, nullptr, &mTimestampPool[i]);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to create timestamp query pool: %d", err);
+
+        if (statistics) {
+            poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            poolInfo.queryCount = GPU_REGION_COUNT;
+            poolInfo.pipelineStatistics = STATISTICS_FLAGS;
+            err = mDeviceFunctions->vkCreateQueryPool(dev, &poolInfo, nullptr, &mStatisticsPool[i]);
+            if (err != VK_SUCCESS)
+                qFatal("Failed to create pipeline statistics query pool: %d", err);
+        }
+
+        mRecordedRegions[i] = 0;
+        mFrameRecorded[i] = false;
+    }
+
+    qDebug() << "GPU profiler: timestamp period" << mTimestampPeriodNs << "ns," << validBits << "valid bits,"
+             << "pipeline statistics" << (statistics ? "on" : "not supported");
+}
+
+void GpuProfiler::release()
+{
+    if (!mWindow)
+        return;
+
+    VkDevice dev = mWindow->device();
+    for (int i = 0; i < QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT; ++i) {
+        if (mTimestampPool[i]) {
+            mDeviceFunctions->vkDestroyQueryPool(dev, mTimestampPool[i], nullptr);
+            mTimestampPool[i] = VK_NULL_HANDLE;
+        }
+        if (mStatisticsPool[i]) {
+            mDeviceFunctions->vkDestroyQueryPool(dev, mStatisticsPool[i], nullptr);
+            mStatisticsPool[i] = VK_NULL_HANDLE;
+        }
+    }
+    mWindow = nullptr;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer cb)
+{
+    if (!isSupported())
+        return;
+
+    const int frame = mWindow->currentFrame();
+
+    // The fence of this frame slot has been waited on, so its old queries are finished
+    if (mFrameRecorded[frame])
+        readResults(frame);
+
+    mDeviceFunctions->vkCmdResetQueryPool(cb, mTimestampPool[frame], 0, TIMESTAMP_QUERY_COUNT);
+    if (hasPipelineStatistics())
+        mDeviceFunctions->vkCmdResetQueryPool(cb, mStatisticsPool[frame], 0, GPU_REGION_COUNT);
+
+    mRecordedRegions[frame] = 0;
+    mFrameRecorded[frame] = true;
+    mActiveRegion = -1;
+
+    mDeviceFunctions->vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mTimestampPool[frame], 0);
+}
+
+void GpuProfiler::endFrame(VkCommandBuffer cb)
+{
+    if (!isSupported())
+        return;
+
+    const int frame = mWindow->currentFrame();
+    mDeviceFunctions->vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mTimestampPool[frame], 1);
+}
+
+void GpuProfiler::beginRegion(VkCommandBuffer cb, GpuRegion region, bool withStatistics)
+{
+    if (!isSupported())
+        return;
+
+    const int frame = mWindow->currentFrame();
+    const uint32_t index = uint32_t(region);
+    Q_ASSERT(mActiveRegion < 0);
+    if (mRecordedRegions[frame] & (1u << index)) {
+        qWarning() << "GPU profiler: region" << regionName(region) << "used twice in one frame";
+        return;
+    }
+
+    mActiveRegion = int(index);
+    mActiveStatistics = withStatistics && hasPipelineStatistics();
+    mDeviceFunctions->vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mTimestampPool[frame],
+                                          FRAME_QUERY_COUNT + 2 * index);
+    if (mActiveStatistics)
+        mDeviceFunctions->vkCmdBeginQuery(cb, mStatisticsPool[frame], index, 0);
+}
+
+void GpuProfiler::endRegion(VkCommandBuffer cb, GpuRegion region)
+{
+    if (!isSupported() || mActiveRegion != int(region))
+        return;
+
+    const int frame = mWindow->currentFrame();
+    const uint32_t index = uint32_t(region);
+    if (mActiveStatistics)
+        mDeviceFunctions->vkCmdEndQuery(cb, mStatisticsPool[frame], index);
+    mDeviceFunctions->vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mTimestampPool[frame],
+                                          FRAME_QUERY_COUNT + 2 * index + 1);
+
+    mRecordedRegions[frame] |= 1u << index;
+    mActiveRegion = -1;
+}
+
+void GpuProfiler::replayRegions(uint32_t regionMask)
+{
+    if (!isSupported())
+        return;
+
+    // The buffer was recorded for this frame slot, so it writes into this slot's query pools
+    mRecordedRegions[mWindow->currentFrame()] |= regionMask;
+}
+
+void GpuProfiler::readResults(int frame)
+{
+    VkDevice dev = mWindow->device();
+
+    // Each result is followed by its availability, no WAIT flag so this never blocks.
+    // VK_NOT_READY just means some queries were not written, the available ones are still filled in.
+    struct TimestampResult { uint64_t value; uint64_t available; };
+    TimestampResult timestamps[TIMESTAMP_QUERY_COUNT] = {};
+    VkResult err = mDeviceFunctions->vkGetQueryPoolResults(dev, mTimestampPool[frame], 0, TIMESTAMP_QUERY_COUNT,
+                                                           sizeof(timestamps), timestamps, sizeof(TimestampResult),
+                                                           VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (err != VK_SUCCESS && err != VK_NOT_READY)
+        return;
+    if (!timestamps[0].available || !timestamps[1].available)
+        return;     // Keep the previous results
+
+    struct StatisticsResult { uint64_t vertex; uint64_t clipping; uint64_t fragment; uint64_t available; };
+    StatisticsResult statistics[GPU_REGION_COUNT] = {};
+    if (hasPipelineStatistics()) {
+        mDeviceFunctions->vkGetQueryPoolResults(dev, mStatisticsPool[frame], 0, GPU_REGION_COUNT,
+                                                sizeof(statistics), statistics, sizeof(StatisticsResult),
+                                                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    }
+
+    // Differences are taken within timestampValidBits, so a wrap-around still gives the right answer
+    auto ticksToMs = [this](uint64_t begin, uint64_t end) {
+        return double((end - begin) & mTimestampMask) * mTimestampPeriodNs / 1.0e6;
+    };
+
+    GpuFrameTimings timings;
+    timings.valid = true;
+    timings.frameMs = ticksToMs(timestamps[0].value, timestamps[1].value);
+
+    for (int i = 0; i < GPU_REGION_COUNT; ++i) {
+        if (!(mRecordedRegions[frame] & (1u << i)))
+            continue;
+        const TimestampResult &begin = timestamps[FRAME_QUERY_COUNT + 2 * i];
+        const TimestampResult &end = timestamps[FRAME_QUERY_COUNT + 2 * i + 1];
+        if (!begin.available || !end.available)
+            continue;
+
+        GpuFrameTimings::Region &region = timings.regions[i];
+        region.recorded = true;
+        region.ms = ticksToMs(begin.value, end.value);
+        if (statistics[i].available) {
+            region.vertexInvocations = statistics[i].vertex;
+            region.clippingPrimitives = statistics[i].clipping;
+            region.fragmentInvocations = statistics[i].fragment;
+        }
+    }
+
+    mLastTimings = timings;
+}
+
+const char *GpuProfiler::regionName(GpuRegion region)
+{
+    switch (region) {
+    case GpuRegion::Ground:       return "ground";
+    case GpuRegion::Player:       return "player";
+    case GpuRegion::Collectibles: return "collectibles";
+    case GpuRegion::NPCs:         return "npcs";
+    case GpuRegion::House:        return "house";
+    case GpuRegion::Indoor:       return "indoor";
+    case GpuRegion::Overlay:      return "overlay";
+    case GpuRegion::Culling:      return "culling";
+    case GpuRegion::Instances:    return "instances";
+    case GpuRegion::Occluders:    return "occluders";
+    case GpuRegion::Sorted:       return "sorted";
+    case GpuRegion::Upscale:      return "upscale";
+    case GpuRegion::Temporal:     return "taa";
+    case GpuRegion::Count:        break;
+    }
+    return "unknown";
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QVulkanWindow>
+#include <cstdint>
+
+// Named parts of a frame that get their own GPU timestamps
+enum class GpuRegion {
+    Ground,
+    Player,
+    Collectibles,
+    NPCs,
+    House,
+    Indoor,
+    Overlay,
+    Culling,        // Compute pass of the GPU culling
+    Instances,      // Collectibles and NPCs drawn by the GPU culling
+    Occluders,      // Depth pass and pyramid of the occlusion culling
+    Sorted,         // Player, collectibles and NPCs recorded through the render queue
+    Upscale,        // Scene target into the swap chain: scaled up, FXAA
+    Temporal,       // Temporal AA resolve into the history
+    Count
+};
+
+static constexpr int GPU_REGION_COUNT = int(GpuRegion::Count);
+
+// GPU results of one frame. Pipeline statistics are only filled in when the
+// device supports pipelineStatisticsQuery.
+struct GpuFrameTimings
+{
+    bool valid = false;             // False until the first results have come back
+    double frameMs = 0.0;           // From the first to the last command of the frame
+
+    struct Region {
+        bool recorded = false;      // Region was used in that frame
+        double ms = 0.0;
+        uint64_t vertexInvocations = 0;
+        uint64_t clippingPrimitives = 0;
+        uint64_t fragmentInvocations = 0;
+    };
+    Region regions[GPU_REGION_COUNT];
+};
+
+// Measures GPU time with vkCmdWriteTimestamp pairs around named regions.
+// There is one set of query pools per frame in flight. When a frame slot comes
+// around again QVulkanWindow has already waited for its fence, so the results
+// of the previous use of the slot are ready and reading them never stalls.
+class GpuProfiler
+{
+public:
+    void init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions);
+    void release();
+
+    // Timestamps need support on the graphics queue, statistics need the device feature
+    bool isSupported() const { return mTimestampPool[0] != VK_NULL_HANDLE; }
+    bool hasPipelineStatistics() const { return mStatisticsPool[0] != VK_NULL_HANDLE; }
+
+    // Must be called outside a render pass: reads back the results of this frame slot and resets its queries
+    void beginFrame(VkCommandBuffer cb);
+    void endFrame(VkCommandBuffer cb);
+
+    // Regions can not be nested, each region can be used once per frame.
+    // Pipeline statistics must begin and end in the same command buffer - a region whose
+    // begin and end go into different secondary command buffers only gets timestamps.
+    void beginRegion(VkCommandBuffer cb, GpuRegion region, bool withStatistics = true);
+    void endRegion(VkCommandBuffer cb, GpuRegion region);
+    // Regions (bit mask of GpuRegion) recorded in an earlier frame into a reused
+    // secondary command buffer, which writes them again this frame
+    void replayRegions(uint32_t regionMask);
+
+    // Newest results - these are concurrentFrameCount() frames old
+    const GpuFrameTimings &lastTimings() const { return mLastTimings; }
+
+    static const char *regionName(GpuRegion region);
+
+private:
+    void readResults(int frame);
+
+    // Timestamp query layout: 2 for the whole frame, then a begin/end pair per region
+    static constexpr uint32_t FRAME_QUERY_COUNT = 2;
+    static constexpr uint32_t TIMESTAMP_QUERY_COUNT = FRAME_QUERY_COUNT + 2 * GPU_REGION_COUNT;
+
+    QVulkanWindow *mWindow = nullptr;
+    QVulkanDeviceFunctions *mDeviceFunctions = nullptr;
+
+    double mTimestampPeriodNs = 1.0;    // Nanoseconds per timestamp tick
+    uint64_t mTimestampMask = ~0ull;    // Only timestampValidBits of the result are meaningful
+
+    VkQueryPool mTimestampPool[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT] = {};
+    VkQueryPool mStatisticsPool[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT] = {};
+
+    // Which regions were written into each frame slot, so unused queries are not read
+    uint32_t mRecordedRegions[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT] = {};
+    bool mFrameRecorded[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT] = {};
+    int mActiveRegion = -1;
+    bool mActiveStatistics = false;
+
+    GpuFrameTimings mLastTimings;
+};
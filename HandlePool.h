@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Objects referred to by handles that know when they are stale.
+//
+// A handle is a slot index plus the generation the slot had when the object was added.
+// remove() bumps the generation, so get() returns nullptr for every handle to the removed
+// object - also once the slot holds a new one. Holders of a handle notice that way instead
+// of drawing with whatever took the slot over. Slots are reused, the pool only grows to the
+// most objects alive at once.
+template<typename T>
+class HandlePool
+{
+public:
+    struct Handle {
+        uint32_t index = 0;
+        uint32_t generation = 0;    // 0 is the null handle, no slot has it
+
+        bool isNull() const { return generation == 0; }
+        bool operator==(const Handle &other) const { return index == other.index && generation == other.generation; }
+        bool operator!=(const Handle &other) const { return !(*this == other); }
+    };
+
+    Handle add(T value)
+    {
+        uint32_t index;
+        if (!mFree.empty()) {
+            index = mFree.back();
+            mFree.pop_back();
+        } else {
+            index = uint32_t(mSlots.size());
+            mSlots.push_back(Slot());
+        }
+        Slot &slot = mSlots[index];
+        slot.value = std::move(value);
+        slot.alive = true;
+        mSize++;
+        return { index, slot.generation };
+    }
+
+    T *get(Handle handle)
+    {
+        if (handle.index >= mSlots.size())
+            return nullptr;
+        Slot &slot = mSlots[handle.index];
+        return slot.alive && slot.generation == handle.generation ? &slot.value : nullptr;
+    }
+    const T *get(Handle handle) const { return const_cast<HandlePool *>(this)->get(handle); }
+
+    // Moves the object out into removed, false if the handle was stale already
+    bool remove(Handle handle, T &removed)
+    {
+        T *value = get(handle);
+        if (!value)
+            return false;
+        removed = std::move(*value);
+        Slot &slot = mSlots[handle.index];
+        slot.value = T();
+        slot.alive = false;
+        // Never 0, that is the null handle
+        if (++slot.generation == 0)
+            slot.generation = 1;
+        mFree.push_back(handle.index);
+        mSize--;
+        return true;
+    }
+
+    size_t size() const { return mSize; }
+
+    // Every live object, for tearing down
+    template<typename Function>
+    void forEach(Function function)
+    {
+        for (Slot &slot : mSlots) {
+            if (slot.alive)
+                function(slot.value);
+        }
+    }
+
+    // Stales every handle, the objects must have been destroyed
+    void clear()
+    {
+        for (uint32_t index = 0; index < mSlots.size(); ++index) {
+            Slot &slot = mSlots[index];
+            if (slot.alive) {
+                slot.value = T();
+                slot.alive = false;
+                if (++slot.generation == 0)
+                    slot.generation = 1;
+                mFree.push_back(index);
+            }
+        }
+        mSize = 0;
+    }
+
+private:
+    struct Slot {
+        T value = T();
+        uint32_t generation = 1;
+        bool alive = false;
+    };
+
+    std::vector<Slot> mSlots;
+    std::vector<uint32_t> mFree;
+    size_t mSize = 0;
+};
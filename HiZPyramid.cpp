@@ -0,0 +1,465 @@
+#include "HiZPyramid.h"
+#include <QVulkanFunctions>
+#include <QFile>
+#include <cstring>
+#include "Log.h"
+
+// local_size_x and local_size_y in hiz.comp
+static const uint32_t REDUCE_GROUP_SIZE = 8;
+
+void HiZPyramid::init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions,
+                      const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache)
+{
+    mWindow = window;
+    mDeviceFunctions = deviceFunctions;
+
+    // D32 is what the depth test writes most precisely, D16 has to be supported for both uses
+    VkFormatProperties formatProperties;
+    mWindow->vulkanInstance()->functions()->vkGetPhysicalDeviceFormatProperties(
+                mWindow->physicalDevice(), VK_FORMAT_D32_SFLOAT, &formatProperties);
+    const VkFormatFeatureFlags depthFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+                                             | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    mDepthFormat = (formatProperties.optimalTilingFeatures & depthFeatures) == depthFeatures
+            ? VK_FORMAT_D32_SFLOAT : VK_FORMAT_D16_UNORM;
+
+    createImage(mPyramid, VK_FORMAT_R32_SFLOAT, PYRAMID_SIZE, LEVEL_COUNT,
+                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    VkDevice dev = mWindow->device();
+    for (uint32_t level = 0; level < LEVEL_COUNT; ++level) {
+        VkImageViewCreateInfo viewInfo;
+        memset(&viewInfo, 0, sizeof(viewInfo));
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = mPyramid.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = VK_FORMAT_R32_SFLOAT;
+        viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+        VkResult err = mDeviceFunctions->vkCreateImageView(dev, &viewInfo, nullptr, &mLevelViews[level]);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to create depth pyramid level view: %d", err);
+    }
+
+    // Nearest, so every sample is one texel's farthest depth and nothing is averaged away
+    VkSamplerCreateInfo samplerInfo;
+    memset(&samplerInfo, 0, sizeof(samplerInfo));
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = float(LEVEL_COUNT);
+    VkResult err = mDeviceFunctions->vkCreateSampler(dev, &samplerInfo, nullptr, &mSampler);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create depth pyramid sampler: %d", err);
+
+    // The framebuffer waits for setDepth()
+    createRenderPass();
+    createPipelines(pipelineTemplate, pipelineCache);
+    createDescriptorSets();
+
+    LOG_INFO(Render, "Depth pyramid: {}x{} occluder depth, {} levels", DEPTH_SIZE, DEPTH_SIZE, LEVEL_COUNT);
+}
+
+void HiZPyramid::release()
+{
+    if (!mWindow)
+        return;
+    VkDevice dev = mWindow->device();
+
+    if (mOccluderPipeline)
+        mDeviceFunctions->vkDestroyPipeline(dev, mOccluderPipeline, nullptr);
+    if (mReducePipeline)
+        mDeviceFunctions->vkDestroyPipeline(dev, mReducePipeline, nullptr);
+    if (mReduceLayout)
+        mDeviceFunctions->vkDestroyPipelineLayout(dev, mReduceLayout, nullptr);
+    // Destroying the pool frees its sets
+    if (mDescriptorPool)
+        mDeviceFunctions->vkDestroyDescriptorPool(dev, mDescriptorPool, nullptr);
+    if (mReduceSetLayout)
+        mDeviceFunctions->vkDestroyDescriptorSetLayout(dev, mReduceSetLayout, nullptr);
+    if (mFramebuffer)
+        mDeviceFunctions->vkDestroyFramebuffer(dev, mFramebuffer, nullptr);
+    if (mRenderPass)
+        mDeviceFunctions->vkDestroyRenderPass(dev, mRenderPass, nullptr);
+    if (mSampler)
+        mDeviceFunctions->vkDestroySampler(dev, mSampler, nullptr);
+    for (VkImageView &view : mLevelViews) {
+        if (view)
+            mDeviceFunctions->vkDestroyImageView(dev, view, nullptr);
+        view = VK_NULL_HANDLE;
+    }
+    mOccluderPipeline = mReducePipeline = VK_NULL_HANDLE;
+    mReduceLayout = VK_NULL_HANDLE;
+    mDescriptorPool = VK_NULL_HANDLE;
+    mReduceSetLayout = VK_NULL_HANDLE;
+    mFramebuffer = VK_NULL_HANDLE;
+    mDepthView = VK_NULL_HANDLE;
+    mRenderPass = VK_NULL_HANDLE;
+    mSampler = VK_NULL_HANDLE;
+    for (VkDescriptorSet &set : mReduceSets)
+        set = VK_NULL_HANDLE;
+
+    destroyImage(mPyramid);
+    mWindow = nullptr;
+}
+
+RenderGraph::ImageDesc HiZPyramid::depthDesc() const
+{
+    RenderGraph::ImageDesc desc;
+    desc.format = mDepthFormat;
+    desc.width = desc.height = DEPTH_SIZE;
+    desc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    desc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    return desc;
+}
+
+void HiZPyramid::setDepth(VkImageView view)
+{
+    if (!isInitialized() || view == mDepthView)
+        return;
+    VkDevice dev = mWindow->device();
+    mDepthView = view;
+
+    if (mFramebuffer)
+        mDeviceFunctions->vkDestroyFramebuffer(dev, mFramebuffer, nullptr);
+    VkFramebufferCreateInfo framebufferInfo;
+    memset(&framebufferInfo, 0, sizeof(framebufferInfo));
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = mRenderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &mDepthView;
+    framebufferInfo.width = DEPTH_SIZE;
+    framebufferInfo.height = DEPTH_SIZE;
+    framebufferInfo.layers = 1;
+    VkResult err = mDeviceFunctions->vkCreateFramebuffer(dev, &framebufferInfo, nullptr, &mFramebuffer);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create occluder framebuffer: %d", err);
+
+    // Level 0 is reduced from the depth buffer
+    const VkDescriptorImageInfo source = { mSampler, mDepthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    VkWriteDescriptorSet write;
+    memset(&write, 0, sizeof(write));
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = mReduceSets[0];
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &source;
+    mDeviceFunctions->vkUpdateDescriptorSets(dev, 1, &write, 0, nullptr);
+}
+
+void HiZPyramid::beginOccluders(VkCommandBuffer cb)
+{
+    if (!isInitialized() || !mFramebuffer)
+        return;
+
+    VkClearValue clearValue;
+    clearValue.depthStencil = { 1.0f, 0 };
+    VkRenderPassBeginInfo rpBeginInfo;
+    memset(&rpBeginInfo, 0, sizeof(rpBeginInfo));
+    rpBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    rpBeginInfo.renderPass = mRenderPass;
+    rpBeginInfo.framebuffer = mFramebuffer;
+    rpBeginInfo.renderArea.extent.width = DEPTH_SIZE;
+    rpBeginInfo.renderArea.extent.height = DEPTH_SIZE;
+    rpBeginInfo.clearValueCount = 1;
+    rpBeginInfo.pClearValues = &clearValue;
+    mDeviceFunctions->vkCmdBeginRenderPass(cb, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    mDeviceFunctions->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mOccluderPipeline);
+    VkViewport viewport = {};
+    viewport.width = float(DEPTH_SIZE);
+    viewport.height = float(DEPTH_SIZE);
+    viewport.minDepth = 0;
+    viewport.maxDepth = 1;
+    mDeviceFunctions->vkCmdSetViewport(cb, 0, 1, &viewport);
+    VkRect2D scissor = {};
+    scissor.extent.width = DEPTH_SIZE;
+    scissor.extent.height = DEPTH_SIZE;
+    mDeviceFunctions->vkCmdSetScissor(cb, 0, 1, &scissor);
+}
+
+void HiZPyramid::endOccluders(VkCommandBuffer cb)
+{
+    if (!isInitialized() || !mFramebuffer)
+        return;
+    mDeviceFunctions->vkCmdEndRenderPass(cb);
+}
+
+void HiZPyramid::buildPyramid(VkCommandBuffer cb)
+{
+    if (!isInitialized() || !mFramebuffer)
+        return;
+
+    mDeviceFunctions->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, mReducePipeline);
+    VkMemoryBarrier barrier;
+    memset(&barrier, 0, sizeof(barrier));
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    for (uint32_t level = 0; level < LEVEL_COUNT; ++level) {
+        const uint32_t size = PYRAMID_SIZE >> level;
+        const uint32_t groups = (size + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE;
+        mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, mReduceLayout, 0, 1,
+                                                  &mReduceSets[level], 0, nullptr);
+        mDeviceFunctions->vkCmdDispatch(cb, groups, groups, 1);
+        // Each level is read by the next one. The render graph takes care of the last.
+        if (level + 1 < LEVEL_COUNT) {
+            mDeviceFunctions->vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+    }
+}
+
+VkDescriptorImageInfo HiZPyramid::pyramidInfo() const
+{
+    return { mSampler, mPyramid.view, VK_IMAGE_LAYOUT_GENERAL };
+}
+
+void HiZPyramid::createImage(Image &image, VkFormat format, uint32_t size, uint32_t levels, VkImageUsageFlags usage,
+                             VkImageAspectFlags aspect)
+{
+    VkDevice dev = mWindow->device();
+
+    VkImageCreateInfo imageInfo;
+    memset(&imageInfo, 0, sizeof(imageInfo));
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = { size, size, 1 };
+    imageInfo.mipLevels = levels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = usage;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkResult err = mDeviceFunctions->vkCreateImage(dev, &imageInfo, nullptr, &image.image);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create depth pyramid image: %d", err);
+
+    VkMemoryRequirements memReq;
+    mDeviceFunctions->vkGetImageMemoryRequirements(dev, image.image, &memReq);
+    // QVulkanWindow's device local type suits images too on all common drivers, otherwise take any allowed type
+    uint32_t memoryIndex = mWindow->deviceLocalMemoryIndex();
+    if (!(memReq.memoryTypeBits & (1u << memoryIndex))) {
+        memoryIndex = 0;
+        while (!(memReq.memoryTypeBits & (1u << memoryIndex)))
+            ++memoryIndex;
+    }
+
+    VkMemoryAllocateInfo allocInfo;
+    memset(&allocInfo, 0, sizeof(allocInfo));
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReq.size;
+    allocInfo.memoryTypeIndex = memoryIndex;
+    err = mDeviceFunctions->vkAllocateMemory(dev, &allocInfo, nullptr, &image.memory);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to allocate depth pyramid memory: %d", err);
+    err = mDeviceFunctions->vkBindImageMemory(dev, image.image, image.memory, 0);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to bind depth pyramid memory: %d", err);
+
+    VkImageViewCreateInfo viewInfo;
+    memset(&viewInfo, 0, sizeof(viewInfo));
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = { aspect, 0, levels, 0, 1 };
+    err = mDeviceFunctions->vkCreateImageView(dev, &viewInfo, nullptr, &image.view);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create depth pyramid image view: %d", err);
+}
+
+void HiZPyramid::destroyImage(Image &image)
+{
+    VkDevice dev = mWindow->device();
+    if (image.view)
+        mDeviceFunctions->vkDestroyImageView(dev, image.view, nullptr);
+    if (image.image)
+        mDeviceFunctions->vkDestroyImage(dev, image.image, nullptr);
+    if (image.memory)
+        mDeviceFunctions->vkFreeMemory(dev, image.memory, nullptr);
+    image = Image();
+}
+
+void HiZPyramid::createRenderPass()
+{
+    VkAttachmentDescription depthAttachment;
+    memset(&depthAttachment, 0, sizeof(depthAttachment));
+    depthAttachment.format = mDepthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    // The render graph moves the image in and out of the attachment layout
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthReference = { 0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+    VkSubpassDescription subpass;
+    memset(&subpass, 0, sizeof(subpass));
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.pDepthStencilAttachment = &depthReference;
+
+    // No dependencies either, the barriers before and after the pass are the graph's
+    VkRenderPassCreateInfo renderPassInfo;
+    memset(&renderPassInfo, 0, sizeof(renderPassInfo));
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &depthAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    VkResult err = mDeviceFunctions->vkCreateRenderPass(mWindow->device(), &renderPassInfo, nullptr, &mRenderPass);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create occluder render pass: %d", err);
+}
+
+void HiZPyramid::createPipelines(const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache)
+{
+    VkDevice dev = mWindow->device();
+
+    // Occluders: depth only, so no fragment shader, no color attachment and no multisampling
+    const VkPipelineShaderStageCreateInfo *vertexStage = nullptr;
+    for (uint32_t i = 0; i < pipelineTemplate.stageCount; ++i) {
+        if (pipelineTemplate.pStages[i].stage == VK_SHADER_STAGE_VERTEX_BIT)
+            vertexStage = &pipelineTemplate.pStages[i];
+    }
+    Q_ASSERT(vertexStage);
+
+    VkPipelineMultisampleStateCreateInfo ms;
+    memset(&ms, 0, sizeof(ms));
+    ms.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    ms.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendStateCreateInfo cb;
+    memset(&cb, 0, sizeof(cb));
+    cb.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = pipelineTemplate;
+    pipelineInfo.stageCount = 1;
+    pipelineInfo.pStages = vertexStage;
+    pipelineInfo.pMultisampleState = &ms;
+    pipelineInfo.pColorBlendState = &cb;
+    pipelineInfo.renderPass = mRenderPass;
+    pipelineInfo.subpass = 0;
+    VkResult err = mDeviceFunctions->vkCreateGraphicsPipelines(dev, pipelineCache, 1, &pipelineInfo, nullptr,
+                                                               &mOccluderPipeline);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create occluder pipeline: %d", err);
+
+    // Reduction: the level above, and the level written
+    VkDescriptorSetLayoutBinding bindings[2] = {
+        { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+        { 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr }
+    };
+    VkDescriptorSetLayoutCreateInfo layoutInfo;
+    memset(&layoutInfo, 0, sizeof(layoutInfo));
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+    err = mDeviceFunctions->vkCreateDescriptorSetLayout(dev, &layoutInfo, nullptr, &mReduceSetLayout);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create depth pyramid descriptor set layout: %d", err);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo;
+    memset(&pipelineLayoutInfo, 0, sizeof(pipelineLayoutInfo));
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &mReduceSetLayout;
+    err = mDeviceFunctions->vkCreatePipelineLayout(dev, &pipelineLayoutInfo, nullptr, &mReduceLayout);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create depth pyramid pipeline layout: %d", err);
+
+    VkShaderModule reduceShader = createShader(QStringLiteral(":/hiz_comp.spv"));
+    VkComputePipelineCreateInfo computeInfo;
+    memset(&computeInfo, 0, sizeof(computeInfo));
+    computeInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    computeInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computeInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computeInfo.stage.module = reduceShader;
+    computeInfo.stage.pName = "main";
+    computeInfo.layout = mReduceLayout;
+    err = mDeviceFunctions->vkCreateComputePipelines(dev, pipelineCache, 1, &computeInfo, nullptr, &mReducePipeline);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create depth pyramid pipeline: %d", err);
+
+    if (reduceShader)
+        mDeviceFunctions->vkDestroyShaderModule(dev, reduceShader, nullptr);
+}
+
+void HiZPyramid::createDescriptorSets()
+{
+    VkDevice dev = mWindow->device();
+
+    VkDescriptorPoolSize poolSizes[2] = {
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, LEVEL_COUNT },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, LEVEL_COUNT }
+    };
+    VkDescriptorPoolCreateInfo poolInfo;
+    memset(&poolInfo, 0, sizeof(poolInfo));
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = LEVEL_COUNT;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    VkResult err = mDeviceFunctions->vkCreateDescriptorPool(dev, &poolInfo, nullptr, &mDescriptorPool);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create depth pyramid descriptor pool: %d", err);
+
+    VkDescriptorSetLayout layouts[LEVEL_COUNT];
+    for (VkDescriptorSetLayout &layout : layouts)
+        layout = mReduceSetLayout;
+    VkDescriptorSetAllocateInfo allocInfo;
+    memset(&allocInfo, 0, sizeof(allocInfo));
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = mDescriptorPool;
+    allocInfo.descriptorSetCount = LEVEL_COUNT;
+    allocInfo.pSetLayouts = layouts;
+    err = mDeviceFunctions->vkAllocateDescriptorSets(dev, &allocInfo, mReduceSets);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to allocate depth pyramid descriptor sets: %d", err);
+
+    // The source of level 0, the depth buffer, is written by setDepth()
+    for (uint32_t level = 0; level < LEVEL_COUNT; ++level) {
+        const VkDescriptorImageInfo source = { mSampler, level > 0 ? mLevelViews[level - 1] : VK_NULL_HANDLE,
+                                               VK_IMAGE_LAYOUT_GENERAL };
+        const VkDescriptorImageInfo destination = { VK_NULL_HANDLE, mLevelViews[level], VK_IMAGE_LAYOUT_GENERAL };
+
+        VkWriteDescriptorSet writes[2];
+        memset(writes, 0, sizeof(writes));
+        for (uint32_t i = 0; i < 2; ++i) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = mReduceSets[level];
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+        }
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[0].pImageInfo = &source;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[1].pImageInfo = &destination;
+        const uint32_t firstWrite = level > 0 ? 0 : 1;
+        mDeviceFunctions->vkUpdateDescriptorSets(dev, 2 - firstWrite, writes + firstWrite, 0, nullptr);
+    }
+}
+
+VkShaderModule HiZPyramid::createShader(const QString &name)
+{
+    QFile file(name);
+    if (!file.open(QIODevice::ReadOnly))
+        qFatal("Failed to read shader %s", qPrintable(name));
+    const QByteArray blob = file.readAll();
+
+    VkShaderModuleCreateInfo shaderInfo;
+    memset(&shaderInfo, 0, sizeof(shaderInfo));
+    shaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderInfo.codeSize = size_t(blob.size());
+    shaderInfo.pCode = reinterpret_cast<const uint32_t *>(blob.constData());
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    VkResult err = mDeviceFunctions->vkCreateShaderModule(mWindow->device(), &shaderInfo, nullptr, &shaderModule);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create shader module %s: %d", qPrintable(name), err);
+    return shaderModule;
+}
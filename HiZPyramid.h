@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QVulkanWindow>
+#include <cstdint>
+#include "RenderGraph.h"
+
+// Hierarchical depth buffer for occlusion culling.
+//
+// The large occluders are drawn depth only into a small depth buffer of their own,
+// which hiz.comp reduces into a mip chain: every texel holds the farthest depth of
+// the 2x2 texels below it. An object whose nearest depth lies behind the pyramid
+// everywhere on its screen rectangle is hidden, cull.comp tests that with four
+// samples from the level where the rectangle covers at most 2x2 texels.
+//
+// QVulkanWindow's depth buffer can't be sampled and isn't stored after the render
+// pass, so the occluders are drawn once more - at this size that costs next to nothing.
+// That depth buffer is a transient image of the render graph, which also places the
+// barriers between drawing the occluders, the reduction and the culling reading the pyramid.
+class HiZPyramid
+{
+public:
+    static constexpr uint32_t DEPTH_SIZE = 512;                 // Square, whatever the window's aspect ratio
+    static constexpr uint32_t PYRAMID_SIZE = DEPTH_SIZE / 2;    // Level 0 already halves the depth buffer
+    static constexpr uint32_t LEVEL_COUNT = 9;                  // PYRAMID_SIZE down to 1x1
+
+    // The occluder pipeline is pipelineTemplate with only its vertex shader, so the occluders
+    // are drawn with the same layout, descriptor sets and push constants as usual
+    void init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions,
+              const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache);
+    void release();
+    bool isInitialized() const { return mOccluderPipeline != VK_NULL_HANDLE; }
+
+    // The occluder depth buffer, created by the render graph
+    RenderGraph::ImageDesc depthDesc() const;
+    // Points the depth pass and the reduction at the graph's image. Only does something when the
+    // view changed, which the graph only does once the device is idle.
+    void setDepth(VkImageView view);
+
+    // Outside any render pass: starts the depth pass and binds the occluder pipeline. The depth
+    // buffer has to be in VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL.
+    void beginOccluders(VkCommandBuffer cb);
+    void endOccluders(VkCommandBuffer cb);
+    // Reduces the depth buffer, in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, into the
+    // pyramid, in VK_IMAGE_LAYOUT_GENERAL
+    void buildPyramid(VkCommandBuffer cb);
+
+    // All levels, nearest filtering, in VK_IMAGE_LAYOUT_GENERAL
+    VkDescriptorImageInfo pyramidInfo() const;
+    VkImage pyramidImage() const { return mPyramid.image; }
+
+private:
+    struct Image {
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;  // All levels
+    };
+
+    void createImage(Image &image, VkFormat format, uint32_t size, uint32_t levels, VkImageUsageFlags usage,
+                     VkImageAspectFlags aspect);
+    void destroyImage(Image &image);
+    void createRenderPass();
+    void createPipelines(const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache);
+    void createDescriptorSets();
+    VkShaderModule createShader(const QString &name);
+
+    QVulkanWindow *mWindow = nullptr;
+    QVulkanDeviceFunctions *mDeviceFunctions = nullptr;
+    VkFormat mDepthFormat = VK_FORMAT_UNDEFINED;
+
+    // The GPU works through the frames in order and every frame rebuilds the pyramid
+    // before it is read, so one pyramid serves all frame slots
+    VkImageView mDepthView = VK_NULL_HANDLE;
+    Image mPyramid;
+    VkImageView mLevelViews[LEVEL_COUNT] = {};
+    VkSampler mSampler = VK_NULL_HANDLE;
+    VkRenderPass mRenderPass = VK_NULL_HANDLE;
+    VkFramebuffer mFramebuffer = VK_NULL_HANDLE;
+    VkPipeline mOccluderPipeline = VK_NULL_HANDLE;
+
+    // Reduction: one descriptor set per level, reading the level above (the depth buffer for level 0)
+    VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mReduceSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout mReduceLayout = VK_NULL_HANDLE;
+    VkPipeline mReducePipeline = VK_NULL_HANDLE;
+    VkDescriptorSet mReduceSets[LEVEL_COUNT] = {};
+};
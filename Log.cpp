@@ -0,0 +1,252 @@
+#include "Log.h"
+#include "MpmcQueue.h"
+#include <QPlainTextEdit>
+#include <QScrollBar>
+#include <QStringList>
+#include <QTimer>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// 4096 records of a few hundred bytes each, allocated once
+using RecordQueue = MpmcQueue<Log::Record, 4096>;
+std::unique_ptr<RecordQueue> sQueue(new RecordQueue);
+
+std::atomic<int> sMinLevel{ int(Log::Level::Trace) };
+std::atomic<uint32_t> sDropped{ 0 };        // Records lost because the queue was full
+std::atomic<bool> sRunning{ false };
+std::thread sThread;
+
+// Formatted lines waiting for the widget, handed over under a mutex
+// that only the logger thread and the GUI timer ever take
+std::mutex sPendingMutex;
+QStringList sPendingLines;
+bool sWidgetAttached = false;
+
+// Serializes formatting when flush() runs next to the logger thread
+std::mutex sFormatMutex;
+
+const std::chrono::steady_clock::time_point sEpoch = std::chrono::steady_clock::now();
+
+const char *levelName(Log::Level level)
+{
+    switch (level) {
+    case Log::Level::Trace:   return "TRACE";
+    case Log::Level::Debug:   return "DEBUG";
+    case Log::Level::Info:    return "INFO ";
+    case Log::Level::Warning: return "WARN ";
+    case Log::Level::Error:   return "ERROR";
+    }
+    return "?";
+}
+
+const char *categoryName(Log::Category category)
+{
+    switch (category) {
+    case Log::Category::App:    return "app";
+    case Log::Category::Render: return "render";
+    case Log::Category::Vulkan: return "vulkan";
+    case Log::Category::Game:   return "game";
+    case Log::Category::Scene:  return "scene";
+    case Log::Category::Perf:   return "perf";
+    case Log::Category::Qt:     return "qt";
+    case Log::Category::Count:  break;
+    }
+    return "?";
+}
+
+void appendArg(QString &out, const Log::Arg &arg)
+{
+    switch (arg.type) {
+    case Log::Arg::None:    break;
+    case Log::Arg::Int:     out += QString::number(arg.i); break;
+    case Log::Arg::UInt:    out += QString::number(arg.u); break;
+    case Log::Arg::Double:  out += QString::number(arg.d); break;
+    case Log::Arg::Bool:    out += arg.b ? QLatin1String("true") : QLatin1String("false"); break;
+    case Log::Arg::CString: out += QString::fromUtf8(arg.s); break;
+    case Log::Arg::String:  out += QString::fromUtf8(arg.text); break;
+    case Log::Arg::Vector3:
+        out += QString("(%1, %2, %3)").arg(arg.v[0]).arg(arg.v[1]).arg(arg.v[2]);
+        break;
+    }
+}
+
+QString format(const Log::Record &record)
+{
+    QString line = QString::asprintf("%8.3f %s %-6s ", record.timeMs / 1000.0,
+                                     levelName(record.level), categoryName(record.category));
+
+    if (!record.format) {
+        line += record.text;
+    } else {
+        // Replace each {} with the next argument
+        int argIndex = 0;
+        const char *start = record.format;
+        const char *c = start;
+        for (; *c; ++c) {
+            if (c[0] == '{' && c[1] == '}' && argIndex < record.argCount) {
+                line += QString::fromUtf8(start, int(c - start));
+                appendArg(line, record.args[argIndex++]);
+                start = c + 2;
+                ++c;
+            }
+        }
+        line += QString::fromUtf8(start, int(c - start));
+    }
+
+    if (record.suppressed > 0)
+        line += QString(" (%1 similar messages suppressed)").arg(record.suppressed);
+    return line;
+}
+
+void output(const QString &line)
+{
+    const QByteArray utf8 = line.toUtf8();
+    fprintf(stderr, "%s\n", utf8.constData());
+
+    std::lock_guard<std::mutex> lock(sPendingMutex);
+    if (sWidgetAttached)
+        sPendingLines.append(line);
+}
+
+// Formats everything currently queued. Returns false if the queue was empty.
+bool drain()
+{
+    std::lock_guard<std::mutex> lock(sFormatMutex);
+
+    const uint32_t dropped = sDropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0)
+        output(QString("Log queue full - %1 messages dropped").arg(dropped));
+
+    bool any = false;
+    Log::Record record;
+    while (sQueue->pop(record)) {
+        output(format(record));
+        record.text.clear();
+        any = true;
+    }
+    if (any)
+        fflush(stderr);
+    return any;
+}
+
+void loggerThread()
+{
+    while (sRunning.load(std::memory_order_acquire)) {
+        // Nothing to do: sleep a little instead of making producers signal us
+        if (!drain())
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    drain();
+}
+
+} // namespace
+
+bool Log::RateLimiter::allow(uint32_t &suppressed)
+{
+    if (mPerSecond == 0)
+        return true;
+
+    // Fixed one second windows. A lost race only lets a message or two more through.
+    const int64_t now = nowMs();
+    int64_t windowStart = mWindowStartMs.load(std::memory_order_relaxed);
+    if (now - windowStart >= 1000 && mWindowStartMs.compare_exchange_strong(windowStart, now, std::memory_order_relaxed))
+        mCount.store(0, std::memory_order_relaxed);
+
+    if (mCount.fetch_add(1, std::memory_order_relaxed) < mPerSecond) {
+        suppressed = mSuppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    mSuppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void Log::start()
+{
+    if (sRunning.exchange(true))
+        return;
+    sThread = std::thread(loggerThread);
+}
+
+void Log::shutdown()
+{
+    if (!sRunning.exchange(false))
+        return;
+    sThread.join();
+}
+
+void Log::flush()
+{
+    drain();
+}
+
+void Log::attachWidget(QPlainTextEdit *widget, int maxLines)
+{
+    // Old lines are thrown away by the document itself
+    widget->setMaximumBlockCount(maxLines);
+    {
+        std::lock_guard<std::mutex> lock(sPendingMutex);
+        sWidgetAttached = true;
+    }
+
+    // One append per tick instead of one per line, and only scroll if the user hasn't scrolled up
+    QTimer *timer = new QTimer(widget);
+    QObject::connect(timer, &QTimer::timeout, widget, [widget]() {
+        QStringList lines;
+        {
+            std::lock_guard<std::mutex> lock(sPendingMutex);
+            lines.swap(sPendingLines);
+        }
+        if (lines.isEmpty())
+            return;
+
+        // More lines than the widget keeps would just be thrown away again
+        const int maxLines = widget->maximumBlockCount();
+        if (maxLines > 0 && lines.size() > maxLines)
+            lines.erase(lines.begin(), lines.end() - maxLines);
+
+        QScrollBar *scrollBar = widget->verticalScrollBar();
+        const bool atBottom = scrollBar->value() == scrollBar->maximum();
+        widget->appendPlainText(lines.join(QLatin1Char('\n')));
+        if (atBottom)
+            scrollBar->setValue(scrollBar->maximum());
+    });
+    timer->start(100);
+}
+
+void Log::setMinLevel(Level level)
+{
+    sMinLevel.store(int(level), std::memory_order_relaxed);
+}
+
+bool Log::isEnabled(Level level)
+{
+    return int(level) >= sMinLevel.load(std::memory_order_relaxed);
+}
+
+int64_t Log::nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - sEpoch).count();
+}
+
+void Log::submit(Record &&record)
+{
+    if (!sQueue->push(std::move(record)))
+        sDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Log::writeText(Level level, Category category, const QString &text)
+{
+    if (!isEnabled(level))
+        return;
+    Record record;
+    record.level = level;
+    record.category = category;
+    record.timeMs = nowMs();
+    record.text = text;
+    submit(std::move(record));
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <QString>
+#include <QVector3D>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+QT_FORWARD_DECLARE_CLASS(QPlainTextEdit)
+
+// Asynchronous logging.
+//
+//   LOG_DEBUG(Render, "Drew {} collectibles", count);
+//   LOG_INFO_LIMITED(Game, 1, "Player at {}", mPlayerPosition);   // At most once per second from this line
+//
+// The calling thread only copies the format string pointer and the arguments into
+// a record and pushes it onto a lock-free queue. A logger thread turns records into
+// text and writes them to stderr and, in batches, to the log widget.
+//
+// Filtering at compile time:
+//   QTVK_LOG_MIN_LEVEL   0 = trace, 1 = debug, 2 = info, 3 = warning, 4 = error.
+//                        Macros below the level expand to nothing, arguments are not evaluated.
+//   QTVK_LOG_CATEGORIES  Bit mask of Log::Category values that are compiled in.
+// Filtering at run time: Log::setMinLevel().
+
+#ifndef QTVK_LOG_MIN_LEVEL
+#define QTVK_LOG_MIN_LEVEL 1
+#endif
+
+#ifndef QTVK_LOG_CATEGORIES
+#define QTVK_LOG_CATEGORIES 0xffffffffu
+#endif
+
+namespace Log
+{
+    enum class Level : uint8_t { Trace, Debug, Info, Warning, Error };
+
+    enum class Category : uint8_t {
+        App,        // Start-up, command line, windows
+        Render,     // Per-frame drawing
+        Vulkan,     // Resource creation and Vulkan errors
+        Game,       // Game rules: collisions, pickups, win/lose
+        Scene,      // Doors and indoor/outdoor transitions
+        Perf,       // Profiling and benchmark results
+        Qt,         // Messages that came through qDebug()/qWarning()
+        Count
+    };
+
+    constexpr bool compiledIn(Category category)
+    {
+        return (uint32_t(QTVK_LOG_CATEGORIES) >> uint32_t(category)) & 1u;
+    }
+
+    // One argument of a log call, stored by value so it can be formatted later on another thread
+    struct Arg
+    {
+        enum Type : uint8_t { None, Int, UInt, Double, Bool, CString, String, Vector3 };
+
+        static constexpr int TEXT_SIZE = 48;    // Longer strings are cut
+
+        Type type = None;
+        union {
+            int64_t i;
+            uint64_t u;
+            double d;
+            bool b;
+            const char *s;                      // Must outlive the log call (string literals)
+            float v[3];
+        };
+        char text[TEXT_SIZE];
+    };
+
+    struct Record
+    {
+        static constexpr int MAX_ARGS = 6;
+
+        Level level = Level::Info;
+        Category category = Category::App;
+        uint32_t suppressed = 0;                // Messages from the same line dropped by the rate limit
+        int64_t timeMs = 0;
+        const char *format = nullptr;           // Format with {} placeholders, a string literal
+        QString text;                           // Already formatted text (Qt messages), used when format is null
+        int argCount = 0;
+        Arg args[MAX_ARGS];
+
+        template<typename T>
+        void add(const T &value)
+        {
+            if (argCount >= MAX_ARGS)
+                return;
+            Arg &arg = args[argCount++];
+            if constexpr (std::is_same_v<T, bool>) {
+                arg.type = Arg::Bool;
+                arg.b = value;
+            } else if constexpr (std::is_enum_v<T>) {
+                arg.type = Arg::Int;
+                arg.i = int64_t(value);
+            } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+                arg.type = Arg::Int;
+                arg.i = value;
+            } else if constexpr (std::is_integral_v<T>) {
+                arg.type = Arg::UInt;
+                arg.u = value;
+            } else if constexpr (std::is_floating_point_v<T>) {
+                arg.type = Arg::Double;
+                arg.d = value;
+            } else if constexpr (std::is_same_v<T, QVector3D>) {
+                arg.type = Arg::Vector3;
+                arg.v[0] = value.x();
+                arg.v[1] = value.y();
+                arg.v[2] = value.z();
+            } else if constexpr (std::is_same_v<T, QString>) {
+                addText(value.toUtf8().constData());
+            } else if constexpr (std::is_convertible_v<T, const char *>) {
+                // Character arrays are copied, they might be buffers on the stack
+                if constexpr (std::is_array_v<T>)
+                    addText(value);
+                else {
+                    arg.type = Arg::CString;
+                    arg.s = value;
+                }
+            } else {
+                static_assert(sizeof(T) == 0, "Log: unsupported argument type");
+            }
+        }
+
+    private:
+        void addText(const char *value)
+        {
+            Arg &arg = args[argCount - 1];
+            arg.type = Arg::String;
+            strncpy(arg.text, value ? value : "", Arg::TEXT_SIZE - 1);
+            arg.text[Arg::TEXT_SIZE - 1] = '\0';
+        }
+    };
+
+    // Allows a call site to log at most perSecond messages per second (0 = no limit).
+    // Counts what was dropped so the next message can say so.
+    class RateLimiter
+    {
+    public:
+        explicit RateLimiter(uint32_t perSecond) : mPerSecond(perSecond) {}
+        bool allow(uint32_t &suppressed);
+
+    private:
+        const uint32_t mPerSecond;
+        std::atomic<int64_t> mWindowStartMs{ -1000000 };
+        std::atomic<uint32_t> mCount{ 0 };
+        std::atomic<uint32_t> mSuppressed{ 0 };
+    };
+
+    // Starts the logger thread. Records pushed before that wait in the queue.
+    void start();
+    // Writes everything still queued and stops the logger thread
+    void shutdown();
+    // Formats and writes everything queued on the calling thread (used before qFatal aborts)
+    void flush();
+
+    // Batches lines into the widget a few times per second and caps its line count
+    void attachWidget(QPlainTextEdit *widget, int maxLines = 5000);
+
+    void setMinLevel(Level level);
+    bool isEnabled(Level level);
+
+    int64_t nowMs();
+
+    // Hands a record to the logger thread. Never blocks - if the queue is full the record is dropped and counted.
+    void submit(Record &&record);
+
+    // Already formatted text, e.g. from the Qt message handler
+    void writeText(Level level, Category category, const QString &text);
+
+    template<typename... Args>
+    void write(Level level, Category category, uint32_t suppressed, const char *format, const Args &...args)
+    {
+        static_assert(sizeof...(Args) <= Record::MAX_ARGS, "Log: too many arguments");
+        Record record;
+        record.level = level;
+        record.category = category;
+        record.suppressed = suppressed;
+        record.timeMs = nowMs();
+        record.format = format;
+        (record.add(args), ...);
+        submit(std::move(record));
+    }
+}
+
+#define QTVK_LOG_IMPL(level, category, perSecond, ...)                                              \
+    do {                                                                                            \
+        if constexpr (Log::compiledIn(Log::Category::category)) {                                   \
+            if (Log::isEnabled(Log::Level::level)) {                                                \
+                static Log::RateLimiter qtvkLogLimiter(perSecond);                                  \
+                uint32_t qtvkLogSuppressed = 0;                                                     \
+                if (qtvkLogLimiter.allow(qtvkLogSuppressed))                                        \
+                    Log::write(Log::Level::level, Log::Category::category, qtvkLogSuppressed, __VA_ARGS__); \
+            }                                                                                       \
+        }                                                                                           \
+    } while (0)
+
+#if QTVK_LOG_MIN_LEVEL <= 0
+#define LOG_TRACE(category, ...) QTVK_LOG_IMPL(Trace, category, 0, __VA_ARGS__)
+#define LOG_TRACE_LIMITED(category, perSecond, ...) QTVK_LOG_IMPL(Trace, category, perSecond, __VA_ARGS__)
+#else
+#define LOG_TRACE(category, ...) ((void)0)
+#define LOG_TRACE_LIMITED(category, perSecond, ...) ((void)0)
+#endif
+
+#if QTVK_LOG_MIN_LEVEL <= 1
+#define LOG_DEBUG(category, ...) QTVK_LOG_IMPL(Debug, category, 0, __VA_ARGS__)
+#define LOG_DEBUG_LIMITED(category, perSecond, ...) QTVK_LOG_IMPL(Debug, category, perSecond, __VA_ARGS__)
+#else
+#define LOG_DEBUG(category, ...) ((void)0)
+#define LOG_DEBUG_LIMITED(category, perSecond, ...) ((void)0)
+#endif
+
+#if QTVK_LOG_MIN_LEVEL <= 2
+#define LOG_INFO(category, ...) QTVK_LOG_IMPL(Info, category, 0, __VA_ARGS__)
+#define LOG_INFO_LIMITED(category, perSecond, ...) QTVK_LOG_IMPL(Info, category, perSecond, __VA_ARGS__)
+#else
+#define LOG_INFO(category, ...) ((void)0)
+#define LOG_INFO_LIMITED(category, perSecond, ...) ((void)0)
+#endif
+
+#if QTVK_LOG_MIN_LEVEL <= 3
+#define LOG_WARNING(category, ...) QTVK_LOG_IMPL(Warning, category, 0, __VA_ARGS__)
+#define LOG_WARNING_LIMITED(category, perSecond, ...) QTVK_LOG_IMPL(Warning, category, perSecond, __VA_ARGS__)
+#else
+#define LOG_WARNING(category, ...) ((void)0)
+#define LOG_WARNING_LIMITED(category, perSecond, ...) ((void)0)
+#endif
+
+#define LOG_ERROR(category, ...) QTVK_LOG_IMPL(Error, category, 0, __VA_ARGS__)
@@ -8,6 +8,7 @@
 #include <QMessageBox>
 #include <QTabWidget>
 #include "VulkanWindow.h"
+#include "PerformanceTab.h"
 
 MainWindow::MainWindow(VulkanWindow *vw, QPlainTextEdit *logWidget)
     : mVulkanWindow(vw)
@@ -30,15 +31,14 @@ MainWindow::MainWindow(VulkanWindow *vw, QPlainTextEdit *logWidget)
     connect(grabButton, &QPushButton::clicked, this, &MainWindow::onScreenGrabRequested);
     //connect quit button to quit-function
     connect(quitButton, &QPushButton::clicked, qApp, &QCoreApplication::quit);
-    //connect changes in our logger to trigger scroll to end of log window, using a lambda
-    connect(mLogWidget, &QPlainTextEdit::textChanged, [logWidget]()
-            { logWidget->moveCursor(QTextCursor::End); });
+    //Scrolling the log window to the end is done by Log::attachWidget, once per batch of lines
 
     //Makes the layout of the program, adding items we have made
     QVBoxLayout *layout = new QVBoxLayout;
     layout->addWidget(vulkanWindowWrapper, 7);
     mInfoTab = new QTabWidget(this);
     mInfoTab->addTab(mLogWidget, tr("Debug Log"));
+    mInfoTab->addTab(new PerformanceTab(vw->frameStatsRing()), tr("Performance"));
     layout->addWidget(mInfoTab, 2);
     QHBoxLayout *buttonLayout = new QHBoxLayout;
     buttonLayout->addWidget(grabButton, 1);
@@ -0,0 +1,61 @@
+#include "MemoryBudget.h"
+#include <QVulkanInstance>
+#include <cstring>
+
+void MemoryBudget::init(QVulkanWindow *window)
+{
+    mWindow = window;
+    mGetMemoryProperties2 = nullptr;
+
+    if (!mWindow->supportedDeviceExtensions().contains(QByteArrayLiteral("VK_EXT_memory_budget")))
+        return;
+
+    // Core in Vulkan 1.1, otherwise from VK_KHR_get_physical_device_properties2
+    QVulkanInstance *inst = mWindow->vulkanInstance();
+    mGetMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2>(
+                inst->getInstanceProcAddr("vkGetPhysicalDeviceMemoryProperties2"));
+    if (!mGetMemoryProperties2) {
+        mGetMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2>(
+                    inst->getInstanceProcAddr("vkGetPhysicalDeviceMemoryProperties2KHR"));
+    }
+}
+
+void MemoryBudget::query(uint64_t &usage, uint64_t &budget) const
+{
+    usage = 0;
+    budget = 0;
+    if (!isSupported())
+        return;
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties;
+    memset(&budgetProperties, 0, sizeof(budgetProperties));
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 properties;
+    memset(&properties, 0, sizeof(properties));
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = &budgetProperties;
+
+    mGetMemoryProperties2(mWindow->physicalDevice(), &properties);
+
+    for (uint32_t i = 0; i < properties.memoryProperties.memoryHeapCount; ++i) {
+        if (properties.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            usage += budgetProperties.heapUsage[i];
+            budget += budgetProperties.heapBudget[i];
+        }
+    }
+}
+
+uint64_t MemoryBudget::deviceLocalUsage() const
+{
+    uint64_t usage, budget;
+    query(usage, budget);
+    return usage;
+}
+
+uint64_t MemoryBudget::deviceLocalBudget() const
+{
+    uint64_t usage, budget;
+    query(usage, budget);
+    return budget;
+}
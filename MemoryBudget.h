@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QVulkanWindow>
+#include <cstdint>
+
+// Reads how much device-local memory the process uses through VK_EXT_memory_budget.
+// The extension is requested by VulkanWindow and main.cpp; when the driver does not
+// have it isSupported() is false and usage is reported as 0.
+class MemoryBudget
+{
+public:
+    void init(QVulkanWindow *window);
+
+    bool isSupported() const { return mGetMemoryProperties2 != nullptr; }
+
+    // Bytes used in device-local heaps right now, 0 when not supported
+    uint64_t deviceLocalUsage() const;
+    // Bytes of device-local memory the process can use before it gets into trouble
+    uint64_t deviceLocalBudget() const;
+
+private:
+    void query(uint64_t &usage, uint64_t &budget) const;
+
+    QVulkanWindow *mWindow = nullptr;
+    PFN_vkGetPhysicalDeviceMemoryProperties2 mGetMemoryProperties2 = nullptr;
+};
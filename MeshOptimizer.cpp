@@ -0,0 +1,297 @@
+#include "MeshOptimizer.h"
+#include <QtGlobal>
+#include <QVector3D>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+// Simulated LRU cache of the vertex cache ordering, larger than any real one so the order suits them all
+static const int CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+// The vertices of the triangle just drawn score a bit lower, so strips don't keep turning back
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+// Vertices with few triangles left are worth finishing off
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+// FIFO size the overdraw pass splits the triangle order into runs with
+static const int CLUSTER_CACHE_SIZE = 16;
+
+static const uint32_t NONE = 0xffffffffu;
+
+namespace {
+
+float vertexScore(int cachePosition, uint32_t remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            score = LAST_TRIANGLE_SCORE;
+        } else {
+            const float position = float(cachePosition - 3) / float(CACHE_SIZE - 3);
+            score = std::pow(1.0f - position, CACHE_DECAY_POWER);
+        }
+    }
+    return score + VALENCE_BOOST_SCALE * std::pow(float(remainingTriangles), -VALENCE_BOOST_POWER);
+}
+
+QVector3D positionOf(const float *vertices, size_t strideFloats, uint32_t index)
+{
+    const float *position = vertices + size_t(index) * strideFloats;
+    return QVector3D(position[0], position[1], position[2]);
+}
+
+} // namespace
+
+void PackedMesh::write(void *data) const
+{
+    uint8_t *bytes = static_cast<uint8_t *>(data);
+    memcpy(bytes, vertices.data(), vertices.size() * sizeof(PackedVertex));
+    memcpy(bytes + indexOffset(), indices.data(), indices.size() * sizeof(uint16_t));
+}
+
+PackedMesh MeshOptimizer::optimize(const float *vertices, size_t vertexCount, size_t strideFloats, const LodChain &lod)
+{
+    // Weld: vertices equal in every attribute become one
+    std::vector<uint32_t> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0u);
+    auto vertexAt = [vertices, strideFloats](uint32_t index) { return vertices + size_t(index) * strideFloats; };
+    std::sort(order.begin(), order.end(), [&vertexAt, strideFloats](uint32_t a, uint32_t b) {
+        return std::lexicographical_compare(vertexAt(a), vertexAt(a) + strideFloats, vertexAt(b), vertexAt(b) + strideFloats);
+    });
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<float> welded;
+    uint32_t weldedCount = 0;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        if (i > 0 && std::equal(vertexAt(order[i]), vertexAt(order[i]) + strideFloats, vertexAt(order[i - 1]))) {
+            remap[order[i]] = remap[order[i - 1]];
+            continue;
+        }
+        remap[order[i]] = weldedCount++;
+        welded.insert(welded.end(), vertexAt(order[i]), vertexAt(order[i]) + strideFloats);
+    }
+    // The indices are 16 bit everywhere they are drawn, a larger mesh can't be drawn correctly
+    if (weldedCount > 65536)
+        qFatal("Mesh has %u vertices after welding, 16 bit indices reach 65536", weldedCount);
+
+    PackedMesh mesh;
+    mesh.levels = lod.levels;
+    mesh.indices.resize(lod.indices.size());
+    for (size_t i = 0; i < lod.indices.size(); ++i)
+        mesh.indices[i] = uint16_t(remap[lod.indices[i]]);
+
+    for (const LodLevel &level : mesh.levels) {
+        uint16_t *indices = mesh.indices.data() + level.firstIndex;
+        optimizeVertexCache(indices, level.indexCount, weldedCount);
+        optimizeOverdraw(indices, level.indexCount, welded.data(), strideFloats);
+    }
+
+    // Vertices in the order the indices first use them. Level 0 comes first and uses all the
+    // others do, vertices no level uses are left out.
+    std::vector<uint32_t> fetchOrder(weldedCount, NONE);
+    uint32_t used = 0;
+    for (uint16_t &index : mesh.indices) {
+        if (fetchOrder[index] == NONE)
+            fetchOrder[index] = used++;
+        index = uint16_t(fetchOrder[index]);
+    }
+    mesh.vertices.resize(used);
+    for (uint32_t v = 0; v < weldedCount; ++v) {
+        if (fetchOrder[v] != NONE)
+            mesh.vertices[fetchOrder[v]] = packVertex(welded.data() + size_t(v) * strideFloats);
+    }
+    return mesh;
+}
+
+void MeshOptimizer::optimizeVertexCache(uint16_t *indices, size_t indexCount, size_t vertexCount)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Triangles around every vertex. The first remaining[v] of a vertex' list are the ones not drawn yet.
+    std::vector<uint32_t> remaining(vertexCount);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        remaining[indices[i]]++;
+    std::vector<uint32_t> firstTriangle(vertexCount + 1);
+    for (size_t v = 0; v < vertexCount; ++v)
+        firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+        adjacency[filled[indices[i]]++] = uint32_t(i / 3);
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        vertexScores[v] = vertexScore(-1, remaining[v]);
+    std::vector<float> triangleScores(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+    std::vector<bool> drawn(triangleCount);
+    std::vector<uint16_t> result;
+    result.reserve(triangleCount * 3);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(CACHE_SIZE + 3);
+    nextCache.reserve(CACHE_SIZE + 3);
+    size_t scanFrom = 0;
+    uint32_t best = NONE;
+
+    while (result.size() < triangleCount * 3) {
+        // Nothing in the cache has triangles left, go on with the first one not drawn
+        if (best == NONE) {
+            while (drawn[scanFrom])
+                ++scanFrom;
+            best = uint32_t(scanFrom);
+        }
+
+        const uint16_t *triangle = indices + size_t(best) * 3;
+        drawn[best] = true;
+        for (int corner = 0; corner < 3; ++corner) {
+            const uint16_t v = triangle[corner];
+            result.push_back(v);
+            uint32_t *around = adjacency.data() + firstTriangle[v];
+            uint32_t *last = around + remaining[v] - 1;
+            std::iter_swap(std::find(around, last + 1, best), last);
+            remaining[v]--;
+        }
+
+        // The triangle's vertices to the front, the rest of the cache behind them
+        nextCache.assign(triangle, triangle + 3);
+        for (uint32_t v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                nextCache.push_back(v);
+        }
+        for (size_t i = 0; i < nextCache.size(); ++i)
+            cachePosition[nextCache[i]] = i < size_t(CACHE_SIZE) ? int(i) : -1;
+        std::swap(cache, nextCache);
+
+        // New scores of everything that moved, the best triangle around the cache is next
+        for (uint32_t v : cache)
+            vertexScores[v] = vertexScore(cachePosition[v], remaining[v]);
+        best = NONE;
+        float bestScore = -1.0f;
+        for (uint32_t v : cache) {
+            for (uint32_t i = 0; i < remaining[v]; ++i) {
+                const uint32_t t = adjacency[firstTriangle[v] + i];
+                const uint16_t *corners = indices + size_t(t) * 3;
+                triangleScores[t] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+                if (triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    best = t;
+                }
+            }
+        }
+        if (cache.size() > size_t(CACHE_SIZE))
+            cache.resize(CACHE_SIZE);
+    }
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimizer::optimizeOverdraw(uint16_t *indices, size_t indexCount, const float *vertices, size_t strideFloats)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+        return;
+
+    // A run starts where a triangle finds none of its vertices in the cache, there the
+    // vertex cache order jumped anyway and moving the runs around costs next to nothing
+    std::vector<size_t> runStarts;
+    std::vector<uint32_t> fifo;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        int misses = 0;
+        for (int corner = 0; corner < 3; ++corner) {
+            const uint32_t v = indices[t * 3 + size_t(corner)];
+            if (std::find(fifo.begin(), fifo.end(), v) == fifo.end()) {
+                misses++;
+                fifo.push_back(v);
+                if (fifo.size() > size_t(CLUSTER_CACHE_SIZE))
+                    fifo.erase(fifo.begin());
+            }
+        }
+        if (t == 0 || misses == 3)
+            runStarts.push_back(t);
+    }
+    if (runStarts.size() < 2)
+        return;
+    runStarts.push_back(triangleCount);
+
+    // Area weighted normal and center of every run and of the whole mesh
+    struct Run {
+        size_t begin;
+        size_t end;
+        QVector3D normal;
+        QVector3D center;
+        float area;
+        float sortKey;
+    };
+    std::vector<Run> runs;
+    QVector3D meshCenter;
+    float meshArea = 0.0f;
+    for (size_t r = 0; r + 1 < runStarts.size(); ++r) {
+        Run run = { runStarts[r], runStarts[r + 1], QVector3D(), QVector3D(), 0.0f, 0.0f };
+        for (size_t t = run.begin; t < run.end; ++t) {
+            const QVector3D a = positionOf(vertices, strideFloats, indices[t * 3]);
+            const QVector3D b = positionOf(vertices, strideFloats, indices[t * 3 + 1]);
+            const QVector3D c = positionOf(vertices, strideFloats, indices[t * 3 + 2]);
+            const QVector3D normal = QVector3D::crossProduct(b - a, c - a);
+            const float area = normal.length();
+            run.normal += normal;
+            run.center += (a + b + c) * (area / 3.0f);
+            run.area += area;
+        }
+        meshCenter += run.center;
+        meshArea += run.area;
+        runs.push_back(run);
+    }
+    if (meshArea <= 0.0f)
+        return;
+    meshCenter /= meshArea;
+
+    // How far out the run's plane lies. The pipelines don't cull back faces and the meshes
+    // don't agree on a winding, so the side the normal points to doesn't count.
+    for (Run &run : runs) {
+        if (run.area <= 0.0f || run.normal.lengthSquared() == 0.0f)
+            continue;
+        run.center /= run.area;
+        run.sortKey = std::fabs(QVector3D::dotProduct(run.normal.normalized(), run.center - meshCenter));
+    }
+    std::stable_sort(runs.begin(), runs.end(), [](const Run &x, const Run &y) { return x.sortKey > y.sortKey; });
+
+    std::vector<uint16_t> result;
+    result.reserve(triangleCount * 3);
+    for (const Run &run : runs)
+        result.insert(result.end(), indices + run.begin * 3, indices + run.end * 3);
+    std::copy(result.begin(), result.end(), indices);
+}
+
+float MeshOptimizer::cacheMissRatio(const uint16_t *indices, size_t indexCount, size_t vertexCount, int cacheSize)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return 0.0f;
+
+    // The time every vertex entered the cache, it drops out cacheSize misses later
+    std::vector<size_t> entered(vertexCount, 0);
+    size_t misses = 0;
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        const uint16_t v = indices[i];
+        if (entered[v] == 0 || misses - entered[v] >= size_t(cacheSize)) {
+            misses++;
+            entered[v] = misses;
+        }
+    }
+    return float(misses) / float(triangleCount);
+}
+
+PackedVertex MeshOptimizer::packVertex(const float *vertex)
+{
+    PackedVertex packed;
+    PackedVertexFormat::pack(vertex, &packed);
+    return packed;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshSimplifier.h"
+#include "VertexFormat.h"
+
+// Vertex as the pipelines read it, 12 bytes instead of 24 for X, Y, Z, R, G, B in floats.
+// The position is R16G16B16A16_SFLOAT with w = 1, the color R8G8B8A8_UNORM with alpha 1.
+struct PackedVertex
+{
+    uint16_t position[4];
+    uint8_t color[4];
+};
+static_assert(sizeof(PackedVertex) == PackedVertexFormat::stride
+              && offsetof(PackedVertex, position) == PackedVertexFormat::offset(0)
+              && offsetof(PackedVertex, color) == PackedVertexFormat::offset(1),
+              "PackedVertex has to match PackedVertexFormat");
+
+// A mesh ready for upload: packed vertices and 16 bit indices in one buffer, the indices
+// right behind the vertices. Levels of detail are ranges of the indices like in LodChain.
+struct PackedMesh
+{
+    std::vector<PackedVertex> vertices;
+    std::vector<uint16_t> indices;      // All levels one after another
+    std::vector<LodLevel> levels;       // Level 0 is the mesh itself
+
+    // Where the indices start in the buffer, a multiple of four bytes
+    size_t indexOffset() const { return (vertices.size() * sizeof(PackedVertex) + 3) & ~size_t(3); }
+    size_t byteSize() const { return indexOffset() + indices.size() * sizeof(uint16_t); }
+    // Vertices and indices into mapped buffer memory of byteSize()
+    void write(void *data) const;
+
+    int select(float pixelsPerUnit, float maxPixels, int current) const
+    {
+        return LodChain::selectLevel(levels, pixelsPerUnit, maxPixels, current);
+    }
+};
+
+// Turns the X, Y, Z, R, G, B meshes of the sources into what the GPU reads fastest.
+//
+// Equal vertices are welded, every level of detail is ordered for the post-transform
+// vertex cache (Forsyth) and then for overdraw, and the vertices are put in the order
+// the indices first use them, so fetching walks through memory. Meshes have to weld
+// down to 65536 vertices for the 16 bit indices, optimize() fails with qFatal otherwise.
+namespace MeshOptimizer {
+
+PackedMesh optimize(const float *vertices, size_t vertexCount, size_t strideFloats, const LodChain &lod);
+
+// Triangle order that reuses the vertices the last triangles left in the cache
+void optimizeVertexCache(uint16_t *indices, size_t indexCount, size_t vertexCount);
+// Keeps runs of triangles that share the cache together, and draws the runs farther out
+// from the center of the mesh first, they are the likelier ones to hide the others
+void optimizeOverdraw(uint16_t *indices, size_t indexCount, const float *vertices, size_t strideFloats);
+// Vertex cache misses per triangle with a FIFO cache of cacheSize, 0.5 is the best a large mesh gets
+float cacheMissRatio(const uint16_t *indices, size_t indexCount, size_t vertexCount, int cacheSize);
+
+PackedVertex packVertex(const float *vertex);
+
+} // namespace MeshOptimizer
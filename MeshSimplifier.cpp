@@ -0,0 +1,256 @@
+#include "MeshSimplifier.h"
+#include <QVector3D>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// A level has to lose at least this share of the triangles of the level before
+static const float MIN_REDUCTION = 0.1f;
+
+namespace {
+
+// Sum of squared distances to a set of planes, as the symmetric 4x4 matrix of Garland and Heckbert
+struct Quadric
+{
+    double a[10] = {};      // xx, xy, xz, xw, yy, yz, yw, zz, zw, ww
+
+    void addPlane(const QVector3D &normal, float d)
+    {
+        const double p[4] = { normal.x(), normal.y(), normal.z(), d };
+        int k = 0;
+        for (int row = 0; row < 4; ++row) {
+            for (int column = row; column < 4; ++column)
+                a[k++] += p[row] * p[column];
+        }
+    }
+
+    void add(const Quadric &other)
+    {
+        for (int i = 0; i < 10; ++i)
+            a[i] += other.a[i];
+    }
+
+    double evaluate(const QVector3D &v) const
+    {
+        const double x = v.x(), y = v.y(), z = v.z();
+        return a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z + 2.0 * a[3] * x
+             + a[4] * y * y + 2.0 * a[5] * y * z + 2.0 * a[6] * y
+             + a[7] * z * z + 2.0 * a[8] * z + a[9];
+    }
+};
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+QVector3D triangleNormal(const QVector3D &a, const QVector3D &b, const QVector3D &c)
+{
+    return QVector3D::crossProduct(b - a, c - a);
+}
+
+// True when moving from onto to turns a triangle around from over
+bool collapseFlips(const std::vector<uint32_t> &triangles, const std::vector<QVector3D> &positions,
+                   uint32_t from, uint32_t to)
+{
+    for (size_t t = 0; t < triangles.size(); t += 3) {
+        const uint32_t *triangle = &triangles[t];
+        const int corner = triangle[0] == from ? 0 : triangle[1] == from ? 1 : triangle[2] == from ? 2 : -1;
+        // Triangles with both vertices disappear
+        if (corner < 0 || triangle[0] == to || triangle[1] == to || triangle[2] == to)
+            continue;
+
+        QVector3D corners[3] = { positions[triangle[0]], positions[triangle[1]], positions[triangle[2]] };
+        const QVector3D before = triangleNormal(corners[0], corners[1], corners[2]);
+        corners[corner] = positions[to];
+        const QVector3D after = triangleNormal(corners[0], corners[1], corners[2]);
+        if (QVector3D::dotProduct(before, after) <= 0.0f)
+            return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int LodChain::selectLevel(const std::vector<LodLevel> &levels, float pixelsPerUnit, float maxPixels, int current)
+{
+    for (int level = int(levels.size()) - 1; level > 0; --level) {
+        const float limit = level > current ? maxPixels * (1.0f - HYSTERESIS) : maxPixels;
+        if (levels[size_t(level)].error * pixelsPerUnit <= limit)
+            return level;
+    }
+    return 0;
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(const float *vertices, size_t vertexCount, size_t strideFloats,
+                                               const uint32_t *indices, size_t indexCount, size_t targetIndexCount,
+                                               float *error)
+{
+    std::vector<QVector3D> positions(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float *position = vertices + i * strideFloats;
+        positions[i] = QVector3D(position[0], position[1], position[2]);
+    }
+
+    // Weld: every vertex is replaced by the first one at its position
+    std::vector<uint32_t> order(vertexCount);
+    std::iota(order.begin(), order.end(), 0u);
+    auto lessPosition = [&positions](uint32_t a, uint32_t b) {
+        const QVector3D &pa = positions[a];
+        const QVector3D &pb = positions[b];
+        if (pa.x() != pb.x())
+            return pa.x() < pb.x();
+        if (pa.y() != pb.y())
+            return pa.y() < pb.y();
+        if (pa.z() != pb.z())
+            return pa.z() < pb.z();
+        return a < b;
+    };
+    std::sort(order.begin(), order.end(), lessPosition);
+    std::vector<uint32_t> remap(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const bool samePosition = i > 0 && positions[order[i]] == positions[order[i - 1]];
+        remap[order[i]] = samePosition ? remap[order[i - 1]] : order[i];
+    }
+
+    std::vector<uint32_t> triangles;
+    triangles.reserve(indexCount);
+    for (size_t t = 0; t + 2 < indexCount; t += 3) {
+        const uint32_t a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+        if (a != b && b != c && c != a)
+            triangles.insert(triangles.end(), { a, b, c });
+    }
+
+    // Plane of every triangle around a vertex, plus a plane standing on every border
+    // edge, so moving along the border costs as much as moving away from the surface
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<std::pair<uint64_t, size_t>> edges;
+    for (size_t t = 0; t < triangles.size(); t += 3) {
+        QVector3D normal = triangleNormal(positions[triangles[t]], positions[triangles[t + 1]], positions[triangles[t + 2]]);
+        if (normal.lengthSquared() == 0.0f)
+            continue;
+        normal.normalize();
+        const float d = -QVector3D::dotProduct(normal, positions[triangles[t]]);
+        for (int corner = 0; corner < 3; ++corner) {
+            quadrics[triangles[t + size_t(corner)]].addPlane(normal, d);
+            const uint32_t a = triangles[t + size_t(corner)];
+            const uint32_t b = triangles[t + size_t(corner + 1) % 3];
+            edges.push_back({ (uint64_t(std::min(a, b)) << 32) | std::max(a, b), t });
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size(); ++i) {
+        const bool shared = (i > 0 && edges[i - 1].first == edges[i].first)
+                            || (i + 1 < edges.size() && edges[i + 1].first == edges[i].first);
+        if (shared)
+            continue;
+        const uint32_t a = uint32_t(edges[i].first >> 32);
+        const uint32_t b = uint32_t(edges[i].first & 0xffffffffu);
+        const size_t t = edges[i].second;
+        const QVector3D faceNormal = triangleNormal(positions[triangles[t]], positions[triangles[t + 1]],
+                                                    positions[triangles[t + 2]]);
+        QVector3D normal = QVector3D::crossProduct(positions[b] - positions[a], faceNormal);
+        if (normal.lengthSquared() == 0.0f)
+            continue;
+        normal.normalize();
+        const float d = -QVector3D::dotProduct(normal, positions[a]);
+        quadrics[a].addPlane(normal, d);
+        quadrics[b].addPlane(normal, d);
+    }
+
+    // Passes over all edges, cheapest first. A vertex takes part in one collapse per
+    // pass, its neighbors' costs are only up to date again in the next one.
+    double largestCost = 0.0;
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched(vertexCount);
+    while (triangles.size() > targetIndexCount) {
+        collapses.clear();
+        for (size_t t = 0; t < triangles.size(); t += 3) {
+            for (int corner = 0; corner < 3; ++corner) {
+                const uint32_t a = triangles[t + size_t(corner)];
+                const uint32_t b = triangles[t + size_t(corner + 1) % 3];
+                // Edges between two triangles come twice, the second one finds its vertices touched
+                Quadric sum = quadrics[a];
+                sum.add(quadrics[b]);
+                const double costA = sum.evaluate(positions[a]);
+                const double costB = sum.evaluate(positions[b]);
+                collapses.push_back(costA < costB ? Collapse{ b, a, costA } : Collapse{ a, b, costB });
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse &x, const Collapse &y) { return x.cost < y.cost; });
+
+        std::fill(touched.begin(), touched.end(), false);
+        bool collapsed = false;
+        for (const Collapse &collapse : collapses) {
+            if (triangles.size() <= targetIndexCount)
+                break;
+            if (touched[collapse.from] || touched[collapse.to]
+                    || collapseFlips(triangles, positions, collapse.from, collapse.to))
+                continue;
+
+            size_t kept = 0;
+            for (size_t t = 0; t < triangles.size(); t += 3) {
+                uint32_t triangle[3] = { triangles[t], triangles[t + 1], triangles[t + 2] };
+                for (uint32_t &index : triangle) {
+                    if (index == collapse.from)
+                        index = collapse.to;
+                }
+                if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0])
+                    continue;
+                for (int corner = 0; corner < 3; ++corner)
+                    triangles[kept++] = triangle[corner];
+            }
+            triangles.resize(kept);
+
+            // The neighbors of both vertices have moved edges now
+            for (size_t t = 0; t < triangles.size(); t += 3) {
+                if (triangles[t] == collapse.to || triangles[t + 1] == collapse.to || triangles[t + 2] == collapse.to) {
+                    touched[triangles[t]] = touched[triangles[t + 1]] = touched[triangles[t + 2]] = true;
+                }
+            }
+            touched[collapse.from] = touched[collapse.to] = true;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            largestCost = std::max(largestCost, collapse.cost);
+            collapsed = true;
+        }
+        if (!collapsed)
+            break;
+    }
+
+    if (error)
+        *error = float(std::sqrt(std::max(largestCost, 0.0)));
+    return triangles;
+}
+
+LodChain MeshSimplifier::buildLodChain(const float *vertices, size_t vertexCount, size_t strideFloats,
+                                       const uint32_t *indices, size_t indexCount, int maxLevels)
+{
+    LodChain chain;
+    chain.indices.assign(indices, indices + indexCount);
+    chain.levels.push_back({ 0, uint32_t(indexCount), 0.0f });
+
+    while (int(chain.levels.size()) < maxLevels) {
+        const LodLevel &previous = chain.levels.back();
+        const size_t target = previous.indexCount / 6 * 3;
+        if (target == 0)
+            break;
+
+        // Always from the full mesh, so errors don't pile up from level to level
+        float error = 0.0f;
+        const std::vector<uint32_t> level = simplify(vertices, vertexCount, strideFloats, indices, indexCount,
+                                                     target, &error);
+        if (level.empty() || float(level.size()) > float(previous.indexCount) * (1.0f - MIN_REDUCTION))
+            break;
+
+        LodLevel lod;
+        lod.firstIndex = uint32_t(chain.indices.size());
+        lod.indexCount = uint32_t(level.size());
+        lod.error = std::max(error, previous.error);
+        chain.indices.insert(chain.indices.end(), level.begin(), level.end());
+        chain.levels.push_back(lod);
+    }
+    return chain;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One level of detail, a range of LodChain::indices
+struct LodLevel
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;         // How far in model space the level may lie from the full mesh
+};
+
+// Levels of detail of one mesh. Every level indexes the mesh's own vertices,
+// so the levels share the vertex buffer and only the index buffer grows.
+struct LodChain
+{
+    // Going coarser needs the error this much below the limit, going finer happens
+    // right at the limit. Objects near a switching distance don't flip every frame.
+    static constexpr float HYSTERESIS = 0.25f;
+
+    std::vector<uint32_t> indices;      // All levels one after another
+    std::vector<LodLevel> levels;       // Level 0 is the mesh itself
+
+    // Coarsest level whose error stays within maxPixels on screen. pixelsPerUnit is
+    // the size of one model space unit at the object's distance, current the level
+    // the object was drawn with last time.
+    int select(float pixelsPerUnit, float maxPixels, int current) const
+    {
+        return selectLevel(levels, pixelsPerUnit, maxPixels, current);
+    }
+    // The same for levels kept elsewhere, as in PackedMesh
+    static int selectLevel(const std::vector<LodLevel> &levels, float pixelsPerUnit, float maxPixels, int current);
+};
+
+// Mesh simplification with quadric error metrics (Garland and Heckbert).
+//
+// Vertices at the same position are welded first, so meshes with a vertex per face
+// corner stay connected. Every edge collapse keeps one of its two vertices, the
+// simplified mesh only uses vertices of the original. Edges along holes and open
+// borders get extra planes, so the outline of the mesh stays where it is.
+namespace MeshSimplifier {
+
+// Triangle list down to at most targetIndexCount indices, or as far as collapses
+// without flipping triangles get. error receives the largest error of a collapse.
+std::vector<uint32_t> simplify(const float *vertices, size_t vertexCount, size_t strideFloats,
+                               const uint32_t *indices, size_t indexCount, size_t targetIndexCount, float *error);
+
+// The mesh and up to maxLevels - 1 simplified levels, each with about half the
+// triangles of the one before. Stops early when a level can't get much smaller.
+LodChain buildLodChain(const float *vertices, size_t vertexCount, size_t strideFloats,
+                       const uint32_t *indices, size_t indexCount, int maxLevels);
+
+} // namespace MeshSimplifier
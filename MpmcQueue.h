@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Bounded multi-producer multi-consumer queue (Dmitry Vyukov's design).
+// Every cell has a sequence number that tells producers and consumers whose
+// turn it is, so push and pop are a CAS on one index and never take a lock.
+// push() fails instead of blocking when the queue is full.
+template<typename T, size_t Capacity>
+class MpmcQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    MpmcQueue()
+    {
+        for (size_t i = 0; i < Capacity; ++i)
+            mCells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue &) = delete;
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+    bool push(T &&value)
+    {
+        Cell *cell;
+        size_t position = mEnqueuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &mCells[position & (Capacity - 1)];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t difference = intptr_t(sequence) - intptr_t(position);
+            if (difference == 0) {
+                if (mEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            } else if (difference < 0) {
+                return false;   // Full
+            } else {
+                position = mEnqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T &value)
+    {
+        Cell *cell;
+        size_t position = mDequeuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &mCells[position & (Capacity - 1)];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t difference = intptr_t(sequence) - intptr_t(position + 1);
+            if (difference == 0) {
+                if (mDequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            } else if (difference < 0) {
+                return false;   // Empty
+            } else {
+                position = mDequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(position + Capacity, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // Producer and consumer indices on their own cache lines
+    alignas(64) Cell mCells[Capacity];
+    alignas(64) std::atomic<size_t> mEnqueuePosition{ 0 };
+    alignas(64) std::atomic<size_t> mDequeuePosition{ 0 };
+};
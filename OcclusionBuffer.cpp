@@ -0,0 +1,201 @@
+#include "OcclusionBuffer.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_BUFFER_SSE 1
+#endif
+
+// Depth of pixels no occluder covers - every object is nearer
+static const float EMPTY_DEPTH = FLT_MAX;
+// Projected w below this is treated as behind the camera
+static const float MIN_W = 1.0e-5f;
+
+OcclusionBuffer::OcclusionBuffer()
+    : mDepth(size_t(WIDTH) * HEIGHT, EMPTY_DEPTH)
+{
+}
+
+void OcclusionBuffer::begin(const QMatrix4x4 &viewProjection)
+{
+    for (int row = 0; row < 4; ++row) {
+        for (int column = 0; column < 4; ++column)
+            mMatrix[row][column] = viewProjection(row, column);
+    }
+    mTriangles.clear();
+}
+
+bool OcclusionBuffer::project(const QVector3D &position, float &x, float &y, float &z) const
+{
+    float clip[4];
+    for (int row = 0; row < 4; ++row) {
+        clip[row] = mMatrix[row][0] * position.x() + mMatrix[row][1] * position.y()
+                  + mMatrix[row][2] * position.z() + mMatrix[row][3];
+    }
+    if (clip[3] < MIN_W)
+        return false;
+    const float inverseW = 1.0f / clip[3];
+    x = (clip[0] * inverseW * 0.5f + 0.5f) * float(WIDTH);
+    y = (clip[1] * inverseW * 0.5f + 0.5f) * float(HEIGHT);
+    z = clip[2] * inverseW;
+    return true;
+}
+
+void OcclusionBuffer::addOccluder(const float *vertices, size_t vertexCount, size_t strideFloats,
+                                  const QVector3D &offset)
+{
+    for (size_t first = 0; first + 2 < vertexCount; first += 3) {
+        float x[3], y[3], z[3];
+        bool inFront = true;
+        for (int i = 0; i < 3; ++i) {
+            const float *position = vertices + (first + size_t(i)) * strideFloats;
+            inFront = inFront && project(QVector3D(position[0], position[1], position[2]) + offset, x[i], y[i], z[i]);
+        }
+        if (!inFront)
+            continue;
+
+        float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (std::fabs(area) < 1.0e-6f)
+            continue;
+        // Counter-clockwise from here on, so inside is where all edge functions are positive
+        if (area < 0.0f) {
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            std::swap(z[1], z[2]);
+            area = -area;
+        }
+
+        Triangle triangle;
+        triangle.minX = std::min({ x[0], x[1], x[2] });
+        triangle.maxX = std::max({ x[0], x[1], x[2] });
+        triangle.minY = std::min({ y[0], y[1], y[2] });
+        triangle.maxY = std::max({ y[0], y[1], y[2] });
+        if (triangle.maxX < 0.0f || triangle.minX > float(WIDTH) || triangle.maxY < 0.0f || triangle.minY > float(HEIGHT))
+            continue;
+
+        for (int edge = 0; edge < 3; ++edge) {
+            const int a = edge;
+            const int b = (edge + 1) % 3;
+            triangle.edgeA[edge] = y[a] - y[b];
+            triangle.edgeB[edge] = x[b] - x[a];
+            // Tested at pixel centers, pulled in by half a pixel's slope: a pixel counts as inside
+            // only when its least covered corner is, so partly covered pixels aren't occluders
+            triangle.edgeC[edge] = x[a] * y[b] - x[b] * y[a]
+                    - 0.5f * (std::fabs(triangle.edgeA[edge]) + std::fabs(triangle.edgeB[edge]));
+        }
+
+        // z / w is linear in screen space. Half a pixel's slope on top gives the farthest
+        // depth anywhere in the pixel, not just at its center.
+        const float depthDx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+        const float depthDy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+        triangle.depthDx = depthDx;
+        triangle.depthDy = depthDy;
+        triangle.depth0 = z[0] - depthDx * x[0] - depthDy * y[0] + 0.5f * (std::fabs(depthDx) + std::fabs(depthDy));
+        mTriangles.push_back(triangle);
+    }
+}
+
+void OcclusionBuffer::rasterizeTile(int tile)
+{
+    const int tileBegin = tile * TILE_HEIGHT;
+    const int tileEnd = tileBegin + TILE_HEIGHT;
+    float *tileDepth = mDepth.data() + size_t(tileBegin) * WIDTH;
+    std::fill(tileDepth, tileDepth + size_t(TILE_HEIGHT) * WIDTH, EMPTY_DEPTH);
+
+    for (const Triangle &triangle : mTriangles) {
+        if (triangle.maxY < float(tileBegin) || triangle.minY > float(tileEnd))
+            continue;
+        const int rowBegin = std::max(tileBegin, int(std::floor(triangle.minY)));
+        const int rowEnd = std::min(tileEnd, int(std::ceil(triangle.maxY)));
+        // Columns start at a multiple of four, WIDTH being one keeps the last group inside the row
+        const int columnBegin = int(std::floor(std::max(triangle.minX, 0.0f))) & ~3;
+        const int columnEnd = int(std::ceil(std::min(triangle.maxX, float(WIDTH))));
+
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            const float centerY = float(row) + 0.5f;
+            float *depthRow = mDepth.data() + size_t(row) * WIDTH;
+#ifdef OCCLUSION_BUFFER_SSE
+            // Edge functions and depth of four neighboring pixel centers
+            const __m128 centerX = _mm_add_ps(_mm_set1_ps(float(columnBegin)), _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+            __m128 edge[3], edgeStep[3];
+            for (int i = 0; i < 3; ++i) {
+                edge[i] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[i]), centerX),
+                                     _mm_set1_ps(triangle.edgeB[i] * centerY + triangle.edgeC[i]));
+                edgeStep[i] = _mm_set1_ps(triangle.edgeA[i] * 4.0f);
+            }
+            __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.depthDx), centerX),
+                                      _mm_set1_ps(triangle.depth0 + triangle.depthDy * centerY));
+            const __m128 depthStep = _mm_set1_ps(triangle.depthDx * 4.0f);
+            const __m128 zero = _mm_setzero_ps();
+
+            for (int column = columnBegin; column < columnEnd; column += 4) {
+                const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge[0], zero), _mm_cmpge_ps(edge[1], zero)),
+                                                 _mm_cmpge_ps(edge[2], zero));
+                const __m128 old = _mm_loadu_ps(depthRow + column);
+                const __m128 nearer = _mm_min_ps(old, depth);
+                _mm_storeu_ps(depthRow + column, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+                for (int i = 0; i < 3; ++i)
+                    edge[i] = _mm_add_ps(edge[i], edgeStep[i]);
+                depth = _mm_add_ps(depth, depthStep);
+            }
+#else
+            for (int column = columnBegin; column < columnEnd; ++column) {
+                const float centerX = float(column) + 0.5f;
+                bool inside = true;
+                for (int i = 0; i < 3; ++i)
+                    inside = inside && triangle.edgeA[i] * centerX + triangle.edgeB[i] * centerY + triangle.edgeC[i] >= 0.0f;
+                if (inside) {
+                    const float depth = triangle.depth0 + triangle.depthDx * centerX + triangle.depthDy * centerY;
+                    depthRow[column] = std::min(depthRow[column], depth);
+                }
+            }
+#endif
+        }
+    }
+}
+
+bool OcclusionBuffer::isOccluded(const QVector3D &min, const QVector3D &max) const
+{
+    // Rectangle and nearest depth of the eight corners
+    float minX = FLT_MAX, maxX = -FLT_MAX, minY = FLT_MAX, maxY = -FLT_MAX, nearest = FLT_MAX;
+    for (int corner = 0; corner < 8; ++corner) {
+        const QVector3D position((corner & 1) ? max.x() : min.x(), (corner & 2) ? max.y() : min.y(),
+                                 (corner & 4) ? max.z() : min.z());
+        float x, y, z;
+        // Reaches behind the camera, where nothing can hide it
+        if (!project(position, x, y, z))
+            return false;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearest = std::min(nearest, z);
+    }
+    if (maxX < 0.0f || minX >= float(WIDTH) || maxY < 0.0f || minY >= float(HEIGHT))
+        return false;
+
+    const int rowBegin = std::max(0, int(std::floor(minY)));
+    const int rowEnd = std::min(HEIGHT - 1, int(std::floor(maxY)));
+    // Groups of four may test a few pixels left and right of the rectangle too, which only makes it stricter
+    const int columnBegin = std::max(0, int(std::floor(minX))) & ~3;
+    const int columnEnd = std::min(WIDTH - 1, int(std::floor(maxX)));
+
+    for (int row = rowBegin; row <= rowEnd; ++row) {
+        const float *depthRow = mDepth.data() + size_t(row) * WIDTH;
+#ifdef OCCLUSION_BUFFER_SSE
+        const __m128 objectDepth = _mm_set1_ps(nearest);
+        for (int column = columnBegin; column <= columnEnd; column += 4) {
+            if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(depthRow + column), objectDepth)) != 0)
+                return false;
+        }
+#else
+        for (int column = columnBegin; column <= columnEnd; ++column) {
+            if (depthRow[column] >= nearest)
+                return false;
+        }
+#endif
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <cstddef>
+#include <vector>
+
+// Small depth buffer on the CPU for occlusion culling without any help from the GPU.
+//
+// The marked occluders are projected and set up once per frame (addOccluder), then
+// rasterized four pixels at a time with SSE. The buffer is split into bands of rows
+// that are cleared and filled independently, so every band can be its own task.
+// Objects are tested with the screen rectangle and nearest depth of their bounding
+// box: they are hidden when every pixel of the rectangle holds something nearer.
+//
+// A pixel is covered when its center is inside a triangle and gets the farthest depth
+// the triangle reaches inside that pixel, so depth never errs towards hiding things.
+class OcclusionBuffer
+{
+public:
+    static constexpr int WIDTH = 256;           // Multiple of four, for the SIMD loops
+    static constexpr int HEIGHT = 128;
+    static constexpr int TILE_HEIGHT = 16;      // Rows per band
+    static constexpr int TILE_COUNT = HEIGHT / TILE_HEIGHT;
+
+    OcclusionBuffer();
+
+    // Forgets the occluders of the last frame
+    void begin(const QMatrix4x4 &viewProjection);
+    // Triangle list in model space, the position in the first three floats of each vertex, moved
+    // by offset. Triangles reaching behind the camera are left out, they'd need clipping.
+    void addOccluder(const float *vertices, size_t vertexCount, size_t strideFloats, const QVector3D &offset);
+    size_t triangleCount() const { return mTriangles.size(); }
+
+    // Clears and rasterizes one band. Different tiles may be rasterized on different threads at once.
+    void rasterizeTile(int tile);
+
+    // Once all tiles are done. Only reads, so any number of threads may test at once.
+    bool isOccluded(const QVector3D &min, const QVector3D &max) const;
+
+private:
+    struct Triangle {
+        float minX, maxX, minY, maxY;       // Screen space bounding box
+        float edgeA[3];                     // Inside when edgeA * x + edgeB * y + edgeC >= 0 for all three edges
+        float edgeB[3];
+        float edgeC[3];
+        float depth0, depthDx, depthDy;     // Farthest depth in the pixel around (x, y) = depth0 + depthDx * x + depthDy * y
+    };
+
+    // Screen position in pixels and z / w, false when behind the camera
+    bool project(const QVector3D &position, float &x, float &y, float &z) const;
+
+    float mMatrix[4][4] = {};               // Rows of the view-projection
+    std::vector<Triangle> mTriangles;
+    std::vector<float> mDepth;              // WIDTH * HEIGHT, nearest occluder depth
+};
@@ -0,0 +1,169 @@
+#include "ParallelRecorder.h"
+#include <QVulkanFunctions>
+#include <algorithm>
+#include <cstring>
+#include "DeletionQueue.h"
+#include "Trace.h"
+
+// Trace keeps only the pointer, so thread names have to be literals
+static const char *const sWorkerNames[ParallelRecorder::MAX_THREADS] = {
+    "render", "record worker 1", "record worker 2", "record worker 3", "record worker 4",
+    "record worker 5", "record worker 6", "record worker 7", "record worker 8", "record worker 9",
+    "record worker 10", "record worker 11", "record worker 12", "record worker 13", "record worker 14",
+    "record worker 15"
+};
+
+void ParallelRecorder::init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions, int threadCount)
+{
+    mWindow = window;
+    mDeviceFunctions = deviceFunctions;
+    mThreadCount = std::clamp(threadCount, 1, MAX_THREADS);
+
+    VkCommandPoolCreateInfo poolInfo;
+    memset(&poolInfo, 0, sizeof(poolInfo));
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    // Short lived buffers, the whole pool is reset every frame instead of single buffers
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = mWindow->graphicsQueueFamilyIndex();
+
+    const int concurrentFrameCount = mWindow->concurrentFrameCount();
+    for (int worker = 0; worker < mThreadCount; ++worker) {
+        for (int frame = 0; frame < concurrentFrameCount; ++frame) {
+            VkResult err = mDeviceFunctions->vkCreateCommandPool(mWindow->device(), &poolInfo, nullptr,
+                                                                 &mPools[worker][frame].pool);
+            if (err != VK_SUCCESS)
+                qFatal("Failed to create recording command pool: %d", err);
+        }
+    }
+
+    mQuit = false;
+    for (int worker = 1; worker < mThreadCount; ++worker)
+        mThreads.emplace_back(&ParallelRecorder::workerLoop, this, worker);
+}
+
+void ParallelRecorder::release(DeletionQueue *deferred)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWake.notify_all();
+    for (std::thread &thread : mThreads)
+        thread.join();
+    mThreads.clear();
+
+    // Destroying a pool frees its command buffers
+    for (int worker = 0; worker < MAX_THREADS; ++worker) {
+        for (FramePool &framePool : mPools[worker]) {
+            if (framePool.pool && deferred)
+                deferred->destroyCommandPool(framePool.pool);
+            else if (framePool.pool)
+                mDeviceFunctions->vkDestroyCommandPool(mWindow->device(), framePool.pool, nullptr);
+            framePool = FramePool();
+        }
+    }
+    mThreadCount = 0;
+}
+
+void ParallelRecorder::beginFrame()
+{
+    mFrame = mWindow->currentFrame();
+    for (int worker = 0; worker < mThreadCount; ++worker) {
+        FramePool &framePool = mPools[worker][mFrame];
+        mDeviceFunctions->vkResetCommandPool(mWindow->device(), framePool.pool, 0);
+        framePool.used = 0;
+    }
+}
+
+VkCommandBuffer ParallelRecorder::acquire(int worker)
+{
+    // Only the owning worker touches its pool, so no locking here
+    FramePool &framePool = mPools[worker][mFrame];
+    if (framePool.used == framePool.buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo;
+        memset(&allocInfo, 0, sizeof(allocInfo));
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = framePool.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBuffer cb = VK_NULL_HANDLE;
+        VkResult err = mDeviceFunctions->vkAllocateCommandBuffers(mWindow->device(), &allocInfo, &cb);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to allocate recording command buffer: %d", err);
+        framePool.buffers.push_back(cb);
+    }
+    return framePool.buffers[framePool.used++];
+}
+
+const std::vector<VkCommandBuffer> &ParallelRecorder::record(int taskCount, const RecordFunction &record)
+{
+    TRACE_SCOPE("ParallelRecorder::record");
+    mResults.assign(size_t(std::max(taskCount, 0)), VK_NULL_HANDLE);
+
+    // Each task records into a buffer from its own worker's pool. Capturing two
+    // pointers keeps the function small enough to be stored without allocating.
+    const TaskFunction task = [this, &record](int index, int worker) {
+        VkCommandBuffer cb = acquire(worker);
+        record(cb, index, worker);
+        mResults[size_t(index)] = cb;
+    };
+    run(taskCount, task);
+    return mResults;
+}
+
+void ParallelRecorder::run(int taskCount, const TaskFunction &task)
+{
+    if (taskCount <= 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = &task;
+        mTaskCount = taskCount;
+        mNextTask.store(0, std::memory_order_relaxed);
+        mBusyHelpers = std::max(mThreadCount - 1, 0);
+        mJobId++;
+    }
+    // Every helper reports back, helpers that find no task left just return at once
+    if (mThreadCount > 1)
+        mWake.notify_all();
+
+    runTasks(0);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone.wait(lock, [this]() { return mBusyHelpers == 0; });
+    mTask = nullptr;
+}
+
+void ParallelRecorder::runTasks(int worker)
+{
+    for (;;) {
+        const int task = mNextTask.fetch_add(1, std::memory_order_relaxed);
+        if (task >= mTaskCount)
+            break;
+        (*mTask)(task, worker);
+    }
+}
+
+void ParallelRecorder::workerLoop(int worker)
+{
+    TRACE_THREAD_NAME(sWorkerNames[worker]);
+    uint64_t seenJob = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [&]() { return mQuit || mJobId != seenJob; });
+            if (mQuit)
+                return;
+            seenJob = mJobId;
+        }
+
+        runTasks(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (--mBusyHelpers == 0)
+                mDone.notify_one();
+        }
+    }
+}
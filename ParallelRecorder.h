@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QVulkanWindow>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class DeletionQueue;
+
+// Records secondary command buffers on several threads.
+//
+// Every worker has its own VkCommandPool per frame in flight, so no pool is ever
+// touched by two threads and a whole slot is reset with one vkResetCommandPool
+// once QVulkanWindow has waited for that slot's fence. The render thread takes
+// part as worker 0, threadCount() - 1 helper threads do the rest. The same threads
+// also run tasks that record nothing, see run().
+class ParallelRecorder
+{
+public:
+    static constexpr int MAX_THREADS = 16;
+
+    // Records one task into cb (already reset, not begun). worker is the index of the recording thread.
+    using RecordFunction = std::function<void(VkCommandBuffer cb, int task, int worker)>;
+    using TaskFunction = std::function<void(int task, int worker)>;
+
+    ~ParallelRecorder() { release(); }
+
+    void init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions, int threadCount);
+    // With deferred, the command pools are destroyed once the frames using them are done
+    void release(DeletionQueue *deferred = nullptr);
+
+    int threadCount() const { return mThreadCount; }
+
+    // Resets the command pools of the current frame slot - call once per frame before recording
+    void beginFrame();
+
+    // A secondary command buffer from worker 0's pool, for the render thread's own recording
+    VkCommandBuffer acquire() { return acquire(0); }
+
+    // Runs record for every task in [0, taskCount) on all workers and waits for them.
+    // The returned buffers are in task order, ready for vkCmdExecuteCommands.
+    const std::vector<VkCommandBuffer> &record(int taskCount, const RecordFunction &record);
+
+    // Runs task for every index in [0, taskCount) on all workers and waits for them
+    void run(int taskCount, const TaskFunction &task);
+
+private:
+    struct FramePool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;   // Allocated so far, reused every frame
+        size_t used = 0;
+    };
+
+    VkCommandBuffer acquire(int worker);
+    void runTasks(int worker);
+    void workerLoop(int worker);
+
+    QVulkanWindow *mWindow = nullptr;
+    QVulkanDeviceFunctions *mDeviceFunctions = nullptr;
+    int mThreadCount = 0;
+    int mFrame = 0;
+
+    FramePool mPools[MAX_THREADS][QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
+    std::vector<std::thread> mThreads;
+
+    // Current job, published under mMutex
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+    uint64_t mJobId = 0;
+    int mBusyHelpers = 0;
+    bool mQuit = false;
+    const TaskFunction *mTask = nullptr;
+    int mTaskCount = 0;
+    std::atomic<int> mNextTask{ 0 };
+    std::vector<VkCommandBuffer> mResults;
+};
@@ -0,0 +1,241 @@
+#include "PerformanceTab.h"
+#include "FrameStatsRing.h"
+#include <QLabel>
+#include <QPainter>
+#include <QPainterPath>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QGridLayout>
+
+// Simple line graph of a few series sharing one y-axis
+class FrameGraph : public QWidget
+{
+public:
+    FrameGraph(const QString &unit, QWidget *parent = nullptr) : QWidget(parent), mUnit(unit)
+    {
+        setMinimumHeight(80);
+        setAttribute(Qt::WA_OpaquePaintEvent);
+    }
+
+    void setSeriesCount(int count) { mSeries.resize(count); }
+
+    void setSeries(int index, const QString &name, const QColor &color, const QVector<double> &values)
+    {
+        mSeries[index].name = name;
+        mSeries[index].color = color;
+        mSeries[index].values = values;
+    }
+
+protected:
+    void paintEvent(QPaintEvent *) override
+    {
+        QPainter painter(this);
+        painter.fillRect(rect(), QColor("#2f2f2f"));
+
+        // Scale to the largest value, rounded up so the axis doesn't jump every refresh
+        double maxValue = 1.0;
+        for (const Series &series : mSeries)
+            for (double v : series.values)
+                maxValue = qMax(maxValue, v);
+        double scale = 1.0;
+        while (scale < maxValue)
+            scale *= 2.0;
+
+        const QRectF area = QRectF(rect()).adjusted(4, 4, -4, -16);
+        painter.setPen(QColor("#555555"));
+        painter.drawLine(area.bottomLeft(), area.bottomRight());
+        painter.drawLine(area.topLeft(), area.topRight());
+
+        painter.setRenderHint(QPainter::Antialiasing);
+        int legendX = 4;
+        for (const Series &series : mSeries) {
+            if (series.values.size() >= 2) {
+                QPainterPath path;
+                const double stepX = area.width() / (series.values.size() - 1);
+                for (int i = 0; i < series.values.size(); ++i) {
+                    const QPointF point(area.left() + i * stepX,
+                                        area.bottom() - series.values[i] / scale * area.height());
+                    if (i == 0)
+                        path.moveTo(point);
+                    else
+                        path.lineTo(point);
+                }
+                painter.setPen(QPen(series.color, 1.5));
+                painter.drawPath(path);
+            }
+
+            painter.setPen(series.color);
+            painter.drawText(legendX, height() - 3, series.name);
+            legendX += painter.fontMetrics().horizontalAdvance(series.name) + 12;
+        }
+
+        painter.setPen(Qt::white);
+        painter.drawText(area.adjusted(0, 2, -2, 0), Qt::AlignRight | Qt::AlignTop,
+                         QString("%1 %2").arg(scale).arg(mUnit));
+    }
+
+private:
+    struct Series {
+        QString name;
+        QColor color;
+        QVector<double> values;
+    };
+
+    QString mUnit;
+    QVector<Series> mSeries;
+};
+
+PerformanceTab::PerformanceTab(const FrameStatsRing *ring, QWidget *parent)
+    : QWidget(parent), mRing(ring)
+{
+    mHistory.resize(HISTORY_FRAMES);
+
+    //Graphs on the left, counters on the right
+    mTimeGraph = new FrameGraph(tr("ms"));
+    mTimeGraph->setSeriesCount(5);
+    mDrawGraph = new FrameGraph(tr("draws"));
+    mDrawGraph->setSeriesCount(2);
+
+    QVBoxLayout *graphLayout = new QVBoxLayout;
+    graphLayout->addWidget(mTimeGraph, 2);
+    graphLayout->addWidget(mDrawGraph, 1);
+
+    mCpuLabel = new QLabel;
+    mGpuLabel = new QLabel;
+    mDrawLabel = new QLabel;
+    mMemoryLabel = new QLabel;
+    mEntityLabel = new QLabel;
+
+    QGridLayout *counterLayout = new QGridLayout;
+    counterLayout->addWidget(new QLabel(tr("<b>CPU</b>")), 0, 0, Qt::AlignTop);
+    counterLayout->addWidget(mCpuLabel, 0, 1);
+    counterLayout->addWidget(new QLabel(tr("<b>GPU</b>")), 1, 0, Qt::AlignTop);
+    counterLayout->addWidget(mGpuLabel, 1, 1);
+    counterLayout->addWidget(new QLabel(tr("<b>Draw</b>")), 2, 0, Qt::AlignTop);
+    counterLayout->addWidget(mDrawLabel, 2, 1);
+    counterLayout->addWidget(new QLabel(tr("<b>Memory</b>")), 3, 0, Qt::AlignTop);
+    counterLayout->addWidget(mMemoryLabel, 3, 1);
+    counterLayout->addWidget(new QLabel(tr("<b>Entities</b>")), 4, 0, Qt::AlignTop);
+    counterLayout->addWidget(mEntityLabel, 4, 1);
+    counterLayout->setRowStretch(5, 1);
+
+    QHBoxLayout *layout = new QHBoxLayout;
+    layout->addLayout(graphLayout, 3);
+    layout->addLayout(counterLayout, 1);
+    setLayout(layout);
+
+    connect(&mRefreshTimer, &QTimer::timeout, this, &PerformanceTab::refresh);
+}
+
+void PerformanceTab::showEvent(QShowEvent *event)
+{
+    //Only poll the stats while somebody is looking at them
+    refresh();
+    mRefreshTimer.start(REFRESH_INTERVAL_MS);
+    QWidget::showEvent(event);
+}
+
+void PerformanceTab::hideEvent(QHideEvent *event)
+{
+    mRefreshTimer.stop();
+    QWidget::hideEvent(event);
+}
+
+void PerformanceTab::refresh()
+{
+    if (!mRing)
+        return;
+
+    const int count = mRing->readLatest(mHistory.data(), HISTORY_FRAMES);
+    if (count == 0) {
+        mCpuLabel->setText(tr("no frames yet"));
+        return;
+    }
+
+    QVector<double> frame(count), sim(count), cull(count), record(count), gpu(count);
+    QVector<double> draws(count), binds(count);
+    double frameSum = 0.0, simSum = 0.0, cullSum = 0.0, recordSum = 0.0, gpuSum = 0.0;
+    double drawSum = 0.0, bindSum = 0.0, uniformSum = 0.0, allocationSum = 0.0;
+    double pipelineBindSum = 0.0, vertexBindSum = 0.0, skippedBindSum = 0.0;
+    int gpuFrames = 0;
+
+    for (int i = 0; i < count; ++i) {
+        const FrameStats &stats = mHistory[i];
+        frame[i] = stats.frameMs;
+        sim[i] = stats.simMs;
+        cull[i] = stats.cullMs;
+        record[i] = stats.recordMs;
+        gpu[i] = stats.gpu.valid ? stats.gpu.frameMs : 0.0;
+        draws[i] = stats.drawCalls;
+        binds[i] = stats.descriptorBinds;
+
+        frameSum += stats.frameMs;
+        simSum += stats.simMs;
+        cullSum += stats.cullMs;
+        recordSum += stats.recordMs;
+        drawSum += stats.drawCalls;
+        bindSum += stats.descriptorBinds;
+        pipelineBindSum += stats.pipelineBinds;
+        vertexBindSum += stats.vertexBinds;
+        skippedBindSum += stats.skippedBinds;
+        uniformSum += stats.uniformBytes;
+        allocationSum += stats.allocations;
+        if (stats.gpu.valid) {
+            gpuSum += stats.gpu.frameMs;
+            gpuFrames++;
+        }
+    }
+
+    mTimeGraph->setSeries(0, tr("frame"), QColor("#ffffff"), frame);
+    mTimeGraph->setSeries(1, tr("sim"), QColor("#66bb6a"), sim);
+    mTimeGraph->setSeries(2, tr("cull"), QColor("#ffca28"), cull);
+    mTimeGraph->setSeries(3, tr("record"), QColor("#42a5f5"), record);
+    mTimeGraph->setSeries(4, tr("gpu"), QColor("#ef5350"), gpu);
+    mTimeGraph->update();
+    mDrawGraph->setSeries(0, tr("draw calls"), QColor("#42a5f5"), draws);
+    mDrawGraph->setSeries(1, tr("descriptor binds"), QColor("#ffca28"), binds);
+    mDrawGraph->update();
+
+    const FrameStats &last = mHistory[count - 1];
+    mCpuLabel->setText(tr("frame %1 ms (%2 fps)\nsim %3  cull %4  record %5 ms")
+                       .arg(frameSum / count, 0, 'f', 2)
+                       .arg(frameSum > 0.0 ? 1000.0 * count / frameSum : 0.0, 0, 'f', 0)
+                       .arg(simSum / count, 0, 'f', 2)
+                       .arg(cullSum / count, 0, 'f', 2)
+                       .arg(recordSum / count, 0, 'f', 2));
+
+    if (gpuFrames > 0) {
+        QString text = tr("frame %1 ms").arg(gpuSum / gpuFrames, 0, 'f', 3);
+        for (int i = 0; i < GPU_REGION_COUNT; ++i) {
+            if (last.gpu.regions[i].recorded) {
+                text += QString("\n%1 %2 ms").arg(GpuProfiler::regionName(GpuRegion(i)))
+                                            .arg(last.gpu.regions[i].ms, 0, 'f', 3);
+            }
+        }
+        mGpuLabel->setText(text);
+    } else {
+        mGpuLabel->setText(tr("no timestamp results"));
+    }
+
+    mDrawLabel->setText(tr("%1 draw calls, %2 descriptor binds\n%3 pipeline, %4 vertex buffer binds, %5 skipped\n"
+                           "%6 KB uniforms per frame")
+                        .arg(drawSum / count, 0, 'f', 0)
+                        .arg(bindSum / count, 0, 'f', 0)
+                        .arg(pipelineBindSum / count, 0, 'f', 0)
+                        .arg(vertexBindSum / count, 0, 'f', 0)
+                        .arg(skippedBindSum / count, 0, 'f', 0)
+                        .arg(uniformSum / count / 1024.0, 0, 'f', 1));
+
+    const QString vram = last.vramBytes > 0
+            ? tr("%1 MB VRAM").arg(double(last.vramBytes) / (1024.0 * 1024.0), 0, 'f', 1)
+            : tr("VRAM n/a");
+    const QString antiAliasing = tr("AA %1%2: %3 MB").arg(QLatin1String(last.antiAliasing))
+                                                     .arg(last.temporalAA ? QStringLiteral(" + taa") : QString())
+                                                     .arg(double(last.antiAliasingBytes) / (1024.0 * 1024.0), 0, 'f', 1);
+    mMemoryLabel->setText(tr("%1 allocations per frame\n%2\n%3").arg(allocationSum / count, 0, 'f', 1)
+                          .arg(vram).arg(antiAliasing));
+
+    mEntityLabel->setText(tr("%1 collectibles\n%2 NPCs\n%3 houses\n%4 of %5 culled\n%6 occluded")
+                          .arg(last.collectibles).arg(last.npcs).arg(last.houses)
+                          .arg(last.culled).arg(last.cullTested).arg(last.occluded));
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QWidget>
+#include <QTimer>
+#include <QVector>
+#include "FrameStats.h"
+
+QT_FORWARD_DECLARE_CLASS(QLabel)
+
+class FrameStatsRing;
+class FrameGraph;
+
+// "Performance" tab: rolling graphs of CPU/GPU frame times and draw calls plus
+// a few counters. Reads RenderWindow's numbers from the lock-free FrameStatsRing
+// on a slow timer, and only while the tab is visible.
+class PerformanceTab : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PerformanceTab(const FrameStatsRing *ring, QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void refresh();
+
+private:
+    static constexpr int HISTORY_FRAMES = 240;      // Frames shown in the graphs
+    static constexpr int REFRESH_INTERVAL_MS = 250;
+
+    const FrameStatsRing *mRing{ nullptr };
+    QTimer mRefreshTimer;
+    QVector<FrameStats> mHistory;                   // Scratch buffer, allocated once
+
+    FrameGraph *mTimeGraph{ nullptr };
+    FrameGraph *mDrawGraph{ nullptr };
+
+    QLabel *mCpuLabel{ nullptr };
+    QLabel *mGpuLabel{ nullptr };
+    QLabel *mDrawLabel{ nullptr };
+    QLabel *mMemoryLabel{ nullptr };
+    QLabel *mEntityLabel{ nullptr };
+};
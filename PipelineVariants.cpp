@@ -0,0 +1,204 @@
+#include "PipelineVariants.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QVulkanFunctions>
+#include <cstring>
+#include "Log.h"
+#include "Trace.h"
+
+static VkShaderModule createShader(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions, const QString &name)
+{
+    QFile file(name);
+    if (!file.open(QIODevice::ReadOnly))
+        qFatal("Failed to read shader %s", qPrintable(name));
+    const QByteArray blob = file.readAll();
+
+    VkShaderModuleCreateInfo shaderInfo;
+    memset(&shaderInfo, 0, sizeof(shaderInfo));
+    shaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderInfo.codeSize = size_t(blob.size());
+    shaderInfo.pCode = reinterpret_cast<const uint32_t *>(blob.constData());
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    VkResult err = deviceFunctions->vkCreateShaderModule(window->device(), &shaderInfo, nullptr, &shaderModule);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create shader module %s: %d", qPrintable(name), err);
+    return shaderModule;
+}
+
+// Copies count elements to vector and returns where they are now, null for none
+template <typename T>
+static const T *copyArray(std::vector<T> &vector, const T *data, uint32_t count)
+{
+    vector.assign(data, data + (data ? count : 0));
+    return vector.empty() ? nullptr : vector.data();
+}
+
+void PipelineVariants::init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions,
+                            const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache,
+                            const QString &vertexShader, const QString &fragmentShader)
+{
+    mWindow = window;
+    mDeviceFunctions = deviceFunctions;
+    mPipelineCache = pipelineCache;
+
+    mShaders[0] = createShader(window, deviceFunctions, vertexShader);
+    mShaders[1] = createShader(window, deviceFunctions, fragmentShader);
+    const VkShaderStageFlagBits stages[2] = { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT };
+    for (int i = 0; i < 2; ++i) {
+        mStages[i] = {};
+        mStages[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        mStages[i].stage = stages[i];
+        mStages[i].module = mShaders[i];
+        mStages[i].pName = "main";
+    }
+
+    // Everything the template points to lives on the caller's stack, the background
+    // thread needs copies. Only the states the renderer's pipelines use are copied.
+    mPipelineInfo = pipelineTemplate;
+    mPipelineInfo.stageCount = 2;
+    mPipelineInfo.pStages = mStages;
+
+    mVertexInput = *pipelineTemplate.pVertexInputState;
+    mVertexInput.pVertexBindingDescriptions = copyArray(mBindings, mVertexInput.pVertexBindingDescriptions,
+                                                        mVertexInput.vertexBindingDescriptionCount);
+    mVertexInput.pVertexAttributeDescriptions = copyArray(mAttributes, mVertexInput.pVertexAttributeDescriptions,
+                                                          mVertexInput.vertexAttributeDescriptionCount);
+    mPipelineInfo.pVertexInputState = &mVertexInput;
+
+    mInputAssembly = *pipelineTemplate.pInputAssemblyState;
+    mPipelineInfo.pInputAssemblyState = &mInputAssembly;
+    // Viewport and scissor are dynamic, only their counts are there
+    mViewport = *pipelineTemplate.pViewportState;
+    mViewport.pViewports = nullptr;
+    mViewport.pScissors = nullptr;
+    mPipelineInfo.pViewportState = &mViewport;
+    mRasterization = *pipelineTemplate.pRasterizationState;
+    mPipelineInfo.pRasterizationState = &mRasterization;
+    mMultisample = *pipelineTemplate.pMultisampleState;
+    mMultisample.pSampleMask = nullptr;
+    mPipelineInfo.pMultisampleState = &mMultisample;
+    mDepthStencil = *pipelineTemplate.pDepthStencilState;
+    mPipelineInfo.pDepthStencilState = &mDepthStencil;
+
+    mColorBlend = *pipelineTemplate.pColorBlendState;
+    mColorBlend.pAttachments = copyArray(mBlendAttachments, mColorBlend.pAttachments, mColorBlend.attachmentCount);
+    mPipelineInfo.pColorBlendState = &mColorBlend;
+
+    mPipelineInfo.pDynamicState = nullptr;
+    if (pipelineTemplate.pDynamicState) {
+        mDynamic = *pipelineTemplate.pDynamicState;
+        mDynamic.pDynamicStates = copyArray(mDynamicStates, mDynamic.pDynamicStates, mDynamic.dynamicStateCount);
+        mPipelineInfo.pDynamicState = &mDynamic;
+    }
+    mPipelineInfo.pTessellationState = nullptr;
+
+    // The base variant right away, every frame can fall back to it
+    mPipelines[0] = build(0);
+
+    mQuit = false;
+    mThread = std::thread(&PipelineVariants::compileLoop, this);
+}
+
+void PipelineVariants::release()
+{
+    if (!mWindow)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWake.notify_all();
+    if (mThread.joinable())
+        mThread.join();
+    mQueue.clear();
+    for (bool &requested : mRequested)
+        requested = false;
+
+    VkDevice dev = mWindow->device();
+    for (std::atomic<VkPipeline> &pipeline : mPipelines) {
+        if (VkPipeline variant = pipeline.exchange(VK_NULL_HANDLE))
+            mDeviceFunctions->vkDestroyPipeline(dev, variant, nullptr);
+    }
+    for (VkShaderModule &shader : mShaders) {
+        if (shader)
+            mDeviceFunctions->vkDestroyShaderModule(dev, shader, nullptr);
+        shader = VK_NULL_HANDLE;
+    }
+    mWindow = nullptr;
+}
+
+VkPipeline PipelineVariants::pipeline(Features features)
+{
+    Q_ASSERT(features < Features(VARIANT_COUNT));
+    if (VkPipeline variant = mPipelines[features].load(std::memory_order_acquire))
+        return variant;
+
+    prepare(features);
+    // Subsets of the features from the largest down, the last one is the base variant
+    for (Features subset = (features - 1) & features; ; subset = (subset - 1) & features) {
+        if (VkPipeline variant = mPipelines[subset].load(std::memory_order_acquire))
+            return variant;
+        if (subset == 0)
+            return VK_NULL_HANDLE;
+    }
+}
+
+void PipelineVariants::prepare(Features features)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mRequested[features] || isReady(features))
+            return;
+        mRequested[features] = true;
+        mQueue.push_back(features);
+    }
+    mWake.notify_one();
+}
+
+VkPipeline PipelineVariants::build(Features features)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // One VkBool32 per feature, the same constants for both stages
+    VkBool32 values[FEATURE_COUNT];
+    VkSpecializationMapEntry entries[FEATURE_COUNT];
+    for (uint32_t i = 0; i < uint32_t(FEATURE_COUNT); ++i) {
+        values[i] = (features >> i) & 1u ? VK_TRUE : VK_FALSE;
+        entries[i] = { i, uint32_t(i * sizeof(VkBool32)), sizeof(VkBool32) };
+    }
+    VkSpecializationInfo specialization = { uint32_t(FEATURE_COUNT), entries, sizeof(values), values };
+
+    VkPipelineShaderStageCreateInfo stages[2] = { mStages[0], mStages[1] };
+    stages[0].pSpecializationInfo = stages[1].pSpecializationInfo = &specialization;
+    VkGraphicsPipelineCreateInfo pipelineInfo = mPipelineInfo;
+    pipelineInfo.pStages = stages;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult err = mDeviceFunctions->vkCreateGraphicsPipelines(mWindow->device(), mPipelineCache, 1, &pipelineInfo,
+                                                               nullptr, &pipeline);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create pipeline variant %u: %d", features, err);
+    LOG_INFO(Vulkan, "Pipeline variant {} ready in {} ms", features, timer.nsecsElapsed() / 1.0e6);
+    return pipeline;
+}
+
+void PipelineVariants::compileLoop()
+{
+    TRACE_THREAD_NAME("pipeline compiler");
+    for (;;) {
+        Features features;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this]() { return mQuit || !mQueue.empty(); });
+            if (mQuit)
+                return;
+            features = mQueue.front();
+            mQueue.erase(mQueue.begin());
+        }
+
+        TRACE_SCOPE("build pipeline variant");
+        mPipelines[features].store(build(features), std::memory_order_release);
+    }
+}
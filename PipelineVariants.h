@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QVulkanWindow>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Graphics pipelines of one shader pair, one per combination of features.
+//
+// Every feature is a boolean specialization constant - constant_id n is feature bit n,
+// in every stage - so the shaders test it with an if the compiler removes, and the
+// feature bits are the key of the variant. The variant without features is built in
+// init(), all others on a thread of their own the first time they are asked for. Until
+// a variant is ready pipeline() returns the ready one with the most of its features,
+// there is never a stall. All variants go through the pipeline cache, which the
+// renderer keeps on disk, so they are quick to build from the second run on.
+class PipelineVariants
+{
+public:
+    enum Feature : uint32_t {
+        Fog = 1u << 0,      // Far fragments fade into the clear color
+    };
+    using Features = uint32_t;
+    static constexpr int FEATURE_COUNT = 1;
+    static constexpr int VARIANT_COUNT = 1 << FEATURE_COUNT;
+
+    ~PipelineVariants() { release(); }
+
+    // Copies the state pipelineTemplate points to, the stages are replaced by the two shaders
+    void init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions,
+              const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache,
+              const QString &vertexShader, const QString &fragmentShader);
+    // Waits for the variant being built, if any
+    void release();
+
+    bool isInitialized() const { return mPipelines[0].load() != VK_NULL_HANDLE; }
+
+    // The variant with the features, or the ready one with the most of them while it is built
+    VkPipeline pipeline(Features features);
+    // Starts building the variant in the background, so it is there when it is needed
+    void prepare(Features features);
+    bool isReady(Features features) const { return mPipelines[features].load() != VK_NULL_HANDLE; }
+
+private:
+    VkPipeline build(Features features);
+    void compileLoop();
+
+    QVulkanWindow *mWindow = nullptr;
+    QVulkanDeviceFunctions *mDeviceFunctions = nullptr;
+    VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
+    VkShaderModule mShaders[2] = {};
+
+    // The template's state, its pointers redirected to the copies here
+    VkGraphicsPipelineCreateInfo mPipelineInfo = {};
+    VkPipelineShaderStageCreateInfo mStages[2] = {};
+    VkPipelineVertexInputStateCreateInfo mVertexInput = {};
+    std::vector<VkVertexInputBindingDescription> mBindings;
+    std::vector<VkVertexInputAttributeDescription> mAttributes;
+    VkPipelineInputAssemblyStateCreateInfo mInputAssembly = {};
+    VkPipelineViewportStateCreateInfo mViewport = {};
+    VkPipelineRasterizationStateCreateInfo mRasterization = {};
+    VkPipelineMultisampleStateCreateInfo mMultisample = {};
+    VkPipelineDepthStencilStateCreateInfo mDepthStencil = {};
+    VkPipelineColorBlendStateCreateInfo mColorBlend = {};
+    std::vector<VkPipelineColorBlendAttachmentState> mBlendAttachments;
+    VkPipelineDynamicStateCreateInfo mDynamic = {};
+    std::vector<VkDynamicState> mDynamicStates;
+
+    // Written once by the thread that builds the variant, read by the render thread
+    std::atomic<VkPipeline> mPipelines[VARIANT_COUNT] = {};
+
+    // Variants waiting to be built, published under mMutex
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::vector<Features> mQueue;
+    bool mRequested[VARIANT_COUNT] = {};
+    bool mQuit = false;
+    std::thread mThread;
+};
@@ -0,0 +1,224 @@
+#include "PortalCuller.h"
+#include <cmath>
+
+// Planes through the eye and an edge shorter than this are left out, the volume only gets a little larger
+static const float MIN_EDGE_NORMAL = 1.0e-6f;
+// An eye closer than this to the portal plane stands in the doorway and sees the whole volume through it
+static const float MIN_PORTAL_DISTANCE = 1.0e-3f;
+
+static float planeDistance(const float *plane, const QVector3D &point)
+{
+    return plane[0] * point.x() + plane[1] * point.y() + plane[2] * point.z() + plane[3];
+}
+
+static void setPlane(float *plane, const QVector3D &normal, const QVector3D &point)
+{
+    plane[0] = normal.x();
+    plane[1] = normal.y();
+    plane[2] = normal.z();
+    plane[3] = -QVector3D::dotProduct(normal, point);
+}
+
+ClipVolume ClipVolume::fromFrustum(const Frustum &frustum)
+{
+    // Far first, then left, right, bottom, top, near
+    ClipVolume volume;
+    for (int i = 0; i < 6; ++i) {
+        const float *plane = frustum.planes[(i + 5) % 6];
+        for (int j = 0; j < 4; ++j)
+            volume.planes[i][j] = plane[j];
+    }
+    volume.planeCount = 6;
+    return volume;
+}
+
+bool ClipVolume::intersectsSphere(const QVector3D &center, float radius) const
+{
+    for (int i = 0; i < planeCount; ++i) {
+        if (planeDistance(planes[i], center) < -radius)
+            return false;
+    }
+    return true;
+}
+
+bool ClipVolume::intersectsBox(const QVector3D &min, const QVector3D &max) const
+{
+    // Only the corner farthest along the plane normal has to be tested
+    for (int i = 0; i < planeCount; ++i) {
+        const float *plane = planes[i];
+        const QVector3D corner(plane[0] >= 0.0f ? max.x() : min.x(),
+                               plane[1] >= 0.0f ? max.y() : min.y(),
+                               plane[2] >= 0.0f ? max.z() : min.z());
+        if (planeDistance(plane, corner) < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+int PortalCuller::addOutsideCell()
+{
+    Cell cell;
+    cell.outside = true;
+    mCells.push_back(cell);
+    return int(mCells.size()) - 1;
+}
+
+int PortalCuller::addCell(const QVector3D &min, const QVector3D &max)
+{
+    Cell cell;
+    cell.min = min;
+    cell.max = max;
+    mCells.push_back(cell);
+    return int(mCells.size()) - 1;
+}
+
+int PortalCuller::addPortal(int cellA, int cellB, const QVector3D *corners, int cornerCount)
+{
+    Portal portal;
+    portal.cornerCount = cornerCount < MAX_PORTAL_CORNERS ? cornerCount : MAX_PORTAL_CORNERS;
+    for (int i = 0; i < portal.cornerCount; ++i)
+        portal.corners[i] = corners[i];
+    portal.cells[0] = cellA;
+    portal.cells[1] = cellB;
+    mPortals.push_back(portal);
+
+    const int index = int(mPortals.size()) - 1;
+    mCells[size_t(cellA)].portals.push_back(index);
+    mCells[size_t(cellB)].portals.push_back(index);
+    return index;
+}
+
+void PortalCuller::setPortalOpen(int portal, bool open)
+{
+    mPortals[size_t(portal)].open = open;
+}
+
+void PortalCuller::clear()
+{
+    mCells.clear();
+    mPortals.clear();
+}
+
+int PortalCuller::cellAt(const QVector3D &point) const
+{
+    int outside = -1;
+    for (size_t i = 0; i < mCells.size(); ++i) {
+        const Cell &cell = mCells[i];
+        if (cell.outside) {
+            outside = int(i);
+            continue;
+        }
+        if (point.x() >= cell.min.x() && point.y() >= cell.min.y() && point.z() >= cell.min.z()
+            && point.x() <= cell.max.x() && point.y() <= cell.max.y() && point.z() <= cell.max.z())
+            return int(i);
+    }
+    return outside;
+}
+
+void PortalCuller::findVisibleCells(const QVector3D &eye, const Frustum &frustum,
+                                    std::vector<VisibleCell> &visible) const
+{
+    visible.clear();
+    const int cell = cellAt(eye);
+    if (cell >= 0)
+        visit(cell, -1, 0, eye, ClipVolume::fromFrustum(frustum), visible);
+}
+
+void PortalCuller::visit(int cell, int fromPortal, int depth, const QVector3D &eye, const ClipVolume &volume,
+                         std::vector<VisibleCell> &visible) const
+{
+    visible.push_back({ cell, depth, volume });
+    if (depth >= MAX_DEPTH)
+        return;
+
+    for (int index : mCells[size_t(cell)].portals) {
+        const Portal &portal = mPortals[size_t(index)];
+        // Going back through the portal we came in by would only find what is already there
+        if (index == fromPortal || !portal.open)
+            continue;
+
+        ClipVolume narrowed;
+        if (clipPortal(portal, eye, volume, narrowed)) {
+            const int next = portal.cells[0] == cell ? portal.cells[1] : portal.cells[0];
+            visit(next, index, depth + 1, eye, narrowed, visible);
+        }
+    }
+}
+
+bool PortalCuller::clipPortal(const Portal &portal, const QVector3D &eye, const ClipVolume &volume,
+                              ClipVolume &result) const
+{
+    // Every plane cuts off at most one corner and adds two, so the polygon grows by one per plane
+    const int MAX_CORNERS = MAX_PORTAL_CORNERS + ClipVolume::MAX_PLANES;
+    QVector3D buffers[2][MAX_CORNERS];
+    int count = portal.cornerCount;
+    for (int i = 0; i < count; ++i)
+        buffers[0][i] = portal.corners[i];
+
+    int current = 0;
+    for (int p = 0; p < volume.planeCount && count >= 3; ++p) {
+        const float *plane = volume.planes[p];
+        const QVector3D *in = buffers[current];
+        QVector3D *out = buffers[current ^ 1];
+        int outCount = 0;
+        for (int i = 0; i < count; ++i) {
+            const QVector3D &a = in[i];
+            const QVector3D &b = in[(i + 1) % count];
+            const float da = planeDistance(plane, a);
+            const float db = planeDistance(plane, b);
+            if (da >= 0.0f && outCount < MAX_CORNERS)
+                out[outCount++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f) && outCount < MAX_CORNERS)
+                out[outCount++] = a + (b - a) * (da / (da - db));
+        }
+        count = outCount;
+        current ^= 1;
+    }
+    if (count < 3)
+        return false;
+    const QVector3D *polygon = buffers[current];
+
+    // Portal plane, the eye on its negative side so only what lies behind the portal is inside
+    QVector3D normal = QVector3D::crossProduct(portal.corners[1] - portal.corners[0],
+                                               portal.corners[2] - portal.corners[0]).normalized();
+    float eyeDistance = QVector3D::dotProduct(normal, eye - portal.corners[0]);
+    if (eyeDistance > 0.0f) {
+        normal = -normal;
+        eyeDistance = -eyeDistance;
+    }
+    if (-eyeDistance < MIN_PORTAL_DISTANCE) {
+        result = volume;
+        return true;
+    }
+
+    QVector3D centroid;
+    for (int i = 0; i < count; ++i)
+        centroid += polygon[i];
+    centroid /= float(count);
+
+    result.planeCount = 0;
+    auto addPlane = [&result](const float *plane) {
+        for (int j = 0; j < 4; ++j)
+            result.planes[result.planeCount][j] = plane[j];
+        result.planeCount++;
+    };
+    addPlane(volume.planes[0]);
+    float plane[4];
+    setPlane(plane, normal, portal.corners[0]);
+    addPlane(plane);
+
+    // One side plane per edge of the clipped outline. A polygon with more edges than
+    // there are planes left only gets the first ones - a larger volume, never a smaller one.
+    for (int i = 0; i < count && result.planeCount < ClipVolume::MAX_PLANES; ++i) {
+        QVector3D side = QVector3D::crossProduct(polygon[i] - eye, polygon[(i + 1) % count] - eye);
+        const float length = side.length();
+        if (length < MIN_EDGE_NORMAL)
+            continue;
+        side /= length;
+        if (QVector3D::dotProduct(side, centroid - eye) < 0.0f)
+            side = -side;
+        setPlane(plane, side, eye);
+        addPlane(plane);
+    }
+    return true;
+}
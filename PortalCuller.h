@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QVector3D>
+#include <vector>
+#include "FrustumCuller.h"
+
+// Convex region bounded by normalized planes, inside is a*x + b*y + c*z + d >= 0 for all of them.
+// Starts as the camera frustum and gets narrower with every portal it is seen through.
+// The first plane is always the far plane of the frustum.
+struct ClipVolume
+{
+    static constexpr int MAX_PLANES = 16;
+
+    float planes[MAX_PLANES][4] = {};
+    int planeCount = 0;
+
+    static ClipVolume fromFrustum(const Frustum &frustum);
+
+    bool intersectsSphere(const QVector3D &center, float radius) const;
+    bool intersectsBox(const QVector3D &min, const QVector3D &max) const;
+};
+
+// Cells connected by portals, so a cell behind a doorway is drawn with only what can
+// be seen through the doorway.
+//
+// The cell with the camera is visible with the whole frustum. Every open portal of it
+// is clipped against that volume (Sutherland-Hodgman), and the planes through the eye
+// and the edges of what is left, together with the portal's own plane, make the volume
+// the cell behind it is seen through. That cell's portals are clipped against the new
+// volume, and so on. Closed portals and portals clipped away end the search.
+class PortalCuller
+{
+public:
+    static constexpr int MAX_DEPTH = 4;                 // Portals looked through one behind the other
+    static constexpr int MAX_PORTAL_CORNERS = 8;
+
+    struct VisibleCell {
+        int cell;
+        int depth;              // Portals between the camera and the cell
+        ClipVolume volume;
+    };
+
+    // The cell holding everything that is in no other cell, usually the outdoor world
+    int addOutsideCell();
+    int addCell(const QVector3D &min, const QVector3D &max);
+    // Convex polygon with its corners in order around the outline, open from the start
+    int addPortal(int cellA, int cellB, const QVector3D *corners, int cornerCount);
+    void setPortalOpen(int portal, bool open);
+    void clear();
+
+    int cellAt(const QVector3D &point) const;
+    int cellCount() const { return int(mCells.size()); }
+
+    // Cells visible from eye, the camera cell first. A cell seen through several portals
+    // is listed once for each of them. visible keeps its capacity between calls.
+    void findVisibleCells(const QVector3D &eye, const Frustum &frustum, std::vector<VisibleCell> &visible) const;
+
+private:
+    struct Cell {
+        QVector3D min;
+        QVector3D max;
+        bool outside = false;
+        std::vector<int> portals;
+    };
+    struct Portal {
+        QVector3D corners[MAX_PORTAL_CORNERS];
+        int cornerCount = 0;
+        int cells[2] = { -1, -1 };
+        bool open = true;
+    };
+
+    void visit(int cell, int fromPortal, int depth, const QVector3D &eye, const ClipVolume &volume,
+               std::vector<VisibleCell> &visible) const;
+    // Volume of what is seen through the portal from eye, false when none of it is inside volume
+    bool clipPortal(const Portal &portal, const QVector3D &eye, const ClipVolume &volume, ClipVolume &result) const;
+
+    std::vector<Cell> mCells;
+    std::vector<Portal> mPortals;
+};
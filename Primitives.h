@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "VertexFormat.h"
+
+// Meshes generated at compile time as X, Y, Z, R, G, B triangle lists (SourceVertexFormat),
+// for the scene's cubes, walls and roof instead of tables written out by hand.
+//
+// A quad a, b, c, d is the triangles a, b, c and d, c, b: a and d are opposite corners.
+namespace Primitives {
+
+constexpr size_t VERTEX_FLOATS = SourceVertexFormat::sourceFloats;
+
+struct Vec3
+{
+    float x, y, z;
+};
+using Color = Vec3;
+
+// A triangle list of N vertices
+template <size_t N>
+using Vertices = std::array<float, N * VERTEX_FLOATS>;
+
+template <size_t N>
+constexpr void setVertex(Vertices<N> &vertices, size_t index, Vec3 position, Color color)
+{
+    const float values[VERTEX_FLOATS] = { position.x, position.y, position.z, color.x, color.y, color.z };
+    for (size_t i = 0; i < VERTEX_FLOATS; ++i)
+        vertices[index * VERTEX_FLOATS + i] = values[i];
+}
+
+constexpr Vertices<6> quad(Vec3 a, Vec3 b, Vec3 c, Vec3 d, Color color)
+{
+    Vertices<6> vertices = {};
+    const Vec3 corners[6] = { a, b, c, d, c, b };
+    for (size_t i = 0; i < 6; ++i)
+        setVertex<6>(vertices, i, corners[i], color);
+    return vertices;
+}
+
+// Upright rectangle from (x0, z0) to (x1, z1) on the ground, bottom to top high
+constexpr Vertices<6> wall(float x0, float z0, float x1, float z1, float bottom, float top, Color color)
+{
+    return quad({ x0, bottom, z0 }, { x0, top, z0 }, { x1, bottom, z1 }, { x1, top, z1 }, color);
+}
+
+// Flat rectangle from (x0, z0) to (x1, z1) at height y
+constexpr Vertices<6> horizontal(float x0, float z0, float x1, float z1, float y, Color color)
+{
+    return quad({ x0, y, z0 }, { x1, y, z0 }, { x0, y, z1 }, { x1, y, z1 }, color);
+}
+
+// The meshes one after another
+template <size_t... Floats>
+constexpr std::array<float, (Floats + ...)> concat(const std::array<float, Floats> &... meshes)
+{
+    std::array<float, (Floats + ...)> result = {};
+    size_t offset = 0;
+    auto append = [&result, &offset](const auto &mesh) {
+        for (size_t i = 0; i < mesh.size(); ++i)
+            result[offset + i] = mesh[i];
+        offset += mesh.size();
+    };
+    (append(meshes), ...);
+    return result;
+}
+
+// Axis aligned box, two triangles per face: front, back, left, right, top, bottom
+constexpr Vertices<36> box(Vec3 min, Vec3 max, Color color)
+{
+    const float x0 = min.x, y0 = min.y, z0 = min.z;
+    const float x1 = max.x, y1 = max.y, z1 = max.z;
+    return concat(
+        quad({ x0, y0, z1 }, { x1, y0, z1 }, { x0, y1, z1 }, { x1, y1, z1 }, color),
+        quad({ x0, y0, z0 }, { x1, y0, z0 }, { x0, y1, z0 }, { x1, y1, z0 }, color),
+        quad({ x0, y0, z0 }, { x0, y0, z1 }, { x0, y1, z0 }, { x0, y1, z1 }, color),
+        quad({ x1, y0, z0 }, { x1, y0, z1 }, { x1, y1, z0 }, { x1, y1, z1 }, color),
+        horizontal(x0, z0, x1, z1, y1, color),
+        horizontal(x0, z0, x1, z1, y0, color));
+}
+
+constexpr Vertices<36> cube(float halfSize, Color color)
+{
+    return box({ -halfSize, -halfSize, -halfSize }, { halfSize, halfSize, halfSize }, color);
+}
+
+// Square based pyramid, four triangles from the edges of the base up to the apex, no bottom
+constexpr Vertices<12> pyramid(float halfSize, float baseY, float apexY, Color color)
+{
+    const float h = halfSize;
+    const Vec3 apex = { 0.0f, apexY, 0.0f };
+    const Vec3 corners[12] = {
+        { -h, baseY,  h }, {  h, baseY,  h }, apex,     // Front
+        { -h, baseY, -h }, {  h, baseY, -h }, apex,     // Back
+        { -h, baseY, -h }, { -h, baseY,  h }, apex,     // Left
+        {  h, baseY, -h }, {  h, baseY,  h }, apex      // Right
+    };
+    Vertices<12> vertices = {};
+    for (size_t i = 0; i < 12; ++i)
+        setVertex<12>(vertices, i, corners[i], color);
+    return vertices;
+}
+
+// Cube with one vertex per corner, for meshes that share vertices between faces.
+// Corners 0-3 go around the bottom, 4-7 around the top above them.
+struct IndexedCube
+{
+    Vertices<8> vertices;
+    std::array<uint32_t, 36> indices;
+};
+
+constexpr IndexedCube indexedCube(float halfSize, Color color)
+{
+    const float h = halfSize;
+    const float ring[4][2] = { { -h, h }, { -h, -h }, { h, -h }, { h, h } };      // X, Z
+    IndexedCube cube = {};
+    for (size_t i = 0; i < 8; ++i)
+        setVertex<8>(cube.vertices, i, { ring[i % 4][0], i < 4 ? -h : h, ring[i % 4][1] }, color);
+    cube.indices = {
+        4, 5, 1, 4, 1, 0,       // Left
+        5, 6, 2, 5, 2, 1,       // Back
+        6, 7, 3, 6, 3, 2,       // Right
+        7, 4, 0, 7, 0, 3,       // Front
+        0, 1, 2, 0, 2, 3,       // Bottom
+        7, 6, 5, 7, 5, 4        // Top
+    };
+    return cube;
+}
+
+} // namespace Primitives
@@ -0,0 +1,535 @@
+#include "RenderGraph.h"
+#include <QVulkanFunctions>
+#include <algorithm>
+#include <cstring>
+#include "Log.h"
+#include "Trace.h"
+
+static const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                                        | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT
+                                        | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+struct AccessInfo {
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    VkImageLayout layout;       // Images only
+};
+
+static AccessInfo accessInfo(RenderGraph::Access access)
+{
+    switch (access) {
+    case RenderGraph::Access::DepthWrite:
+        return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                 VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+    case RenderGraph::Access::ColorWrite:
+        return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                 VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                 VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    case RenderGraph::Access::ComputeSampled:
+        return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    case RenderGraph::Access::FragmentSampled:
+        return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    case RenderGraph::Access::ComputeRead:
+        return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+    case RenderGraph::Access::ComputeWrite:
+        return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                 VK_IMAGE_LAYOUT_GENERAL };
+    case RenderGraph::Access::IndirectRead:
+        return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+    case RenderGraph::Access::VertexRead:
+        return { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+    case RenderGraph::Access::HostRead:
+        return { VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+    case RenderGraph::Access::TransferRead:
+        return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+    case RenderGraph::Access::TransferWrite:
+        return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+    }
+    return { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+             VK_IMAGE_LAYOUT_GENERAL };
+}
+
+static bool sameDesc(const RenderGraph::ImageDesc &a, const RenderGraph::ImageDesc &b)
+{
+    return a.format == b.format && a.width == b.width && a.height == b.height && a.levels == b.levels
+        && a.samples == b.samples && a.usage == b.usage && a.aspect == b.aspect;
+}
+
+void RenderGraph::init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions)
+{
+    mWindow = window;
+    mDeviceFunctions = deviceFunctions;
+}
+
+void RenderGraph::release()
+{
+    if (!mWindow)
+        return;
+    destroyTransients();
+    reset();
+    mImported.clear();
+    mStats = Stats();
+    mWindow = nullptr;
+}
+
+void RenderGraph::reset()
+{
+    mResources.clear();
+    mPasses.clear();
+    mImageBarriers.clear();
+}
+
+RenderGraph::Resource RenderGraph::addResource(const char *name)
+{
+    ResourceInfo resource;
+    resource.name = name;
+    mResources.push_back(resource);
+    return Resource(mResources.size() - 1);
+}
+
+void RenderGraph::releaseSizeDependent()
+{
+    bool sizeDependent = false;
+    for (const TransientImage &transient : mTransients)
+        sizeDependent = sizeDependent || transient.desc.swapChainScale > 0.0f;
+    // Sharing memory with them, the others are allocated anew as well
+    if (sizeDependent)
+        freeTransients();
+    // Imported images that follow the size are created anew too, maybe with the handle of the old
+    // one. Nothing is in flight, so their next use may just as well start from an undefined layout.
+    mImported.clear();
+}
+
+void RenderGraph::setSwapChainSize(const QSize &size)
+{
+    mSwapChainSize = size;
+}
+
+RenderGraph::Resource RenderGraph::createImage(const char *name, const ImageDesc &desc)
+{
+    const Resource id = addResource(name);
+    ResourceInfo &resource = mResources[id];
+    resource.isImage = true;
+    resource.transient = true;
+    resource.desc = desc;
+    if (desc.swapChainScale > 0.0f) {
+        resource.desc.width = qMax(1u, uint32_t(mSwapChainSize.width() * desc.swapChainScale + 0.5f));
+        resource.desc.height = qMax(1u, uint32_t(mSwapChainSize.height() * desc.swapChainScale + 0.5f));
+    }
+    resource.aspect = desc.aspect;
+    resource.levels = desc.levels;
+    return id;
+}
+
+RenderGraph::Resource RenderGraph::importImage(const char *name, VkImage image, VkImageAspectFlags aspect,
+                                               uint32_t levels)
+{
+    const Resource id = addResource(name);
+    ResourceInfo &resource = mResources[id];
+    resource.isImage = true;
+    resource.image = image;
+    resource.aspect = aspect;
+    resource.levels = levels;
+    return id;
+}
+
+RenderGraph::Resource RenderGraph::importBuffer(const char *name)
+{
+    return addResource(name);
+}
+
+RenderGraph::Pass RenderGraph::addPass(const char *name, Execute execute, bool sideEffects)
+{
+    PassInfo pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    pass.sideEffects = sideEffects;
+    mPasses.push_back(std::move(pass));
+    return Pass(mPasses.size() - 1);
+}
+
+void RenderGraph::read(Pass pass, Resource resource, Access access)
+{
+    use(pass, resource, access, false);
+}
+
+void RenderGraph::write(Pass pass, Resource resource, Access access)
+{
+    use(pass, resource, access, true);
+}
+
+void RenderGraph::use(Pass pass, Resource resource, Access access, bool write)
+{
+    const AccessInfo info = accessInfo(access);
+    const bool isImage = mResources[resource].isImage;
+    const VkImageLayout layout = isImage ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+    std::vector<Use> &uses = mPasses[pass].uses;
+    for (Use &earlier : uses) {
+        if (earlier.resource != resource)
+            continue;
+        if (earlier.layout != layout)
+            qFatal("Render graph pass %s uses %s in two layouts", mPasses[pass].name.c_str(),
+                   mResources[resource].name.c_str());
+        earlier.stages |= info.stages;
+        earlier.access |= info.access;
+        earlier.write = earlier.write || write;
+        return;
+    }
+    uses.push_back({ resource, info.stages, info.access, layout, write });
+}
+
+void RenderGraph::compile()
+{
+    TRACE_SCOPE("render graph compile");
+    cullPasses();
+
+    // Lifetimes of the transient images among the passes that run
+    for (int p = 0; p < int(mPasses.size()); ++p) {
+        if (!mPasses[size_t(p)].needed)
+            continue;
+        for (const Use &use : mPasses[size_t(p)].uses) {
+            ResourceInfo &resource = mResources[use.resource];
+            if (resource.firstPass < 0)
+                resource.firstPass = p;
+            resource.lastPass = p;
+        }
+    }
+    if (!reuseTransients()) {
+        destroyTransients();
+        allocateTransients();
+    }
+
+    // Walk the passes in order, every use against the state the resource was left in
+    std::vector<State *> states(mResources.size(), nullptr);
+    for (size_t r = 0; r < mResources.size(); ++r) {
+        ResourceInfo &resource = mResources[r];
+        if (resource.firstPass < 0)
+            continue;
+        if (resource.transient) {
+            states[r] = &mSlots[size_t(resource.slot)].state;
+        } else {
+            ImportedState &imported = mImported[resource.name];
+            if (imported.image != resource.image)
+                imported = ImportedState{ resource.image, State() };
+            states[r] = &imported.state;
+        }
+    }
+
+    mImageBarriers.clear();
+    mStats.passes = mStats.culledPasses = mStats.barriers = mStats.imageBarriers = 0;
+    for (int p = 0; p < int(mPasses.size()); ++p) {
+        PassInfo &pass = mPasses[size_t(p)];
+        if (!pass.needed) {
+            mStats.culledPasses++;
+            continue;
+        }
+        pass.firstImageBarrier = mImageBarriers.size();
+        for (const Use &use : pass.uses) {
+            const ResourceInfo &resource = mResources[use.resource];
+            // A transient image starts out undefined, whatever was in its memory before
+            addBarrier(pass, resource, *states[use.resource], use, resource.transient && resource.firstPass == p);
+        }
+        pass.imageBarrierCount = mImageBarriers.size() - pass.firstImageBarrier;
+        mStats.passes++;
+        if (pass.dstStages)
+            mStats.barriers++;
+    }
+    mStats.imageBarriers = uint32_t(mImageBarriers.size());
+}
+
+void RenderGraph::cullPasses()
+{
+    // Backwards: a pass is needed if it has side effects or writes what a needed pass uses.
+    // Writes count as uses too, a pass may only overwrite part of a resource.
+    std::vector<bool> used(mResources.size(), false);
+    for (size_t p = mPasses.size(); p-- > 0;) {
+        PassInfo &pass = mPasses[p];
+        pass.needed = pass.sideEffects;
+        pass.srcStages = pass.dstStages = 0;
+        pass.srcAccess = pass.dstAccess = 0;
+        pass.firstImageBarrier = pass.imageBarrierCount = 0;
+        for (const Use &use : pass.uses) {
+            if (use.write && used[use.resource])
+                pass.needed = true;
+        }
+        if (!pass.needed)
+            continue;
+        for (const Use &use : pass.uses)
+            used[use.resource] = true;
+    }
+}
+
+void RenderGraph::addBarrier(PassInfo &pass, const ResourceInfo &resource, State &state, const Use &use, bool discard)
+{
+    if (discard)
+        state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    const bool transition = resource.isImage && state.layout != use.layout;
+    const VkPipelineStageFlags earlier = state.writeStages | state.readStages;
+
+    if (transition || use.write) {
+        // Writes wait for everything before them, reads included. A layout transition is a write as well.
+        if (transition) {
+            VkImageMemoryBarrier barrier;
+            memset(&barrier, 0, sizeof(barrier));
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = state.writeAccess;
+            barrier.dstAccessMask = use.access;
+            barrier.oldLayout = state.layout;
+            barrier.newLayout = use.layout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = resource.image;
+            barrier.subresourceRange = { resource.aspect, 0, resource.levels, 0, 1 };
+            mImageBarriers.push_back(barrier);
+            pass.srcStages |= earlier;
+            pass.dstStages |= use.stages;
+        } else if (earlier) {
+            pass.srcStages |= earlier;
+            pass.srcAccess |= state.writeAccess;
+            pass.dstStages |= use.stages;
+            pass.dstAccess |= use.access;
+        }
+        // Later readers chain onto this pass' stages. After a transition alone nothing is left to make visible.
+        state.writeStages = use.stages;
+        state.writeAccess = use.write ? use.access & WRITE_ACCESS : 0;
+        state.readStages = use.write ? 0 : use.stages;
+        state.readAccess = use.write ? 0 : use.access;
+        state.layout = use.layout;
+        return;
+    }
+
+    // Read in the layout the resource is in already: only a write not yet visible to these stages needs a barrier
+    if (state.writeStages && ((state.readStages & use.stages) != use.stages
+                              || (state.readAccess & use.access) != use.access)) {
+        pass.srcStages |= state.writeStages;
+        pass.srcAccess |= state.writeAccess;
+        pass.dstStages |= use.stages;
+        pass.dstAccess |= use.access;
+    }
+    state.readStages |= use.stages;
+    state.readAccess |= use.access;
+}
+
+void RenderGraph::execute(VkCommandBuffer cb)
+{
+    for (const PassInfo &pass : mPasses) {
+        if (!pass.needed)
+            continue;
+        if (pass.dstStages) {
+            VkMemoryBarrier barrier;
+            memset(&barrier, 0, sizeof(barrier));
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = pass.srcAccess;
+            barrier.dstAccessMask = pass.dstAccess;
+            const uint32_t memoryBarrierCount = pass.srcAccess || pass.dstAccess ? 1 : 0;
+            // Nothing used the resources before: the barrier only has to order the transitions
+            const VkPipelineStageFlags srcStages = pass.srcStages ? pass.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            mDeviceFunctions->vkCmdPipelineBarrier(cb, srcStages, pass.dstStages, 0, memoryBarrierCount, &barrier,
+                                                   0, nullptr, uint32_t(pass.imageBarrierCount),
+                                                   mImageBarriers.data() + pass.firstImageBarrier);
+        }
+        if (pass.execute)
+            pass.execute(cb);
+    }
+}
+
+bool RenderGraph::reuseTransients()
+{
+    std::vector<size_t> used;
+    for (size_t r = 0; r < mResources.size(); ++r) {
+        if (mResources[r].transient && mResources[r].firstPass >= 0)
+            used.push_back(r);
+    }
+
+    // Images that aren't used this frame stay, so a pass that runs only now and then doesn't
+    // make the graph create and destroy its images over and over
+    std::vector<size_t> match(used.size());
+    for (size_t i = 0; i < used.size(); ++i) {
+        const ResourceInfo &resource = mResources[used[i]];
+        size_t t = 0;
+        while (t < mTransients.size()
+               && (resource.name != mTransients[t].name || !sameDesc(resource.desc, mTransients[t].desc)))
+            ++t;
+        if (t == mTransients.size())
+            return false;
+        match[i] = t;
+        // Images sharing memory must still not be used at the same time
+        for (size_t j = 0; j < i; ++j) {
+            const ResourceInfo &other = mResources[used[j]];
+            if (mTransients[match[j]].slot == mTransients[t].slot
+                    && resource.firstPass <= other.lastPass && other.firstPass <= resource.lastPass)
+                return false;
+        }
+    }
+
+    for (size_t i = 0; i < used.size(); ++i) {
+        ResourceInfo &resource = mResources[used[i]];
+        resource.image = mTransients[match[i]].image;
+        resource.view = mTransients[match[i]].view;
+        resource.slot = mTransients[match[i]].slot;
+    }
+    return true;
+}
+
+void RenderGraph::allocateTransients()
+{
+    VkDevice dev = mWindow->device();
+
+    std::vector<size_t> used;
+    std::vector<VkMemoryRequirements> requirements;
+    for (size_t r = 0; r < mResources.size(); ++r) {
+        ResourceInfo &resource = mResources[r];
+        if (!resource.transient || resource.firstPass < 0)
+            continue;
+
+        VkImageCreateInfo imageInfo;
+        memset(&imageInfo, 0, sizeof(imageInfo));
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = resource.desc.format;
+        imageInfo.extent = { resource.desc.width, resource.desc.height, 1 };
+        imageInfo.mipLevels = resource.desc.levels;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = resource.desc.samples;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = resource.desc.usage;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkResult err = mDeviceFunctions->vkCreateImage(dev, &imageInfo, nullptr, &resource.image);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to create render graph image %s: %d", resource.name.c_str(), err);
+
+        VkMemoryRequirements memReq;
+        mDeviceFunctions->vkGetImageMemoryRequirements(dev, resource.image, &memReq);
+        used.push_back(r);
+        requirements.push_back(memReq);
+    }
+
+    // Largest first, each into the first memory whose images are all done before it starts or
+    // start after it is done. Every image sits at offset 0, the memory is as large as its largest.
+    struct SlotPlan {
+        VkDeviceSize size = 0;
+        uint32_t memoryTypeBits = ~0u;
+        std::vector<size_t> images;
+    };
+    std::vector<size_t> order(used.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&requirements](size_t a, size_t b) {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    std::vector<SlotPlan> plans;
+    VkDeviceSize imageBytes = 0;
+    for (size_t i : order) {
+        const ResourceInfo &resource = mResources[used[i]];
+        const VkMemoryRequirements &memReq = requirements[i];
+        imageBytes += memReq.size;
+        size_t slot = 0;
+        for (; slot < plans.size(); ++slot) {
+            if (!(plans[slot].memoryTypeBits & memReq.memoryTypeBits))
+                continue;
+            bool overlaps = false;
+            for (size_t other : plans[slot].images) {
+                const ResourceInfo &otherResource = mResources[used[other]];
+                overlaps = overlaps || (resource.firstPass <= otherResource.lastPass
+                                        && otherResource.firstPass <= resource.lastPass);
+            }
+            if (!overlaps)
+                break;
+        }
+        if (slot == plans.size())
+            plans.push_back(SlotPlan());
+        plans[slot].size = qMax(plans[slot].size, memReq.size);
+        plans[slot].memoryTypeBits &= memReq.memoryTypeBits;
+        plans[slot].images.push_back(i);
+    }
+
+    mSlots.resize(plans.size());
+    mStats.transientBytes = 0;
+    for (size_t slot = 0; slot < plans.size(); ++slot) {
+        // QVulkanWindow's device local type suits images on all common drivers, otherwise take any allowed type
+        const uint32_t typeBits = plans[slot].memoryTypeBits;
+        uint32_t memoryIndex = mWindow->deviceLocalMemoryIndex();
+        if (!(typeBits & (1u << memoryIndex))) {
+            memoryIndex = 0;
+            while (!(typeBits & (1u << memoryIndex)))
+                ++memoryIndex;
+        }
+
+        VkMemoryAllocateInfo allocInfo;
+        memset(&allocInfo, 0, sizeof(allocInfo));
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = plans[slot].size;
+        allocInfo.memoryTypeIndex = memoryIndex;
+        VkResult err = mDeviceFunctions->vkAllocateMemory(dev, &allocInfo, nullptr, &mSlots[slot].memory);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to allocate render graph memory: %d", err);
+        mSlots[slot].state = State();
+        mStats.transientBytes += plans[slot].size;
+
+        for (size_t i : plans[slot].images)
+            mResources[used[i]].slot = int(slot);
+    }
+
+    mTransients.clear();
+    for (size_t r : used) {
+        ResourceInfo &resource = mResources[r];
+        VkResult err = mDeviceFunctions->vkBindImageMemory(dev, resource.image, mSlots[size_t(resource.slot)].memory, 0);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to bind render graph memory: %d", err);
+
+        VkImageViewCreateInfo viewInfo;
+        memset(&viewInfo, 0, sizeof(viewInfo));
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = resource.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = resource.desc.format;
+        viewInfo.subresourceRange = { resource.desc.aspect, 0, resource.desc.levels, 0, 1 };
+        err = mDeviceFunctions->vkCreateImageView(dev, &viewInfo, nullptr, &resource.view);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to create render graph image view %s: %d", resource.name.c_str(), err);
+
+        TransientImage transient;
+        transient.name = resource.name;
+        transient.desc = resource.desc;
+        transient.image = resource.image;
+        transient.view = resource.view;
+        transient.slot = resource.slot;
+        mTransients.push_back(transient);
+    }
+    mStats.aliasedBytes = imageBytes - mStats.transientBytes;
+    mGeneration++;
+
+    if (!mTransients.empty()) {
+        LOG_INFO(Render, "Render graph: {} transient images in {} allocations, {} KiB, {} KiB saved by aliasing",
+                 mTransients.size(), mSlots.size(), mStats.transientBytes / 1024, mStats.aliasedBytes / 1024);
+    }
+}
+
+void RenderGraph::destroyTransients()
+{
+    if (mTransients.empty() && mSlots.empty())
+        return;
+    mDeviceFunctions->vkDeviceWaitIdle(mWindow->device());
+    freeTransients();
+}
+
+void RenderGraph::freeTransients()
+{
+    VkDevice dev = mWindow->device();
+    for (TransientImage &transient : mTransients) {
+        if (transient.view)
+            mDeviceFunctions->vkDestroyImageView(dev, transient.view, nullptr);
+        if (transient.image)
+            mDeviceFunctions->vkDestroyImage(dev, transient.image, nullptr);
+    }
+    for (Slot &slot : mSlots) {
+        if (slot.memory)
+            mDeviceFunctions->vkFreeMemory(dev, slot.memory, nullptr);
+    }
+    mTransients.clear();
+    mSlots.clear();
+    mStats.transientBytes = mStats.aliasedBytes = 0;
+}
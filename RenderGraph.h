@@ -0,0 +1,197 @@
+#pragma once
+
+#include <QVulkanWindow>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// The GPU work of a frame as passes that declare what they read and write.
+//
+// Every frame the passes and resources are declared again (reset(), create/import,
+// addPass(), read() and write()), compile() works out what the declarations imply and
+// execute() records the passes in the order they were added:
+//
+//   - Passes nothing needs are dropped. A pass is needed when it has side effects (it
+//     draws to the swap chain, say) or writes a resource that a needed pass reads later.
+//   - Before each pass one vkCmdPipelineBarrier makes the writes of earlier passes visible
+//     and moves images into the layout the pass wants. Reads after reads of the same layout
+//     need none. Images get image barriers, buffers a global memory barrier.
+//   - Transient images live only within the frame. Those whose passes don't overlap share
+//     memory; the first pass using one sees undefined contents.
+//
+// Barriers inside a pass, between its own dispatches say, are still the pass' business.
+// The state of every resource carries over to the next frame, matched by name, so the
+// first barrier of a frame also waits for the last use in the frame before.
+class RenderGraph
+{
+public:
+    typedef uint32_t Resource;
+    typedef uint32_t Pass;
+    typedef std::function<void(VkCommandBuffer)> Execute;
+
+    // How a pass uses a resource: stages, access and image layout
+    enum class Access {
+        DepthWrite,         // Depth attachment of a render pass
+        ColorWrite,         // Color attachment of a render pass
+        ComputeSampled,     // Sampled image in a compute shader
+        FragmentSampled,    // Sampled image in a fragment shader
+        ComputeRead,        // Storage buffer or image (general layout) read by a compute shader
+        ComputeWrite,       // ... written, and maybe read, by a compute shader
+        IndirectRead,       // Indirect draw commands and counts
+        VertexRead,         // Storage buffer read by a vertex shader
+        HostRead,           // Mapped memory read by the CPU once the frame's fence has signalled
+        TransferRead,
+        TransferWrite,
+    };
+
+    struct ImageDesc {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // > 0: width and height are the swap chain's times this, and follow it when the window is resized
+        float swapChainScale = 0.0f;
+        uint32_t levels = 1;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+        VkImageUsageFlags usage = 0;
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    };
+
+    // What the last compile() came up with
+    struct Stats {
+        uint32_t passes = 0;            // Executed
+        uint32_t culledPasses = 0;
+        uint32_t barriers = 0;          // vkCmdPipelineBarrier calls
+        uint32_t imageBarriers = 0;
+        VkDeviceSize transientBytes = 0;    // Memory of the transient images
+        VkDeviceSize aliasedBytes = 0;      // ... they would need without aliasing, minus the above
+    };
+
+    void init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions);
+    void release();
+
+    // Forgets the passes and resources of the last frame, keeps the transient images and all states
+    void reset();
+
+    // Swap chain recreation, QVulkanWindow has waited for the device to be idle. Destroys the
+    // transient images when any of them follows the swap chain size, so compile() allocates them
+    // anew without waiting for the device once more. The others are kept. Imported resources
+    // start over from an undefined layout, their contents are gone.
+    void releaseSizeDependent();
+    // Size the images with a swapChainScale are created with from now on
+    void setSwapChainSize(const QSize &size);
+
+    // Image owned by the graph, valid from compile() to the next compile()
+    Resource createImage(const char *name, const ImageDesc &desc);
+    // Image owned by someone else, it keeps its contents between frames
+    Resource importImage(const char *name, VkImage image, VkImageAspectFlags aspect, uint32_t levels);
+    // Buffers only get memory barriers, the graph doesn't need their handles
+    Resource importBuffer(const char *name);
+
+    // Passes are executed in the order they are added
+    Pass addPass(const char *name, Execute execute, bool sideEffects = false);
+    // Several uses of the same resource in a pass are merged, image uses must agree on the layout
+    void read(Pass pass, Resource resource, Access access);
+    void write(Pass pass, Resource resource, Access access);
+
+    // Culls passes, allocates the transient images and works out the barriers
+    void compile();
+    // Records barriers and passes into cb
+    void execute(VkCommandBuffer cb);
+
+    VkImage image(Resource resource) const { return mResources[resource].image; }
+    VkImageView view(Resource resource) const { return mResources[resource].view; }
+    // Changes whenever the transient images are created anew, views handed out before are gone then.
+    // That only happens with the device idle, so whatever refers to them can be updated right away.
+    uint32_t generation() const { return mGeneration; }
+    bool isCulled(Pass pass) const { return !mPasses[pass].needed; }
+    const Stats &stats() const { return mStats; }
+
+private:
+    // What happened to a resource so far: stages of the last write and of the reads since,
+    // access made visible to those reads
+    struct State {
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        VkPipelineStageFlags readStages = 0;
+        VkAccessFlags readAccess = 0;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+    struct ResourceInfo {
+        std::string name;
+        bool isImage = false;
+        bool transient = false;
+        ImageDesc desc;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkImageAspectFlags aspect = 0;
+        uint32_t levels = 1;
+        int firstPass = -1;             // Lifetime among the needed passes
+        int lastPass = -1;
+        int slot = -1;                  // Transient: memory it shares
+    };
+    // Uses of the same resource in a pass merged into one
+    struct Use {
+        Resource resource;
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+        VkImageLayout layout;
+        bool write;
+    };
+    struct PassInfo {
+        std::string name;
+        Execute execute;
+        bool sideEffects = false;
+        bool needed = false;
+        std::vector<Use> uses;
+        // Barrier recorded before the pass
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        VkAccessFlags srcAccess = 0;
+        VkAccessFlags dstAccess = 0;
+        size_t firstImageBarrier = 0;
+        size_t imageBarrierCount = 0;
+    };
+    // Transient image of an earlier compile(), kept until one is needed that isn't there
+    struct TransientImage {
+        std::string name;
+        ImageDesc desc;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        int slot = -1;
+    };
+    struct Slot {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        State state;
+    };
+    struct ImportedState {
+        VkImage image = VK_NULL_HANDLE;
+        State state;
+    };
+
+    Resource addResource(const char *name);
+    void use(Pass pass, Resource resource, Access access, bool write);
+    void cullPasses();
+    // Takes over images created before when all the ones used are there and their lifetimes still allow the aliasing
+    bool reuseTransients();
+    void allocateTransients();
+    // Waits for the device to be idle, frames in flight may still use them
+    void destroyTransients();
+    void freeTransients();
+    void addBarrier(PassInfo &pass, const ResourceInfo &resource, State &state, const Use &use, bool discard);
+
+    QVulkanWindow *mWindow = nullptr;
+    QVulkanDeviceFunctions *mDeviceFunctions = nullptr;
+
+    std::vector<ResourceInfo> mResources;
+    std::vector<PassInfo> mPasses;
+    std::vector<VkImageMemoryBarrier> mImageBarriers;
+
+    std::vector<TransientImage> mTransients;
+    std::vector<Slot> mSlots;
+    std::map<std::string, ImportedState> mImported;
+    QSize mSwapChainSize;
+    uint32_t mGeneration = 0;
+    Stats mStats;
+};
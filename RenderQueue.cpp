@@ -0,0 +1,153 @@
+#include "RenderQueue.h"
+#include <QVulkanFunctions>
+#include <algorithm>
+#include <cstring>
+
+// Field widths of the key, from the top
+static constexpr int PASS_BITS = 2;
+static constexpr int PIPELINE_BITS = 10;
+static constexpr int MATERIAL_BITS = 12;
+static constexpr int MESH_BITS = 12;
+static constexpr int DEPTH_BITS = 28;
+static_assert(PASS_BITS + PIPELINE_BITS + MATERIAL_BITS + MESH_BITS + DEPTH_BITS == 64, "Key fields must fill 64 bits");
+
+static constexpr int MESH_SHIFT = DEPTH_BITS;
+static constexpr int MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+static constexpr int PIPELINE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+static constexpr int PASS_SHIFT = PIPELINE_SHIFT + PIPELINE_BITS;
+
+// Blended passes put the depth first, the state only orders draws at the same depth
+static constexpr int BLENDED_MATERIAL_SHIFT = MESH_BITS;
+static constexpr int BLENDED_PIPELINE_SHIFT = BLENDED_MATERIAL_SHIFT + MATERIAL_BITS;
+static constexpr int BLENDED_DEPTH_SHIFT = BLENDED_PIPELINE_SHIFT + PIPELINE_BITS;
+static_assert(BLENDED_DEPTH_SHIFT + DEPTH_BITS == PASS_SHIFT, "Blended key fields must fill the same bits");
+
+void RenderQueue::clear()
+{
+    mDraws.clear();
+    mItems.clear();
+    mPipelines.clear();
+    mMeshes.clear();
+}
+
+template <typename Handle>
+uint32_t RenderQueue::idOf(std::vector<Handle> &handles, Handle handle, uint32_t limit)
+{
+    // A frame has a handful of each, a linear search beats hashing
+    for (size_t i = 0; i < handles.size(); ++i) {
+        if (handles[i] == handle)
+            return uint32_t(i);
+    }
+    if (handles.size() + 1 >= limit)
+        return limit - 1;
+    handles.push_back(handle);
+    return uint32_t(handles.size() - 1);
+}
+
+uint64_t RenderQueue::makeKey(Pass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+{
+    // Non-negative floats sort like their bits. Without the sign bit and the lowest
+    // three mantissa bits they fit the depth field, even infinity does.
+    if (!(depth > 0.0f))
+        depth = 0.0f;
+    uint32_t depthBits;
+    memcpy(&depthBits, &depth, sizeof(depthBits));
+    uint64_t quantized = depthBits >> (32 - 1 - DEPTH_BITS);
+    if (pass == Overlay) {
+        quantized = ~quantized & ((uint64_t(1) << DEPTH_BITS) - 1);     // Far to near
+        return (uint64_t(pass) << PASS_SHIFT)
+             | (quantized << BLENDED_DEPTH_SHIFT)
+             | (uint64_t(pipeline) << BLENDED_PIPELINE_SHIFT)
+             | (uint64_t(material) << BLENDED_MATERIAL_SHIFT)
+             | uint64_t(mesh);
+    }
+
+    return (uint64_t(pass) << PASS_SHIFT)
+         | (uint64_t(pipeline) << PIPELINE_SHIFT)
+         | (uint64_t(material) << MATERIAL_SHIFT)
+         | (uint64_t(mesh) << MESH_SHIFT)
+         | quantized;
+}
+
+void RenderQueue::add(Pass pass, VkPipeline pipeline, uint32_t material, VkBuffer buffer, VkDeviceSize indexOffset,
+                      uint32_t indexCount, uint32_t firstIndex, uint32_t transform, float depth)
+{
+    const uint32_t pipelineId = idOf(mPipelines, pipeline, 1u << PIPELINE_BITS);
+    // Materials are small numbers already
+    const uint32_t materialId = std::min(material, (1u << MATERIAL_BITS) - 1);
+    const uint32_t meshId = idOf(mMeshes, buffer, 1u << MESH_BITS);
+
+    Draw draw;
+    draw.pipeline = pipeline;
+    draw.buffer = buffer;
+    draw.indexOffset = indexOffset;
+    draw.indexCount = indexCount;
+    draw.firstIndex = firstIndex;
+    draw.indices = { transform, material };
+
+    mItems.push_back({ makeKey(pass, pipelineId, materialId, meshId, depth), uint32_t(mDraws.size()) });
+    mDraws.push_back(draw);
+}
+
+void RenderQueue::sort()
+{
+    const size_t count = mItems.size();
+    if (count < 2)
+        return;
+    mScratch.resize(count);
+
+    // Stable counting sort on each byte from the lowest up
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {};
+        for (const Item &item : mItems)
+            histogram[(item.key >> shift) & 0xffu]++;
+        // Depth is often the only byte that differs, the ids all share theirs
+        if (histogram[(mItems[0].key >> shift) & 0xffu] == count)
+            continue;
+
+        size_t offset = 0;
+        for (size_t &bucket : histogram) {
+            const size_t bucketCount = bucket;
+            bucket = offset;
+            offset += bucketCount;
+        }
+        for (const Item &item : mItems)
+            mScratch[histogram[(item.key >> shift) & 0xffu]++] = item;
+        mItems.swap(mScratch);
+    }
+}
+
+RenderQueue::Stats RenderQueue::submit(VkCommandBuffer cb, QVulkanDeviceFunctions *deviceFunctions,
+                                       VkPipelineLayout layout, VkPipeline boundPipeline) const
+{
+    Stats stats;
+    VkPipeline pipeline = boundPipeline;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize indexOffset = 0;
+
+    for (const Item &item : mItems) {
+        const Draw &draw = mDraws[item.draw];
+
+        if (draw.pipeline != pipeline) {
+            deviceFunctions->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+            pipeline = draw.pipeline;
+            stats.pipelineBinds++;
+        }
+        if (draw.buffer != buffer || draw.indexOffset != indexOffset) {
+            const VkDeviceSize vertexOffset = 0;
+            deviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &draw.buffer, &vertexOffset);
+            deviceFunctions->vkCmdBindIndexBuffer(cb, draw.buffer, draw.indexOffset, VK_INDEX_TYPE_UINT16);
+            buffer = draw.buffer;
+            indexOffset = draw.indexOffset;
+            stats.vertexBinds++;
+        } else {
+            stats.skippedBinds++;
+        }
+
+        deviceFunctions->vkCmdPushConstants(cb, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(draw.indices),
+                                            &draw.indices);
+        deviceFunctions->vkCmdDrawIndexed(cb, draw.indexCount, 1, draw.firstIndex, 0, 0);
+        stats.drawCalls++;
+    }
+    return stats;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QVulkanWindow>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BindlessSet.h"
+
+// Draws of one command buffer, added in any order and recorded sorted by a 64 bit key
+//
+//   Opaque:   63-62 pass | 61-52 pipeline | 51-40 material | 39-28 mesh | 27-0 depth
+//   Overlay:  63-62 pass | 61-34 depth | 33-24 pipeline | 23-12 material | 11-0 mesh
+//
+// so opaque draws with the same pipeline, material and buffer (mesh) follow each other and
+// submit() binds the pipeline and the buffer only when they change. Materials and
+// transforms are rows of the BindlessSet, which the command buffer has bound already:
+// a draw just pushes their indices. Within the same state opaque draws go front to back,
+// so the depth test rejects more fragments early. Overlay draws blend, so they all go back
+// to front, whatever their state: only draws at the same depth are grouped. Pipelines and
+// meshes are numbered in the order they are first added: the ids only group equal handles,
+// submit() compares the handles themselves.
+//
+// Not thread safe, every recording thread has a queue of its own.
+class RenderQueue
+{
+public:
+    enum Pass : uint32_t {
+        Opaque,
+        Overlay,
+    };
+
+    // What submit() recorded
+    struct Stats {
+        uint32_t drawCalls = 0;
+        uint32_t pipelineBinds = 0;
+        uint32_t vertexBinds = 0;
+        uint32_t skippedBinds = 0;  // Vertex buffer binds the previous draw made unnecessary
+    };
+
+    // Keeps the memory, the queue is refilled every frame
+    void clear();
+    // The indices are in buffer from indexOffset on, the vertices from its start. transform and
+    // material are rows of the BindlessSet, depth is the distance from the camera.
+    void add(Pass pass, VkPipeline pipeline, uint32_t material, VkBuffer buffer, VkDeviceSize indexOffset,
+             uint32_t indexCount, uint32_t firstIndex, uint32_t transform, float depth);
+
+    bool isEmpty() const { return mDraws.empty(); }
+    size_t size() const { return mDraws.size(); }
+
+    // LSD radix sort of the keys, a byte per pass. Bytes all keys share are skipped.
+    void sort();
+    // Records the draws in key order: binds, BindlessSet::DrawIndices push constant, indexed draw.
+    // boundPipeline is what cb has bound already, it isn't bound again.
+    Stats submit(VkCommandBuffer cb, QVulkanDeviceFunctions *deviceFunctions, VkPipelineLayout layout,
+                 VkPipeline boundPipeline = VK_NULL_HANDLE) const;
+
+    static uint64_t makeKey(Pass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+
+private:
+    struct Draw {
+        VkPipeline pipeline;
+        VkBuffer buffer;
+        VkDeviceSize indexOffset;
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        BindlessSet::DrawIndices indices;
+    };
+    struct Item {
+        uint64_t key;
+        uint32_t draw;      // Index into mDraws
+    };
+
+    // Id of handle within this frame, ids past limit share the last one
+    template <typename Handle>
+    static uint32_t idOf(std::vector<Handle> &handles, Handle handle, uint32_t limit);
+
+    std::vector<Draw> mDraws;
+    std::vector<Item> mItems;       // Sorted by sort()
+    std::vector<Item> mScratch;
+    std::vector<VkPipeline> mPipelines;
+    std::vector<VkBuffer> mMeshes;
+};
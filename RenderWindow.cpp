@@ -1,453 +1,99 @@
 ﻿#include "RenderWindow.h"
 #include <QVulkanFunctions>
 #include <QFile>
+#include <QElapsedTimer>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include "AllocationCounter.h"
+#include "FrameStatsRing.h"
+#include "Trace.h"
+#include "Log.h"
 #include "VulkanWindow.h"
+#include "Primitives.h"
+
+// Meshes, generated at compile time (see Primitives.h)
+using Primitives::Color;
 
 // ENLARGED ground vertex data (10x10 plane instead of 5x5)
-static float groundVertexData[] = {
-    -10.0f,  0.0f, -10.0f,   0.3f, 0.3f, 0.3f,  // Bottom-left
-    -10.0f,  0.0f,  10.0f,   0.3f, 0.3f, 0.3f,  // Top-left
-     10.0f,  0.0f, -10.0f,   0.3f, 0.3f, 0.3f,  // Bottom-right
-
-    -10.0f,  0.0f,  10.0f,   0.3f, 0.3f, 0.3f,  // Top-left
-     10.0f,  0.0f,  10.0f,   0.3f, 0.3f, 0.3f,  // Top-right
-     10.0f,  0.0f, -10.0f,   0.3f, 0.3f, 0.3f   // Bottom-right
-};
-
-// FIXED Player cube vertex data (MUCH brighter blue color for visibility)
-static float playerVertexData[] = {
-    // Front face
-    -0.8f, -0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  // Bright blue
-     0.8f, -0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-    -0.8f,  0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f,  0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-    -0.8f,  0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f, -0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-
-    // Back face
-    -0.8f, -0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f, -0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-    -0.8f,  0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f,  0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-    -0.8f,  0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f, -0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-
-    // Left face
-    -0.8f, -0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-    -0.8f, -0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-    -0.8f,  0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-    -0.8f,  0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-    -0.8f,  0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-    -0.8f, -0.8f,  0.8f,   0.0f, 0.0f, 1.0f, 
-
-    // Right face
-     0.8f, -0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f, -0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f,  0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f,  0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f,  0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f, -0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-
-    // Top face
-    -0.8f,  0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f,  0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-    -0.8f,  0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f,  0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-    -0.8f,  0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f,  0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-
-    // Bottom face
-    -0.8f, -0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f, -0.8f, -0.8f,   0.0f, 0.0f, 1.0f,  
-    -0.8f, -0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f, -0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-    -0.8f, -0.8f,  0.8f,   0.0f, 0.0f, 1.0f,  
-     0.8f, -0.8f, -0.8f,   0.0f, 0.0f, 1.0f    
-};
-
-// FIXED Collectible vertex data (VERY bright yellow color)
-static float collectibleVertexData[] = {
-    // Front face (pure bright yellow)
-    -0.6f, -0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  // Pure yellow
-     0.6f, -0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.6f,  0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f,  0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.6f,  0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f, -0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-
-    // Back face
-    -0.6f, -0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f, -0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.6f,  0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f,  0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.6f,  0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f, -0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-
-    // Left face
-    -0.6f, -0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.6f, -0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.6f,  0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.6f,  0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.6f,  0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.6f, -0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-
-    // Right face
-     0.6f, -0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f, -0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f,  0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f,  0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f,  0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f, -0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-
-    // Top face
-    -0.6f,  0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f,  0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.6f,  0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f,  0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.6f,  0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f,  0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-
-    // Bottom face
-    -0.6f, -0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f, -0.6f, -0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.6f, -0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f, -0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.6f, -0.6f,  0.6f,   1.0f, 1.0f, 0.0f,  
-     0.6f, -0.6f, -0.6f,   1.0f, 1.0f, 0.0f   
-};
-
-// NPC vertex data arrays with different colors for each NPC
-// Red NPC vertex data (for NPC 1)
-static float npcVertexData1[] = {
-    // Front face (bright red color)
-    -0.7f, -0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  // Pure red
-     0.7f, -0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-    -0.7f,  0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f,  0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-    -0.7f,  0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f, -0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-
-    // Back face
-    -0.7f, -0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f, -0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-    -0.7f,  0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f,  0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-    -0.7f,  0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f, -0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-
-    // Left face
-    -0.7f, -0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-    -0.7f, -0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-    -0.7f,  0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-    -0.7f,  0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-    -0.7f,  0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-    -0.7f, -0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-
-    // Right face
-     0.7f, -0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f, -0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f,  0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f,  0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f,  0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f, -0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-
-    // Top face
-    -0.7f,  0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f,  0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-    -0.7f,  0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f,  0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-    -0.7f,  0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f,  0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-
-    // Bottom face
-    -0.7f, -0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f, -0.7f, -0.7f,   1.0f, 0.0f, 0.0f,  
-    -0.7f, -0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f, -0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-    -0.7f, -0.7f,  0.7f,   1.0f, 0.0f, 0.0f,  
-     0.7f, -0.7f, -0.7f,   1.0f, 0.0f, 0.0f   
-};
-
-// Green NPC vertex data (for NPC 2)
-static float npcVertexData2[] = {
-    // Front face (bright green color)
-    -0.7f, -0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  // Pure green
-     0.7f, -0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-    -0.7f,  0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f,  0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-    -0.7f,  0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f, -0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-
-    // Back face
-    -0.7f, -0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f, -0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-    -0.7f,  0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f,  0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-    -0.7f,  0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f, -0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-
-    // Left face
-    -0.7f, -0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-    -0.7f, -0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-    -0.7f,  0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-    -0.7f,  0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-    -0.7f,  0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-    -0.7f, -0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-
-    // Right face
-     0.7f, -0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f, -0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f,  0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f,  0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f,  0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f, -0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-
-    // Top face
-    -0.7f,  0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f,  0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-    -0.7f,  0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f,  0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-    -0.7f,  0.7f,  0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f,  0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-
-    // Bottom face
-    -0.7f, -0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-     0.7f, -0.7f, -0.7f,   0.0f, 1.0f, 0.0f,  
-    -0.7f, -0.7f,  0.6f,   1.0f, 1.0f, 0.0f,  
-     0.7f, -0.7f,  0.6f,   1.0f, 1.0f, 0.0f,  
-    -0.7f, -0.7f,  0.6f,   1.0f, 1.0f, 0.0f,  
-     0.7f, -0.7f, -0.6f,   1.0f, 1.0f, 0.0f   
-};
-
-// Blue NPC vertex data (for NPC 3)
-static float npcVertexData3[] = {
-    // Front face (bright blue color)
-    -0.7f, -0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  // Bright blue
-     0.7f, -0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-    -0.7f,  0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f,  0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-    -0.7f,  0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f, -0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-
-    // Back face
-    -0.7f, -0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f, -0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-    -0.7f,  0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f,  0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-    -0.7f,  0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f, -0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-
-    // Left face
-    -0.7f, -0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-    -0.7f, -0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-    -0.7f,  0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-    -0.7f,  0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-    -0.7f,  0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-    -0.7f, -0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-
-    // Right face
-     0.7f, -0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f, -0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f,  0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f,  0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f,  0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f, -0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-
-    // Top face
-    -0.7f,  0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f,  0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-    -0.7f,  0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f,  0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-    -0.7f,  0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f,  0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-
-    // Bottom face
-    -0.7f, -0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f, -0.7f, -0.7f,   0.0f, 0.5f, 1.0f,  
-    -0.7f, -0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f, -0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-    -0.7f, -0.7f,  0.7f,   0.0f, 0.5f, 1.0f,  
-     0.7f, -0.7f, -0.7f,   0.0f, 0.5f, 1.0f   
-};
-
-//House vertex data - brown walls
-static float houseWallsVertexData[] = {
-    // Front wall (with door hole)
-    // Left part of front wall
-    -3.0f,  0.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-left
-    -3.0f,  2.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Top-left
-    -1.0f,  0.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-right
-    -1.0f,  2.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Top-right
-    -1.0f,  0.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-right
-    -3.0f,  2.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Top-left
-
-    // Right part of front wall
-    1.0f,   0.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-left
-    1.0f,   2.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Top-left
-    3.0f,   0.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-right
-    3.0f,   2.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Top-right
-    3.0f,   0.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-right
-    1.0f,   2.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Top-left
-
-    // Top part of front wall
-    -1.0f,  2.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-left
-    -1.0f,  3.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Top-left
-    1.0f,   2.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-right
-    1.0f,   3.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Top-right
-    1.0f,   2.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-right
-    -1.0f,  3.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Top-left
-
-    // Back wall
-    -3.0f,  0.0f, -3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-left
-    -3.0f,  3.0f, -3.0f,   0.6f, 0.4f, 0.2f,  // Top-left
-    3.0f,   0.0f, -3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-right
-    3.0f,   3.0f, -3.0f,   0.6f, 0.4f, 0.2f,  // Top-right
-    3.0f,   0.0f, -3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-right
-    -3.0f,  3.0f, -3.0f,   0.6f, 0.4f, 0.2f,  // Top-left
-
-    // Left wall
-    -3.0f,  0.0f, -3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-back
-    -3.0f,  3.0f, -3.0f,   0.6f, 0.4f, 0.2f,  // Top-back
-    -3.0f,  0.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-front
-    -3.0f,  3.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Top-front
-    -3.0f,  0.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-front
-    -3.0f,  3.0f, -3.0f,   0.6f, 0.4f, 0.2f,  // Top-back
-
-    // Right wall
-    3.0f,   0.0f, -3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-back
-    3.0f,   3.0f, -3.0f,   0.6f, 0.4f, 0.2f,  // Top-back
-    3.0f,   0.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-front
-    3.0f,   3.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Top-front
-    3.0f,   0.0f,  3.0f,   0.6f, 0.4f, 0.2f,  // Bottom-front
-    3.0f,   3.0f, -3.0f,   0.6f, 0.4f, 0.2f   // Top-back
-};
-
-// House door vertex data - dark brown (closed position)
-static float houseDoorVertexData[] = {
-    // Door (slightly inset)
-    -1.0f,  0.0f,  2.9f,   0.4f, 0.2f, 0.1f,  // Bottom-left
-    -1.0f,  2.0f,  2.9f,   0.4f, 0.2f, 0.1f,  // Top-left
-    1.0f,   0.0f,  2.9f,   0.4f, 0.2f, 0.1f,  // Bottom-right
-    1.0f,   2.0f,  2.9f,   0.4f, 0.2f, 0.1f,  // Top-right
-    1.0f,   0.0f,  2.9f,   0.4f, 0.2f, 0.1f,  // Bottom-right
-    -1.0f,  2.0f,  2.9f,   0.4f, 0.2f, 0.1f   // Top-left
-};
-
-// House door vertex data - dark brown (open position - rotated 90 degrees)
-static float houseDoorOpenVertexData[] = {
-    // Door (rotated to open position) - with a different color to make it obvious when open
-    -1.0f,  0.0f,  2.9f,   0.9f, 0.5f, 0.2f,  // Bottom-left (hinge point) - brighter color
-    -1.0f,  2.0f,  2.9f,   0.9f, 0.5f, 0.2f,  // Top-left (hinge point) - brighter color
-    -1.0f,  0.0f,  0.9f,   0.9f, 0.5f, 0.2f,  // Bottom-right (new position) - brighter color
-    -1.0f,  2.0f,  0.9f,   0.9f, 0.5f, 0.2f,  // Top-right (new position) - brighter color
-    -1.0f,  0.0f,  0.9f,   0.9f, 0.5f, 0.2f,  // Bottom-right (new position) - brighter color
-    -1.0f,  2.0f,  2.9f,   0.9f, 0.5f, 0.2f   // Top-left (hinge point) - brighter color
-};
-
-// House roof vertex data - red
-static float houseRoofVertexData[] = {
-    // Front triangle
-    -3.5f,  3.0f,  3.5f,   0.8f, 0.2f, 0.2f,  // Bottom-left
-    3.5f,   3.0f,  3.5f,   0.8f, 0.2f, 0.2f,  // Bottom-right
-    0.0f,   5.0f,  0.0f,   0.8f, 0.2f, 0.2f,  // Top
-
-    // Back triangle
-    -3.5f,  3.0f, -3.5f,   0.8f, 0.2f, 0.2f,  // Bottom-left
-    3.5f,   3.0f, -3.5f,   0.8f, 0.2f, 0.2f,  // Bottom-right
-    0.0f,   5.0f,  0.0f,   0.8f, 0.2f, 0.2f,  // Top
-
-    // Left triangle
-    -3.5f,  3.0f, -3.5f,   0.8f, 0.2f, 0.2f,  // Bottom-back
-    -3.5f,  3.0f,  3.5f,   0.8f, 0.2f, 0.2f,  // Bottom-front
-    0.0f,   5.0f,  0.0f,   0.8f, 0.2f, 0.2f,  // Top
-
-    // Right triangle
-    3.5f,   3.0f, -3.5f,   0.8f, 0.2f, 0.2f,  // Bottom-back
-    3.5f,   3.0f,  3.5f,   0.8f, 0.2f, 0.2f,  // Bottom-front
-    0.0f,   5.0f,  0.0f,   0.8f, 0.2f, 0.2f   // Top
-};
-
-// Indoor walls vertex data - light beige
-static float indoorWallsVertexData[] = {
-    // Front wall (with door hole)
-    // Left part of front wall
-    -3.0f,  0.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-left
-    -3.0f,  3.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Top-left
-    -1.0f,  0.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-right
-    -1.0f,  3.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Top-right
-    -1.0f,  0.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-right
-    -3.0f,  3.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Top-left
-
-    // Right part of front wall
-    1.0f,   0.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-left
-    1.0f,   3.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Top-left
-    3.0f,   0.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-right
-    3.0f,   3.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Top-right
-    3.0f,   0.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-right
-    1.0f,   3.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Top-left
-
-    // Top part of front wall
-    -1.0f,  2.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-left
-    -1.0f,  3.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Top-left
-    1.0f,   2.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-right
-    1.0f,   3.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Top-right
-    1.0f,   2.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-right
-    -1.0f,  3.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Top-left
-
-    // Back wall
-    -3.0f,  0.0f, -3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-left
-    -3.0f,  3.0f, -3.0f,   0.9f, 0.8f, 0.7f,  // Top-left
-    3.0f,   0.0f, -3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-right
-    3.0f,   3.0f, -3.0f,   0.9f, 0.8f, 0.7f,  // Top-right
-    3.0f,   0.0f, -3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-right
-    -3.0f,  3.0f, -3.0f,   0.9f, 0.8f, 0.7f,  // Top-left
-
-    // Left wall
-    -3.0f,  0.0f, -3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-back
-    -3.0f,  3.0f, -3.0f,   0.9f, 0.8f, 0.7f,  // Top-back
-    -3.0f,  0.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-front
-    -3.0f,  3.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Top-front
-    -3.0f,  0.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-front
-    -3.0f,  3.0f, -3.0f,   0.9f, 0.8f, 0.7f,  // Top-back
-
-    // Right wall
-    3.0f,   0.0f, -3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-back
-    3.0f,   3.0f, -3.0f,   0.9f, 0.8f, 0.7f,  // Top-back
-    3.0f,   0.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-front
-    3.0f,   3.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Top-front
-    3.0f,   0.0f,  3.0f,   0.9f, 0.8f, 0.7f,  // Bottom-front
-    3.0f,   3.0f, -3.0f,   0.9f, 0.8f, 0.7f,  // Top-back
-    
-    // Ceiling
-    -3.0f,  3.0f, -3.0f,   0.9f, 0.9f, 0.8f,  // Back-left
-    3.0f,   3.0f, -3.0f,   0.9f, 0.9f, 0.8f,  // Back-right
-    -3.0f,  3.0f,  3.0f,   0.9f, 0.9f, 0.8f,  // Front-left
-    3.0f,   3.0f,  3.0f,   0.9f, 0.9f, 0.8f,  // Front-right
-    -3.0f,  3.0f,  3.0f,   0.9f, 0.9f, 0.8f,  // Front-left
-    3.0f,   3.0f, -3.0f,   0.9f, 0.9f, 0.8f,  // Back-right
-    
-    // Floor
-    -3.0f,  0.0f, -3.0f,   0.7f, 0.6f, 0.5f,  // Back-left
-    3.0f,   0.0f, -3.0f,   0.7f, 0.6f, 0.5f,  // Back-right
-    -3.0f,  0.0f,  3.0f,   0.7f, 0.6f, 0.5f,  // Front-left
-    3.0f,   0.0f,  3.0f,   0.7f, 0.6f, 0.5f,  // Front-right
-    -3.0f,  0.0f,  3.0f,   0.7f, 0.6f, 0.5f,  // Front-left
-    3.0f,   0.0f, -3.0f,   0.7f, 0.6f, 0.5f,  // Back-right
-};
-
-// Exit door vertex data (for inside)
-static float exitDoorVertexData[] = {
-    // Door (exit to outside)
-    -1.0f,  0.0f,  3.0f,   0.4f, 0.8f, 0.4f,  // Bottom-left (green for exit)
-    -1.0f,  2.0f,  3.0f,   0.4f, 0.8f, 0.4f,  // Top-left
-    1.0f,   0.0f,  3.0f,   0.4f, 0.8f, 0.4f,  // Bottom-right
-    1.0f,   2.0f,  3.0f,   0.4f, 0.8f, 0.4f,  // Top-right
-    1.0f,   0.0f,  3.0f,   0.4f, 0.8f, 0.4f,  // Bottom-right
-    -1.0f,  2.0f,  3.0f,   0.4f, 0.8f, 0.4f   // Top-left
-};
+static constexpr auto groundVertexData = Primitives::horizontal(-10.0f, -10.0f, 10.0f, 10.0f, 0.0f, { 0.3f, 0.3f, 0.3f });
+
+// Player cube (bright blue for visibility), collectibles (bright yellow), NPC fallback cubes
+static constexpr auto playerVertexData = Primitives::cube(0.8f, { 0.0f, 0.0f, 1.0f });
+static constexpr auto collectibleVertexData = Primitives::cube(0.6f, { 1.0f, 1.0f, 0.0f });
+static constexpr auto npcVertexData1 = Primitives::cube(0.7f, { 1.0f, 0.0f, 0.0f });     // Red
+static constexpr auto npcVertexData2 = Primitives::cube(0.7f, { 0.0f, 1.0f, 0.0f });     // Green
+static constexpr auto npcVertexData3 = Primitives::cube(0.7f, { 0.0f, 0.5f, 1.0f });     // Blue
+
+// House walls - brown, the front wall with a hole for the door
+static constexpr Color HOUSE_WALL_COLOR = { 0.6f, 0.4f, 0.2f };
+static constexpr auto houseWallsVertexData = Primitives::concat(
+    Primitives::wall(-3.0f,  3.0f, -1.0f,  3.0f, 0.0f, 2.0f, HOUSE_WALL_COLOR),     // Front, left of the door
+    Primitives::wall( 1.0f,  3.0f,  3.0f,  3.0f, 0.0f, 2.0f, HOUSE_WALL_COLOR),     // Front, right of the door
+    Primitives::wall(-1.0f,  3.0f,  1.0f,  3.0f, 2.0f, 3.0f, HOUSE_WALL_COLOR),     // Front, above the door
+    Primitives::wall(-3.0f, -3.0f,  3.0f, -3.0f, 0.0f, 3.0f, HOUSE_WALL_COLOR),     // Back
+    Primitives::wall(-3.0f, -3.0f, -3.0f,  3.0f, 0.0f, 3.0f, HOUSE_WALL_COLOR),     // Left
+    Primitives::wall( 3.0f, -3.0f,  3.0f,  3.0f, 0.0f, 3.0f, HOUSE_WALL_COLOR));    // Right
+
+// House door, slightly inset - dark brown when closed, brighter and turned 90 degrees
+// around its hinge when open, so it's obvious
+static constexpr auto houseDoorVertexData = Primitives::wall(-1.0f, 2.9f, 1.0f, 2.9f, 0.0f, 2.0f, { 0.4f, 0.2f, 0.1f });
+static constexpr auto houseDoorOpenVertexData = Primitives::wall(-1.0f, 2.9f, -1.0f, 0.9f, 0.0f, 2.0f, { 0.9f, 0.5f, 0.2f });
+
+// House roof - red
+static constexpr auto houseRoofVertexData = Primitives::pyramid(3.5f, 3.0f, 5.0f, { 0.8f, 0.2f, 0.2f });
+
+// Indoor walls - light beige, with ceiling and floor
+static constexpr Color INDOOR_WALL_COLOR = { 0.9f, 0.8f, 0.7f };
+static constexpr auto indoorWallsVertexData = Primitives::concat(
+    Primitives::wall(-3.0f,  3.0f, -1.0f,  3.0f, 0.0f, 3.0f, INDOOR_WALL_COLOR),    // Front, left of the door
+    Primitives::wall( 1.0f,  3.0f,  3.0f,  3.0f, 0.0f, 3.0f, INDOOR_WALL_COLOR),    // Front, right of the door
+    Primitives::wall(-1.0f,  3.0f,  1.0f,  3.0f, 2.0f, 3.0f, INDOOR_WALL_COLOR),    // Front, above the door
+    Primitives::wall(-3.0f, -3.0f,  3.0f, -3.0f, 0.0f, 3.0f, INDOOR_WALL_COLOR),    // Back
+    Primitives::wall(-3.0f, -3.0f, -3.0f,  3.0f, 0.0f, 3.0f, INDOOR_WALL_COLOR),    // Left
+    Primitives::wall( 3.0f, -3.0f,  3.0f,  3.0f, 0.0f, 3.0f, INDOOR_WALL_COLOR),    // Right
+    Primitives::horizontal(-3.0f, -3.0f, 3.0f, 3.0f, 3.0f, { 0.9f, 0.9f, 0.8f }),   // Ceiling
+    Primitives::horizontal(-3.0f, -3.0f, 3.0f, 3.0f, 0.0f, { 0.7f, 0.6f, 0.5f }));  // Floor
+
+// Exit door (for inside) - green
+static constexpr auto exitDoorVertexData = Primitives::wall(-1.0f, 3.0f, 1.0f, 3.0f, 0.0f, 2.0f, { 0.4f, 0.8f, 0.4f });
+
+// The crate cube the NPCs are drawn with (matching CrateCube.obj), 8 shared corners and
+// 36 indices - brown-ish. At file scope because the GPU culler packs it into its own mesh buffer too.
+static constexpr Primitives::IndexedCube crateCube = Primitives::indexedCube(1.0f, { 0.8f, 0.5f, 0.2f });
 
 //Utility variable and function for alignment:
-static const int UNIFORM_DATA_SIZE = 16 * sizeof(float); //our MVP matrix contains 16 floats
+static const int UNIFORM_DATA_SIZE = 16 * sizeof(float); //our view-projection matrix contains 16 floats
+static const float COLLECTIBLE_SCALE = 0.4f;    // Collectibles are drawn a bit smaller than their mesh
+static const float NPC_SCALE = 1.2f;            // NPCs slightly larger for better visibility
+static const int VERTEX_FLOATS = int(SourceVertexFormat::sourceFloats);   // X, Y, Z, R, G, B
+static const uint32_t OCCLUDED_INDEX = 0xffffffffu; // Marks visible list entries the occlusion buffer removes
+static const int LOD_LEVELS = 4;                // Levels of detail per mesh, the full mesh included
+static const float LOD_PIXEL_ERROR = 1.0f;      // A simplified level may be off by this many pixels on screen
+
+// Vertices of an X, Y, Z, R, G, B array
+template <size_t N>
+static constexpr size_t vertexCount(const std::array<float, N> &)
+{
+    return N / VERTEX_FLOATS;
+}
+
+// Packed mesh with up to levels levels of detail, from a mesh with a vertex per triangle
+// corner, which has no index list of its own
+template <size_t N>
+static PackedMesh packMesh(const std::array<float, N> &mesh, int levels)
+{
+    const float *vertices = mesh.data();
+    const size_t count = vertexCount(mesh);
+    std::vector<uint32_t> indices(count);
+    for (size_t i = 0; i < count; ++i)
+        indices[i] = uint32_t(i);
+    const LodChain lod = MeshSimplifier::buildLodChain(vertices, count, VERTEX_FLOATS, indices.data(), indices.size(), levels);
+    return MeshOptimizer::optimize(vertices, count, VERTEX_FLOATS, lod);
+}
 
 // Forward declarations
 static uint32_t getMemoryTypeIndex(const VkPhysicalDeviceMemoryProperties& memProperties, 
@@ -462,30 +108,106 @@ static inline VkDeviceSize aligned(VkDeviceSize v, VkDeviceSize byteAlign)
 
 /*** RenderWindow class ***/
 
-RenderWindow::RenderWindow(QVulkanWindow *w, bool msaa)
+RenderWindow::RenderWindow(QVulkanWindow *w, AntiAliasing antiAliasing, const SceneDescription &scene)
     : mWindow(w),
     mPlayerPosition(0.0f, 0.0f, 0.0f),      // Player starts at center of platform
+    mScene(scene),                           // Default or generated world
+    mWorldSize(scene.worldSize),
     mGameManager(nullptr),                   // Initialize to nullptr first
     mCollectedCount(0)                       // Initialize collected count
 {
-    if (msaa) {
+    // Every sample multiplies the bandwidth and memory of the color and depth buffers, so no
+    // more than the mode asks for. Without that many the next lower count that is there.
+    mAntiAliasing = antiAliasing;
+    const int samples = antiAliasingSamples(antiAliasing);
+    if (samples > 1) {
         const QList<int> counts = w->supportedSampleCounts();
         qDebug() << "Supported sample counts:" << counts;
-        for (int s = 16; s >= 4; s /= 2) {
+        int chosen = 1;
+        for (int s = samples; s >= 2; s /= 2) {
             if (counts.contains(s)) {
-                qDebug("Requesting sample count %d", s);
-                w->setSampleCount(s);
+                chosen = s;
                 break;
             }
         }
+        // The statistics name the mode that is actually used
+        mAntiAliasing = chosen == 8 ? AntiAliasing::Msaa8 : chosen == 4 ? AntiAliasing::Msaa4
+                      : chosen == 2 ? AntiAliasing::Msaa2 : AntiAliasing::Off;
+        mSceneSamples = VkSampleCountFlagBits(chosen);
     }
+    mUpscaler.setEdgeAA(antiAliasing == AntiAliasing::Fxaa);
     
     // Initialize GameManager after member initialization
-    mGameManager = new GameManager(this);
+    mGameManager = new GameManager(this, mScene);
     
     // Initialize player position
     mPlayerPosition = QVector3D(0.0f, 0.0f, 0.0f);
-    
+
+    // Houses - the first one is the house the player can enter
+    mHousePositions = mScene.houses;
+    if (!mHousePositions.isEmpty())
+        mHousePosition = mHousePositions.first();
+    
+    // Bounding volumes of the meshes, for frustum culling. NPCs use the crate cube,
+    // which also covers the smaller fallback NPC cubes.
+    mCollectibleMeshBounds = MeshBounds::fromVertices(collectibleVertexData.data(),
+        vertexCount(collectibleVertexData), VERTEX_FLOATS);
+    mNPCMeshBounds = MeshBounds::fromVertices(crateCube.vertices.data(), vertexCount(crateCube.vertices), VERTEX_FLOATS);
+    mHouseMeshBounds = MeshBounds::fromVertices(houseWallsVertexData.data(), vertexCount(houseWallsVertexData), VERTEX_FLOATS)
+        .united(MeshBounds::fromVertices(houseRoofVertexData.data(), vertexCount(houseRoofVertexData), VERTEX_FLOATS))
+        .united(MeshBounds::fromVertices(houseDoorOpenVertexData.data(), vertexCount(houseDoorOpenVertexData),
+                                         VERTEX_FLOATS));
+
+    // Packed meshes with their levels of detail - at startup, the meshes are small enough
+    mGroundMesh = packMesh(groundVertexData, 1);
+    mPlayerMesh = packMesh(playerVertexData, 1);
+    mCollectibleMesh = packMesh(collectibleVertexData, LOD_LEVELS);
+    mNPCMesh = MeshOptimizer::optimize(crateCube.vertices.data(), vertexCount(crateCube.vertices), VERTEX_FLOATS,
+                                       MeshSimplifier::buildLodChain(crateCube.vertices.data(),
+                                                                     vertexCount(crateCube.vertices), VERTEX_FLOATS,
+                                                                     crateCube.indices.data(), crateCube.indices.size(),
+                                                                     LOD_LEVELS));
+    mNPCFallbackMeshes[0] = packMesh(npcVertexData1, 1);
+    mNPCFallbackMeshes[1] = packMesh(npcVertexData2, 1);
+    mNPCFallbackMeshes[2] = packMesh(npcVertexData3, 1);
+    mHouseWallsMesh = packMesh(houseWallsVertexData, LOD_LEVELS);
+    mHouseDoorMesh = packMesh(houseDoorVertexData, 1);
+    mHouseDoorOpenMesh = packMesh(houseDoorOpenVertexData, 1);
+    mHouseRoofMesh = packMesh(houseRoofVertexData, 1);
+    mIndoorWallsMesh = packMesh(indoorWallsVertexData, 1);
+    mExitDoorMesh = packMesh(exitDoorVertexData, 1);
+    LOG_INFO(Render, "Levels of detail: collectible {}, NPC {}, house walls {}",
+             mCollectibleMesh.levels.size(), mNPCMesh.levels.size(), mHouseWallsMesh.levels.size());
+
+    const PackedMesh *packedMeshes[] = { &mGroundMesh, &mPlayerMesh, &mCollectibleMesh, &mNPCMesh,
+                                         &mNPCFallbackMeshes[0], &mNPCFallbackMeshes[1], &mNPCFallbackMeshes[2],
+                                         &mHouseWallsMesh, &mHouseDoorMesh, &mHouseDoorOpenMesh, &mHouseRoofMesh,
+                                         &mIndoorWallsMesh, &mExitDoorMesh };
+    size_t packedBytes = 0;
+    for (const PackedMesh *mesh : packedMeshes)
+        packedBytes += mesh->byteSize();
+    const size_t floatBytes = sizeof(groundVertexData) + sizeof(playerVertexData) + sizeof(collectibleVertexData)
+                            + sizeof(crateCube) + sizeof(npcVertexData1)
+                            + sizeof(npcVertexData2) + sizeof(npcVertexData3) + sizeof(houseWallsVertexData)
+                            + sizeof(houseDoorVertexData) + sizeof(houseDoorOpenVertexData) + sizeof(houseRoofVertexData)
+                            + sizeof(indoorWallsVertexData) + sizeof(exitDoorVertexData);
+    LOG_INFO(Render, "Packed meshes: {} bytes with every level of detail, {} bytes as float vertices",
+             packedBytes, floatBytes);
+
+    // The entrance house is a cell of its own and the hole in its front wall the portal
+    // to the outdoor world, open while the door is
+    mOutsideCell = mPortals.addOutsideCell();
+    mHouseCell = mPortals.addCell(mHousePosition + QVector3D(-3.0f, 0.0f, -3.0f),
+                                  mHousePosition + QVector3D(3.0f, 3.0f, 3.0f));
+    const QVector3D doorway[] = {
+        mHousePosition + QVector3D(-1.0f, 0.0f, 3.0f),
+        mHousePosition + QVector3D(1.0f, 0.0f, 3.0f),
+        mHousePosition + QVector3D(1.0f, 2.0f, 3.0f),
+        mHousePosition + QVector3D(-1.0f, 2.0f, 3.0f)
+    };
+    mDoorPortal = mPortals.addPortal(mOutsideCell, mHouseCell, doorway, 4);
+    mPortals.setPortalOpen(mDoorPortal, mDoorOpen);
+
     // Initialize collectibles
     initializeCollectibles();
     
@@ -503,9 +225,6 @@ RenderWindow::~RenderWindow()
 
 void RenderWindow::moveForward(float distance)
 {
-    // Store old position for debug output
-    QVector3D oldPos = mPlayerPosition;
-    
     // Move player along negative Z axis (forward in top-down view)
     // Multiply distance by 5 for faster movement
     mPlayerPosition.setZ(mPlayerPosition.z() - (distance * 5.0f));
@@ -513,19 +232,14 @@ void RenderWindow::moveForward(float distance)
     // Keep player on ground
     mPlayerPosition.setY(0.0f);
     
-    qDebug() << "Moving player cube from" << oldPos << "to" << mPlayerPosition;
+    LOG_DEBUG(Game, "Moved player cube to {}", mPlayerPosition);
     
     // Request a redraw to show the player in its new position
-    if (mWindow) {
-        mWindow->requestUpdate();
-    }
+    requestFrame(FrameScheduler::Input);
 }
 
 void RenderWindow::moveRight(float distance)
 {
-    // Store old position for debug output
-    QVector3D oldPos = mPlayerPosition;
-    
     // Move player along positive X axis (right in top-down view)
     // Multiply distance by 5 for faster movement
     mPlayerPosition.setX(mPlayerPosition.x() + (distance * 5.0f));
@@ -533,41 +247,33 @@ void RenderWindow::moveRight(float distance)
     // Keep player on ground
     mPlayerPosition.setY(0.0f);
     
-    qDebug() << "Moving player cube from" << oldPos << "to" << mPlayerPosition;
+    LOG_DEBUG(Game, "Moved player cube to {}", mPlayerPosition);
     
     // Request a redraw to show the player in its new position
-    if (mWindow) {
-        mWindow->requestUpdate();
-    }
+    requestFrame(FrameScheduler::Input);
 }
 
 void RenderWindow::moveCube(const QVector3D& movement)
 {
-    // Store old position for debug output
-    QVector3D oldPos = mPlayerPosition;
-
     // Apply direct movement - make sure input controls are properly applied
     mPlayerPosition.setX(mPlayerPosition.x() + movement.x());
     mPlayerPosition.setZ(mPlayerPosition.z() + movement.z());
     
     // Keep within ground boundaries
-    const float BOUNDARY = 9.5f; // Slightly smaller than the ground plane size
+    const float BOUNDARY = mWorldSize - 0.5f; // Slightly smaller than the ground plane size
     mPlayerPosition.setX(qBound(-BOUNDARY, mPlayerPosition.x(), BOUNDARY));
     mPlayerPosition.setZ(qBound(-BOUNDARY, mPlayerPosition.z(), BOUNDARY));
     
     // Force Y to be 0 to keep player on ground
     mPlayerPosition.setY(0.0f);
 
-    qDebug() << "PLAYER MOVED: From" << oldPos << "to" << mPlayerPosition 
-             << "- Applied movement:" << movement;
+    LOG_DEBUG(Game, "Player moved by {} to {}", movement, mPlayerPosition);
              
     // Check for collectible collisions after movement
     checkCollectibleCollisions();
 
     // Request a redraw to update the scene
-    if (mWindow) {
-        mWindow->requestUpdate();
-    }
+    requestFrame(FrameScheduler::Input);
 }
 
 void RenderWindow::rotate(float yawDelta, float pitchDelta)
@@ -577,24 +283,42 @@ void RenderWindow::rotate(float yawDelta, float pitchDelta)
     Q_UNUSED(pitchDelta);
 }
 
+void RenderWindow::preInitResources()
+{
+    // The options are all set by now. With the offscreen scene target only the target is
+    // multisampled: the swap chain pass just draws the upscale triangle and the overlay.
+    if (mSceneSamples != VK_SAMPLE_COUNT_1_BIT && !needsSceneTarget()) {
+        qDebug("Requesting sample count %d", int(mSceneSamples));
+        mWindow->setSampleCount(int(mSceneSamples));
+    }
+}
+
 void RenderWindow::initResources()
 {
+    TRACE_SCOPE_STAGED("initResources");
     qDebug("\n ***************************** initResources ******************************************* \n");
 
     VkDevice logicalDevice = mWindow->device();
     mDeviceFunctions = mWindow->vulkanInstance()->deviceFunctions(logicalDevice);
+    // First, the buffers it fills are created for its queue. Uploads go with the next frame,
+    // which the scheduler is asked for on the GUI thread whatever thread uploads.
+    mUploader.setFrameRequest([this] {
+        QMetaObject::invokeMethod(mWindow, [this] { requestFrame(FrameScheduler::Scene); }, Qt::QueuedConnection);
+    });
+    mUploader.init(mWindow, mDeviceFunctions, mTransferQueue ? *mTransferQueue : StreamingUploader::QueueInfo());
+    mDeletionQueue.init(mWindow, mDeviceFunctions);
 
     const int concurrentFrameCount = mWindow->concurrentFrameCount(); // 2 on Oles Machine
     const VkPhysicalDeviceLimits *pdevLimits = &mWindow->physicalDeviceProperties()->limits;
     const VkDeviceSize uniAlign = pdevLimits->minUniformBufferOffsetAlignment;
     qDebug("uniform buffer offset alignment is %u", (uint)uniAlign); //64 on Oles machine
 
-    // Create uniform buffer for MVP matrices - allocate 8x the size to include indoor scene
+    TRACE_BEGIN("uniform buffer");
+    // Uniform buffer with the camera's view-projection matrix, one slot per frame
     VkBufferCreateInfo bufInfo;
     memset(&bufInfo, 0, sizeof(bufInfo));
     bufInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    // Increased size to accommodate ground, player, collectibles, 3 separate NPCs, house, and indoor scene
-    bufInfo.size = concurrentFrameCount * 8 * aligned(UNIFORM_DATA_SIZE, uniAlign);
+    bufInfo.size = concurrentFrameCount * aligned(UNIFORM_DATA_SIZE, uniAlign);
     bufInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
 
     // Use existing err variable
@@ -628,100 +352,25 @@ void RenderWindow::initResources()
 
     QMatrix4x4 ident;
     memset(mUniformBufferInfo, 0, sizeof(mUniformBufferInfo));
-    memset(mPlayerUniformBufferInfo, 0, sizeof(mPlayerUniformBufferInfo));
-    memset(mCollectibleUniformBufferInfo, 0, sizeof(mCollectibleUniformBufferInfo));
-    memset(mNPCUniformBufferInfo1, 0, sizeof(mNPCUniformBufferInfo1));
-    memset(mNPCUniformBufferInfo2, 0, sizeof(mNPCUniformBufferInfo2));
-    memset(mNPCUniformBufferInfo3, 0, sizeof(mNPCUniformBufferInfo3));
-    memset(mHouseUniformBufferInfo, 0, sizeof(mHouseUniformBufferInfo));
-    memset(mIndoorUniformBufferInfo, 0, sizeof(mIndoorUniformBufferInfo));
-    
     const VkDeviceSize alignedUniformSize = aligned(UNIFORM_DATA_SIZE, uniAlign);
-    
     for (int i = 0; i < concurrentFrameCount; ++i) {
-        // Initialize the ground matrix (first matrix in the buffer)
-        const VkDeviceSize groundOffset = i * 8 * alignedUniformSize; // *8 for ground, player, collectible, NPC1, NPC2, NPC3, house, indoor
-        memcpy(p + groundOffset, ident.constData(), 16 * sizeof(float));
+        const VkDeviceSize offset = i * alignedUniformSize;
+        memcpy(p + offset, ident.constData(), 16 * sizeof(float));
         mUniformBufferInfo[i].buffer = mBuffer;
-        mUniformBufferInfo[i].offset = groundOffset;
+        mUniformBufferInfo[i].offset = offset;
         mUniformBufferInfo[i].range = UNIFORM_DATA_SIZE;
-        
-        // Initialize the player matrix space (second matrix in the buffer)
-        const VkDeviceSize playerOffset = groundOffset + alignedUniformSize;
-        memcpy(p + playerOffset, ident.constData(), 16 * sizeof(float));
-        mPlayerUniformBufferInfo[i].buffer = mBuffer;
-        mPlayerUniformBufferInfo[i].offset = playerOffset;
-        mPlayerUniformBufferInfo[i].range = UNIFORM_DATA_SIZE;
-        
-        // Initialize the collectible matrix space (third matrix in the buffer)
-        const VkDeviceSize collectibleOffset = playerOffset + alignedUniformSize;
-        memcpy(p + collectibleOffset, ident.constData(), 16 * sizeof(float));
-        mCollectibleUniformBufferInfo[i].buffer = mBuffer;
-        mCollectibleUniformBufferInfo[i].offset = collectibleOffset;
-        mCollectibleUniformBufferInfo[i].range = UNIFORM_DATA_SIZE;
-        
-        // Initialize the NPC1 matrix space (fourth matrix in the buffer)
-        const VkDeviceSize npc1Offset = collectibleOffset + alignedUniformSize;
-        memcpy(p + npc1Offset, ident.constData(), 16 * sizeof(float));
-        mNPCUniformBufferInfo1[i].buffer = mBuffer;
-        mNPCUniformBufferInfo1[i].offset = npc1Offset;
-        mNPCUniformBufferInfo1[i].range = UNIFORM_DATA_SIZE;
-        
-        // Initialize the NPC2 matrix space (fifth matrix in the buffer)
-        const VkDeviceSize npc2Offset = npc1Offset + alignedUniformSize;
-        memcpy(p + npc2Offset, ident.constData(), 16 * sizeof(float));
-        mNPCUniformBufferInfo2[i].buffer = mBuffer;
-        mNPCUniformBufferInfo2[i].offset = npc2Offset;
-        mNPCUniformBufferInfo2[i].range = UNIFORM_DATA_SIZE;
-        
-        // Initialize the NPC3 matrix space (sixth matrix in the buffer)
-        const VkDeviceSize npc3Offset = npc2Offset + alignedUniformSize;
-        memcpy(p + npc3Offset, ident.constData(), 16 * sizeof(float));
-        mNPCUniformBufferInfo3[i].buffer = mBuffer;
-        mNPCUniformBufferInfo3[i].offset = npc3Offset;
-        mNPCUniformBufferInfo3[i].range = UNIFORM_DATA_SIZE;
-        
-        // Initialize the house matrix space (seventh matrix in the buffer)
-        const VkDeviceSize houseOffset = npc3Offset + alignedUniformSize;
-        memcpy(p + houseOffset, ident.constData(), 16 * sizeof(float));
-        mHouseUniformBufferInfo[i].buffer = mBuffer;
-        mHouseUniformBufferInfo[i].offset = houseOffset;
-        mHouseUniformBufferInfo[i].range = UNIFORM_DATA_SIZE;
-        
-        // Initialize the indoor scene matrix space (eighth matrix in the buffer)
-        const VkDeviceSize indoorOffset = houseOffset + alignedUniformSize;
-        memcpy(p + indoorOffset, ident.constData(), 16 * sizeof(float));
-        mIndoorUniformBufferInfo[i].buffer = mBuffer;
-        mIndoorUniformBufferInfo[i].offset = indoorOffset;
-        mIndoorUniformBufferInfo[i].range = UNIFORM_DATA_SIZE;
     }
     
     mDeviceFunctions->vkUnmapMemory(logicalDevice, mBufferMemory);
 
     /********************************* Vertex layout: *********************************/
-    //The size of each vertex to be passed to the shader
-    VkVertexInputBindingDescription vertexBindingDesc = {
-        0, // binding - has to match that in VkVertexInputAttributeDescription and startNextFrame()s m_devFuncs->vkCmdBindVertexBuffers
-        6 * sizeof(float), // stride account for X, Y, Z, R, G, B
-        VK_VERTEX_INPUT_RATE_VERTEX
-    };
+    //The size of each vertex to be passed to the shader - half float X, Y, Z, W and unorm R, G, B, A.
+    //Binding 0 has to match startNextFrame()s vkCmdBindVertexBuffers
+    static constexpr VkVertexInputBindingDescription vertexBindingDesc = PackedVertexFormat::binding(0);
 
     /********************************* Shader bindings: *********************************/
-    //Descritpion of the attributes used in the shader
-    VkVertexInputAttributeDescription vertexAttrDesc[] = {
-        { // position
-            0, // location has to correspond to the layout(location = x) in the shader
-            0, // binding
-            VK_FORMAT_R32G32B32_SFLOAT,
-            0
-        },
-        { // color
-            1, // location has to correspond to the layout(location = x) in the shader
-            0, // binding
-            VK_FORMAT_R32G32B32_SFLOAT,
-            3 * sizeof(float) // offset to account for X, Y, Z
-        }
-    };
+    //Position at location 0 and color at location 1, as in the layout(location = x) of the shaders
+    static constexpr auto vertexAttrDesc = PackedVertexFormat::attributes(0);
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo;
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -729,131 +378,26 @@ void RenderWindow::initResources()
     vertexInputInfo.flags = 0;
     vertexInputInfo.vertexBindingDescriptionCount = 1;
     vertexInputInfo.pVertexBindingDescriptions = &vertexBindingDesc;
-    vertexInputInfo.vertexAttributeDescriptionCount = 2;
-    vertexInputInfo.pVertexAttributeDescriptions = vertexAttrDesc;
+    vertexInputInfo.vertexAttributeDescriptionCount = uint32_t(vertexAttrDesc.size());
+    vertexInputInfo.pVertexAttributeDescriptions = vertexAttrDesc.data();
 
-    // Set up descriptor pool for all objects (ground, player, collectibles, and 3 separate NPCs)
-    VkDescriptorPoolSize descPoolSizes = { 
-        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 
-        uint32_t(concurrentFrameCount * 10) // Ten objects: ground, player, collectible, NPC1, NPC2, NPC3, house walls, house door, house roof, spare
-    };
-    
-    VkDescriptorPoolCreateInfo descPoolInfo;
-    memset(&descPoolInfo, 0, sizeof(descPoolInfo));
-    descPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    descPoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT; // Add this flag to allow freeing individual sets
-    descPoolInfo.maxSets = concurrentFrameCount * 10; // Ten objects: ground, player, collectible, NPC1, NPC2, NPC3, house walls, house door, house roof, spare
-    descPoolInfo.poolSizeCount = 1;
-    descPoolInfo.pPoolSizes = &descPoolSizes;
-    
-    // Destroy old pool if it exists
-    if (mDescriptorPool != VK_NULL_HANDLE) {
-        mDeviceFunctions->vkDestroyDescriptorPool(mWindow->device(), mDescriptorPool, nullptr);
-        mDescriptorPool = VK_NULL_HANDLE;
-    }
-    
-    // Use existing err variable without redeclaring it
-    err = mDeviceFunctions->vkCreateDescriptorPool(logicalDevice, &descPoolInfo, nullptr, &mDescriptorPool);
-    if (err != VK_SUCCESS)
-        qFatal("Failed to create descriptor pool: %d", err);
-
-    /********************************* Uniform (projection matrix) bindings: *********************************/
-    VkDescriptorSetLayoutBinding layoutBinding = {
-        0, // binding
-        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        1,
-        VK_SHADER_STAGE_VERTEX_BIT,
-        nullptr
-    };
-    VkDescriptorSetLayoutCreateInfo descLayoutInfo = {
-        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        nullptr,
-        0,
-        1,
-        &layoutBinding
-    };
-    err = mDeviceFunctions->vkCreateDescriptorSetLayout(logicalDevice, &descLayoutInfo, nullptr, &mDescriptorSetLayout);
-    if (err != VK_SUCCESS)
-        qFatal("Failed to create descriptor set layout: %d", err);
+    TRACE_END();
 
-    // Create separate descriptor sets for all objects
-    for (int i = 0; i < concurrentFrameCount; ++i) {
-        // Ground descriptor set
-        VkDescriptorSetAllocateInfo descSetAllocInfo = {
-            VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-            nullptr,
-            mDescriptorPool,
-            1,
-            &mDescriptorSetLayout
-        };
-        err = mDeviceFunctions->vkAllocateDescriptorSets(logicalDevice, &descSetAllocInfo, &mDescriptorSet[i]);
-        if (err != VK_SUCCESS)
-            qFatal("Failed to allocate ground descriptor set: %d", err);
-
-        VkWriteDescriptorSet descWrite;
-        memset(&descWrite, 0, sizeof(descWrite));
-        descWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descWrite.dstSet = mDescriptorSet[i];
-        descWrite.descriptorCount = 1;
-        descWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descWrite.pBufferInfo = &mUniformBufferInfo[i];
-        mDeviceFunctions->vkUpdateDescriptorSets(logicalDevice, 1, &descWrite, 0, nullptr);
-        
-        // Player descriptor set 
-        err = mDeviceFunctions->vkAllocateDescriptorSets(logicalDevice, &descSetAllocInfo, &mPlayerDescriptorSet[i]);
-        if (err != VK_SUCCESS)
-            qFatal("Failed to allocate player descriptor set: %d", err);
-            
-        // Update player descriptor set
-        descWrite.dstSet = mPlayerDescriptorSet[i];
-        descWrite.pBufferInfo = &mPlayerUniformBufferInfo[i];
-        mDeviceFunctions->vkUpdateDescriptorSets(logicalDevice, 1, &descWrite, 0, nullptr);
-        
-        // Collectible descriptor set 
-        err = mDeviceFunctions->vkAllocateDescriptorSets(logicalDevice, &descSetAllocInfo, &mCollectibleDescriptorSet[i]);
-        if (err != VK_SUCCESS)
-            qFatal("Failed to allocate collectible descriptor set: %d", err);
-            
-        // Update collectible descriptor set
-        descWrite.dstSet = mCollectibleDescriptorSet[i];
-        descWrite.pBufferInfo = &mCollectibleUniformBufferInfo[i];
-        mDeviceFunctions->vkUpdateDescriptorSets(logicalDevice, 1, &descWrite, 0, nullptr);
-        
-        // NPC 1 (Red) descriptor set 
-        err = mDeviceFunctions->vkAllocateDescriptorSets(logicalDevice, &descSetAllocInfo, &mNPCDescriptorSet1[i]);
-        if (err != VK_SUCCESS)
-            qFatal("Failed to allocate NPC1 descriptor set: %d", err);
-            
-        // Update NPC1 descriptor set
-        descWrite.dstSet = mNPCDescriptorSet1[i];
-        descWrite.pBufferInfo = &mNPCUniformBufferInfo1[i];
-        mDeviceFunctions->vkUpdateDescriptorSets(logicalDevice, 1, &descWrite, 0, nullptr);
-        
-        // NPC 2 (Green) descriptor set 
-        err = mDeviceFunctions->vkAllocateDescriptorSets(logicalDevice, &descSetAllocInfo, &mNPCDescriptorSet2[i]);
-        if (err != VK_SUCCESS)
-            qFatal("Failed to allocate NPC2 descriptor set: %d", err);
-            
-        // Update NPC2 descriptor set
-        descWrite.dstSet = mNPCDescriptorSet2[i];
-        descWrite.pBufferInfo = &mNPCUniformBufferInfo2[i];
-        mDeviceFunctions->vkUpdateDescriptorSets(logicalDevice, 1, &descWrite, 0, nullptr);
-        
-        // NPC 3 (Blue) descriptor set 
-        err = mDeviceFunctions->vkAllocateDescriptorSets(logicalDevice, &descSetAllocInfo, &mNPCDescriptorSet3[i]);
-        if (err != VK_SUCCESS)
-            qFatal("Failed to allocate NPC3 descriptor set: %d", err);
-            
-        // Update NPC3 descriptor set
-        descWrite.dstSet = mNPCDescriptorSet3[i];
-        descWrite.pBufferInfo = &mNPCUniformBufferInfo3[i];
-        mDeviceFunctions->vkUpdateDescriptorSets(logicalDevice, 1, &descWrite, 0, nullptr);
-    }
+    TRACE_BEGIN("descriptor sets and pipeline layout");
+    // One set per frame slot for all objects: the camera, a transform row per object and the materials.
+    // The materials only tint the vertex colors, all of them white for now.
+    std::vector<BindlessSet::Material> materials(MATERIAL_COUNT, BindlessSet::Material{ { 1.0f, 1.0f, 1.0f, 1.0f } });
+    updateTransformLayout();
+    mBindless.init(mWindow, mDeviceFunctions, mUniformBufferInfo, materials, mTransforms.count);
+    const VkDescriptorSetLayout setLayout = mBindless.layout();
 
-    // Pipeline cache
+    // Pipeline cache, filled with what the last run compiled
+    const QByteArray pipelineCacheData = loadPipelineCache();
     VkPipelineCacheCreateInfo pipelineCacheInfo;
     memset(&pipelineCacheInfo, 0, sizeof(pipelineCacheInfo));
     pipelineCacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheInfo.initialDataSize = size_t(pipelineCacheData.size());
+    pipelineCacheInfo.pInitialData = pipelineCacheData.isEmpty() ? nullptr : pipelineCacheData.constData();
     err = mDeviceFunctions->vkCreatePipelineCache(logicalDevice, &pipelineCacheInfo, nullptr, &mPipelineCache);
     if (err != VK_SUCCESS)
         qFatal("Failed to create pipeline cache: %d", err);
@@ -863,12 +407,19 @@ void RenderWindow::initResources()
     memset(&pipelineLayoutInfo, 0, sizeof(pipelineLayoutInfo));
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &mDescriptorSetLayout;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    // Each draw pushes its transform and material rows
+    VkPushConstantRange drawIndicesRange = { VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(BindlessSet::DrawIndices) };
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &drawIndicesRange;
     err = mDeviceFunctions->vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &mPipelineLayout);
     if (err != VK_SUCCESS)
         qFatal("Failed to create pipeline layout: %d", err);
 
+    TRACE_END();
+
     /********************************* Create shaders *********************************/
+    TRACE_BEGIN("shaders and pipeline");
     //Creates our actuall shader modules
     VkShaderModule vertShaderModule = createShader(QStringLiteral(":/color_vert.spv"));
     VkShaderModule fragShaderModule = createShader(QStringLiteral(":/color_frag.spv"));
@@ -931,7 +482,7 @@ void RenderWindow::initResources()
     memset(&ms, 0, sizeof(ms));
     ms.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
     // Enable multisampling.
-    ms.rasterizationSamples = mWindow->sampleCountFlagBits();
+    ms.rasterizationSamples = mSceneSamples;
     pipelineInfo.pMultisampleState = &ms;
 
     // Fix depth settings to avoid invisible objects
@@ -965,20 +516,43 @@ void RenderWindow::initResources()
     pipelineInfo.layout = mPipelineLayout;
     pipelineInfo.renderPass = mWindow->defaultRenderPass();
 
-    err = mDeviceFunctions->vkCreateGraphicsPipelines(logicalDevice, mPipelineCache, 1, &pipelineInfo, nullptr, &mPipeline);
-    if (err != VK_SUCCESS)
-        qFatal("Failed to create graphics pipeline: %d", err);
+    // Dynamic resolution and post-process AA: the same state with the upscale's shaders. The scene
+    // is drawn into the target's render pass then, which has the samples the window doesn't.
+    if (needsSceneTarget()) {
+        mUpscaler.init(mWindow, mDeviceFunctions, mSceneSamples, pipelineInfo, mPipelineCache);
+        mResolution.reset();
+        mResolution.setLatency(mWindow->concurrentFrameCount());
+        pipelineInfo.renderPass = mUpscaler.renderPass();
+    }
+
+    // The variants of this state with color.vert and color.frag. Fog is built in the background
+    // right away, so switching it on finds it ready.
+    mPipelines.init(mWindow, mDeviceFunctions, pipelineInfo, mPipelineCache,
+                    QStringLiteral(":/color_vert.spv"), QStringLiteral(":/color_frag.spv"));
+    mPipelines.prepare(PipelineVariants::Fog);
+    mScenePipeline = mPipelines.pipeline(0);
+
+    // GPU driven collectibles and NPCs: same pipeline state, their own vertex shader
+    if (mGpuCulling)
+        initGpuCulling(pipelineInfo);
+
+    // The same state with the temporal resolve's shaders, in a render pass of its own
+    if (mTemporalAAEnabled)
+        mTemporalAA.init(mWindow, mDeviceFunctions, pipelineInfo, mPipelineCache);
 
     if (vertShaderModule)
         mDeviceFunctions->vkDestroyShaderModule(logicalDevice, vertShaderModule, nullptr);
     if (fragShaderModule)
         mDeviceFunctions->vkDestroyShaderModule(logicalDevice, fragShaderModule, nullptr);
 
+    TRACE_END();
+
+    TRACE_BEGIN("vertex buffers");
     // Create and set up ground buffer
     VkBufferCreateInfo groundBufferInfo = {};
     groundBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    groundBufferInfo.size = sizeof(groundVertexData);
-    groundBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    groundBufferInfo.size = mGroundMesh.byteSize();
+    groundBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
 
     err = mDeviceFunctions->vkCreateBuffer(mWindow->device(), &groundBufferInfo, nullptr, &mGroundBuffer);
     if (err != VK_SUCCESS)
@@ -1007,14 +581,14 @@ void RenderWindow::initResources()
     if (err != VK_SUCCESS)
         qFatal("Failed to map ground memory: %d", err);
 
-    memcpy(groundData, groundVertexData, sizeof(groundVertexData));
+    mGroundMesh.write(groundData);
     mDeviceFunctions->vkUnmapMemory(mWindow->device(), mGroundBufferMemory);
 
     // Create and set up player buffer
     VkBufferCreateInfo playerBufferInfo = {};
     playerBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    playerBufferInfo.size = sizeof(playerVertexData);
-    playerBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    playerBufferInfo.size = mPlayerMesh.byteSize();
+    playerBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
 
     err = mDeviceFunctions->vkCreateBuffer(mWindow->device(), &playerBufferInfo, nullptr, &mPlayerBuffer);
     if (err != VK_SUCCESS)
@@ -1043,14 +617,14 @@ void RenderWindow::initResources()
     if (err != VK_SUCCESS)
         qFatal("Failed to map player memory: %d", err);
 
-    memcpy(playerData, playerVertexData, sizeof(playerVertexData));
+    mPlayerMesh.write(playerData);
     mDeviceFunctions->vkUnmapMemory(mWindow->device(), mPlayerBufferMemory);
 
     // Create and set up collectible buffer
     VkBufferCreateInfo collectibleBufferInfo = {};
     collectibleBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    collectibleBufferInfo.size = sizeof(collectibleVertexData);
-    collectibleBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    collectibleBufferInfo.size = mCollectibleMesh.byteSize();
+    collectibleBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
 
     err = mDeviceFunctions->vkCreateBuffer(mWindow->device(), &collectibleBufferInfo, nullptr, &mCollectibleBuffer);
     if (err != VK_SUCCESS)
@@ -1079,15 +653,15 @@ void RenderWindow::initResources()
     if (err != VK_SUCCESS)
         qFatal("Failed to map collectible memory: %d", err);
 
-    memcpy(collectibleData, collectibleVertexData, sizeof(collectibleVertexData));
+    mCollectibleMesh.write(collectibleData);
     mDeviceFunctions->vkUnmapMemory(mWindow->device(), mCollectibleBufferMemory);
 
     // Create NPC buffers - one for each color
     // Buffer 1 - Red NPC
     VkBufferCreateInfo npcBufInfo1 = {};
     npcBufInfo1.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    npcBufInfo1.size = sizeof(npcVertexData1);
-    npcBufInfo1.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    npcBufInfo1.size = mNPCFallbackMeshes[0].byteSize();
+    npcBufInfo1.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
     err = mDeviceFunctions->vkCreateBuffer(logicalDevice, &npcBufInfo1, nullptr, &mNPCBuffer1);
     VkMemoryRequirements npcMemReq1;
     mDeviceFunctions->vkGetBufferMemoryRequirements(logicalDevice, mNPCBuffer1, &npcMemReq1);
@@ -1107,14 +681,14 @@ void RenderWindow::initResources()
     
     quint8 *npcVertPtr1;
     err = mDeviceFunctions->vkMapMemory(logicalDevice, mNPCBufferMemory1, 0, npcBufInfo1.size, 0, reinterpret_cast<void **>(&npcVertPtr1));
-    memcpy(npcVertPtr1, npcVertexData1, sizeof(npcVertexData1));
+    mNPCFallbackMeshes[0].write(npcVertPtr1);
     mDeviceFunctions->vkUnmapMemory(logicalDevice, mNPCBufferMemory1);
     
     // Buffer 2 - Green NPC
     VkBufferCreateInfo npcBufInfo2 = {};
     npcBufInfo2.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    npcBufInfo2.size = sizeof(npcVertexData2);
-    npcBufInfo2.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    npcBufInfo2.size = mNPCFallbackMeshes[1].byteSize();
+    npcBufInfo2.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
     err = mDeviceFunctions->vkCreateBuffer(logicalDevice, &npcBufInfo2, nullptr, &mNPCBuffer2);
     VkMemoryRequirements npcMemReq2;
     mDeviceFunctions->vkGetBufferMemoryRequirements(logicalDevice, mNPCBuffer2, &npcMemReq2);
@@ -1134,14 +708,14 @@ void RenderWindow::initResources()
     
     quint8 *npcVertPtr2;
     err = mDeviceFunctions->vkMapMemory(logicalDevice, mNPCBufferMemory2, 0, npcBufInfo2.size, 0, reinterpret_cast<void **>(&npcVertPtr2));
-    memcpy(npcVertPtr2, npcVertexData2, sizeof(npcVertexData2));
+    mNPCFallbackMeshes[1].write(npcVertPtr2);
     mDeviceFunctions->vkUnmapMemory(logicalDevice, mNPCBufferMemory2);
     
     // Buffer 3 - Blue NPC
     VkBufferCreateInfo npcBufInfo3 = {};
     npcBufInfo3.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    npcBufInfo3.size = sizeof(npcVertexData3);
-    npcBufInfo3.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    npcBufInfo3.size = mNPCFallbackMeshes[2].byteSize();
+    npcBufInfo3.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
     err = mDeviceFunctions->vkCreateBuffer(logicalDevice, &npcBufInfo3, nullptr, &mNPCBuffer3);
     VkMemoryRequirements npcMemReq3;
     mDeviceFunctions->vkGetBufferMemoryRequirements(logicalDevice, mNPCBuffer3, &npcMemReq3);
@@ -1161,50 +735,21 @@ void RenderWindow::initResources()
     
     quint8 *npcVertPtr3;
     err = mDeviceFunctions->vkMapMemory(logicalDevice, mNPCBufferMemory3, 0, npcBufInfo3.size, 0, reinterpret_cast<void **>(&npcVertPtr3));
-    memcpy(npcVertPtr3, npcVertexData3, sizeof(npcVertexData3));
+    mNPCFallbackMeshes[2].write(npcVertPtr3);
     mDeviceFunctions->vkUnmapMemory(logicalDevice, mNPCBufferMemory3);
     
+    TRACE_END();
+
+    // Asset loading
+    TRACE_BEGIN("load CrateCube model");
     // Load CrateCube model for NPCs
     qDebug() << "Loading CrateCube model for NPCs...";
     
-    // Simple hardcoded vertices and indices for the crate cube (matching CrateCube.obj format)
-    // In a real application, you should parse the OBJ file properly
-    static const float crateCubeVertices[] = {
-        // Position (XYZ)     // Color (RGB) - brown-ish crate color
-        // 8 vertices of a cube
-        -1.0f, -1.0f,  1.0f,  0.8f, 0.5f, 0.2f,  // 0
-        -1.0f, -1.0f, -1.0f,  0.8f, 0.5f, 0.2f,  // 1
-         1.0f, -1.0f, -1.0f,  0.8f, 0.5f, 0.2f,  // 2
-         1.0f, -1.0f,  1.0f,  0.8f, 0.5f, 0.2f,  // 3
-        -1.0f,  1.0f,  1.0f,  0.8f, 0.5f, 0.2f,  // 4
-        -1.0f,  1.0f, -1.0f,  0.8f, 0.5f, 0.2f,  // 5
-         1.0f,  1.0f, -1.0f,  0.8f, 0.5f, 0.2f,  // 6
-         1.0f,  1.0f,  1.0f,  0.8f, 0.5f, 0.2f   // 7
-    };
-    
-    // Indices for the cube faces (6 faces, 2 triangles per face, 3 indices per triangle)
-    static const uint32_t crateCubeIndices[] = {
-        // Left side
-        4, 5, 1, 4, 1, 0,
-        // Back side
-        5, 6, 2, 5, 2, 1,
-        // Right side
-        6, 7, 3, 6, 3, 2,
-        // Front side
-        7, 4, 0, 7, 0, 3,
-        // Bottom
-        0, 1, 2, 0, 2, 3,
-        // Top
-        7, 6, 5, 7, 5, 4
-    };
-    
-    mCrateCubeIndexCount = sizeof(crateCubeIndices) / sizeof(crateCubeIndices[0]);
-    
-    // Create CrateCube vertex buffer
+    // Create CrateCube buffer, the indices of every level of detail behind the vertices
     VkBufferCreateInfo crateBufInfo = {};
     crateBufInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    crateBufInfo.size = sizeof(crateCubeVertices);
-    crateBufInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    crateBufInfo.size = mNPCMesh.byteSize();
+    crateBufInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
     
     try {
         err = mDeviceFunctions->vkCreateBuffer(logicalDevice, &crateBufInfo, nullptr, &mCrateCubeBuffer);
@@ -1256,84 +801,10 @@ void RenderWindow::initResources()
             return; // Skip further initialization if mapping fails
         }
         
-        memcpy(crateVertPtr, crateCubeVertices, sizeof(crateCubeVertices));
+        mNPCMesh.write(crateVertPtr);
         mDeviceFunctions->vkUnmapMemory(logicalDevice, mCrateCubeBufferMemory);
         
-        // Create CrateCube index buffer
-        VkBufferCreateInfo crateIndexBufInfo = {};
-        crateIndexBufInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        crateIndexBufInfo.size = sizeof(crateCubeIndices);
-        crateIndexBufInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-        
-        err = mDeviceFunctions->vkCreateBuffer(logicalDevice, &crateIndexBufInfo, nullptr, &mCrateCubeIndexBuffer);
-        if (err != VK_SUCCESS) {
-            qDebug() << "WARNING: Failed to create CrateCube index buffer: Error" << err;
-            mDeviceFunctions->vkDestroyBuffer(logicalDevice, mCrateCubeBuffer, nullptr);
-            mDeviceFunctions->vkFreeMemory(logicalDevice, mCrateCubeBufferMemory, nullptr);
-            mCrateCubeBuffer = VK_NULL_HANDLE;
-            mCrateCubeBufferMemory = VK_NULL_HANDLE;
-            mCrateCubeIndexBuffer = VK_NULL_HANDLE;
-            return; // Skip further initialization if index buffer creation fails
-        }
-        
-        VkMemoryRequirements crateIndexMemReq;
-        mDeviceFunctions->vkGetBufferMemoryRequirements(logicalDevice, mCrateCubeIndexBuffer, &crateIndexMemReq);
-        
-        VkMemoryAllocateInfo crateIndexAllocInfo = {
-            VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            nullptr,
-            crateIndexMemReq.size,
-            mWindow->hostVisibleMemoryIndex()
-        };
-        
-        err = mDeviceFunctions->vkAllocateMemory(logicalDevice, &crateIndexAllocInfo, nullptr, &mCrateCubeIndexBufferMemory);
-        if (err != VK_SUCCESS) {
-            qDebug() << "WARNING: Failed to allocate CrateCube index buffer memory: Error" << err;
-            mDeviceFunctions->vkDestroyBuffer(logicalDevice, mCrateCubeBuffer, nullptr);
-            mDeviceFunctions->vkFreeMemory(logicalDevice, mCrateCubeBufferMemory, nullptr);
-            mDeviceFunctions->vkDestroyBuffer(logicalDevice, mCrateCubeIndexBuffer, nullptr);
-            mCrateCubeBuffer = VK_NULL_HANDLE;
-            mCrateCubeBufferMemory = VK_NULL_HANDLE;
-            mCrateCubeIndexBuffer = VK_NULL_HANDLE;
-            mCrateCubeIndexBufferMemory = VK_NULL_HANDLE;
-            return; // Skip further initialization if index memory allocation fails
-        }
-        
-        err = mDeviceFunctions->vkBindBufferMemory(logicalDevice, mCrateCubeIndexBuffer, mCrateCubeIndexBufferMemory, 0);
-        if (err != VK_SUCCESS) {
-            qDebug() << "WARNING: Failed to bind CrateCube index buffer memory: Error" << err;
-            mDeviceFunctions->vkDestroyBuffer(logicalDevice, mCrateCubeBuffer, nullptr);
-            mDeviceFunctions->vkFreeMemory(logicalDevice, mCrateCubeBufferMemory, nullptr);
-            mDeviceFunctions->vkDestroyBuffer(logicalDevice, mCrateCubeIndexBuffer, nullptr);
-            mDeviceFunctions->vkFreeMemory(logicalDevice, mCrateCubeIndexBufferMemory, nullptr);
-            mCrateCubeBuffer = VK_NULL_HANDLE;
-            mCrateCubeBufferMemory = VK_NULL_HANDLE;
-            mCrateCubeIndexBuffer = VK_NULL_HANDLE;
-            mCrateCubeIndexBufferMemory = VK_NULL_HANDLE;
-            return; // Skip further initialization if index binding fails
-        }
-        
-        // Map and fill the index buffer
-        quint8 *crateIndexPtr = nullptr;
-        err = mDeviceFunctions->vkMapMemory(logicalDevice, mCrateCubeIndexBufferMemory, 0, crateIndexBufInfo.size, 0, 
-                                         reinterpret_cast<void **>(&crateIndexPtr));
-        if (err != VK_SUCCESS || crateIndexPtr == nullptr) {
-            qDebug() << "WARNING: Failed to map CrateCube index memory: Error" << err;
-            mDeviceFunctions->vkDestroyBuffer(logicalDevice, mCrateCubeBuffer, nullptr);
-            mDeviceFunctions->vkFreeMemory(logicalDevice, mCrateCubeBufferMemory, nullptr);
-            mDeviceFunctions->vkDestroyBuffer(logicalDevice, mCrateCubeIndexBuffer, nullptr);
-            mDeviceFunctions->vkFreeMemory(logicalDevice, mCrateCubeIndexBufferMemory, nullptr);
-            mCrateCubeBuffer = VK_NULL_HANDLE;
-            mCrateCubeBufferMemory = VK_NULL_HANDLE;
-            mCrateCubeIndexBuffer = VK_NULL_HANDLE;
-            mCrateCubeIndexBufferMemory = VK_NULL_HANDLE;
-            return; // Skip further initialization if index mapping fails
-        }
-        
-        memcpy(crateIndexPtr, crateCubeIndices, sizeof(crateCubeIndices));
-        mDeviceFunctions->vkUnmapMemory(logicalDevice, mCrateCubeIndexBufferMemory);
-        
-        qDebug() << "CrateCube model loaded successfully with" << mCrateCubeIndexCount << "indices";
+        qDebug() << "CrateCube model loaded successfully with" << mNPCMesh.levels[0].indexCount << "indices";
     }
     catch (const std::exception& e) {
         qDebug() << "Exception during CrateCube initialization:" << e.what();
@@ -1346,16 +817,11 @@ void RenderWindow::initResources()
             mDeviceFunctions->vkFreeMemory(logicalDevice, mCrateCubeBufferMemory, nullptr);
             mCrateCubeBufferMemory = VK_NULL_HANDLE;
         }
-        if (mCrateCubeIndexBuffer != VK_NULL_HANDLE) {
-            mDeviceFunctions->vkDestroyBuffer(logicalDevice, mCrateCubeIndexBuffer, nullptr);
-            mCrateCubeIndexBuffer = VK_NULL_HANDLE;
-        }
-        if (mCrateCubeIndexBufferMemory != VK_NULL_HANDLE) {
-            mDeviceFunctions->vkFreeMemory(logicalDevice, mCrateCubeIndexBufferMemory, nullptr);
-            mCrateCubeIndexBufferMemory = VK_NULL_HANDLE;
-        }
     }
 
+    TRACE_END();
+
+    TRACE_BEGIN("house buffers");
     // Create house buffers
     qDebug() << "Created and initialized 3 separate NPC buffers with different colors";
 
@@ -1364,8 +830,8 @@ void RenderWindow::initResources()
     // Create and initialize house walls buffer
     VkBufferCreateInfo houseWallsBufferInfo = {};
     houseWallsBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    houseWallsBufferInfo.size = sizeof(houseWallsVertexData);
-    houseWallsBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    houseWallsBufferInfo.size = mHouseWallsMesh.byteSize();
+    houseWallsBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
     err = mDeviceFunctions->vkCreateBuffer(logicalDevice, &houseWallsBufferInfo, nullptr, &mHouseWallsBuffer);
     if (err != VK_SUCCESS)
         qFatal("Failed to create house walls buffer: %d", err);
@@ -1387,49 +853,25 @@ void RenderWindow::initResources()
         qFatal("Failed to bind house walls buffer memory: %d", err);
     
     void* houseWallsData;
-    err = mDeviceFunctions->vkMapMemory(logicalDevice, mHouseWallsBufferMemory, 0, sizeof(houseWallsVertexData), 0, &houseWallsData);
+    err = mDeviceFunctions->vkMapMemory(logicalDevice, mHouseWallsBufferMemory, 0, mHouseWallsMesh.byteSize(), 0, &houseWallsData);
     if (err != VK_SUCCESS)
         qFatal("Failed to map house walls memory: %d", err);
-    memcpy(houseWallsData, houseWallsVertexData, sizeof(houseWallsVertexData));
+    mHouseWallsMesh.write(houseWallsData);
     mDeviceFunctions->vkUnmapMemory(logicalDevice, mHouseWallsBufferMemory);
 
-    // Create and initialize house door buffer
-    VkBufferCreateInfo houseDoorBufferInfo = {};
-    houseDoorBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    houseDoorBufferInfo.size = sizeof(houseDoorVertexData);
-    houseDoorBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-    err = mDeviceFunctions->vkCreateBuffer(logicalDevice, &houseDoorBufferInfo, nullptr, &mHouseDoorBuffer);
-    if (err != VK_SUCCESS)
-        qFatal("Failed to create house door buffer: %d", err);
-
-    VkMemoryRequirements houseDoorMemReq;
-    mDeviceFunctions->vkGetBufferMemoryRequirements(logicalDevice, mHouseDoorBuffer, &houseDoorMemReq);
-    VkMemoryAllocateInfo houseDoorAllocInfo = {
-        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        nullptr,
-        houseDoorMemReq.size,
-        mWindow->hostVisibleMemoryIndex()
-    };
-    err = mDeviceFunctions->vkAllocateMemory(logicalDevice, &houseDoorAllocInfo, nullptr, &mHouseDoorBufferMemory);
-    if (err != VK_SUCCESS)
-        qFatal("Failed to allocate house door memory: %d", err);
-    
-    err = mDeviceFunctions->vkBindBufferMemory(logicalDevice, mHouseDoorBuffer, mHouseDoorBufferMemory, 0);
-    if (err != VK_SUCCESS)
-        qFatal("Failed to bind house door buffer memory: %d", err);
-    
-    void* houseDoorData;
-    err = mDeviceFunctions->vkMapMemory(logicalDevice, mHouseDoorBufferMemory, 0, sizeof(houseDoorVertexData), 0, &houseDoorData);
-    if (err != VK_SUCCESS)
-        qFatal("Failed to map house door memory: %d", err);
-    memcpy(houseDoorData, houseDoorVertexData, sizeof(houseDoorVertexData));
-    mDeviceFunctions->vkUnmapMemory(logicalDevice, mHouseDoorBufferMemory);
+    // House door, streamed in like every later state of it - the closed door right away
+    mDoorBuffer = createRuntimeBuffer(mHouseDoorMesh.byteSize(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    std::vector<uint8_t> closedDoor(mHouseDoorMesh.byteSize());
+    mHouseDoorMesh.write(closedDoor.data());
+    mUploader.wait(mUploader.upload(mRuntimeBuffers.get(mDoorBuffer)->buffer, 0, std::move(closedDoor)));
+    mDoorBufferOpen = false;
+    mDoorUpload = 0;
 
     // Create and initialize house roof buffer
     VkBufferCreateInfo houseRoofBufferInfo = {};
     houseRoofBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    houseRoofBufferInfo.size = sizeof(houseRoofVertexData);
-    houseRoofBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    houseRoofBufferInfo.size = mHouseRoofMesh.byteSize();
+    houseRoofBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
     err = mDeviceFunctions->vkCreateBuffer(logicalDevice, &houseRoofBufferInfo, nullptr, &mHouseRoofBuffer);
     if (err != VK_SUCCESS)
         qFatal("Failed to create house roof buffer: %d", err);
@@ -1451,18 +893,18 @@ void RenderWindow::initResources()
         qFatal("Failed to bind house roof buffer memory: %d", err);
     
     void* houseRoofData;
-    err = mDeviceFunctions->vkMapMemory(logicalDevice, mHouseRoofBufferMemory, 0, sizeof(houseRoofVertexData), 0, &houseRoofData);
+    err = mDeviceFunctions->vkMapMemory(logicalDevice, mHouseRoofBufferMemory, 0, mHouseRoofMesh.byteSize(), 0, &houseRoofData);
     if (err != VK_SUCCESS)
         qFatal("Failed to map house roof memory: %d", err);
-    memcpy(houseRoofData, houseRoofVertexData, sizeof(houseRoofVertexData));
+    mHouseRoofMesh.write(houseRoofData);
     mDeviceFunctions->vkUnmapMemory(logicalDevice, mHouseRoofBufferMemory);
 
     // Initialize indoor scene resources
     // Create indoor walls buffer
     VkBufferCreateInfo indoorWallsBufferInfo = {};
     indoorWallsBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    indoorWallsBufferInfo.size = sizeof(indoorWallsVertexData);
-    indoorWallsBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    indoorWallsBufferInfo.size = mIndoorWallsMesh.byteSize();
+    indoorWallsBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
     err = mDeviceFunctions->vkCreateBuffer(logicalDevice, &indoorWallsBufferInfo, nullptr, &mIndoorWallsBuffer);
     if (err != VK_SUCCESS)
         qFatal("Failed to create indoor walls buffer: %d", err);
@@ -1484,17 +926,17 @@ void RenderWindow::initResources()
         qFatal("Failed to bind indoor walls buffer memory: %d", err);
     
     void* indoorWallsData;
-    err = mDeviceFunctions->vkMapMemory(logicalDevice, mIndoorWallsBufferMemory, 0, sizeof(indoorWallsVertexData), 0, &indoorWallsData);
+    err = mDeviceFunctions->vkMapMemory(logicalDevice, mIndoorWallsBufferMemory, 0, mIndoorWallsMesh.byteSize(), 0, &indoorWallsData);
     if (err != VK_SUCCESS)
         qFatal("Failed to map indoor walls memory: %d", err);
-    memcpy(indoorWallsData, indoorWallsVertexData, sizeof(indoorWallsVertexData));
+    mIndoorWallsMesh.write(indoorWallsData);
     mDeviceFunctions->vkUnmapMemory(logicalDevice, mIndoorWallsBufferMemory);
 
     // Create exit door buffer
     VkBufferCreateInfo exitDoorBufferInfo = {};
     exitDoorBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    exitDoorBufferInfo.size = sizeof(exitDoorVertexData);
-    exitDoorBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    exitDoorBufferInfo.size = mExitDoorMesh.byteSize();
+    exitDoorBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
     err = mDeviceFunctions->vkCreateBuffer(logicalDevice, &exitDoorBufferInfo, nullptr, &mExitDoorBuffer);
     if (err != VK_SUCCESS)
         qFatal("Failed to create exit door buffer: %d", err);
@@ -1516,70 +958,30 @@ void RenderWindow::initResources()
         qFatal("Failed to bind exit door buffer memory: %d", err);
     
     void* exitDoorData;
-    err = mDeviceFunctions->vkMapMemory(logicalDevice, mExitDoorBufferMemory, 0, sizeof(exitDoorVertexData), 0, &exitDoorData);
+    err = mDeviceFunctions->vkMapMemory(logicalDevice, mExitDoorBufferMemory, 0, mExitDoorMesh.byteSize(), 0, &exitDoorData);
     if (err != VK_SUCCESS)
         qFatal("Failed to map exit door memory: %d", err);
-    memcpy(exitDoorData, exitDoorVertexData, sizeof(exitDoorVertexData));
+    mExitDoorMesh.write(exitDoorData);
     mDeviceFunctions->vkUnmapMemory(logicalDevice, mExitDoorBufferMemory);
 
-    // Create descriptor sets for the house
-    VkDescriptorSetAllocateInfo houseDescSetAllocInfo = {
-        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        nullptr,
-        mDescriptorPool,
-        1,
-        &mDescriptorSetLayout
-    };
-
-    for (int i = 0; i < concurrentFrameCount; ++i) {
-        err = mDeviceFunctions->vkAllocateDescriptorSets(logicalDevice, &houseDescSetAllocInfo, &mHouseDescriptorSet[i]);
-        if (err != VK_SUCCESS)
-            qFatal("Failed to allocate house descriptor set: %d", err);
-
-        VkWriteDescriptorSet writeDescSet = {
-            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            nullptr,
-            mHouseDescriptorSet[i],
-            0, // binding
-            0, // arrayElement
-            1, // descriptorCount
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            nullptr,
-            &mHouseUniformBufferInfo[i],
-            nullptr
-        };
-        mDeviceFunctions->vkUpdateDescriptorSets(logicalDevice, 1, &writeDescSet, 0, nullptr);
-    }
-    
-    // Create descriptor sets for the indoor scene
-    for (int i = 0; i < concurrentFrameCount; ++i) {
-        err = mDeviceFunctions->vkAllocateDescriptorSets(logicalDevice, &houseDescSetAllocInfo, &mIndoorDescriptorSet[i]);
-        if (err != VK_SUCCESS)
-            qFatal("Failed to allocate indoor descriptor set: %d", err);
-
-        VkWriteDescriptorSet writeDescSet = {
-            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            nullptr,
-            mIndoorDescriptorSet[i],
-            0, // binding
-            0, // arrayElement
-            1, // descriptorCount
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            nullptr,
-            &mIndoorUniformBufferInfo[i],
-            nullptr
-        };
-        mDeviceFunctions->vkUpdateDescriptorSets(logicalDevice, 1, &writeDescSet, 0, nullptr);
-    }
+    TRACE_END();
 
     qDebug("\n ***************************** initResources finished ******************************************* \n");
 
     getVulkanHWInfo();
 
 
-    
-    // Initialize indoor scene resources
-    createIndoorSceneResources();
+
+    // GPU timestamp queries, one set per frame in flight
+    mGpuProfiler.init(mWindow, mDeviceFunctions);
+    mRenderGraph.init(mWindow, mDeviceFunctions);
+    mMemoryBudget.init(mWindow);
+
+    // Secondary command buffers for the cached static scene and the per-frame dynamic part
+    TRACE_BEGIN("secondary command buffers");
+    createSecondaryCommandBuffers();
+    mRecorder.init(mWindow, mDeviceFunctions, mRecordThreads);
+    TRACE_END();
     
     // Initialize default scene state
     mCurrentScene = 1; // Start in outdoor scene
@@ -1587,466 +989,312 @@ void RenderWindow::initResources()
     
 }
 
-void RenderWindow::createIndoorSceneResources()
+void RenderWindow::drawOutdoorStatic(VkCommandBuffer cb)
 {
-    qDebug() << "Creating indoor scene resources...";
-    VkDevice dev = mWindow->device();
-    
-    // Indoor room vertices (simple cube room)
-    static const float indoorWallsVertexData[] = {
-        // Position            // Color (white walls with blue accent)
-        // Back wall (negative Z)
-        -5.0f, 0.0f, -5.0f,    0.9f, 0.9f, 1.0f,  // Bottom-left
-        5.0f, 0.0f, -5.0f,     0.9f, 0.9f, 1.0f,  // Bottom-right
-        5.0f, 5.0f, -5.0f,     0.9f, 0.9f, 1.0f,  // Top-right
-        -5.0f, 5.0f, -5.0f,    0.9f, 0.9f, 1.0f,  // Top-left
-        
-        // Front wall (positive Z) with door cutout
-        -5.0f, 0.0f, 5.0f,     0.9f, 0.9f, 1.0f,  // Bottom-left
-        -1.5f, 0.0f, 5.0f,     0.9f, 0.9f, 1.0f,  // Door left bottom
-        -1.5f, 3.0f, 5.0f,     0.9f, 0.9f, 1.0f,  // Door left top
-        -5.0f, 5.0f, 5.0f,     0.9f, 0.9f, 1.0f,  // Top-left
-        
-        // Front wall right of door
-        1.5f, 0.0f, 5.0f,      0.9f, 0.9f, 1.0f,  // Door right bottom
-        5.0f, 0.0f, 5.0f,      0.9f, 0.9f, 1.0f,  // Bottom-right
-        5.0f, 5.0f, 5.0f,      0.9f, 0.9f, 1.0f,  // Top-right
-        1.5f, 3.0f, 5.0f,      0.9f, 0.9f, 1.0f,  // Door right top
-        
-        // Front wall above door
-        -1.5f, 3.0f, 5.0f,     0.9f, 0.9f, 1.0f,  // Door left top
-        1.5f, 3.0f, 5.0f,      0.9f, 0.9f, 1.0f,  // Door right top
-        1.5f, 5.0f, 5.0f,      0.9f, 0.9f, 1.0f,  // Top-right of door
-        -1.5f, 5.0f, 5.0f,     0.9f, 0.9f, 1.0f,  // Top-left of door
-        
-        // Left wall (negative X)
-        -5.0f, 0.0f, -5.0f,    0.8f, 0.8f, 1.0f,  // Back bottom
-        -5.0f, 0.0f, 5.0f,     0.8f, 0.8f, 1.0f,  // Front bottom
-        -5.0f, 5.0f, 5.0f,     0.8f, 0.8f, 1.0f,  // Front top
-        -5.0f, 5.0f, -5.0f,    0.8f, 0.8f, 1.0f,  // Back top
-        
-        // Right wall (positive X)
-        5.0f, 0.0f, -5.0f,     0.8f, 0.8f, 1.0f,  // Back bottom
-        5.0f, 0.0f, 5.0f,      0.8f, 0.8f, 1.0f,  // Front bottom
-        5.0f, 5.0f, 5.0f,      0.8f, 0.8f, 1.0f,  // Front top
-        5.0f, 5.0f, -5.0f,     0.8f, 0.8f, 1.0f,  // Back top
-        
-        // Ceiling (positive Y)
-        -5.0f, 5.0f, -5.0f,    0.7f, 0.7f, 1.0f,  // Back-left
-        5.0f, 5.0f, -5.0f,     0.7f, 0.7f, 1.0f,  // Back-right
-        5.0f, 5.0f, 5.0f,      0.7f, 0.7f, 1.0f,  // Front-right
-        -5.0f, 5.0f, 5.0f,     0.7f, 0.7f, 1.0f,  // Front-left
-    };
-    
-    // Exit door vertices
-    static const float exitDoorVertexData[] = {
-        // Position            // Color (wooden door)
-        -1.5f, 0.0f, 5.0f,     0.6f, 0.4f, 0.2f,  // Bottom-left
-        1.5f, 0.0f, 5.0f,      0.6f, 0.4f, 0.2f,  // Bottom-right
-        1.5f, 3.0f, 5.0f,      0.6f, 0.4f, 0.2f,  // Top-right
-        -1.5f, 3.0f, 5.0f,     0.6f, 0.4f, 0.2f,  // Top-left
-    };
-    
-    // Create indoor walls buffer
-    VkBufferCreateInfo bufInfo = {};
-    bufInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufInfo.size = sizeof(indoorWallsVertexData);
-    bufInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-    
-    VkResult err = mDeviceFunctions->vkCreateBuffer(dev, &bufInfo, nullptr, &mIndoorWallsBuffer);
-    if (err != VK_SUCCESS) {
-        qFatal("Failed to create indoor walls buffer: %d", err);
-    }
-    
-    VkMemoryRequirements memReq;
-    mDeviceFunctions->vkGetBufferMemoryRequirements(dev, mIndoorWallsBuffer, &memReq);
-    
-    VkMemoryAllocateInfo memAllocInfo = {};
-    memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memAllocInfo.allocationSize = memReq.size;
-    memAllocInfo.memoryTypeIndex = mWindow->hostVisibleMemoryIndex();
-    
-    err = mDeviceFunctions->vkAllocateMemory(dev, &memAllocInfo, nullptr, &mIndoorWallsBufferMemory);
-    if (err != VK_SUCCESS) {
-        qFatal("Failed to allocate indoor walls memory: %d", err);
-    }
-    
-    err = mDeviceFunctions->vkBindBufferMemory(dev, mIndoorWallsBuffer, mIndoorWallsBufferMemory, 0);
-    if (err != VK_SUCCESS) {
-        qFatal("Failed to bind indoor walls buffer memory: %d", err);
-    }
-    
-    void* data;
-    err = mDeviceFunctions->vkMapMemory(dev, mIndoorWallsBufferMemory, 0, memReq.size, 0, &data);
-    if (err != VK_SUCCESS) {
-        qFatal("Failed to map indoor walls buffer memory: %d", err);
-    }
-    memcpy(data, indoorWallsVertexData, sizeof(indoorWallsVertexData));
-    mDeviceFunctions->vkUnmapMemory(dev, mIndoorWallsBufferMemory);
-    
-    // Create exit door buffer
-    bufInfo.size = sizeof(exitDoorVertexData);
-    err = mDeviceFunctions->vkCreateBuffer(dev, &bufInfo, nullptr, &mExitDoorBuffer);
-    if (err != VK_SUCCESS) {
-        qFatal("Failed to create exit door buffer: %d", err);
-    }
-    
-    mDeviceFunctions->vkGetBufferMemoryRequirements(dev, mExitDoorBuffer, &memReq);
-    memAllocInfo.allocationSize = memReq.size;
-    
-    err = mDeviceFunctions->vkAllocateMemory(dev, &memAllocInfo, nullptr, &mExitDoorBufferMemory);
-    if (err != VK_SUCCESS) {
-        qFatal("Failed to allocate exit door memory: %d", err);
-    }
-    
-    err = mDeviceFunctions->vkBindBufferMemory(dev, mExitDoorBuffer, mExitDoorBufferMemory, 0);
-    if (err != VK_SUCCESS) {
-        qFatal("Failed to bind exit door buffer memory: %d", err);
-    }
-    
-    err = mDeviceFunctions->vkMapMemory(dev, mExitDoorBufferMemory, 0, memReq.size, 0, &data);
-    if (err != VK_SUCCESS) {
-        qFatal("Failed to map exit door buffer memory: %d", err);
-    }
-    memcpy(data, exitDoorVertexData, sizeof(exitDoorVertexData));
-    mDeviceFunctions->vkUnmapMemory(dev, mExitDoorBufferMemory);
-    
-    // Setup descriptor sets for indoor scene
-    const int concurrentFrameCount = mWindow->concurrentFrameCount();
-    
-    for (int i = 0; i < concurrentFrameCount; ++i) {
-        // Allocate indoor descriptor set
-        VkDescriptorSetAllocateInfo descSetAllocInfo = {
-            VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-            nullptr,
-            mDescriptorPool,
-            1,
-            &mDescriptorSetLayout
-        };
-        err = mDeviceFunctions->vkAllocateDescriptorSets(dev, &descSetAllocInfo, &mIndoorDescriptorSet[i]);
-        if (err != VK_SUCCESS) {
-            qFatal("Failed to allocate indoor descriptor set: %d", err);
+    // Draw ground, scaled to the size of the world (groundVertexData is a 20x20 plane)
+    mGpuProfiler.beginRegion(cb, GpuRegion::Ground);
+    QMatrix4x4 groundMatrix;
+    groundMatrix.setToIdentity();
+    groundMatrix.scale(mWorldSize / 10.0f, 1.0f, mWorldSize / 10.0f);
+
+    bindObjectSet(cb);
+    mFrameStats.descriptorBinds++;
+    pushObject(cb, GroundTransform, GroundMaterial, groundMatrix);
+    drawMesh(cb, mGroundBuffer, mGroundMesh);
+    mFrameStats.drawCalls++;
+    mGpuProfiler.endRegion(cb, GpuRegion::Ground);
+    
+    LOG_TRACE(Render, "Drew larger ground plane");
+
+    // Draw house components - every house shares the same walls, door and roof buffers.
+    // The door is a runtime buffer resolved from its handle, one per door state (see updateDoorMesh).
+    // The other state's buffer is swapped in once its upload is complete, and the swap
+    // invalidates the static scenes, which re-records these commands with the new buffer.
+    mGpuProfiler.beginRegion(cb, GpuRegion::House);
+    mHouseLevels.resize(size_t(mHousePositions.size()));
+    for (int house = 0; house < mHousePositions.size(); ++house) {
+        const QVector3D &housePosition = mHousePositions[house];
+        // Houses outside the camera frustum are left out of the cached buffer.
+        // A new camera re-records it (see cullOutdoorScene).
+        if (!mFrustum.intersectsBox(housePosition + mHouseMeshBounds.min, housePosition + mHouseMeshBounds.max)) {
+            mFrameStats.culled++;
+            continue;
         }
-        
-        // Update indoor descriptor set
-        VkWriteDescriptorSet descWrite = {};
-        descWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descWrite.dstSet = mIndoorDescriptorSet[i];
-        descWrite.descriptorCount = 1;
-        descWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descWrite.pBufferInfo = &mIndoorUniformBufferInfo[i];
-        mDeviceFunctions->vkUpdateDescriptorSets(dev, 1, &descWrite, 0, nullptr);
+
+        // The walls have levels of detail, the door and the roof are too small to gain anything
+        const float distance = qMax((housePosition + mHouseMeshBounds.center - mCullEye).length() - mHouseMeshBounds.radius, 0.1f);
+        mHouseLevels[size_t(house)] = uint8_t(mHouseWallsMesh.select(mLodPixelsPerUnit / distance, LOD_PIXEL_ERROR,
+                                                                     mHouseLevels[size_t(house)]));
+
+        // Position the house at its fixed location
+        QMatrix4x4 houseMatrix;
+        houseMatrix.setToIdentity();
+        houseMatrix.translate(housePosition);
+        pushObject(cb, mTransforms.houses + uint32_t(house), HouseMaterial, houseMatrix);
+
+        // Draw house walls, door and roof
+        drawMesh(cb, mHouseWallsBuffer, mHouseWallsMesh, mHouseLevels[size_t(house)]);
+        if (const RuntimeBuffer *door = mRuntimeBuffers.get(mDoorBuffer))
+            drawMesh(cb, door->buffer, mDoorBufferOpen ? mHouseDoorOpenMesh : mHouseDoorMesh);
+        drawMesh(cb, mHouseRoofBuffer, mHouseRoofMesh);
+        mFrameStats.drawCalls += 3;
     }
-    
-    qDebug() << "Initialized indoor scene resources successfully";
+    mGpuProfiler.endRegion(cb, GpuRegion::House);
+
+    LOG_TRACE(Render, "Drew {} houses, entrance house at position {}", mHousePositions.size(), mHousePosition);
 }
 
-void RenderWindow::drawOutdoorScene(VkDevice dev, VkCommandBuffer cb, quint8* GPUmemPointer, VkResult& err)
+void RenderWindow::drawOutdoorScene(VkCommandBuffer cb)
 {
-    // Draw ground
-    QMatrix4x4 groundMatrix;
-    groundMatrix.setToIdentity();
-    QMatrix4x4 groundMVP = mProjectionMatrix * mViewMatrix * groundMatrix;
+    // Player, collectibles and NPCs go into the render queue in any order. Sorted by pipeline,
+    // material and mesh, the pipeline and the mesh are bound once per group instead of once per object.
+    mRenderQueue.clear();
+    drawPlayer(mRenderQueue);
+    if (!mGpuCulling) {
+        LOG_TRACE(Render, "Starting to render {} of {} collectibles", mVisibleCollectibles.size(), mCollectibles.size());
+        drawCollectibles(mRenderQueue, 0, int(mVisibleCollectibles.size()));
+        drawNPCs(mRenderQueue, 0, int(mVisibleNPCs.size()));
+    }
+
+    RecordCounters counters;
+    mGpuProfiler.beginRegion(cb, GpuRegion::Sorted);
+    submitQueue(cb, mRenderQueue, counters);
+    mGpuProfiler.endRegion(cb, GpuRegion::Sorted);
+    addRecordCounters(counters);
+    drawPortalCells(cb);
+
+    // Collectibles and NPCs culled on the GPU - one indirect draw, whatever their number
+    if (mGpuCulling) {
+        mGpuProfiler.beginRegion(cb, GpuRegion::Instances);
+        mFrameStats.drawCalls += mGpuCuller.recordDraw(cb, sceneFeatures());
+        mFrameStats.descriptorBinds++;
+        mGpuProfiler.endRegion(cb, GpuRegion::Instances);
+        mDeviceFunctions->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mScenePipeline);
+        mFrameStats.pipelineBinds++;
+        bindObjectSet(cb);
+        mFrameStats.descriptorBinds++;
+    }
 
-    // Update uniform buffer for ground
-    VkDeviceSize groundOffset = mUniformBufferInfo[mWindow->currentFrame()].offset;
-    err = mDeviceFunctions->vkMapMemory(dev, mBufferMemory, groundOffset,
-                                        UNIFORM_DATA_SIZE, 0, reinterpret_cast<void **>(&GPUmemPointer));
-    memcpy(GPUmemPointer, groundMVP.constData(), 16 * sizeof(float));
-    mDeviceFunctions->vkUnmapMemory(dev, mBufferMemory);
+    // Draw game over overlay if player has lost
+    if (mGameLost) {
+        // Reminder every few seconds (window title will still show you lost)
+        LOG_INFO_LIMITED(Game, 1, "GAME OVER! YOU LOST! You can press R to restart the game");
+    }
+}
 
-    // Draw ground
-    mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
-                                            &mDescriptorSet[mWindow->currentFrame()], 0, nullptr);
-    VkDeviceSize groundVertexOffset = 0;
-    mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mGroundBuffer, &groundVertexOffset);
-    mDeviceFunctions->vkCmdDraw(cb, 6, 1, 0, 0);  // 6 vertices for ground
-    
-    qDebug() << "Drew larger ground plane";
+void RenderWindow::drawOutdoorSceneParallel(std::vector<VkCommandBuffer> &executeList)
+{
+    // Slices of the visible collectible and NPC lists become tasks, a few per thread so
+    // a thread that finishes early picks up more. Tiny slices cost more than they save.
+    const int MIN_SLICE = 256;
+    const int maxSlices = mRecorder.threadCount() * 2;
+    auto addSlices = [this, maxSlices](bool npcs, int count) {
+        const int slices = qBound(1, (count + MIN_SLICE - 1) / MIN_SLICE, maxSlices);
+        for (int slice = 0; slice < slices && count > 0; ++slice)
+            mRecordTasks.push_back({ npcs, count * slice / slices, count * (slice + 1) / slices });
+    };
+    mRecordTasks.clear();
+    addSlices(false, int(mVisibleCollectibles.size()));
+    const size_t collectibleTasks = mRecordTasks.size();
+    addSlices(true, int(mVisibleNPCs.size()));
+
+    // The render thread records the player and the GPU profiler marks between the slices.
+    // Collectibles and NPCs span several command buffers, so they only get timestamps.
+    VkCommandBuffer head = mRecorder.acquire();
+    beginSecondary(head, sceneFramebuffer(), VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    RecordCounters headCounters;
+    mRenderQueue.clear();
+    drawPlayer(mRenderQueue);
+    mGpuProfiler.beginRegion(head, GpuRegion::Player);
+    submitQueue(head, mRenderQueue, headCounters);
+    mGpuProfiler.endRegion(head, GpuRegion::Player);
+    addRecordCounters(headCounters);
+    drawPortalCells(head);
+    mGpuProfiler.beginRegion(head, GpuRegion::Collectibles, false);
+    endSecondary(head);
+
+    VkCommandBuffer middle = mRecorder.acquire();
+    beginSecondary(middle, sceneFramebuffer(), VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    mGpuProfiler.endRegion(middle, GpuRegion::Collectibles);
+    mGpuProfiler.beginRegion(middle, GpuRegion::NPCs, false);
+    endSecondary(middle);
+
+    VkCommandBuffer tail = mRecorder.acquire();
+    beginSecondary(tail, sceneFramebuffer(), VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    mGpuProfiler.endRegion(tail, GpuRegion::NPCs);
+    // With the offscreen scene target the overlay comes after the upscale
+    if (!mUpscaler.isInitialized())
+        recordOverlay(tail);
+    endSecondary(tail);
+
+    // Worker threads only write their own counters and queues. Each slice is sorted on its own.
+    for (RecordCounters &counters : mWorkerCounters)
+        counters = RecordCounters();
+    const VkFramebuffer framebuffer = sceneFramebuffer();
+    const std::vector<VkCommandBuffer> &slices = mRecorder.record(int(mRecordTasks.size()),
+        [this, framebuffer](VkCommandBuffer cb, int task, int worker) {
+            const RecordTask &recordTask = mRecordTasks[size_t(task)];
+            RenderQueue &queue = mWorkerQueues[worker];
+            queue.clear();
+            if (recordTask.npcs)
+                drawNPCs(queue, recordTask.begin, recordTask.end);
+            else
+                drawCollectibles(queue, recordTask.begin, recordTask.end);
+            beginSecondary(cb, framebuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+            submitQueue(cb, queue, mWorkerCounters[worker]);
+            endSecondary(cb);
+        });
+
+    for (const RecordCounters &counters : mWorkerCounters)
+        addRecordCounters(counters);
+
+    // Same order as the single threaded recording
+    executeList.push_back(head);
+    executeList.insert(executeList.end(), slices.begin(), slices.begin() + collectibleTasks);
+    executeList.push_back(middle);
+    executeList.insert(executeList.end(), slices.begin() + collectibleTasks, slices.end());
+    executeList.push_back(tail);
+
+    if (mGameLost)
+        LOG_INFO_LIMITED(Game, 1, "GAME OVER! YOU LOST! You can press R to restart the game");
+}
+
+void RenderWindow::drawPlayer(RenderQueue &queue)
+{
+    const int frame = mWindow->currentFrame();
 
-    // Draw player cube at its current position
     QMatrix4x4 playerMatrix;
     playerMatrix.setToIdentity();
     playerMatrix.translate(mPlayerPosition);
-    
-    QMatrix4x4 playerMVP = mProjectionMatrix * mViewMatrix * playerMatrix;
 
-    // Update player's uniform buffer
-    VkDeviceSize playerOffset = mPlayerUniformBufferInfo[mWindow->currentFrame()].offset;
-    err = mDeviceFunctions->vkMapMemory(dev, mBufferMemory, playerOffset,
-                                       UNIFORM_DATA_SIZE, 0, reinterpret_cast<void **>(&GPUmemPointer));
-    memcpy(GPUmemPointer, playerMVP.constData(), 16 * sizeof(float));
-    mDeviceFunctions->vkUnmapMemory(dev, mBufferMemory);
+    const LodLevel &lod = mPlayerMesh.levels[0];
+    mBindless.setTransform(frame, PlayerTransform, playerMatrix);
+    queue.add(RenderQueue::Opaque, mScenePipeline, PlayerMaterial, mPlayerBuffer, mPlayerMesh.indexOffset(),
+              lod.indexCount, lod.firstIndex, PlayerTransform, (mPlayerPosition - mCullEye).length());
 
-    // Draw player cube
-    mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
-                                             &mPlayerDescriptorSet[mWindow->currentFrame()], 0, nullptr);
-    VkDeviceSize playerVertexOffset = 0;
-    mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mPlayerBuffer, &playerVertexOffset);
-    mDeviceFunctions->vkCmdDraw(cb, 36, 1, 0, 0);  // 36 vertices for cube
+    LOG_TRACE(Render, "Drew player cube at {}", mPlayerPosition);
+}
 
-    qDebug() << "Drew player cube at" << mPlayerPosition;
+void RenderWindow::drawCollectibles(RenderQueue &queue, int begin, int end)
+{
+    // Called from the recording threads: only reads the scene and writes to queue and to
+    // the transform rows of the collectibles it draws
+    const int frame = mWindow->currentFrame();
 
-    // Draw collectibles one by one
+    // Per-object debug output only for small hand-made scenes, stress scenes would drown in it
+    const bool logEachObject = (mCollectibles.size() + mNPCs.size()) <= 32;
     int renderedCollectibles = 0;
-    qDebug() << "Starting to render" << mCollectibles.size() << "collectibles";
-    
-    for (int i = 0; i < mCollectibles.size(); ++i) {
+
+    for (int v = begin; v < end; ++v) {
+        const int i = int(mVisibleCollectibles[size_t(v)]);
         if (!mCollectibles[i].collected) {
-            qDebug() << "Rendering collectible" << i << "at position" << mCollectibles[i].position;
+            if (logEachObject)
+                LOG_TRACE(Render, "Rendering collectible {} at position {}", i, mCollectibles[i].position);
             
             // Create matrix for this collectible
             QMatrix4x4 collectibleMatrix;
             collectibleMatrix.setToIdentity();
             collectibleMatrix.translate(mCollectibles[i].position);
             // Make collectibles a bit smaller
-            collectibleMatrix.scale(0.4f);
+            collectibleMatrix.scale(COLLECTIBLE_SCALE);
             
-            // Update collectible uniform buffer with this collectible's MVP
-            QMatrix4x4 collectibleMVP = mProjectionMatrix * mViewMatrix * collectibleMatrix;
-            err = mDeviceFunctions->vkMapMemory(dev, mBufferMemory, mCollectibleUniformBufferInfo[mWindow->currentFrame()].offset,
-                                             UNIFORM_DATA_SIZE, 0, reinterpret_cast<void **>(&GPUmemPointer));
-            memcpy(GPUmemPointer, collectibleMVP.constData(), 16 * sizeof(float));
-            mDeviceFunctions->vkUnmapMemory(dev, mBufferMemory);
-            
-            // Draw this collectible with correct descriptor set
-            mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
-                                                    &mCollectibleDescriptorSet[mWindow->currentFrame()], 0, nullptr);
-            VkDeviceSize collectibleVertexOffset = 0;
-            mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mCollectibleBuffer, &collectibleVertexOffset);
-            mDeviceFunctions->vkCmdDraw(cb, 36, 1, 0, 0);  // 36 vertices for cube
+            // Queue this collectible with its own transform row
+            const uint32_t transform = mTransforms.collectibles + uint32_t(i);
+            const LodLevel &lod = mCollectibleMesh.levels[mCollectibleLevels[size_t(i)]];
+            mBindless.setTransform(frame, transform, collectibleMatrix);
+            queue.add(RenderQueue::Opaque, mScenePipeline, CollectibleMaterial, mCollectibleBuffer,
+                      mCollectibleMesh.indexOffset(), lod.indexCount, lod.firstIndex, transform,
+                      (mCollectibles[i].position - mCullEye).length());
             
             renderedCollectibles++;
         }
     }
-    
-    qDebug() << "Drew" << renderedCollectibles << "collectibles";
 
-    // Draw NPCs with proper dedicated buffers - one buffer for each NPC with different colors
+    LOG_TRACE(Render, "Drew {} collectibles ({} to {})", renderedCollectibles, begin, end);
+}
+
+void RenderWindow::drawNPCs(RenderQueue &queue, int begin, int end)
+{
+    // Called from the recording threads: only reads the scene and writes to queue and to
+    // the transform rows of the NPCs it draws
+    const int frame = mWindow->currentFrame();
+    const bool logEachObject = (mCollectibles.size() + mNPCs.size()) <= 32;
+
+    // The red, green and blue NPC resources are used in turn, so any number of NPCs can be drawn
+    VkBuffer npcFallbackBuffers[] = { mNPCBuffer1, mNPCBuffer2, mNPCBuffer3 };
     int renderedNPCs = 0;
-    
-    // Draw NPC 1 (Red)
-    if (mNPCs.size() > 0) {
-        // Create matrix for NPC 1
+
+    for (int v = begin; v < end; ++v) {
+        const int i = int(mVisibleNPCs[size_t(v)]);
+
+        // Create matrix for this NPC
         QMatrix4x4 npcMatrix;
         npcMatrix.setToIdentity();
-        npcMatrix.translate(mNPCs[0].position);
+        npcMatrix.translate(mNPCs[i].position);
         
         // Make NPCs slightly larger (1.2x) for better visibility
-        npcMatrix.scale(1.2f);
-        
-        // Update uniform buffer with NPC1's MVP
-        QMatrix4x4 npcMVP = mProjectionMatrix * mViewMatrix * npcMatrix;
+        npcMatrix.scale(NPC_SCALE);
+
+        const float depth = (mNPCs[i].position - mCullEye).length();
+        const uint32_t transform = mTransforms.npcs + uint32_t(i);
+        const uint32_t material = NPCMaterial1 + uint32_t(i % 3);
+        mBindless.setTransform(frame, transform, npcMatrix);
         
-        // Use dedicated NPC1 buffer
-        VkDeviceSize npcOffset1 = mNPCUniformBufferInfo1[mWindow->currentFrame()].offset;
-        err = mDeviceFunctions->vkMapMemory(dev, mBufferMemory, npcOffset1,
-                                         UNIFORM_DATA_SIZE, 0, reinterpret_cast<void **>(&GPUmemPointer));
-        if (err != VK_SUCCESS) {
-            qDebug() << "Failed to map memory for NPC1 uniform buffer! Error:" << err;
+        // Draw the CrateCube model at the NPC's level of detail
+        // Add null check for CrateCube buffer
+        if (mCrateCubeBuffer != VK_NULL_HANDLE) {
+            const LodLevel &lod = mNPCMesh.levels[mNPCLevels[size_t(i)]];
+            queue.add(RenderQueue::Opaque, mScenePipeline, material, mCrateCubeBuffer, mNPCMesh.indexOffset(),
+                      lod.indexCount, lod.firstIndex, transform, depth);
         } else {
-            memcpy(GPUmemPointer, npcMVP.constData(), 16 * sizeof(float));
-            mDeviceFunctions->vkUnmapMemory(dev, mBufferMemory);
-            
-            // Use dedicated NPC1 descriptor set
-            mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
-                                                   &mNPCDescriptorSet1[mWindow->currentFrame()], 0, nullptr);
-            
-            // Bind the CrateCube model buffer instead of NPC1 vertex buffer
-            // Add null check for CrateCube buffer
-            if (mCrateCubeBuffer != VK_NULL_HANDLE) {
-                VkDeviceSize npcVertexOffset = 0;
-                mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mCrateCubeBuffer, &npcVertexOffset);
-                
-                // If the crate cube has an index buffer, use indexed drawing
-                if (mCrateCubeIndexBuffer != VK_NULL_HANDLE && mCrateCubeIndexCount > 0) {
-                    mDeviceFunctions->vkCmdBindIndexBuffer(cb, mCrateCubeIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
-                    mDeviceFunctions->vkCmdDrawIndexed(cb, mCrateCubeIndexCount, 1, 0, 0, 0);
-                } else {
-                    // Fallback to non-indexed drawing if needed
-                    mDeviceFunctions->vkCmdDraw(cb, 36, 1, 0, 0);  // 36 vertices for cube
-                }
-            } else {
-                // Fallback to original NPC buffer if CrateCube buffer is null
-                VkDeviceSize npcVertexOffset = 0;
-                mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mNPCBuffer1, &npcVertexOffset);
-                mDeviceFunctions->vkCmdDraw(cb, 36, 1, 0, 0);  // 36 vertices for cube
-                qDebug() << "WARNING: Using fallback NPC buffer for NPC 0 - CrateCube buffer was null";
-            }
-            
-            renderedNPCs++;
-            qDebug() << "Drew NPC 0 (CrateCube) at position" << mNPCs[0].position;
+            // Fallback to original NPC buffer if CrateCube buffer is null
+            const PackedMesh &fallbackMesh = mNPCFallbackMeshes[i % 3];
+            queue.add(RenderQueue::Opaque, mScenePipeline, material, npcFallbackBuffers[i % 3],
+                      fallbackMesh.indexOffset(), fallbackMesh.levels[0].indexCount, fallbackMesh.levels[0].firstIndex,
+                      transform, depth);
+            if (logEachObject)
+                LOG_WARNING(Render, "Using fallback NPC buffer for NPC {} - CrateCube buffer was null", i);
         }
-    }
-    
-    // Draw NPC 2 (Green)
-    if (mNPCs.size() > 1) {
-        // Create matrix for NPC 2
-        QMatrix4x4 npcMatrix;
-        npcMatrix.setToIdentity();
-        npcMatrix.translate(mNPCs[1].position);
         
-        // Make NPCs slightly larger (1.2x) for better visibility
-        npcMatrix.scale(1.2f);
-        
-        // Update uniform buffer with NPC2's MVP
-        QMatrix4x4 npcMVP = mProjectionMatrix * mViewMatrix * npcMatrix;
-        
-        // Use dedicated NPC2 buffer
-        VkDeviceSize npcOffset2 = mNPCUniformBufferInfo2[mWindow->currentFrame()].offset;
-        err = mDeviceFunctions->vkMapMemory(dev, mBufferMemory, npcOffset2,
-                                         UNIFORM_DATA_SIZE, 0, reinterpret_cast<void **>(&GPUmemPointer));
-        if (err != VK_SUCCESS) {
-            qDebug() << "Failed to map memory for NPC2 uniform buffer! Error:" << err;
-        } else {
-            memcpy(GPUmemPointer, npcMVP.constData(), 16 * sizeof(float));
-            mDeviceFunctions->vkUnmapMemory(dev, mBufferMemory);
-            
-            // Use dedicated NPC2 descriptor set
-            mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
-                                                   &mNPCDescriptorSet2[mWindow->currentFrame()], 0, nullptr);
-            
-            // Bind the CrateCube model buffer
-            // Add null check for CrateCube buffer
-            if (mCrateCubeBuffer != VK_NULL_HANDLE) {
-                VkDeviceSize npcVertexOffset = 0;
-                mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mCrateCubeBuffer, &npcVertexOffset);
-                
-                // If the crate cube has an index buffer, use indexed drawing
-                if (mCrateCubeIndexBuffer != VK_NULL_HANDLE && mCrateCubeIndexCount > 0) {
-                    mDeviceFunctions->vkCmdBindIndexBuffer(cb, mCrateCubeIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
-                    mDeviceFunctions->vkCmdDrawIndexed(cb, mCrateCubeIndexCount, 1, 0, 0, 0);
-                } else {
-                    // Fallback to non-indexed drawing if needed
-                    mDeviceFunctions->vkCmdDraw(cb, 36, 1, 0, 0);  // 36 vertices for cube
-                }
-            } else {
-                // Fallback to original NPC buffer if CrateCube buffer is null
-                VkDeviceSize npcVertexOffset = 0;
-                mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mNPCBuffer2, &npcVertexOffset);
-                mDeviceFunctions->vkCmdDraw(cb, 36, 1, 0, 0);  // 36 vertices for cube
-                qDebug() << "WARNING: Using fallback NPC buffer for NPC 1 - CrateCube buffer was null";
-            }
-            
-            renderedNPCs++;
-            qDebug() << "Drew NPC 1 (CrateCube) at position" << mNPCs[1].position;
-        }
+        renderedNPCs++;
+        if (logEachObject)
+            LOG_TRACE(Render, "Drew NPC {} (CrateCube) at position {}", i, mNPCs[i].position);
     }
-    
-    // Draw NPC 3 (Blue)
-    if (mNPCs.size() > 2) {
-        // Create matrix for NPC 3
-        QMatrix4x4 npcMatrix;
-        npcMatrix.setToIdentity();
-        npcMatrix.translate(mNPCs[2].position);
-        
-        // Make NPCs slightly larger (1.2x) for better visibility
-        npcMatrix.scale(1.2f);
-        
-        // Update uniform buffer with NPC3's MVP
-        QMatrix4x4 npcMVP = mProjectionMatrix * mViewMatrix * npcMatrix;
-        
-        // Use dedicated NPC3 buffer
-        VkDeviceSize npcOffset3 = mNPCUniformBufferInfo3[mWindow->currentFrame()].offset;
-        err = mDeviceFunctions->vkMapMemory(dev, mBufferMemory, npcOffset3,
-                                         UNIFORM_DATA_SIZE, 0, reinterpret_cast<void **>(&GPUmemPointer));
-        if (err != VK_SUCCESS) {
-            qDebug() << "Failed to map memory for NPC3 uniform buffer! Error:" << err;
-        } else {
-            memcpy(GPUmemPointer, npcMVP.constData(), 16 * sizeof(float));
-            mDeviceFunctions->vkUnmapMemory(dev, mBufferMemory);
-            
-            // Use dedicated NPC3 descriptor set
-            mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
-                                                   &mNPCDescriptorSet3[mWindow->currentFrame()], 0, nullptr);
-            
-            // Bind the CrateCube model buffer
-            // Add null check for CrateCube buffer
-            if (mCrateCubeBuffer != VK_NULL_HANDLE) {
-                VkDeviceSize npcVertexOffset = 0;
-                mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mCrateCubeBuffer, &npcVertexOffset);
-                
-                // If the crate cube has an index buffer, use indexed drawing
-                if (mCrateCubeIndexBuffer != VK_NULL_HANDLE && mCrateCubeIndexCount > 0) {
-                    mDeviceFunctions->vkCmdBindIndexBuffer(cb, mCrateCubeIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
-                    mDeviceFunctions->vkCmdDrawIndexed(cb, mCrateCubeIndexCount, 1, 0, 0, 0);
-                } else {
-                    // Fallback to non-indexed drawing if needed
-                    mDeviceFunctions->vkCmdDraw(cb, 36, 1, 0, 0);  // 36 vertices for cube
-                }
-            } else {
-                // Fallback to original NPC buffer if CrateCube buffer is null
-                VkDeviceSize npcVertexOffset = 0;
-                mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mNPCBuffer3, &npcVertexOffset);
-                mDeviceFunctions->vkCmdDraw(cb, 36, 1, 0, 0);  // 36 vertices for cube
-                qDebug() << "WARNING: Using fallback NPC buffer for NPC 2 - CrateCube buffer was null";
-            }
-            
-            renderedNPCs++;
-            qDebug() << "Drew NPC 2 (CrateCube) at position" << mNPCs[2].position;
-        }
-    }
-    
-    qDebug() << "Drew" << renderedNPCs << "NPCs using CrateCube model";
 
-    // Draw game over overlay if player has lost
-    if (mGameLost) {
-        // Draw a text message on screen (window title will still show you lost)
-        qDebug() << "\n*************************************************";
-        qDebug() << "*************** GAME OVER! YOU LOST! **************";
-        qDebug() << "***    You can press R to restart the game     ***";
-        qDebug() << "*************************************************\n";
-    }
-    
-    // Draw house components
-    // Create and update house matrix
-    QMatrix4x4 houseMatrix;
-    houseMatrix.setToIdentity();
-    // Position the house at a fixed location
-    houseMatrix.translate(mHousePosition);  // Place the house in the corner of the map
-    QMatrix4x4 houseMVP = mProjectionMatrix * mViewMatrix * houseMatrix;
-
-    // Update house uniform buffer
-    err = mDeviceFunctions->vkMapMemory(dev, mBufferMemory, mHouseUniformBufferInfo[mWindow->currentFrame()].offset,
-                                     UNIFORM_DATA_SIZE, 0, reinterpret_cast<void **>(&GPUmemPointer));
-    if (err != VK_SUCCESS) {
-        qDebug() << "Failed to map memory for house uniform buffer! Error:" << err;
-    } else {
-        memcpy(GPUmemPointer, houseMVP.constData(), 16 * sizeof(float));
-        mDeviceFunctions->vkUnmapMemory(dev, mBufferMemory);
-
-        // Bind house descriptor set
-        mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
-                                               &mHouseDescriptorSet[mWindow->currentFrame()], 0, nullptr);
-
-        // Draw house walls
-        VkDeviceSize houseWallsOffset = 0;
-        mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mHouseWallsBuffer, &houseWallsOffset);
-        mDeviceFunctions->vkCmdDraw(cb, 36, 1, 0, 0);  // 36 vertices for walls (6 faces * 6 vertices)
-
-        // Draw house door
-        VkDeviceSize houseDoorOffset = 0;
-        mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mHouseDoorBuffer, &houseDoorOffset);
-        mDeviceFunctions->vkCmdDraw(cb, 6, 1, 0, 0);  // 6 vertices for door
-        
-        // Debug output for door state
-        if (mDoorOpen) {
-            qDebug() << "Drew house door in OPEN position";
-        } else {
-            qDebug() << "Drew house door in CLOSED position";
-        }
+    LOG_TRACE(Render, "Drew {} NPCs using CrateCube model ({} to {})", renderedNPCs, begin, end);
+}
 
-        // Draw house roof
-        VkDeviceSize houseRoofOffset = 0;
-        mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mHouseRoofBuffer, &houseRoofOffset);
-        mDeviceFunctions->vkCmdDraw(cb, 12, 1, 0, 0);  // 12 vertices for roof (4 triangles * 3 vertices)
+void RenderWindow::submitQueue(VkCommandBuffer cb, RenderQueue &queue, RecordCounters &counters)
+{
+    // The one set all the queued draws index into
+    bindObjectSet(cb);
+    counters.descriptorBinds++;
+
+    // Every queued draw wrote its transform row when it was added
+    counters.uniformBytes += uint64_t(queue.size()) * BindlessSet::TRANSFORM_SIZE;
+    queue.sort();
+    const RenderQueue::Stats stats = queue.submit(cb, mDeviceFunctions, mPipelineLayout, mScenePipeline);
+    counters.drawCalls += stats.drawCalls;
+    counters.pipelineBinds += stats.pipelineBinds;
+    counters.vertexBinds += stats.vertexBinds;
+    counters.skippedBinds += stats.skippedBinds;
+}
 
-        qDebug() << "Drew house at position" << mHousePosition;
-    }
+void RenderWindow::addRecordCounters(const RecordCounters &counters)
+{
+    mFrameStats.drawCalls += counters.drawCalls;
+    mFrameStats.descriptorBinds += counters.descriptorBinds;
+    mFrameStats.pipelineBinds += counters.pipelineBinds;
+    mFrameStats.vertexBinds += counters.vertexBinds;
+    mFrameStats.skippedBinds += counters.skippedBinds;
+    mFrameStats.uniformBytes += counters.uniformBytes;
 }
 
-void RenderWindow::drawIndoorScene(VkDevice dev, VkCommandBuffer cb, quint8* GPUmemPointer, VkResult& err)
+void RenderWindow::drawIndoorStatic(VkCommandBuffer cb)
 {
+    // The room itself is one profiler region
+    mGpuProfiler.beginRegion(cb, GpuRegion::Indoor);
+
     // Set a different clear color for indoor scene
     VkClearColorValue indoorClearColor = {{ 0.4f, 0.4f, 0.6f, 1.0f }}; // Light blue-gray indoor lighting
     VkClearAttachment clearAttachment = {};
@@ -2055,8 +1303,8 @@ void RenderWindow::drawIndoorScene(VkDevice dev, VkCommandBuffer cb, quint8* GPU
     clearAttachment.clearValue.color = indoorClearColor;
     
     VkClearRect clearRect = {};
-    clearRect.rect.extent.width = mWindow->swapChainImageSize().width();
-    clearRect.rect.extent.height = mWindow->swapChainImageSize().height();
+    clearRect.rect.extent.width = mSceneSize.width();
+    clearRect.rect.extent.height = mSceneSize.height();
     clearRect.layerCount = 1;
     
     // Clear with indoor lighting color
@@ -2067,82 +1315,82 @@ void RenderWindow::drawIndoorScene(VkDevice dev, VkCommandBuffer cb, quint8* GPU
     groundMatrix.setToIdentity();
     // Make the floor dark wood colored by scaling blue component
     groundMatrix.scale(1.0f, 1.0f, 0.5f);
-    QMatrix4x4 groundMVP = mProjectionMatrix * mViewMatrix * groundMatrix;
-
-    // Update uniform buffer for ground
-    VkDeviceSize groundOffset = mUniformBufferInfo[mWindow->currentFrame()].offset;
-    err = mDeviceFunctions->vkMapMemory(dev, mBufferMemory, groundOffset,
-                                        UNIFORM_DATA_SIZE, 0, reinterpret_cast<void **>(&GPUmemPointer));
-    memcpy(GPUmemPointer, groundMVP.constData(), 16 * sizeof(float));
-    mDeviceFunctions->vkUnmapMemory(dev, mBufferMemory);
 
     // Draw indoor floor (reusing ground buffer for simplicity)
-    mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
-                                            &mDescriptorSet[mWindow->currentFrame()], 0, nullptr);
-    VkDeviceSize groundVertexOffset = 0;
-    mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mGroundBuffer, &groundVertexOffset);
-    mDeviceFunctions->vkCmdDraw(cb, 6, 1, 0, 0);  // 6 vertices for ground
+    bindObjectSet(cb);
+    mFrameStats.descriptorBinds++;
+    pushObject(cb, IndoorFloorTransform, GroundMaterial, groundMatrix);
+    drawMesh(cb, mGroundBuffer, mGroundMesh);
+    mFrameStats.drawCalls++;
     
-    qDebug() << "Drew indoor floor";
-    
-    // Draw indoor collectible if not collected
-    if (!mIndoorCollectible.collected) {
+    mGpuProfiler.endRegion(cb, GpuRegion::Indoor);
+
+    LOG_TRACE(Render, "Drew indoor floor");
+}
+
+void RenderWindow::drawIndoorScene(VkCommandBuffer cb)
+{
+    bindObjectSet(cb);
+    mFrameStats.descriptorBinds++;
+
+    // Draw the indoor collectibles (one per room) that are not collected yet
+    mGpuProfiler.beginRegion(cb, GpuRegion::Collectibles);
+    for (int i = 0; i < mIndoorCollectibles.size(); ++i) {
+        const Collectible &indoorCollectible = mIndoorCollectibles[i];
+        if (indoorCollectible.collected)
+            continue;
+
         // Create matrix for this collectible
         QMatrix4x4 collectibleMatrix;
         collectibleMatrix.setToIdentity();
-        collectibleMatrix.translate(mIndoorCollectible.position);
+        collectibleMatrix.translate(indoorCollectible.position);
         // Make collectibles a bit smaller and shinier
         collectibleMatrix.scale(0.5f);
         
-        // Update collectible uniform buffer
-        QMatrix4x4 collectibleMVP = mProjectionMatrix * mViewMatrix * collectibleMatrix;
-        err = mDeviceFunctions->vkMapMemory(dev, mBufferMemory, mCollectibleUniformBufferInfo[mWindow->currentFrame()].offset,
-                                         UNIFORM_DATA_SIZE, 0, reinterpret_cast<void **>(&GPUmemPointer));
-        memcpy(GPUmemPointer, collectibleMVP.constData(), 16 * sizeof(float));
-        mDeviceFunctions->vkUnmapMemory(dev, mBufferMemory);
-        
         // Draw the indoor collectible with golden color
-        mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
-                                                &mCollectibleDescriptorSet[mWindow->currentFrame()], 0, nullptr);
-        VkDeviceSize collectibleVertexOffset = 0;
-        mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mCollectibleBuffer, &collectibleVertexOffset);
-        mDeviceFunctions->vkCmdDraw(cb, 36, 1, 0, 0);  // 36 vertices for cube
+        pushObject(cb, mTransforms.indoorCollectibles + uint32_t(i), CollectibleMaterial, collectibleMatrix);
+        drawMesh(cb, mCollectibleBuffer, mCollectibleMesh);
+        mFrameStats.drawCalls++;
         
-        qDebug() << "Drew special indoor collectible at" << mIndoorCollectible.position;
+        LOG_TRACE(Render, "Drew special indoor collectible at {}", indoorCollectible.position);
     }
+    mGpuProfiler.endRegion(cb, GpuRegion::Collectibles);
 
     // Draw player cube at its current position inside the house
+    mGpuProfiler.beginRegion(cb, GpuRegion::Player);
     QMatrix4x4 playerMatrix;
     playerMatrix.setToIdentity();
     playerMatrix.translate(mPlayerPosition);
-    
-    QMatrix4x4 playerMVP = mProjectionMatrix * mViewMatrix * playerMatrix;
-
-    // Update player's uniform buffer
-    VkDeviceSize playerOffset = mPlayerUniformBufferInfo[mWindow->currentFrame()].offset;
-    err = mDeviceFunctions->vkMapMemory(dev, mBufferMemory, playerOffset,
-                                       UNIFORM_DATA_SIZE, 0, reinterpret_cast<void **>(&GPUmemPointer));
-    memcpy(GPUmemPointer, playerMVP.constData(), 16 * sizeof(float));
-    mDeviceFunctions->vkUnmapMemory(dev, mBufferMemory);
 
     // Draw player cube
-    mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
-                                             &mPlayerDescriptorSet[mWindow->currentFrame()], 0, nullptr);
-    VkDeviceSize playerVertexOffset = 0;
-    mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &mPlayerBuffer, &playerVertexOffset);
-    mDeviceFunctions->vkCmdDraw(cb, 36, 1, 0, 0);  // 36 vertices for cube
+    pushObject(cb, PlayerTransform, PlayerMaterial, playerMatrix);
+    drawMesh(cb, mPlayerBuffer, mPlayerMesh);
+    mFrameStats.drawCalls++;
+    mGpuProfiler.endRegion(cb, GpuRegion::Player);
 
-    qDebug() << "Drew player cube at" << mPlayerPosition << "inside house";
+    LOG_TRACE(Render, "Drew player cube at {} inside house", mPlayerPosition);
 
     // Draw a helpful message to instruct player how to exit
-    qDebug() << "\n*************************************************";
-    qDebug() << "***       YOU ARE INSIDE THE HOUSE           ***";
-    qDebug() << "***    Press 'E' key to exit the house       ***";
-    qDebug() << "*************************************************\n";
+    LOG_INFO_LIMITED(Scene, 1, "YOU ARE INSIDE THE HOUSE - press 'E' key to exit the house");
 }
 
 void RenderWindow::startNextFrame()
 {
+    TRACE_SCOPE_STAGED("startNextFrame");
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+    mFrameStats = FrameStats();
+    mFrameStats.frameIndex = quint64(mFrameCount);
+    // QVulkanWindow has waited for this frame slot: what the frame before in it retired can go
+    mDeletionQueue.beginFrame();
+    // Uploads that finished since the last frame can be drawn from now on
+    mFrameStats.uploadBytes = mUploader.beginFrame();
+    const uint64_t allocationsAtStart = AllocationCounter::allocations();
+    // Fixed 60 Hz NPC steps since the last frame, so throttled frames don't slow the game down
+    const int simulationSteps = mFrameScheduler ? mFrameScheduler->beginFrame() : 1;
+
+    TRACE_BEGIN("simulation");
+
     // First, always check if all collectibles have been collected
     if (mCollectedCount == getTotalCollectibles() && mCollectedCount > 0) {
         // Force the game won state
@@ -2150,10 +1398,7 @@ void RenderWindow::startNextFrame()
             mGameWon = true;
             
             // Display very visible win message 
-            qDebug() << "\n!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!";
-            qDebug() << "!!                YOU WON!                    !!";
-            qDebug() << "!!     ALL COLLECTIBLES FOUND: " << mCollectedCount << " of " << getTotalCollectibles() << "   !!";
-            qDebug() << "!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!";
+            LOG_INFO(Game, "YOU WON! ALL COLLECTIBLES FOUND: {} of {}", mCollectedCount, getTotalCollectibles());
             
             // Update game UI
             if (VulkanWindow* vulkanWindow = qobject_cast<VulkanWindow*>(mWindow)) {
@@ -2163,7 +1408,8 @@ void RenderWindow::startNextFrame()
     }
     
     // Update NPC positions
-    updateNPCs();
+    for (int step = 0; step < simulationSteps; ++step)
+        updateNPCs();
     
     // Check for NPC collisions - reset player if hit
     if (checkNPCCollision()) {
@@ -2196,24 +1442,27 @@ void RenderWindow::startNextFrame()
     if (mGameLost) {
         // You lose message is shown in checkNPCCollision()
     } else if (mGameWon) {
-        // Display win message each frame to ensure it's visible
-        qDebug() << "\n*************************************************";
-        qDebug() << "***               YOU WON!                    ***";
-        qDebug() << "***     All collectibles have been found!     ***";
-        qDebug() << "*************************************************\n";
+        // Repeat the win message now and then to ensure it's visible
+        LOG_INFO_LIMITED(Game, 1, "YOU WON! All collectibles have been found!");
     }
     
-    // Print collection status every 30 frames
-    if (mFrameCount % 30 == 0) {
-        qDebug() << "COLLECTION STATUS: " << mCollectedCount << " of " << getTotalCollectibles() 
-                 << " collected. GameWon=" << (mGameWon ? "true" : "false");
-    }
+    // Print collection status about once per second
+    LOG_DEBUG_LIMITED(Game, 1, "COLLECTION STATUS: {} of {} collected. GameWon={}",
+                      mCollectedCount, getTotalCollectibles(), mGameWon);
     mFrameCount++;
     
     // Always check for win condition (in case it was missed during collection)
     if (!mGameLost && mCollectedCount > 0) {
         checkGameWinCondition();
     }
+
+    // The door may have changed above, and one uploaded before may be there now
+    updateDoorMesh();
+
+    mFrameStats.simMs = frameTimer.nsecsElapsed() / 1.0e6;
+    TRACE_END();
+
+    TRACE_BEGIN("camera and uniforms");
     
     // SIMPLIFIED CAMERA - more angled view to see the scene better
     const QVector3D cameraPos(0.0f, 20.0f, 20.0f);  // Position higher and back to see more
@@ -2223,16 +1472,247 @@ void RenderWindow::startNextFrame()
     QMatrix4x4 viewMatrix;
     viewMatrix.lookAt(cameraPos, cameraTarget, QVector3D(0.0f, 1.0f, 0.0f)); // Use standard Y up direction
 
-    // Create projection matrix
-    QMatrix4x4 projectionMatrix;
-    projectionMatrix.perspective(45.0f, mAspectRatio, 0.1f, 100.0f);
-
+    // The projection only changes with the window size, see updateProjection()
     mViewMatrix = viewMatrix;
-    mProjectionMatrix = projectionMatrix;
 
-    VkDevice dev = mWindow->device();
-    VkCommandBuffer cb = mWindow->currentCommandBuffer();
-    const QSize sz = mWindow->swapChainImageSize();
+    // The camera is the same for every object this frame, with temporal AA moved by this frame's jitter
+    if (mTemporalAA.isInitialized()) {
+        mTemporalAA.beginFrame();
+        // Something other than the settling frames themselves changed the image, it settles from here
+        if (isSimulationRunning() || (mFrameScheduler && (mFrameScheduler->lastDirtyFlags() & ~FrameScheduler::Converge)))
+            mTemporalAAFramesLeft = TemporalAA::SETTLE_FRAMES;
+    }
+    updateViewProjection();
+    // Every object has a transform row, collectibles may have been added since the last frame
+    updateTransformLayout();
+    TRACE_END();
+
+    // Only what the camera can see is recorded. The room indoors is a single draw, nothing to cull.
+    TRACE_BEGIN("cull");
+    const qint64 cullStart = frameTimer.nsecsElapsed();
+    if (mCurrentScene == 1)
+        cullOutdoorScene();
+    mFrameStats.cullMs = (frameTimer.nsecsElapsed() - cullStart) / 1.0e6;
+    TRACE_END();
+
+    VkCommandBuffer cmdBuf = mWindow->currentCommandBuffer();
+
+    // Reads back the GPU timings of the last frame that used this frame slot and resets its queries
+    mGpuProfiler.beginFrame(cmdBuf);
+    mFrameStats.gpu = mGpuProfiler.lastTimings();
+
+    // Dynamic resolution follows the GPU time of the newest frame measured
+    if (mUpscaler.isInitialized() && mFrameStats.gpu.valid && mResolution.update(mFrameStats.gpu.frameMs)) {
+        updateProjection();
+        // Viewports and scissors are baked into the cached scene commands
+        invalidateStaticScenes();
+        // The history was drawn at the old scale, in another part of the images
+        mTemporalAA.resetHistory();
+        mTemporalAAFramesLeft = TemporalAA::SETTLE_FRAMES;
+        LOG_DEBUG(Perf, "Dynamic resolution: scale {} at {} ms GPU time, scene drawn at {}x{}", mResolution.scale(),
+                  mFrameStats.gpu.frameMs, mSceneSize.width(), mSceneSize.height());
+    }
+    mFrameStats.renderScale = mUpscaler.isInitialized() ? mResolution.scale() : 1.0f;
+    mFrameStats.antiAliasing = antiAliasingName(mAntiAliasing);
+    mFrameStats.temporalAA = mTemporalAA.isInitialized();
+    mFrameStats.antiAliasingBytes = mAntiAliasingBytes;
+
+    // The frame is a render graph, recorded into the primary command buffer
+    const qint64 recordStart = frameTimer.nsecsElapsed();
+    TRACE_BEGIN("record");
+    declareFrameGraph();
+    mRenderGraph.compile();
+    mRenderGraph.execute(cmdBuf);
+    mFrameStats.graphPasses = mRenderGraph.stats().passes;
+    mFrameStats.graphBarriers = mRenderGraph.stats().barriers;
+    mGpuProfiler.endFrame(cmdBuf);
+    mFrameStats.recordMs = (frameTimer.nsecsElapsed() - recordStart) / 1.0e6;
+    TRACE_END();
+    
+    // Debug output to confirm submission
+    LOG_TRACE(Render, "Render pass ended, submitting frame...");
+    
+    TRACE_BEGIN("frameReady");
+    mWindow->frameReady();
+    TRACE_END();
+
+    // Resize to the first frame at the new size handed to the presentation engine
+    if (mResizeTimer.isValid()) {
+        const QSize sz = mWindow->swapChainImageSize();
+        mFrameStats.resizeMs = mResizeTimer.nsecsElapsed() / 1.0e6;
+        LOG_INFO(Perf, "Resized to {}x{}: swap chain and resources rebuilt in {} ms, next frame submitted after {} ms",
+                 sz.width(), sz.height(), mResizeRebuildMs, mFrameStats.resizeMs);
+        mResizeTimer.invalidate();
+    }
+
+    // Live entity counts for the statistics
+    int liveCollectibles = 0;
+    for (const Collectible &collectible : mCollectibles)
+        liveCollectibles += collectible.collected ? 0 : 1;
+    for (const Collectible &collectible : mIndoorCollectibles)
+        liveCollectibles += collectible.collected ? 0 : 1;
+    mFrameStats.collectibles = uint32_t(liveCollectibles);
+    mFrameStats.npcs = uint32_t(mNPCs.size());
+    mFrameStats.houses = uint32_t(mHousePositions.size());
+    mFrameStats.frameMs = frameTimer.nsecsElapsed() / 1.0e6;
+
+    // VRAM use changes slowly and the query goes to the driver, so only ask now and then
+    if (mFrameCount % 60 == 1)
+        mVramBytes = mMemoryBudget.deviceLocalUsage();
+    mFrameStats.vramBytes = mVramBytes;
+    mFrameStats.allocations = AllocationCounter::allocations() - allocationsAtStart;
+
+    // Hand the numbers to the Performance tab
+    if (mFrameStatsRing)
+        mFrameStatsRing->push(mFrameStats);
+
+    if (mBenchmark.addFrame(mFrameStats)) {
+        // Benchmark run is complete - print the summary and quit
+        qInfo().noquote() << mBenchmark.report();
+
+        // Recording scaling: run again with the next thread count
+        if (!mRecordScalingThreads.isEmpty()) {
+            mRecordScalingMs.append(mBenchmark.averageRecordMs());
+            if (mRecordScalingMs.size() < mRecordScalingThreads.size()) {
+                mPendingRecordThreads = mRecordScalingThreads[mRecordScalingMs.size()];
+                mBenchmark.start(mBenchmarkFrames);
+            } else {
+                qInfo().noquote() << FrameBenchmark::recordScalingReport(mRecordScalingThreads, mRecordScalingMs);
+            }
+        }
+        if (!mBenchmark.isRunning()) {
+            QCoreApplication::quit();
+            return;
+        }
+    }
+
+    // Ask for the next frame only while something moves or changed (see FrameScheduler).
+    // Temporal AA only blends in frames that are rendered, a still scene needs a few more of them
+    // or it rests on the few jittered frames since the change.
+    if (mFrameScheduler && mTemporalAA.isInitialized() && mTemporalAAFramesLeft > 0) {
+        --mTemporalAAFramesLeft;
+        mFrameScheduler->markDirty(FrameScheduler::Converge);
+    }
+    if (mFrameScheduler)
+        mFrameScheduler->endFrame(isSimulationRunning());
+    else
+        mWindow->requestUpdate();
+}
+
+void RenderWindow::declareFrameGraph()
+{
+    mRenderGraph.reset();
+
+    // GPU culling has to finish before the scene pass, whose indirect draw reads its results.
+    // The houses are drawn into the depth pyramid first, so what they hide is culled as well.
+    // The passes are there whenever the culler is, the graph drops them while nothing reads
+    // the results: indoors, or with the culling done on the CPU.
+    RenderGraph::Resource cullResults = 0;
+    if (mGpuCuller.isInitialized()) {
+        cullResults = mRenderGraph.importBuffer("cull results");
+        RenderGraph::Resource pyramid = 0;
+        if (mHiZ.isInitialized()) {
+            const RenderGraph::Resource occluderDepth = mRenderGraph.createImage("occluder depth", mHiZ.depthDesc());
+            pyramid = mRenderGraph.importImage("depth pyramid", mHiZ.pyramidImage(), VK_IMAGE_ASPECT_COLOR_BIT,
+                                               HiZPyramid::LEVEL_COUNT);
+
+            const RenderGraph::Pass occluders = mRenderGraph.addPass("occluders", [this, occluderDepth](VkCommandBuffer cb) {
+                if (mHiZDepthGeneration != mRenderGraph.generation()) {
+                    mHiZ.setDepth(mRenderGraph.view(occluderDepth));
+                    mHiZDepthGeneration = mRenderGraph.generation();
+                }
+                mGpuProfiler.beginRegion(cb, GpuRegion::Occluders);
+                mHiZ.beginOccluders(cb);
+                drawOccluders(cb);
+                mHiZ.endOccluders(cb);
+            });
+            mRenderGraph.write(occluders, occluderDepth, RenderGraph::Access::DepthWrite);
+
+            const RenderGraph::Pass reduce = mRenderGraph.addPass("depth pyramid", [this](VkCommandBuffer cb) {
+                mHiZ.buildPyramid(cb);
+                mGpuProfiler.endRegion(cb, GpuRegion::Occluders);
+            });
+            mRenderGraph.read(reduce, occluderDepth, RenderGraph::Access::ComputeSampled);
+            mRenderGraph.write(reduce, pyramid, RenderGraph::Access::ComputeWrite);
+        }
+
+        const RenderGraph::Pass cull = mRenderGraph.addPass("cull", [this](VkCommandBuffer cb) {
+            mGpuProfiler.beginRegion(cb, GpuRegion::Culling, false);
+            mGpuCuller.recordCull(cb, mFrustum, mHiZ.isInitialized(), mCullEye, mLodPixelsPerUnit / LOD_PIXEL_ERROR);
+            mGpuProfiler.endRegion(cb, GpuRegion::Culling);
+        });
+        if (mHiZ.isInitialized())
+            mRenderGraph.read(cull, pyramid, RenderGraph::Access::ComputeRead);
+        mRenderGraph.write(cull, cullResults, RenderGraph::Access::ComputeWrite);
+    }
+
+    RenderGraph::Pass scene;
+    if (mUpscaler.isInitialized()) {
+        // Dynamic resolution and post-process AA: the scene goes into the graph's target, the
+        // upscale into the swap chain
+        const RenderGraph::Resource sceneColor = mRenderGraph.createImage("scene color", mUpscaler.colorDesc());
+        const RenderGraph::Resource sceneDepth = mRenderGraph.createImage("scene depth", mUpscaler.depthDesc());
+        const bool multisampled = mUpscaler.isMultisampled();
+        const RenderGraph::Resource sceneMsaaColor = multisampled
+                ? mRenderGraph.createImage("scene msaa color", mUpscaler.msaaColorDesc()) : sceneColor;
+
+        scene = mRenderGraph.addPass("scene", [this, sceneColor, sceneDepth, sceneMsaaColor, multisampled](VkCommandBuffer cb) {
+            if (mSceneTargetGeneration != mRenderGraph.generation()) {
+                mUpscaler.setImages(mRenderGraph.view(sceneColor), mRenderGraph.view(sceneDepth),
+                                    multisampled ? mRenderGraph.view(sceneMsaaColor) : VK_NULL_HANDLE,
+                                    mWindow->swapChainImageSize());
+                mTemporalAA.setSceneColor(mRenderGraph.view(sceneColor));
+                mSceneTargetGeneration = mRenderGraph.generation();
+            }
+            recordScenePass(cb);
+        });
+        mRenderGraph.write(scene, sceneColor, RenderGraph::Access::ColorWrite);
+        mRenderGraph.write(scene, sceneDepth, RenderGraph::Access::DepthWrite);
+        if (multisampled)
+            mRenderGraph.write(scene, sceneMsaaColor, RenderGraph::Access::ColorWrite);
+
+        // Temporal AA blends the target into the history, which is what gets scaled up then
+        RenderGraph::Resource upscaleSource = sceneColor;
+        SceneUpscaler::Source source = SceneUpscaler::SceneColor;
+        if (mTemporalAA.isInitialized()) {
+            const int current = mTemporalAA.current();
+            const RenderGraph::Resource history[2] = {
+                mRenderGraph.importImage("taa history 0", mTemporalAA.historyImage(0), VK_IMAGE_ASPECT_COLOR_BIT, 1),
+                mRenderGraph.importImage("taa history 1", mTemporalAA.historyImage(1), VK_IMAGE_ASPECT_COLOR_BIT, 1)
+            };
+            const RenderGraph::Pass resolve = mRenderGraph.addPass("temporal aa", [this](VkCommandBuffer cb) {
+                mGpuProfiler.beginRegion(cb, GpuRegion::Temporal);
+                mTemporalAA.resolve(cb, mSceneSize);
+                mGpuProfiler.endRegion(cb, GpuRegion::Temporal);
+            });
+            mRenderGraph.read(resolve, sceneColor, RenderGraph::Access::FragmentSampled);
+            mRenderGraph.read(resolve, history[mTemporalAA.previous()], RenderGraph::Access::FragmentSampled);
+            mRenderGraph.write(resolve, history[current], RenderGraph::Access::ColorWrite);
+            upscaleSource = history[current];
+            source = current == 0 ? SceneUpscaler::History0 : SceneUpscaler::History1;
+        }
+
+        const RenderGraph::Pass upscale = mRenderGraph.addPass("upscale", [this, source](VkCommandBuffer cb) {
+            recordUpscalePass(cb, source);
+        }, true);
+        mRenderGraph.read(upscale, upscaleSource, RenderGraph::Access::FragmentSampled);
+    } else {
+        // QVulkanWindow's render pass takes care of the swap chain image itself
+        scene = mRenderGraph.addPass("scene", [this](VkCommandBuffer cb) {
+            recordScenePass(cb);
+        }, true);
+    }
+    if (mGpuCulling && mCurrentScene == 1 && mGpuCuller.isInitialized()) {
+        // The draw reads the commands and the vertex shader the visible list, the CPU reads the counts next time
+        mRenderGraph.read(scene, cullResults, RenderGraph::Access::IndirectRead);
+        mRenderGraph.read(scene, cullResults, RenderGraph::Access::VertexRead);
+        mRenderGraph.read(scene, cullResults, RenderGraph::Access::HostRead);
+    }
+}
+
+void RenderWindow::recordScenePass(VkCommandBuffer cb)
+{
+    const QSize sz = mSceneSize;
 
     // Clear screen
     VkClearColorValue clearColor = {{ 0.0f, 1.0f, 0.0f, 1.0f }}; // Changed to bright green for debugging
@@ -2243,58 +1723,129 @@ void RenderWindow::startNextFrame()
 
     VkRenderPassBeginInfo rpBeginInfo = {};
     rpBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    rpBeginInfo.renderPass = mWindow->defaultRenderPass();
-    rpBeginInfo.framebuffer = mWindow->currentFramebuffer();
+    rpBeginInfo.renderPass = mUpscaler.isInitialized() ? mUpscaler.renderPass() : mWindow->defaultRenderPass();
+    rpBeginInfo.framebuffer = sceneFramebuffer();
     rpBeginInfo.renderArea.extent.width = sz.width();
     rpBeginInfo.renderArea.extent.height = sz.height();
     rpBeginInfo.clearValueCount = 3;
     rpBeginInfo.pClearValues = clearValues;
 
-    VkCommandBuffer cmdBuf = mWindow->currentCommandBuffer();
-    mDeviceFunctions->vkCmdBeginRenderPass(cmdBuf, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    // Set viewport and scissor
-    VkViewport viewport = {};
-    viewport.width = sz.width();
-    viewport.height = sz.height();
-    viewport.minDepth = 0;
-    viewport.maxDepth = 1;
-    mDeviceFunctions->vkCmdSetViewport(cb, 0, 1, &viewport);
-
-    VkRect2D scissor = {};
-    scissor.extent.width = sz.width();
-    scissor.extent.height = sz.height();
-    mDeviceFunctions->vkCmdSetScissor(cb, 0, 1, &scissor);
-
-    // Bind pipeline once for all draws
-    mDeviceFunctions->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipeline);
+    // The whole pass is made of secondary command buffers: the static part of the
+    // scene is replayed from its cache, only the moving objects are recorded again
+    mDeviceFunctions->vkCmdBeginRenderPass(cb, &rpBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+    const int frame = mWindow->currentFrame();
+    const int sceneIndex = mCurrentScene == 1 ? 0 : 1;
+    // Until its variant is built the scene is drawn with one that has fewer features, and
+    // frames keep coming so the switch happens without waiting for input
+    mScenePipeline = mPipelines.pipeline(sceneFeatures());
+    if (!mPipelines.isReady(sceneFeatures()))
+        requestFrame(FrameScheduler::Scene);
+    StaticScene &staticScene = mStaticScene[frame][sceneIndex];
+    if (!staticScene.valid || staticScene.pipeline != mScenePipeline)
+        recordStaticScene(staticScene, sceneIndex);
+    else
+        mGpuProfiler.replayRegions(staticScene.gpuRegions);
+    mFrameStats.drawCalls += staticScene.drawCalls;
+    mFrameStats.descriptorBinds += staticScene.descriptorBinds;
+    mFrameStats.culled += staticScene.culled;
+
+    // Static first - the indoor room starts by clearing the screen
+    mExecuteList.clear();
+    mExecuteList.push_back(staticScene.commandBuffer);
+
+    // Draw the moving part of the appropriate scene based on current scene value.
+    // Big outdoor scenes are recorded on several threads.
+    if (mPendingRecordThreads > 0) {
+        // Other frame slots may still be executing buffers from the old pools, they are destroyed later
+        mRecordThreads = mPendingRecordThreads;
+        mPendingRecordThreads = 0;
+        mRecorder.release(&mDeletionQueue);
+        mRecorder.init(mWindow, mDeviceFunctions, mRecordThreads);
+    }
+    mRecorder.beginFrame();
+    // Below a few hundred objects waking the threads costs more than recording on one
+    const int PARALLEL_RECORD_MIN_OBJECTS = 512;
+    const bool recordInParallel = mCurrentScene == 1 && mRecorder.threadCount() > 1
+                               && mVisibleCollectibles.size() + mVisibleNPCs.size() >= size_t(PARALLEL_RECORD_MIN_OBJECTS);
+    if (recordInParallel) {
+        drawOutdoorSceneParallel(mExecuteList);
+    } else {
+        VkCommandBuffer dynamicCb = mDynamicCommandBuffer[frame];
+        beginSecondary(dynamicCb, sceneFramebuffer(), VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        if (mCurrentScene == 1) {
+            // Draw outdoor scene
+            drawOutdoorScene(dynamicCb);
+        } else {
+            // Draw indoor scene
+            drawIndoorScene(dynamicCb);
+        }
 
-    // Initialize memory pointer and error variable once at the beginning of the function
-    quint8* GPUmemPointer = nullptr;
-    VkResult err = VK_SUCCESS;
+        // With the offscreen scene target the overlay comes after the upscale
+        if (!mUpscaler.isInitialized())
+            recordOverlay(dynamicCb);
 
-    // Draw the appropriate scene based on current scene value
-    if (mCurrentScene == 1) {
-        // Draw outdoor scene
-        drawOutdoorScene(dev, cb, GPUmemPointer, err);
-    } else {
-        // Draw indoor scene
-        drawIndoorScene(dev, cb, GPUmemPointer, err);
+        endSecondary(dynamicCb);
+        mExecuteList.push_back(dynamicCb);
     }
+    mFrameStats.recordThreads = uint32_t(recordInParallel ? mRecorder.threadCount() : 1);
+
+    mDeviceFunctions->vkCmdExecuteCommands(cb, uint32_t(mExecuteList.size()), mExecuteList.data());
     
     // Debug output to confirm render pass status
-    qDebug() << "Ending render pass and submitting draw commands...";
+    LOG_TRACE(Render, "Ending render pass and submitting draw commands...");
     
     // End render pass
-    mDeviceFunctions->vkCmdEndRenderPass(cmdBuf);
-    
-    // Debug output to confirm submission
-    qDebug() << "Render pass ended, submitting frame...";
-    
-    mWindow->frameReady();
-    mWindow->requestUpdate();
+    mDeviceFunctions->vkCmdEndRenderPass(cb);
 }
 
+void RenderWindow::recordUpscalePass(VkCommandBuffer cb, SceneUpscaler::Source source)
+{
+    const QSize sz = mWindow->swapChainImageSize();
+
+    // The upscale covers every pixel, the clear is only there because the render pass asks for it
+    VkClearValue clearValues[3];
+    memset(clearValues, 0, sizeof(clearValues));
+    clearValues[1].depthStencil = { 1.0f, 0 };
+
+    VkRenderPassBeginInfo rpBeginInfo = {};
+    rpBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    rpBeginInfo.renderPass = mWindow->defaultRenderPass();
+    rpBeginInfo.framebuffer = mWindow->currentFramebuffer();
+    rpBeginInfo.renderArea.extent.width = sz.width();
+    rpBeginInfo.renderArea.extent.height = sz.height();
+    rpBeginInfo.clearValueCount = 3;
+    rpBeginInfo.pClearValues = clearValues;
+    mDeviceFunctions->vkCmdBeginRenderPass(cb, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    mGpuProfiler.beginRegion(cb, GpuRegion::Upscale);
+    mUpscaler.upscale(cb, mSceneSize, sz, source);
+    mGpuProfiler.endRegion(cb, GpuRegion::Upscale);
+    // At the window's own resolution, on top of the scaled scene
+    recordOverlay(cb);
+
+    mDeviceFunctions->vkCmdEndRenderPass(cb);
+}
+
+void RenderWindow::recordOverlay(VkCommandBuffer cb)
+{
+    // Overlay region (game over screen / HUD) - measured even while it has no draws
+    mGpuProfiler.beginRegion(cb, GpuRegion::Overlay);
+    mGpuProfiler.endRegion(cb, GpuRegion::Overlay);
+}
+
+void RenderWindow::requestFrame(uint32_t reason)
+{
+    if (mFrameScheduler)
+        mFrameScheduler->markDirty(reason);
+    else if (mWindow)
+        mWindow->requestUpdate();
+}
+
+bool RenderWindow::isSimulationRunning() const
+{
+    return !mGameLost && !mGameWon && !mNPCsPaused && !mNPCs.isEmpty();
+}
 
 VkShaderModule RenderWindow::createShader(const QString &name)
 {
@@ -2323,6 +1874,59 @@ VkShaderModule RenderWindow::createShader(const QString &name)
     return shaderModule;
 }
 
+static QString pipelineCachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/pipelines.bin");
+}
+
+QByteArray RenderWindow::loadPipelineCache() const
+{
+    QFile file(pipelineCachePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    const QByteArray data = file.readAll();
+
+    // The driver checks the header too, but data of another GPU or driver is better not handed over at all
+    const VkPhysicalDeviceProperties *properties = mWindow->physicalDeviceProperties();
+    uint32_t header[4] = {};
+    if (size_t(data.size()) < sizeof(header) + VK_UUID_SIZE)
+        return QByteArray();
+    memcpy(header, data.constData(), sizeof(header));
+    if (header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || header[2] != properties->vendorID
+            || header[3] != properties->deviceID
+            || memcmp(data.constData() + sizeof(header), properties->pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        LOG_INFO(Vulkan, "Pipeline cache of another device or driver, starting empty");
+        return QByteArray();
+    }
+    LOG_INFO(Vulkan, "Pipeline cache: {} bytes from the last run", data.size());
+    return data;
+}
+
+void RenderWindow::savePipelineCache()
+{
+    size_t size = 0;
+    VkResult err = mDeviceFunctions->vkGetPipelineCacheData(mWindow->device(), mPipelineCache, &size, nullptr);
+    if (err != VK_SUCCESS || size == 0)
+        return;
+    QByteArray data(qsizetype(size), Qt::Uninitialized);
+    err = mDeviceFunctions->vkGetPipelineCacheData(mWindow->device(), mPipelineCache, &size, data.data());
+    if (err != VK_SUCCESS)
+        return;
+    data.resize(qsizetype(size));
+
+    const QString path = pipelineCachePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit())
+        LOG_WARNING(Vulkan, "Could not save the pipeline cache to {}", path);
+}
+
+PipelineVariants::Features RenderWindow::sceneFeatures() const
+{
+    // The room indoors is small, fog would only tint it
+    return mCurrentScene == 1 && mFog ? PipelineVariants::Fog : 0;
+}
+
 void RenderWindow::getVulkanHWInfo()
 {
     qDebug("\n ***************************** Vulkan Hardware Info ******************************************* \n");
@@ -2372,21 +1976,45 @@ void RenderWindow::getVulkanHWInfo()
 void RenderWindow::releaseSwapChainResources()
 {
     qDebug("\n ***************************** releaseSwapChainResources ******************************************* \n");
-    // Nothing specific to release in swap chain resources
-    // This method is called when the swap chain is being recreated,
-    // such as when the window is resized
+    // Also called before releaseResources() when the window closes, the timer is only read by the next frame
+    mResizeTimer.start();
+    // QVulkanWindow has waited for the device, the graph images that follow the size can go without another wait
+    mRenderGraph.releaseSizeDependent();
 }
 
 void RenderWindow::releaseResources()
 {
+    TRACE_SCOPE("releaseResources");
     qDebug("\n ***************************** releaseResources ******************************************* \n");
 
     VkDevice dev = mWindow->device();
 
-    if (mPipeline) {
-        mDeviceFunctions->vkDestroyPipeline(dev, mPipeline, nullptr);
-        mPipeline = VK_NULL_HANDLE;
-    }
+    // Before the buffers it copies into
+    mUploader.release();
+    mGpuProfiler.release();
+    mRecorder.release();
+    mGpuCuller.release();
+    mHiZ.release();
+    mUpscaler.release();
+    mTemporalAA.release();
+    mSceneTargetGeneration = ~0u;
+    mRenderGraph.release();
+    mHiZDepthGeneration = ~0u;
+
+    // Frees every secondary command buffer allocated from it
+    if (mSecondaryCommandPool) {
+        mDeviceFunctions->vkDestroyCommandPool(dev, mSecondaryCommandPool, nullptr);
+        mSecondaryCommandPool = VK_NULL_HANDLE;
+    }
+    for (int frame = 0; frame < QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT; ++frame) {
+        mDynamicCommandBuffer[frame] = VK_NULL_HANDLE;
+        for (StaticScene &staticScene : mStaticScene[frame])
+            staticScene = StaticScene();
+    }
+
+    // Waits for a variant still being built, it goes into the cache as well
+    mPipelines.release();
+    mScenePipeline = VK_NULL_HANDLE;
 
     if (mPipelineLayout) {
         mDeviceFunctions->vkDestroyPipelineLayout(dev, mPipelineLayout, nullptr);
@@ -2394,21 +2022,12 @@ void RenderWindow::releaseResources()
     }
 
     if (mPipelineCache) {
+        savePipelineCache();
         mDeviceFunctions->vkDestroyPipelineCache(dev, mPipelineCache, nullptr);
         mPipelineCache = VK_NULL_HANDLE;
     }
 
-    if (mDescriptorSetLayout) {
-        mDeviceFunctions->vkDestroyDescriptorSetLayout(dev, mDescriptorSetLayout, nullptr);
-        mDescriptorSetLayout = VK_NULL_HANDLE;
-    }
-
-    if (mDescriptorPool) {
-        // Note: Destroying the descriptor pool automatically frees all descriptor sets
-        // allocated from it (both mDescriptorSet and mPlayerDescriptorSet)
-        mDeviceFunctions->vkDestroyDescriptorPool(dev, mDescriptorPool, nullptr);
-        mDescriptorPool = VK_NULL_HANDLE;
-    }
+    mBindless.release();
 
     if (mBuffer) {
         mDeviceFunctions->vkDestroyBuffer(dev, mBuffer, nullptr);
@@ -2502,15 +2121,15 @@ void RenderWindow::releaseResources()
         mHouseWallsBufferMemory = VK_NULL_HANDLE;
     }
 
-    if (mHouseDoorBuffer) {
-        mDeviceFunctions->vkDestroyBuffer(dev, mHouseDoorBuffer, nullptr);
-        mHouseDoorBuffer = VK_NULL_HANDLE;
-    }
-
-    if (mHouseDoorBufferMemory) {
-        mDeviceFunctions->vkFreeMemory(dev, mHouseDoorBufferMemory, nullptr);
-        mHouseDoorBufferMemory = VK_NULL_HANDLE;
-    }
+    // The door and whatever else was created while running, then what waits for frames that are done now
+    mRuntimeBuffers.forEach([this, dev](RuntimeBuffer &runtimeBuffer) {
+        mDeviceFunctions->vkDestroyBuffer(dev, runtimeBuffer.buffer, nullptr);
+        mDeviceFunctions->vkFreeMemory(dev, runtimeBuffer.memory, nullptr);
+    });
+    mRuntimeBuffers.clear();
+    mDoorBuffer = mDoorUploadBuffer = RuntimeBufferHandle();
+    mDoorUpload = 0;
+    mDeletionQueue.release();
 
     if (mHouseRoofBuffer) {
         mDeviceFunctions->vkDestroyBuffer(dev, mHouseRoofBuffer, nullptr);
@@ -2522,12 +2141,6 @@ void RenderWindow::releaseResources()
         mHouseRoofBufferMemory = VK_NULL_HANDLE;
     }
 
-    // Free house descriptor sets
-    if (mHouseDescriptorSet[0]) {
-        mDeviceFunctions->vkFreeDescriptorSets(dev, mDescriptorPool, 1, mHouseDescriptorSet);
-        mHouseDescriptorSet[0] = VK_NULL_HANDLE;
-    }
-
     // Free NPC buffers
     if (mNPCBuffer3 != VK_NULL_HANDLE) {
         mDeviceFunctions->vkDestroyBuffer(dev, mNPCBuffer3, nullptr);
@@ -2547,14 +2160,6 @@ void RenderWindow::releaseResources()
         mDeviceFunctions->vkFreeMemory(dev, mCrateCubeBufferMemory, nullptr);
         mCrateCubeBufferMemory = VK_NULL_HANDLE;
     }
-    if (mCrateCubeIndexBuffer != VK_NULL_HANDLE) {
-        mDeviceFunctions->vkDestroyBuffer(dev, mCrateCubeIndexBuffer, nullptr);
-        mCrateCubeIndexBuffer = VK_NULL_HANDLE;
-    }
-    if (mCrateCubeIndexBufferMemory != VK_NULL_HANDLE) {
-        mDeviceFunctions->vkFreeMemory(dev, mCrateCubeIndexBufferMemory, nullptr);
-        mCrateCubeIndexBufferMemory = VK_NULL_HANDLE;
-    }
 
     qDebug() << "Renderer resources released";
 
@@ -2567,19 +2172,30 @@ void RenderWindow::initializeCollectibles()
     mCollectibles.clear();
     mCollectedCount = 0;
 
-    // Create collectibles in a grid with HIGHER POSITION
-    // Making them clearly visible on the larger ground plane
-    mCollectibles.append(Collectible(QVector3D(-6.0f, 1.5f, -6.0f)));   // Top left
-    mCollectibles.append(Collectible(QVector3D(0.0f, 1.5f, -6.0f)));    // Top center
-    mCollectibles.append(Collectible(QVector3D(6.0f, 1.5f, -6.0f)));    // Top right
-    mCollectibles.append(Collectible(QVector3D(-6.0f, 1.5f, 6.0f)));    // Bottom left
-    mCollectibles.append(Collectible(QVector3D(0.0f, 1.5f, 6.0f)));     // Bottom center
-    mCollectibles.append(Collectible(QVector3D(6.0f, 1.5f, 6.0f)));     // Bottom right
+    // Outdoor collectibles come from the scene description
+    // (the default scene has the original grid of 6, high up so they are clearly visible)
+    mCollectibles.reserve(mScene.collectibles.size());
+    for (const QVector3D &position : mScene.collectibles)
+        mCollectibles.append(Collectible(position));
+
+    // Restarting shows the collected ones again
+    if (mGpuCulling && mGpuCuller.isInitialized())
+        updateGpuInstances();
+
+    // Collectibles never move, their bounding spheres are set once
+    mCollectibleBounds.resize(size_t(mCollectibles.size()));
+    for (int i = 0; i < mCollectibles.size(); ++i) {
+        mCollectibleBounds.set(size_t(i), mCollectibles[i].position + mCollectibleMeshBounds.center * COLLECTIBLE_SCALE,
+                               mCollectibleMeshBounds.radius * COLLECTIBLE_SCALE);
+    }
 
-    // Reset the indoor collectible to not collected
-    mIndoorCollectible.collected = false;
+    // One special collectible per indoor room, all reset to not collected
+    mIndoorCollectibles.clear();
+    mIndoorCollectibles.reserve(mScene.indoorCollectibles.size());
+    for (const QVector3D &position : mScene.indoorCollectibles)
+        mIndoorCollectibles.append(Collectible(position));
 
-    qDebug() << "Initialized 6 outdoor and 1 indoor collectibles";
+    qDebug() << "Initialized" << mCollectibles.size() << "outdoor and" << mIndoorCollectibles.size() << "indoor collectibles";
 }
 
 void RenderWindow::checkCollectibleCollisions()
@@ -2598,18 +2214,19 @@ void RenderWindow::checkCollectibleCollisions()
             if (distance < collectionDistance) {
                 // Collect the item
                 mCollectibles[i].collected = true;
+                if (mGpuCulling && size_t(i) < mGpuCuller.instances().size()) {
+                    mGpuCuller.instances()[size_t(i)].mesh = GpuCuller::HIDDEN;
+                    mGpuCuller.markInstancesDirty(size_t(i), 1);
+                }
                 mCollectedCount++;
                 collectedAny = true;
-                qDebug() << "COLLECTED: item at position" << mCollectibles[i].position << "!"
-                         << mCollectedCount << "of" << getTotalCollectibles() << "collected";
+                LOG_INFO(Game, "Collected item at {}, {} of {} collected", mCollectibles[i].position,
+                         mCollectedCount, getTotalCollectibles());
                 
                 // Check if all collectibles are collected immediately - set game won state
                 if (mCollectedCount == getTotalCollectibles()) {
                     mGameWon = true;
-                    qDebug() << "\n*************************************************";
-                    qDebug() << "***               YOU WON!                    ***";
-                    qDebug() << "***     All collectibles have been found!     ***";
-                    qDebug() << "*************************************************\n";
+                    LOG_INFO(Game, "YOU WON! All collectibles have been found!");
                     
                     // Update UI to show win status
                     if (VulkanWindow* vulkanWindow = qobject_cast<VulkanWindow*>(mWindow)) {
@@ -2622,73 +2239,543 @@ void RenderWindow::checkCollectibleCollisions()
     
     if (collectedAny) {
         // Force an immediate update of the UI when a collectible is collected
-        if (mWindow) {
-            mWindow->requestUpdate();
-        }
+        requestFrame(FrameScheduler::Simulation);
     }
 }
 
-void RenderWindow::updateUniformBuffer(VkDescriptorBufferInfo &bufferInfo, const QMatrix4x4 &matrix)
+void RenderWindow::updateViewProjection()
 {
     VkDevice dev = mWindow->device();
-    QMatrix4x4 mvp = mProjectionMatrix * mViewMatrix * matrix;
-    
-    // Check if bufferInfo is valid
-    if (!bufferInfo.buffer) {
-        qDebug() << "WARNING: Invalid buffer in updateUniformBuffer - buffer is null";
+    QMatrix4x4 viewProjection = mProjectionMatrix * mViewMatrix;
+    // Temporal AA: the clip space offset is scaled by w, which shifts the projected image by the
+    // same fraction of a pixel everywhere. Only the drawing sees it, culling keeps the plain matrix.
+    if (mTemporalAA.isInitialized()) {
+        const QPointF jitter = mTemporalAA.jitter(mSceneSize);
+        QMatrix4x4 offset;
+        offset.translate(float(jitter.x()), float(jitter.y()));
+        viewProjection = offset * viewProjection;
+    }
+    
+    // Check if the uniform buffer is valid
+    if (mBuffer == VK_NULL_HANDLE) {
+        qDebug() << "WARNING: Invalid buffer in updateViewProjection - buffer is null";
         return;
     }
+
+    // Every object shares the camera, its frame slot is the only uniform written
+    const VkDescriptorBufferInfo &slot = mUniformBufferInfo[mWindow->currentFrame()];
     
     quint8* GPUmemPointer;
-    VkResult err = mDeviceFunctions->vkMapMemory(dev, mBufferMemory, bufferInfo.offset,
-                                             UNIFORM_DATA_SIZE, 0, reinterpret_cast<void **>(&GPUmemPointer));
+    VkResult err = mDeviceFunctions->vkMapMemory(dev, mBufferMemory, slot.offset, slot.range, 0,
+                                                 reinterpret_cast<void **>(&GPUmemPointer));
     if (err != VK_SUCCESS) {
         qDebug() << "Failed to map memory for uniform buffer! Error:" << err;
         return;
     }
     
-    memcpy(GPUmemPointer, mvp.constData(), 16 * sizeof(float));
+    memcpy(GPUmemPointer, viewProjection.constData(), 16 * sizeof(float));
+    mFrameStats.uniformBytes += 16 * sizeof(float);
     mDeviceFunctions->vkUnmapMemory(dev, mBufferMemory);
 }
 
+void RenderWindow::drawMesh(VkCommandBuffer cb, VkBuffer buffer, const PackedMesh &mesh, int level) const
+{
+    const VkDeviceSize vertexOffset = 0;
+    mDeviceFunctions->vkCmdBindVertexBuffers(cb, 0, 1, &buffer, &vertexOffset);
+    mDeviceFunctions->vkCmdBindIndexBuffer(cb, buffer, mesh.indexOffset(), VK_INDEX_TYPE_UINT16);
+    const LodLevel &lod = mesh.levels[size_t(level)];
+    mDeviceFunctions->vkCmdDrawIndexed(cb, lod.indexCount, 1, lod.firstIndex, 0, 0);
+}
+
+void RenderWindow::bindObjectSet(VkCommandBuffer cb)
+{
+    const VkDescriptorSet set = mBindless.set(mWindow->currentFrame());
+    mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1, &set,
+                                              0, nullptr);
+}
+
+void RenderWindow::pushObject(VkCommandBuffer cb, uint32_t transform, uint32_t material, const QMatrix4x4 &model)
+{
+    // The matrix goes into the object's row of this frame slot, the draw only carries the indices
+    mBindless.setTransform(mWindow->currentFrame(), transform, model);
+    mFrameStats.uniformBytes += BindlessSet::TRANSFORM_SIZE;
+    const BindlessSet::DrawIndices indices = { transform, material };
+    mDeviceFunctions->vkCmdPushConstants(cb, mPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(indices),
+                                         &indices);
+}
+
+void RenderWindow::updateTransformLayout()
+{
+    // Rows of the objects that stay put come first: they keep their index while
+    // collectibles are added, and the cached static scenes stay valid
+    mTransforms.houses = FIXED_TRANSFORM_COUNT;
+    mTransforms.collectibles = mTransforms.houses + uint32_t(mHousePositions.size());
+    mTransforms.npcs = mTransforms.collectibles + uint32_t(mCollectibles.size());
+    mTransforms.indoorCollectibles = mTransforms.npcs + uint32_t(mNPCs.size());
+    mTransforms.portalCollectibles = mTransforms.indoorCollectibles + uint32_t(mIndoorCollectibles.size());
+    mTransforms.count = mTransforms.portalCollectibles + uint32_t(mIndoorCollectibles.size());
+
+    // Only the current frame slot's buffer grows, its static scenes are the ones that bound the old one
+    const int frame = mWindow->currentFrame();
+    if (mBindless.isInitialized() && mBindless.reserveTransforms(frame, mTransforms.count, mDeletionQueue)) {
+        for (StaticScene &staticScene : mStaticScene[frame])
+            staticScene.valid = false;
+    }
+}
+
+RenderWindow::RuntimeBufferHandle RenderWindow::createRuntimeBuffer(VkDeviceSize size, VkBufferUsageFlags usage)
+{
+    VkDevice dev = mWindow->device();
+    RuntimeBuffer runtimeBuffer;
+
+    VkBufferCreateInfo bufferInfo;
+    memset(&bufferInfo, 0, sizeof(bufferInfo));
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    mUploader.prepareBuffer(bufferInfo);
+    VkResult err = mDeviceFunctions->vkCreateBuffer(dev, &bufferInfo, nullptr, &runtimeBuffer.buffer);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create runtime buffer: %d", err);
+
+    VkMemoryRequirements memReq;
+    mDeviceFunctions->vkGetBufferMemoryRequirements(dev, runtimeBuffer.buffer, &memReq);
+    VkMemoryAllocateInfo allocInfo;
+    memset(&allocInfo, 0, sizeof(allocInfo));
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReq.size;
+    allocInfo.memoryTypeIndex = mWindow->deviceLocalMemoryIndex();
+    err = mDeviceFunctions->vkAllocateMemory(dev, &allocInfo, nullptr, &runtimeBuffer.memory);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to allocate runtime buffer memory: %d", err);
+
+    err = mDeviceFunctions->vkBindBufferMemory(dev, runtimeBuffer.buffer, runtimeBuffer.memory, 0);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to bind runtime buffer memory: %d", err);
+
+    return mRuntimeBuffers.add(runtimeBuffer);
+}
+
+void RenderWindow::destroyRuntimeBuffer(RuntimeBufferHandle &handle)
+{
+    // Frames in flight may still draw from it, the handle is stale right away
+    RuntimeBuffer runtimeBuffer;
+    if (mRuntimeBuffers.remove(handle, runtimeBuffer)) {
+        mDeletionQueue.destroyBuffer(runtimeBuffer.buffer);
+        mDeletionQueue.freeMemory(runtimeBuffer.memory);
+    }
+    handle = RuntimeBufferHandle();
+}
+
+void RenderWindow::createSecondaryCommandBuffers()
+{
+    VkDevice dev = mWindow->device();
+
+    // Own pool, so single command buffers can be reset and re-recorded
+    VkCommandPoolCreateInfo poolInfo;
+    memset(&poolInfo, 0, sizeof(poolInfo));
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = mWindow->graphicsQueueFamilyIndex();
+    VkResult err = mDeviceFunctions->vkCreateCommandPool(dev, &poolInfo, nullptr, &mSecondaryCommandPool);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create secondary command pool: %d", err);
+
+    // Per frame slot: one dynamic buffer plus one static buffer for each scene
+    const int concurrentFrameCount = mWindow->concurrentFrameCount();
+    for (int frame = 0; frame < concurrentFrameCount; ++frame) {
+        VkCommandBuffer buffers[1 + STATIC_SCENE_COUNT];
+        VkCommandBufferAllocateInfo allocInfo;
+        memset(&allocInfo, 0, sizeof(allocInfo));
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = mSecondaryCommandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1 + STATIC_SCENE_COUNT;
+        err = mDeviceFunctions->vkAllocateCommandBuffers(dev, &allocInfo, buffers);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to allocate secondary command buffers: %d", err);
+
+        mDynamicCommandBuffer[frame] = buffers[0];
+        for (int scene = 0; scene < STATIC_SCENE_COUNT; ++scene) {
+            mStaticScene[frame][scene] = StaticScene();
+            mStaticScene[frame][scene].commandBuffer = buffers[1 + scene];
+        }
+    }
+}
+
+void RenderWindow::beginSecondary(VkCommandBuffer cb, VkFramebuffer framebuffer, VkCommandBufferUsageFlags usage)
+{
+    // Secondary command buffers run inside the primary's render pass and inherit none of its state
+    VkCommandBufferInheritanceInfo inheritance;
+    memset(&inheritance, 0, sizeof(inheritance));
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = mUpscaler.isInitialized() ? mUpscaler.renderPass() : mWindow->defaultRenderPass();
+    inheritance.subpass = 0;
+    inheritance.framebuffer = framebuffer;     // May be null - cached buffers are used with every swap chain image
+
+    VkCommandBufferBeginInfo beginInfo;
+    memset(&beginInfo, 0, sizeof(beginInfo));
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = usage | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+    VkResult err = mDeviceFunctions->vkBeginCommandBuffer(cb, &beginInfo);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to begin secondary command buffer: %d", err);
+
+    // Set viewport and scissor - the part of the target the scene is drawn to
+    const QSize sz = mSceneSize;
+    VkViewport viewport = {};
+    viewport.width = sz.width();
+    viewport.height = sz.height();
+    viewport.minDepth = 0;
+    viewport.maxDepth = 1;
+    mDeviceFunctions->vkCmdSetViewport(cb, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.extent.width = sz.width();
+    scissor.extent.height = sz.height();
+    mDeviceFunctions->vkCmdSetScissor(cb, 0, 1, &scissor);
+
+    // Bind pipeline once for all draws
+    mDeviceFunctions->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mScenePipeline);
+}
+
+void RenderWindow::endSecondary(VkCommandBuffer cb)
+{
+    VkResult err = mDeviceFunctions->vkEndCommandBuffer(cb);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to end secondary command buffer: %d", err);
+}
+
+void RenderWindow::recordStaticScene(StaticScene &staticScene, int sceneIndex)
+{
+    TRACE_SCOPE("recordStaticScene");
+
+    // QVulkanWindow has waited for this frame slot's fence, so its buffers are no longer in use
+    mDeviceFunctions->vkResetCommandBuffer(staticScene.commandBuffer, 0);
+    beginSecondary(staticScene.commandBuffer, VK_NULL_HANDLE, 0);
+
+    // Count what goes into the buffer so replays can report it too
+    const uint32_t drawCallsBefore = mFrameStats.drawCalls;
+    const uint32_t descriptorBindsBefore = mFrameStats.descriptorBinds;
+    const uint32_t culledBefore = mFrameStats.culled;
+    if (sceneIndex == 0) {
+        drawOutdoorStatic(staticScene.commandBuffer);
+        staticScene.gpuRegions = (1u << uint32_t(GpuRegion::Ground)) | (1u << uint32_t(GpuRegion::House));
+    } else {
+        drawIndoorStatic(staticScene.commandBuffer);
+        staticScene.gpuRegions = 1u << uint32_t(GpuRegion::Indoor);
+    }
+    staticScene.drawCalls = mFrameStats.drawCalls - drawCallsBefore;
+    staticScene.descriptorBinds = mFrameStats.descriptorBinds - descriptorBindsBefore;
+    staticScene.culled = mFrameStats.culled - culledBefore;
+    mFrameStats.drawCalls = drawCallsBefore;
+    mFrameStats.descriptorBinds = descriptorBindsBefore;
+    mFrameStats.culled = culledBefore;
+
+    endSecondary(staticScene.commandBuffer);
+    staticScene.valid = true;
+    staticScene.pipeline = mScenePipeline;
+
+    LOG_DEBUG(Render, "Recorded static commands of scene {} for frame slot {}", sceneIndex + 1, mWindow->currentFrame());
+}
+
+void RenderWindow::initGpuCulling(const VkGraphicsPipelineCreateInfo &pipelineTemplate)
+{
+    // Meshes stay with the culler, only the Vulkan objects are created again
+    if (mGpuCuller.meshCount() == 0) {
+        // Every level of detail becomes a draw command of its own
+        mGpuCollectibleMesh = mGpuCuller.addMesh(mCollectibleMesh, mCollectibleMeshBounds);
+        mGpuNPCMesh = mGpuCuller.addMesh(mNPCMesh, mNPCMeshBounds);
+    }
+    updateGpuInstances();
+    mHiZ.init(mWindow, mDeviceFunctions, pipelineTemplate, mPipelineCache);
+    mGpuCuller.init(mWindow, mDeviceFunctions, pipelineTemplate, mPipelineCache, mUniformBufferInfo, mHiZ.pyramidInfo());
+}
+
+void RenderWindow::drawOccluders(VkCommandBuffer cb)
+{
+    // Walls and roof of the houses in view. The door is left out, the hole behind it opens.
+    bindObjectSet(cb);
+    mFrameStats.descriptorBinds++;
+    for (int house = 0; house < mHousePositions.size(); ++house) {
+        const QVector3D &housePosition = mHousePositions[house];
+        if (!mFrustum.intersectsBox(housePosition + mHouseMeshBounds.min, housePosition + mHouseMeshBounds.max))
+            continue;
+
+        QMatrix4x4 houseMatrix;
+        houseMatrix.setToIdentity();
+        houseMatrix.translate(housePosition);
+        pushObject(cb, mTransforms.houses + uint32_t(house), HouseMaterial, houseMatrix);
+
+        drawMesh(cb, mHouseWallsBuffer, mHouseWallsMesh);
+        drawMesh(cb, mHouseRoofBuffer, mHouseRoofMesh);
+        mFrameStats.drawCalls += 2;
+    }
+}
+
+void RenderWindow::updateGpuInstances()
+{
+    // Collectibles first, then NPCs - the same order the CPU path draws them in
+    std::vector<GpuCuller::Instance> &instances = mGpuCuller.instances();
+    instances.resize(size_t(mCollectibles.size() + mNPCs.size()));
+    GpuCuller::Instance *instance = instances.data();
+    for (const Collectible &collectible : mCollectibles) {
+        *instance = GpuCuller::Instance();
+        instance->position[0] = collectible.position.x();
+        instance->position[1] = collectible.position.y();
+        instance->position[2] = collectible.position.z();
+        instance->scale = COLLECTIBLE_SCALE;
+        instance->mesh = collectible.collected ? GpuCuller::HIDDEN : mGpuCollectibleMesh;
+        ++instance;
+    }
+    for (const PatrolEnemy &npc : mNPCs) {
+        *instance = GpuCuller::Instance();
+        instance->position[0] = npc.position.x();
+        instance->position[1] = npc.position.y();
+        instance->position[2] = npc.position.z();
+        instance->scale = NPC_SCALE;
+        instance->mesh = mGpuNPCMesh;
+        ++instance;
+    }
+    mGpuCuller.markInstancesDirty();
+    mNPCBoundsDirty = false;
+}
+
+void RenderWindow::drawPortalCells(VkCommandBuffer cb)
+{
+    for (const PortalCuller::VisibleCell &visible : mVisibleCells) {
+        // The camera cell is the outdoor scene itself
+        if (visible.cell != mHouseCell)
+            continue;
+
+        mGpuProfiler.beginRegion(cb, GpuRegion::Indoor);
+
+        // The room of the indoor scene, a little smaller and off the ground so it doesn't
+        // fight with the outer walls and the ground over depth
+        QMatrix4x4 roomMatrix;
+        roomMatrix.setToIdentity();
+        roomMatrix.translate(mHousePosition + QVector3D(0.0f, 0.01f, 0.0f));
+        roomMatrix.scale(0.97f);
+        pushObject(cb, IndoorRoomTransform, IndoorMaterial, roomMatrix);
+        drawMesh(cb, mIndoorWallsBuffer, mIndoorWallsMesh);
+        mFrameStats.drawCalls++;
+
+        // Indoor collectibles of the room around the indoor origin, the one this house
+        // leads to. Only those seen through the doorway are drawn.
+        uint32_t tested = 0;
+        uint32_t drawn = 0;
+        for (int i = 0; i < mIndoorCollectibles.size(); ++i) {
+            const Collectible &collectible = mIndoorCollectibles[i];
+            if (collectible.collected || qAbs(collectible.position.x()) > 3.0f || qAbs(collectible.position.z()) > 3.0f)
+                continue;
+            tested++;
+            const QVector3D position = mHousePosition + collectible.position;
+            if (!visible.volume.intersectsSphere(position + mCollectibleMeshBounds.center * 0.5f,
+                                                 mCollectibleMeshBounds.radius * 0.5f))
+                continue;
+
+            QMatrix4x4 collectibleMatrix;
+            collectibleMatrix.setToIdentity();
+            collectibleMatrix.translate(position);
+            collectibleMatrix.scale(0.5f);
+            pushObject(cb, mTransforms.portalCollectibles + uint32_t(i), CollectibleMaterial, collectibleMatrix);
+            drawMesh(cb, mCollectibleBuffer, mCollectibleMesh);
+            mFrameStats.drawCalls++;
+            drawn++;
+        }
+        mFrameStats.cullTested += tested;
+        mFrameStats.culled += tested - drawn;
+
+        mGpuProfiler.endRegion(cb, GpuRegion::Indoor);
+        LOG_DEBUG_LIMITED(Render, 1, "Portals: house interior seen through the door, {} of {} indoor collectibles visible",
+                          drawn, tested);
+    }
+}
+
+void RenderWindow::cullOutdoorScene()
+{
+    const QMatrix4x4 viewProjection = mProjectionMatrix * mViewMatrix;
+    mFrustum = Frustum::fromViewProjection(viewProjection);
+    mCullEye = mViewMatrix.inverted().map(QVector3D());
+    mPortals.findVisibleCells(mCullEye, mFrustum, mVisibleCells);
+
+    // The houses are culled when the static scene is recorded, so its cached
+    // buffers only stay valid for the camera they were recorded with
+    if (viewProjection != mCullViewProjection) {
+        mCullViewProjection = viewProjection;
+        invalidateStaticScenes();
+    }
+
+    if (mGpuCulling) {
+        // Only moved NPCs are handed over, the culling itself runs on the GPU
+        if (mNPCBoundsDirty) {
+            std::vector<GpuCuller::Instance> &instances = mGpuCuller.instances();
+            const size_t firstNPC = size_t(mCollectibles.size());
+            for (int i = 0; i < mNPCs.size() && firstNPC + size_t(i) < instances.size(); ++i) {
+                GpuCuller::Instance &instance = instances[firstNPC + size_t(i)];
+                instance.position[0] = mNPCs[i].position.x();
+                instance.position[1] = mNPCs[i].position.y();
+                instance.position[2] = mNPCs[i].position.z();
+            }
+            // The collectibles before them stay as they are
+            mGpuCuller.markInstancesDirty(firstNPC, size_t(mNPCs.size()));
+            mNPCBoundsDirty = false;
+        }
+
+        // The GPU's counts arrive a few frames late, like the GPU timings
+        mFrameStats.cullTested = mGpuCuller.lastTestedCount() + uint32_t(mHousePositions.size());
+        mFrameStats.culled += mGpuCuller.lastTestedCount() - mGpuCuller.lastVisibleCount();
+        mFrameStats.occluded = mGpuCuller.lastOccludedCount();
+        LOG_DEBUG_LIMITED(Render, 1, "GPU culling: {} of {} instances visible, {} hidden behind houses",
+                          mGpuCuller.lastVisibleCount(), mGpuCuller.lastTestedCount(), mGpuCuller.lastOccludedCount());
+        return;
+    }
+
+    // Moved NPCs take their spheres along - several simulation steps cost one update
+    if (mNPCBoundsDirty) {
+        const QVector3D centerOffset = mNPCMeshBounds.center * NPC_SCALE;
+        for (int i = 0; i < mNPCs.size(); ++i)
+            mNPCBounds.setCenter(size_t(i), mNPCs[i].position + centerOffset);
+        mNPCBoundsDirty = false;
+    }
+
+    FrustumCuller::cull(mFrustum, mCollectibleBounds, mVisibleCollectibles);
+    FrustumCuller::cull(mFrustum, mNPCBounds, mVisibleNPCs);
+    const size_t occluded = mSoftwareOcclusion ? occludeVisibleObjects() : 0;
+    const size_t visibleCollectibles = mVisibleCollectibles.size();
+    const size_t visibleNPCs = mVisibleNPCs.size();
+
+    // Levels of detail of what is left
+    mCollectibleLevels.resize(size_t(mCollectibles.size()));
+    mNPCLevels.resize(size_t(mNPCs.size()));
+    const size_t triangles = selectLevels(mVisibleCollectibles, mCollectibleBounds, mCollectibleMesh, COLLECTIBLE_SCALE,
+                                          mCollectibleLevels)
+                           + selectLevels(mVisibleNPCs, mNPCBounds, mNPCMesh, NPC_SCALE, mNPCLevels);
+    const size_t fullTriangles = (visibleCollectibles * mCollectibleMesh.levels[0].indexCount
+                                  + visibleNPCs * mNPCMesh.levels[0].indexCount) / 3;
+    LOG_DEBUG_LIMITED(Render, 1, "Levels of detail: {} of {} triangles drawn", triangles, fullTriangles);
+
+    // Houses are counted here, the ones culled come from the static scene
+    mFrameStats.cullTested = uint32_t(mCollectibleBounds.size() + mNPCBounds.size() + size_t(mHousePositions.size()));
+    mFrameStats.culled += uint32_t(mCollectibleBounds.size() - visibleCollectibles + mNPCBounds.size() - visibleNPCs);
+    mFrameStats.occluded = uint32_t(occluded);
+
+    LOG_DEBUG_LIMITED(Render, 1, "Frustum culling: {} of {} collectibles and {} of {} NPCs visible, {} occluded",
+                      visibleCollectibles, mCollectibleBounds.size(), visibleNPCs, mNPCBounds.size(), occluded);
+}
+
+size_t RenderWindow::selectLevels(const std::vector<uint32_t> &visible, const SphereBounds &bounds, const PackedMesh &mesh,
+                                  float scale, std::vector<uint8_t> &levels)
+{
+    // The errors are in model space, so the object's scale enlarges them just like its size
+    const float pixelsPerUnit = mLodPixelsPerUnit * scale;
+    size_t indices = 0;
+    for (uint32_t index : visible) {
+        const QVector3D center(bounds.x()[index], bounds.y()[index], bounds.z()[index]);
+        // From the nearest point of the sphere, and never nearer than the near plane
+        const float distance = qMax((center - mCullEye).length() - bounds.radius()[index], 0.1f);
+        const int level = mesh.select(pixelsPerUnit / distance, LOD_PIXEL_ERROR, levels[index]);
+        levels[index] = uint8_t(level);
+        indices += mesh.levels[size_t(level)].indexCount;
+    }
+    return indices / 3;
+}
+
+size_t RenderWindow::occludeVisibleObjects()
+{
+    TRACE_SCOPE("software occlusion");
+
+    // Walls and roof of the houses in view are the occluders
+    mOcclusionBuffer.begin(mProjectionMatrix * mViewMatrix);
+    const size_t wallVertices = vertexCount(houseWallsVertexData);
+    const size_t roofVertices = vertexCount(houseRoofVertexData);
+    for (const QVector3D &housePosition : mHousePositions) {
+        if (!mFrustum.intersectsBox(housePosition + mHouseMeshBounds.min, housePosition + mHouseMeshBounds.max))
+            continue;
+        mOcclusionBuffer.addOccluder(houseWallsVertexData.data(), wallVertices, VERTEX_FLOATS, housePosition);
+        mOcclusionBuffer.addOccluder(houseRoofVertexData.data(), roofVertices, VERTEX_FLOATS, housePosition);
+    }
+    if (mOcclusionBuffer.triangleCount() == 0)
+        return 0;
+
+    // One band of the buffer per task, on the recording threads
+    const ParallelRecorder::TaskFunction rasterize = [this](int tile, int) { mOcclusionBuffer.rasterizeTile(tile); };
+    mRecorder.run(OcclusionBuffer::TILE_COUNT, rasterize);
+
+    // The boxes are tested in slices on the same threads, collectibles first and then NPCs.
+    // Hidden entries are marked and removed afterwards, so the lists stay in order.
+    struct Slices {
+        size_t collectibleCount;
+        size_t candidateCount;
+        size_t taskCount;
+    };
+    const size_t candidateCount = mVisibleCollectibles.size() + mVisibleNPCs.size();
+    const Slices slices = { mVisibleCollectibles.size(), candidateCount,
+                            std::min<size_t>((candidateCount + 1023) / 1024, size_t(mRecorder.threadCount() * 4)) };
+    // Two captured pointers keep the function from allocating
+    const ParallelRecorder::TaskFunction test = [this, &slices](int task, int) {
+        const size_t begin = slices.candidateCount * size_t(task) / slices.taskCount;
+        const size_t end = slices.candidateCount * size_t(task + 1) / slices.taskCount;
+        const size_t collectibleCount = slices.collectibleCount;
+        for (size_t candidate = begin; candidate < end; ++candidate) {
+            if (candidate < collectibleCount) {
+                uint32_t &index = mVisibleCollectibles[candidate];
+                const QVector3D &position = mCollectibles[int(index)].position;
+                if (mOcclusionBuffer.isOccluded(position + mCollectibleMeshBounds.min * COLLECTIBLE_SCALE,
+                                                position + mCollectibleMeshBounds.max * COLLECTIBLE_SCALE))
+                    index = OCCLUDED_INDEX;
+            } else {
+                uint32_t &index = mVisibleNPCs[candidate - collectibleCount];
+                const QVector3D &position = mNPCs[int(index)].position;
+                if (mOcclusionBuffer.isOccluded(position + mNPCMeshBounds.min * NPC_SCALE,
+                                                position + mNPCMeshBounds.max * NPC_SCALE))
+                    index = OCCLUDED_INDEX;
+            }
+        }
+    };
+    mRecorder.run(int(slices.taskCount), test);
+
+    mVisibleCollectibles.erase(std::remove(mVisibleCollectibles.begin(), mVisibleCollectibles.end(), OCCLUDED_INDEX),
+                               mVisibleCollectibles.end());
+    mVisibleNPCs.erase(std::remove(mVisibleNPCs.begin(), mVisibleNPCs.end(), OCCLUDED_INDEX), mVisibleNPCs.end());
+    return candidateCount - mVisibleCollectibles.size() - mVisibleNPCs.size();
+}
+
+void RenderWindow::invalidateStaticScenes()
+{
+    // Each slot re-records the next time it is used, never while the GPU may still run it
+    for (int frame = 0; frame < QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT; ++frame) {
+        for (StaticScene &staticScene : mStaticScene[frame])
+            staticScene.valid = false;
+    }
+}
+
 void RenderWindow::initializeNPCs()
 {
     // Clear any existing NPCs
     mNPCs.clear();
 
-    // Create three NPCs with distinct patrol paths, different heights and colors
-    // Use much more extreme height differences for better visibility
-    
-    // NPC 1: Higher position (red) - patrols horizontally top of map
-    mNPCs.append(PatrolEnemy(
-        QVector3D(-8.0f, 2.0f, -5.0f),   // Start at top left, much higher position
-        QVector3D(8.0f, 2.0f, -5.0f),    // Patrol to top right
-        0.03f                           // Slower speed for visibility
-    ));
-    
-    // NPC 2: Middle height (green) - patrols horizontally bottom of map
-    mNPCs.append(PatrolEnemy(
-        QVector3D(-8.0f, 0.5f, 5.0f),   // Start at bottom left, lower than player
-        QVector3D(8.0f, 0.5f, 5.0f),    // Patrol to bottom right
-        0.04f                           // Medium speed
-    ));
-    
-    // NPC 3: Highest position (blue) - patrols vertically on right side
-    mNPCs.append(PatrolEnemy(
-        QVector3D(5.0f, 3.0f, -8.0f),   // Start at back right, much higher position
-        QVector3D(5.0f, 3.0f, 8.0f),    // Patrol to front right
-        0.05f                           // Faster speed
-    ));
-    
-    qDebug() << "\n*** INITIALIZED" << mNPCs.size() << "NPCS WITH IMPROVED VISIBILITY ***";
-    qDebug() << " - NPC 1 (TOP): Red, height 2.0, patrols across top";
-    qDebug() << " - NPC 2 (BOTTOM): Green, height 0.5, patrols across bottom";
-    qDebug() << " - NPC 3 (RIGHT): Blue, height 3.0, patrols along right side\n";
-    
-    // Detailed debug output for NPC positions
-    for (int i = 0; i < mNPCs.size(); ++i) {
-        qDebug() << "NPC" << i << "patrolling from" << mNPCs[i].pointA << "to" << mNPCs[i].pointB
-                 << "with speed" << mNPCs[i].speed;
+    // NPCs and their patrol paths come from the scene description.
+    // The default scene has three NPCs with distinct patrol paths, different heights and colors
+    mNPCs.reserve(mScene.npcs.size());
+    for (const SceneDescription::NPCPatrol &patrol : mScene.npcs)
+        mNPCs.append(PatrolEnemy(patrol.pointA, patrol.pointB, patrol.speed));
+
+    // The radius stays the same, the centers follow the NPCs (see cullOutdoorScene)
+    mNPCBounds.resize(size_t(mNPCs.size()));
+    for (int i = 0; i < mNPCs.size(); ++i)
+        mNPCBounds.set(size_t(i), mNPCs[i].position + mNPCMeshBounds.center * NPC_SCALE, mNPCMeshBounds.radius * NPC_SCALE);
+    mNPCBoundsDirty = false;
+    
+    qDebug() << "\n*** INITIALIZED" << mNPCs.size() << "NPCS ***";
+    
+    // Detailed debug output for NPC positions - skipped for big generated scenes
+    if (mNPCs.size() <= 16) {
+        for (int i = 0; i < mNPCs.size(); ++i) {
+            qDebug() << "NPC" << i << "patrolling from" << mNPCs[i].pointA << "to" << mNPCs[i].pointB
+                     << "with speed" << mNPCs[i].speed;
+        }
     }
 }
 
@@ -2698,6 +2785,7 @@ void RenderWindow::updateNPCs()
         // Update NPC position along its patrol route
         mNPCs[i].updatePosition();
     }
+    mNPCBoundsDirty = true;
 }
 
 bool RenderWindow::checkNPCCollision()
@@ -2713,9 +2801,8 @@ bool RenderWindow::checkNPCCollision()
         
         // Enhanced debug output to track distances
         if (distance < 3.0f) {
-            qDebug() << "NEAR NPC" << i << ": Player at" << playerXZ 
-                     << "is" << distance << "units from NPC at" << npcXZ
-                     << "(collision occurs at < " << collisionDistance << ")";
+            LOG_DEBUG_LIMITED(Game, 4, "NEAR NPC {}: Player at {} is {} units from NPC at {} (collision occurs at < {})",
+                              i, playerXZ, distance, npcXZ, collisionDistance);
         }
         
         if (distance < collisionDistance) {
@@ -2731,12 +2818,8 @@ bool RenderWindow::checkNPCCollision()
             mGameLost = true;
             
             // Print clear game over message
-            qDebug() << "\n*************************************************";
-            qDebug() << "*************** GAME OVER! YOU LOST! **************";
-            qDebug() << "*** You collided with the" << npcColor << "NPC!" << "***";
-            qDebug() << "*** Your final position:" << mPlayerPosition << "***";
-            qDebug() << "*** Press R to restart the game ***";
-            qDebug() << "*************************************************\n";
+            LOG_INFO(Game, "GAME OVER! YOU LOST! You collided with the {} NPC at {}. Press R to restart the game",
+                     npcColor, mPlayerPosition);
             
             return true; // Player hit an NPC
         }
@@ -2768,12 +2851,13 @@ void RenderWindow::checkDoorProximity()
     float distance = (mPlayerPosition - doorPosition).length();
     
     // Debug output
-    qDebug() << "Distance to door:" << distance << "Player position:" << mPlayerPosition << "Door position:" << doorPosition;
+    LOG_TRACE_LIMITED(Scene, 2, "Distance to door: {} Player position: {} Door position: {}",
+                      distance, mPlayerPosition, doorPosition);
     
     // Update door state based on proximity
     if (distance < mDoorOpenDistance) {
         if (!mDoorOpen) {
-            qDebug() << "Player is close to door - opening!";
+            LOG_DEBUG(Scene, "Player is close to door - opening!");
             updateDoorState(true);
         }
         
@@ -2781,7 +2865,7 @@ void RenderWindow::checkDoorProximity()
         checkHouseEntry(doorPosition);
     } else {
         if (mDoorOpen) {
-            qDebug() << "Player moved away from door - closing!";
+            LOG_DEBUG(Scene, "Player moved away from door - closing!");
             updateDoorState(false);
         }
     }
@@ -2795,7 +2879,7 @@ void RenderWindow::checkHouseEntry(const QVector3D& doorPosition)
     // 2. The player is at the doorway
     
     if (!mDoorOpen) {
-        qDebug() << "Door is closed, cannot enter house";
+        LOG_TRACE_LIMITED(Scene, 1, "Door is closed, cannot enter house");
         return; // Door must be open to enter
     }
     
@@ -2803,9 +2887,8 @@ void RenderWindow::checkHouseEntry(const QVector3D& doorPosition)
     QVector3D relativePos = mPlayerPosition - doorPosition;
     
     // Debug output to track player position relative to door
-    qDebug() << "Player relative to door:" << relativePos 
-             << "Distance:" << relativePos.length() 
-             << "X offset:" << std::abs(relativePos.x());
+    LOG_TRACE_LIMITED(Scene, 2, "Player relative to door: {} Distance: {} X offset: {}",
+                      relativePos, relativePos.length(), std::abs(relativePos.x()));
     
     // Check if player is within entry zone 
     // (within small distance from door and aligned with doorway)
@@ -2817,7 +2900,7 @@ void RenderWindow::checkHouseEntry(const QVector3D& doorPosition)
         std::abs(relativePos.x()) < doorwayWidth &&
         relativePos.z() < 0.5f && relativePos.z() > -0.5f) { // Near the door plane
         
-        qDebug() << "*** PLAYER ENTERED HOUSE - TRANSITIONING TO SCENE 2! ***";
+        LOG_INFO(Scene, "PLAYER ENTERED HOUSE - TRANSITIONING TO SCENE 2!");
         // Force scene transition
         transitionToScene2();
     }
@@ -2835,12 +2918,10 @@ void RenderWindow::transitionToScene2()
     mPlayerPosition = QVector3D(0.0f, 0.0f, 0.0f); // Center of the house
     
     // Reset view and state for Scene 2
-    qDebug() << "Transitioned to Scene 2 (inside house)";
+    LOG_INFO(Scene, "Transitioned to Scene 2 (inside house)");
     
     // Request a render update
-    if (mWindow) {
-        mWindow->requestUpdate();
-    }
+    requestFrame(FrameScheduler::Scene);
 }
 
 void RenderWindow::transitionToScene1()
@@ -2854,12 +2935,10 @@ void RenderWindow::transitionToScene1()
     mPlayerPosition = doorPosition + QVector3D(0.0f, 0.0f, 1.0f); // Just outside the door
     
     // Reset view and state for Scene 1
-    qDebug() << "Transitioned to Scene 1 (outside)";
+    LOG_INFO(Scene, "Transitioned to Scene 1 (outside)");
     
     // Request a render update
-    if (mWindow) {
-        mWindow->requestUpdate();
-    }
+    requestFrame(FrameScheduler::Scene);
 }
 
 void RenderWindow::updateDoorState(bool open)
@@ -2869,48 +2948,51 @@ void RenderWindow::updateDoorState(bool open)
     }
     
     mDoorOpen = open;
-    
-    // Update door buffer with appropriate vertex data
-    VkDevice dev = mWindow->device();
-    
-    // Map the door buffer memory
-    void* doorData;
-    VkResult err = mDeviceFunctions->vkMapMemory(dev, mHouseDoorBufferMemory, 0, 
-                                                sizeof(houseDoorVertexData), 0, &doorData);
-    if (err != VK_SUCCESS) {
-        qDebug() << "Failed to map door memory! Error:" << err;
+    mPortals.setPortalOpen(mDoorPortal, open);
+    LOG_INFO(Scene, "Door {}", mDoorOpen ? "opened" : "closed");
+
+    // updateDoorMesh() streams the new door in, the frames until it is there show the old one
+    requestFrame(FrameScheduler::Scene);
+}
+
+void RenderWindow::updateDoorMesh()
+{
+    if (mDoorUpload) {
+        if (!mUploader.isComplete(mDoorUpload)) {
+            // Keep frames coming until the door can be shown
+            requestFrame(FrameScheduler::Scene);
+            return;
+        }
+        destroyRuntimeBuffer(mDoorBuffer);
+        mDoorBuffer = mDoorUploadBuffer;
+        mDoorBufferOpen = mDoorUploadOpen;
+        mDoorUploadBuffer = RuntimeBufferHandle();
+        mDoorUpload = 0;
+        // The door is drawn by the cached static scene
+        invalidateStaticScenes();
+    }
+    if (mDoorBufferOpen == mDoorOpen)
         return;
-    }
-    
-    // Copy the appropriate vertex data based on door state
-    if (mDoorOpen) {
-        memcpy(doorData, houseDoorOpenVertexData, sizeof(houseDoorOpenVertexData));
-        qDebug() << "Door opened - updated vertex data";
-    } else {
-        memcpy(doorData, houseDoorVertexData, sizeof(houseDoorVertexData));
-        qDebug() << "Door closed - updated vertex data";
-    }
-    
-    // Unmap the memory
-    mDeviceFunctions->vkUnmapMemory(dev, mHouseDoorBufferMemory);
-    
-    // Request a redraw to show the updated door state
-    if (mWindow) {
-        mWindow->requestUpdate();
-    }
+
+    // A buffer of its own, nothing draws from it until the upload is complete
+    const PackedMesh &mesh = mDoorOpen ? mHouseDoorOpenMesh : mHouseDoorMesh;
+    mDoorUploadBuffer = createRuntimeBuffer(mesh.byteSize(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    std::vector<uint8_t> data(mesh.byteSize());
+    mesh.write(data.data());
+    mDoorUpload = mUploader.upload(mRuntimeBuffers.get(mDoorUploadBuffer)->buffer, 0, std::move(data));
+    mDoorUploadOpen = mDoorOpen;
+    requestFrame(FrameScheduler::Scene);
 }
 
 void RenderWindow::tryExitHouse()
 {
     // Only works in Scene 2
     if (mCurrentScene != 2) {
-        qDebug() << "Not inside house, can't exit";
+        LOG_DEBUG(Scene, "Not inside house, can't exit");
         return;
     }
     
-    qDebug() << "\n*************************************************";
-    qDebug() << "***       EXITING HOUSE - BACK OUTSIDE!       ***";
-    qDebug() << "*************************************************\n";
+    LOG_INFO(Scene, "Exiting house - back outside");
     
     // Transition back to outdoor scene
     transitionToScene1();
@@ -2918,12 +3000,80 @@ void RenderWindow::tryExitHouse()
 
 void RenderWindow::initSwapChainResources()
 {
+    TRACE_SCOPE("initSwapChainResources");
+    const QSize sz = mWindow->swapChainImageSize();
     qDebug("initSwapChainResources: Window size is %dx%d", mWindow->width(), mWindow->height());
-    
-    // Save aspect ratio for projection matrix
-    mAspectRatio = float(mWindow->swapChainImageSize().width()) / float(mWindow->swapChainImageSize().height());
-    
-    // No other resources to initialize in this demo
+
+    // Only what depends on the size, the meshes, pipelines and descriptor sets stay as they are
+    mAspectRatio = float(sz.width()) / float(sz.height());
+    updateProjection();
+    mRenderGraph.setSwapChainSize(sz);
+    // The graph has forgotten the history's layout, and with a new size the images are new anyway
+    mTemporalAA.resize(sz);
+    mTemporalAA.resetHistory();
+    if (mTemporalAA.isInitialized())
+        mUpscaler.setHistory(mTemporalAA.historyView(0), mTemporalAA.historyView(1));
+    updateAntiAliasingBytes();
+
+    // Viewport, scissor and the indoor clear rectangle are baked into the static scene commands
+    invalidateStaticScenes();
+
+    if (mResizeTimer.isValid())
+        mResizeRebuildMs = mResizeTimer.nsecsElapsed() / 1.0e6;
+}
+
+// Bytes per pixel of the formats QVulkanWindow picks, what drivers typically allocate
+static uint64_t formatBytes(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_D16_UNORM:
+        return 2;
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+void RenderWindow::updateAntiAliasingBytes()
+{
+    const QSize sz = mWindow->swapChainImageSize();
+    const uint64_t pixels = uint64_t(sz.width()) * uint64_t(sz.height());
+    const uint64_t colorBytes = formatBytes(mWindow->colorFormat());
+    const uint64_t depthBytes = formatBytes(mWindow->depthStencilFormat());
+    const uint64_t windowSamples = uint64_t(mWindow->sampleCountFlagBits());
+    const uint64_t sceneSamples = uint64_t(mSceneSamples);
+
+    // Beyond the swap chain and a single-sampled depth buffer. QVulkanWindow has a multisampled
+    // color image per swap chain image, and the depth buffer takes all samples. It is only
+    // multisampled without the offscreen target.
+    uint64_t msaaBytes = 0;
+    if (windowSamples > 1)
+        msaaBytes = uint64_t(mWindow->swapChainImageCount()) * pixels * windowSamples * colorBytes
+                  + pixels * (windowSamples - 1) * depthBytes;
+    // The offscreen target: single-sampled color, the depth and a multisampled color with all samples
+    uint64_t targetBytes = 0;
+    if (mUpscaler.isInitialized())
+        targetBytes = pixels * (colorBytes + sceneSamples * depthBytes + (sceneSamples > 1 ? sceneSamples * colorBytes : 0));
+    // The history is allocated already, its size is known exactly
+    const uint64_t historyBytes = mTemporalAA.historyBytes();
+
+    mAntiAliasingBytes = msaaBytes + targetBytes + historyBytes;
+    LOG_INFO(Perf, "Anti-aliasing {}{}: {} MB MSAA attachments, {} MB scene target, {} MB history",
+             antiAliasingName(mAntiAliasing), mTemporalAA.isInitialized() ? " + taa" : "",
+             msaaBytes / (1024.0 * 1024.0), targetBytes / (1024.0 * 1024.0), historyBytes / (1024.0 * 1024.0));
+}
+
+void RenderWindow::updateProjection()
+{
+    mProjectionMatrix.setToIdentity();
+    mProjectionMatrix.perspective(45.0f, mAspectRatio, 0.1f, 100.0f);
+    mSceneSize = mUpscaler.isInitialized() ? SceneUpscaler::renderSize(mWindow->swapChainImageSize(), mResolution.scale())
+                                           : mWindow->swapChainImageSize();
+    // Half the viewport height covers the distance at which one unit is cot(fov / 2) units tall.
+    // At a lower resolution a unit covers fewer pixels, and coarser levels of detail are drawn.
+    mLodPixelsPerUnit = 0.5f * float(mSceneSize.height()) * mProjectionMatrix(1, 1);
 }
 
 void RenderWindow::checkIndoorCollectibleCollision()
@@ -2933,47 +3083,44 @@ void RenderWindow::checkIndoorCollectibleCollision()
         return;
     }
     
-    // Skip if already collected
-    if (mIndoorCollectible.collected) {
-        return;
-    }
-    
-    // Calculate distance between player and collectible (in XZ plane)
-    QVector3D playerPos2D(mPlayerPosition.x(), 0.0f, mPlayerPosition.z());
-    QVector3D collectiblePos2D(mIndoorCollectible.position.x(), 0.0f, mIndoorCollectible.position.z());
-    
-    float distance = (playerPos2D - collectiblePos2D).length();
-    
     // Collection radius
     const float COLLECT_RADIUS = 1.0f;
+
+    for (Collectible &indoorCollectible : mIndoorCollectibles) {
+        // Skip if already collected
+        if (indoorCollectible.collected) {
+            continue;
+        }
+    
+        // Calculate distance between player and collectible (in XZ plane)
+        QVector3D playerPos2D(mPlayerPosition.x(), 0.0f, mPlayerPosition.z());
+        QVector3D collectiblePos2D(indoorCollectible.position.x(), 0.0f, indoorCollectible.position.z());
+    
+        float distance = (playerPos2D - collectiblePos2D).length();
     
-    if (distance < COLLECT_RADIUS) {
-        // Mark as collected
-        mIndoorCollectible.collected = true;
+        if (distance < COLLECT_RADIUS) {
+            // Mark as collected
+            indoorCollectible.collected = true;
         
-        // Increment count (using the same counter as outdoor collectibles)
-        mCollectedCount++;
+            // Increment count (using the same counter as outdoor collectibles)
+            mCollectedCount++;
         
-        qDebug() << "*** SPECIAL INDOOR COLLECTIBLE COLLECTED! ***";
-        qDebug() << "Total collectibles:" << mCollectedCount << "of" << getTotalCollectibles();
+            LOG_INFO(Game, "Special indoor collectible collected, {} of {} collected", mCollectedCount,
+                     getTotalCollectibles());
         
-        // Check if all collectibles are collected - set game won state
-        if (mCollectedCount == getTotalCollectibles()) {
-            mGameWon = true;
-            qDebug() << "\n*************************************************";
-            qDebug() << "***               YOU WON!                    ***";
-            qDebug() << "***     All collectibles have been found!     ***";
-            qDebug() << "*************************************************\n";
+            // Check if all collectibles are collected - set game won state
+            if (mCollectedCount == getTotalCollectibles()) {
+                mGameWon = true;
+                LOG_INFO(Game, "YOU WON! All collectibles have been found!");
             
-            // Update UI to show win status
-            if (VulkanWindow* vulkanWindow = qobject_cast<VulkanWindow*>(mWindow)) {
-                vulkanWindow->updateGameStatus(VulkanWindow::GameStatus::Won);
+                // Update UI to show win status
+                if (VulkanWindow* vulkanWindow = qobject_cast<VulkanWindow*>(mWindow)) {
+                    vulkanWindow->updateGameStatus(VulkanWindow::GameStatus::Won);
+                }
             }
-        }
         
-        // Request update to refresh rendering
-        if (mWindow) {
-            mWindow->requestUpdate();
+            // Request update to refresh rendering
+            requestFrame(FrameScheduler::Simulation);
         }
     }
 }
@@ -2986,7 +3133,7 @@ void RenderWindow::checkGameWinCondition()
     }
     
     // Debug output to track what's happening
-    qDebug() << "CHECKING WIN CONDITION: Collected:" << mCollectedCount << "Total:" << getTotalCollectibles();
+    LOG_TRACE_LIMITED(Game, 1, "CHECKING WIN CONDITION: Collected: {} Total: {}", mCollectedCount, getTotalCollectibles());
     
     // Check if all collectibles are collected
     if (mCollectedCount == getTotalCollectibles()) {
@@ -2994,17 +3141,14 @@ void RenderWindow::checkGameWinCondition()
         mGameWon = true;
         
         // Display prominent win message
-        qDebug() << "\n*************************************************";
-        qDebug() << "***               YOU WON!                    ***";
-        qDebug() << "***     All collectibles have been found!     ***";
-        qDebug() << "*************************************************\n";
+        LOG_INFO(Game, "YOU WON! All collectibles have been found!");
         
         // Update game UI
         if (VulkanWindow* vulkanWindow = qobject_cast<VulkanWindow*>(mWindow)) {
-            qDebug() << "Updating window status to Won!";
+            LOG_DEBUG(Game, "Updating window status to Won!");
             vulkanWindow->updateGameStatus(VulkanWindow::GameStatus::Won);
         } else {
-            qDebug() << "ERROR: Could not cast to VulkanWindow!";
+            LOG_ERROR(Game, "Could not cast to VulkanWindow!");
         }
     }
 }
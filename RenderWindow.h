@@ -1,8 +1,36 @@
 #pragma once
 
 #include <QVulkanWindow>
+#include <QElapsedTimer>
 #include <QVector>
 #include "GameManager.h"
+#include "SceneGenerator.h"
+#include "FrameStats.h"
+#include "Benchmark.h"
+#include "GpuProfiler.h"
+#include "MemoryBudget.h"
+#include "FrameScheduler.h"
+#include "ParallelRecorder.h"
+#include "FrustumCuller.h"
+#include "OcclusionBuffer.h"
+#include "GpuCuller.h"
+#include "HiZPyramid.h"
+#include "PortalCuller.h"
+#include "MeshOptimizer.h"
+#include "PipelineVariants.h"
+#include "RenderQueue.h"
+#include "BindlessSet.h"
+#include "RenderGraph.h"
+#include "StreamingUploader.h"
+#include "DeletionQueue.h"
+#include "HandlePool.h"
+#include "SceneUpscaler.h"
+#include "ResolutionController.h"
+#include "AntiAliasing.h"
+#include "TemporalAA.h"
+#include <vector>
+
+class FrameStatsRing;
 
 // Structure to represent collectible objects
 struct Collectible {
@@ -48,7 +76,10 @@ struct PatrolEnemy {
 class RenderWindow : public QVulkanWindowRenderer
 {
 public:
-    RenderWindow(QVulkanWindow *w, bool msaa = false);
+    // MSAA modes take their sample count, or the highest supported one below it. It goes to
+    // QVulkanWindow, or to the offscreen scene target when there is one.
+    RenderWindow(QVulkanWindow *w, AntiAliasing antiAliasing = AntiAliasing::Off,
+                 const SceneDescription &scene = SceneGenerator::defaultScene());
     ~RenderWindow() override;
 
     //Initializes the Vulkan resources needed,
@@ -57,10 +88,13 @@ public:
     // making the shaders, etc
     void initResources() override;
 
-    //Set up resources - only MVP-matrix for now:
+    // Asks QVulkanWindow for the samples, the latest point Qt allows
+    void preInitResources() override;
+
+    //Size-dependent resources: projection, level of detail scale and the swap chain sized graph images
     void initSwapChainResources() override;
 
-    //Empty for now - needed since we implement QVulkanWindowRenderer
+    //Swap chain recreation, the window is resized - scene buffers are kept
     void releaseSwapChainResources() override;
 
     //Release Vulkan resources when program ends
@@ -83,7 +117,7 @@ public:
     void initializeCollectibles();
     void checkCollectibleCollisions();
     int getCollectedCount() const { return mCollectedCount; }
-    int getTotalCollectibles() const { return mCollectibles.size() + 1; } // +1 for indoor collectible
+    int getTotalCollectibles() const { return mCollectibles.size() + mIndoorCollectibles.size(); }
 
     // Legacy movement function for GameManager compatibility
     void movePlayer(const QVector3D& delta) { 
@@ -105,12 +139,19 @@ public:
     void resetGameState() { 
         mGameLost = false; 
         mGameWon = false;
+        requestFrame(FrameScheduler::Simulation);  // NPCs start moving again
     }
     bool isGameLost() const { return mGameLost; }
 
+    // Freezes the NPCs - with nothing else moving the window stops rendering
+    void setNPCsPaused(bool paused) { mNPCsPaused = paused; requestFrame(FrameScheduler::Input); }
+    bool areNPCsPaused() const { return mNPCsPaused; }
+
     // Door state management
     void checkDoorProximity();
     void updateDoorState(bool open);
+    // Streams the door mesh of mDoorOpen into a new buffer, and draws that one once it is there
+    void updateDoorMesh();
     
     // Scene transitions
     void checkHouseEntry(const QVector3D& doorPosition);
@@ -124,16 +165,208 @@ public:
     void checkIndoorCollectibleCollision();
     void checkGameWinCondition();
 
+    // Runs the given number of frames, prints timing statistics and quits (0 = off)
+    void startBenchmark(int frames) { mBenchmarkFrames = frames; mBenchmark.start(frames); }
+    // Runs the benchmark once for each thread count and prints how recording time scales
+    void setRecordScaling(const QVector<int> &threadCounts) {
+        mRecordScalingThreads = threadCounts;
+        if (!threadCounts.isEmpty())
+            setRecordThreads(threadCounts.first());
+    }
+
+    // Cull and draw collectibles and NPCs with a compute pass and indirect draws. Call before initResources().
+    void setGpuCulling(bool enabled) { mGpuCulling = enabled; }
+    // Drop collectibles and NPCs hidden behind houses with a CPU occlusion buffer before recording
+    void setSoftwareOcclusion(bool enabled) { mSoftwareOcclusion = enabled; }
+    // Distance fog outdoors - a pipeline variant, built in the background the first time it is needed
+    void setFog(bool enabled) { mFog = enabled; requestFrame(FrameScheduler::Input); }
+    bool isFogEnabled() const { return mFog; }
+
+    // Dynamic resolution: the scene is drawn offscreen at the scale that holds targetMs of GPU time
+    // and scaled up to the window. 0 draws it straight into the swap chain. Call before initResources().
+    void setDynamicResolution(double targetMs) { mResolution.setTargetMs(targetMs); }
+    // Sharpening of the upscale, 0 is plain bilinear
+    void setUpscaleSharpness(float sharpness) { mUpscaler.setSharpness(sharpness); }
+    // Jitter the projection and accumulate the frames, on top of the anti-aliasing mode. Like FXAA
+    // it needs the offscreen scene target. Call before initResources().
+    void setTemporalAA(bool enabled) { mTemporalAAEnabled = enabled; }
+
+    // Threads recording the outdoor objects, 1 = render thread only. Call before initResources().
+    void setRecordThreads(int threads) { mRecordThreads = qBound(1, threads, ParallelRecorder::MAX_THREADS); }
+
+    // GPU timestamps and pipeline statistics per draw group
+    const GpuProfiler &gpuProfiler() const { return mGpuProfiler; }
+
+    // Every frame's FrameStats is pushed here (owned by VulkanWindow, read by the Performance tab)
+    void setFrameStatsRing(FrameStatsRing *ring) { mFrameStatsRing = ring; }
+
+    // Decides when the next frame is drawn (owned by VulkanWindow). Without one every frame requests the next.
+    void setFrameScheduler(FrameScheduler *scheduler) { mFrameScheduler = scheduler; }
+
+    // Queue VulkanWindow asks for for the streaming uploads (owned by VulkanWindow). Its device
+    // creation hooks fill it in after the renderer is created, initResources() reads it.
+    void setTransferQueue(const StreamingUploader::QueueInfo *queue) { mTransferQueue = queue; }
+
+    // Static scene geometry or its descriptor sets changed - the cached commands are recorded again.
+    // The view-projection matrix lives in the uniform buffer, a camera change only needs
+    // this because of the culled houses, and cullOutdoorScene() takes care of that.
+    void invalidateStaticScenes();
+
 private:
     VkShaderModule createShader(const QString &name);
-    void updateUniformBuffer(VkDescriptorBufferInfo &bufferInfo, const QMatrix4x4 &matrix);
+    // Pipeline cache contents of the last run, empty when there are none or they are from another device
+    QByteArray loadPipelineCache() const;
+    void savePipelineCache();
+    // The variant of the scene pipeline the current scene is drawn with
+    PipelineVariants::Features sceneFeatures() const;
+
+    // Writes the camera's view-projection matrix into the uniform slot of the current frame
+    void updateViewProjection();
+
+    // Rows of the material buffer of mBindless
+    enum MaterialId : uint32_t {
+        GroundMaterial,
+        PlayerMaterial,
+        CollectibleMaterial,
+        NPCMaterial1,
+        NPCMaterial2,
+        NPCMaterial3,
+        HouseMaterial,
+        IndoorMaterial,
+        MATERIAL_COUNT
+    };
+    // Rows of the transform buffer of mBindless. Every object has a fixed one, written when it is
+    // drawn. The static objects come first, so cached command buffers keep their rows when the number
+    // of collectibles or NPCs changes.
+    enum FixedTransform : uint32_t {
+        GroundTransform,
+        IndoorFloorTransform,
+        PlayerTransform,
+        IndoorRoomTransform,
+        FIXED_TRANSFORM_COUNT
+    };
+    struct TransformLayout {
+        uint32_t houses = FIXED_TRANSFORM_COUNT;
+        uint32_t collectibles = 0;
+        uint32_t npcs = 0;
+        uint32_t indoorCollectibles = 0;
+        uint32_t portalCollectibles = 0;    // Indoor collectibles seen through the door, placed in the house
+        uint32_t count = 0;
+    };
+    struct RuntimeBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+    };
+    typedef HandlePool<RuntimeBuffer>::Handle RuntimeBufferHandle;
+    // Recomputes mTransforms from the object counts and grows the transform buffers if needed
+    void updateTransformLayout();
+    // Device-local buffer the streaming uploader fills while running
+    RuntimeBufferHandle createRuntimeBuffer(VkDeviceSize size, VkBufferUsageFlags usage);
+    // Stales handle and destroys the buffer once the frames in flight are done with it
+    void destroyRuntimeBuffer(RuntimeBufferHandle &handle);
+    // Binds the BindlessSet of the current frame slot, the set every scene draw indexes into
+    void bindObjectSet(VkCommandBuffer cb);
+    // Writes model into the transform row and pushes the row and material for the next draw
+    void pushObject(VkCommandBuffer cb, uint32_t transform, uint32_t material, const QMatrix4x4 &model);
+    // Binds the vertices and indices of mesh, both in buffer, and draws one of its levels
+    void drawMesh(VkCommandBuffer cb, VkBuffer buffer, const PackedMesh &mesh, int level = 0) const;
+    // Level of detail of each visible object, from its distance to mCullEye. Returns the triangles drawn.
+    size_t selectLevels(const std::vector<uint32_t> &visible, const SphereBounds &bounds, const PackedMesh &mesh,
+                        float scale, std::vector<uint8_t> &levels);
+
+    // Something visible changed - reason is a FrameScheduler::DirtyFlag
+    void requestFrame(uint32_t reason);
+    // NPCs are moving, so frames are needed even without input
+    bool isSimulationRunning() const;
     
-    // Scene drawing functions
-    void drawOutdoorScene(VkDevice dev, VkCommandBuffer cb, quint8* GPUmemPointer, VkResult& err);
-    void drawIndoorScene(VkDevice dev, VkCommandBuffer cb, quint8* GPUmemPointer, VkResult& err);
+    // Static part of each scene, recorded once per frame slot into a cached secondary command buffer
+    struct StaticScene {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        bool valid = false;             // Recorded and still matches the scene
+        VkPipeline pipeline = VK_NULL_HANDLE;   // Variant it was recorded with
+        uint32_t drawCalls = 0;         // Counted into FrameStats every time the buffer is replayed
+        uint32_t descriptorBinds = 0;
+        uint32_t gpuRegions = 0;        // GpuRegion bits written by the buffer
+        uint32_t culled = 0;            // Houses left out of the buffer by frustum culling
+    };
+    static constexpr int STATIC_SCENE_COUNT = 2;    // Outdoor and indoor
+
+    void createSecondaryCommandBuffers();
+    // Begins a secondary command buffer inside the scene render pass and sets viewport, scissor and pipeline
+    void beginSecondary(VkCommandBuffer cb, VkFramebuffer framebuffer, VkCommandBufferUsageFlags usage);
+    void endSecondary(VkCommandBuffer cb);
+    void recordStaticScene(StaticScene &staticScene, int sceneIndex);
+    // Passes of this frame into mRenderGraph: occluders, depth pyramid, GPU culling, the scene, temporal AA
+    // and the upscale
+    void declareFrameGraph();
+    // The scene pass: QVulkanWindow's render pass, or mUpscaler's with the offscreen scene
+    // target, filled with the cached and the freshly recorded secondaries
+    void recordScenePass(VkCommandBuffer cb);
+    // Scene target (or temporal AA history) scaled up into QVulkanWindow's render pass, then the overlay
+    void recordUpscalePass(VkCommandBuffer cb, SceneUpscaler::Source source);
+    // Dynamic resolution, FXAA and temporal AA draw the scene offscreen first
+    bool needsSceneTarget() const
+    {
+        return mResolution.targetMs() > 0.0 || mAntiAliasing == AntiAliasing::Fxaa || mTemporalAAEnabled;
+    }
+    // Attachment memory the anti-aliasing adds, into mFrameStats from now on
+    void updateAntiAliasingBytes();
+    // Game over screen / HUD, at the swap chain's resolution
+    void recordOverlay(VkCommandBuffer cb);
+    // Framebuffer the scene pass draws into this frame
+    VkFramebuffer sceneFramebuffer() const
+    {
+        return mUpscaler.isInitialized() ? mUpscaler.framebuffer() : mWindow->currentFramebuffer();
+    }
+
+    // Scene drawing functions - the static part (ground, houses, room) and the moving objects
+    void drawOutdoorStatic(VkCommandBuffer cb);
+    void drawOutdoorScene(VkCommandBuffer cb);
+    // Records the moving outdoor objects on the ParallelRecorder's threads and appends
+    // the resulting secondary command buffers in draw order
+    void drawOutdoorSceneParallel(std::vector<VkCommandBuffer> &executeList);
+    void drawIndoorStatic(VkCommandBuffer cb);
+    void drawIndoorScene(VkCommandBuffer cb);
+
+    // Draw and bind counts of one recording thread, added to FrameStats afterwards.
+    // Own cache line each, the threads write them all the time.
+    struct alignas(64) RecordCounters {
+        uint32_t drawCalls = 0;
+        uint32_t descriptorBinds = 0;
+        uint32_t pipelineBinds = 0;
+        uint32_t vertexBinds = 0;
+        uint32_t skippedBinds = 0;
+        uint64_t uniformBytes = 0;      // Transform rows written for the queued draws
+    };
+    // One slice of the collectible or NPC list for a recording thread
+    struct RecordTask {
+        bool npcs;
+        int begin;
+        int end;
+    };
+    // The moving objects only go into a render queue, submitQueue() records them
+    void drawPlayer(RenderQueue &queue);
+    // Safe to call from recording threads. begin and end index the visible lists, not the objects.
+    void drawCollectibles(RenderQueue &queue, int begin, int end);
+    void drawNPCs(RenderQueue &queue, int begin, int end);
+    // Sorts queue and records it into cb, which has mScenePipeline bound. Safe to call from recording threads.
+    void submitQueue(VkCommandBuffer cb, RenderQueue &queue, RecordCounters &counters);
+    void addRecordCounters(const RecordCounters &counters);
     
-    // Resource initialization
-    void createIndoorSceneResources();
+    // Tests the collectibles and NPCs against the camera frustum and fills the visible lists
+    void cullOutdoorScene();
+    // Projection and level of detail scale for the swap chain size
+    void updateProjection();
+    // Rasterizes the houses into mOcclusionBuffer and removes what they hide from the visible lists.
+    // Returns how many objects were removed.
+    size_t occludeVisibleObjects();
+    // GPU culling: meshes, pipelines and buffers, and the instance data of every collectible and NPC
+    void initGpuCulling(const VkGraphicsPipelineCreateInfo &pipelineTemplate);
+    void updateGpuInstances();
+    // Depth only pass of the houses for the occlusion test, see HiZPyramid
+    void drawOccluders(VkCommandBuffer cb);
+    // Interior of the entrance house where it can be seen through the open door
+    void drawPortalCells(VkCommandBuffer cb);
     
     QVulkanWindow *mWindow;
     QVulkanDeviceFunctions *mDeviceFunctions;
@@ -145,70 +378,103 @@ private:
     QMatrix4x4 mViewMatrix;
     float mAspectRatio = 1.0f;
     int mFrameCount = 0;
+    // Started when the swap chain is released for a resize, reported with the first frame after it
+    QElapsedTimer mResizeTimer;
+    double mResizeRebuildMs = 0.0;          // Swap chain and size-dependent resources recreated
+
+    // Frame timing and draw counters, fed to the benchmark
+    FrameStats mFrameStats;
+    FrameBenchmark mBenchmark;
+    int mBenchmarkFrames = 0;
+    GpuProfiler mGpuProfiler;
+    MemoryBudget mMemoryBudget;
+
+    // Passes of the frame and the barriers between them, declared anew every frame
+    RenderGraph mRenderGraph;
+    // Runtime copies into device-local buffers, off the render thread
+    StreamingUploader mUploader;
+    const StreamingUploader::QueueInfo *mTransferQueue = nullptr;
+    // Vulkan objects replaced while running, destroyed once the frames using them are done
+    DeletionQueue mDeletionQueue;
+    // Buffers created and destroyed while running, held by handles that notice when they are stale
+    HandlePool<RuntimeBuffer> mRuntimeBuffers;
+    uint64_t mVramBytes = 0;
+    FrameStatsRing *mFrameStatsRing = nullptr;
+    FrameScheduler *mFrameScheduler = nullptr;
 
     // Game state
+    SceneDescription mScene;      // What the world was built from (default or generated)
+    float mWorldSize = 10.0f;     // Half extent of the ground plane
     GameManager* mGameManager;
     QVector<Collectible> mCollectibles;
     int mCollectedCount = 0;
     bool mGameLost = false;  // Track if player has lost
     bool mGameWon = false;   // Track if player has won
+    bool mNPCsPaused = false;
     
     // Door and house state
     bool mDoorOpen = false;
-    QVector3D mHousePosition = QVector3D(0.0f, 0.0f, -12.0f);
+    QVector3D mHousePosition = QVector3D(0.0f, 0.0f, -12.0f);   // The house that can be entered
+    QVector<QVector3D> mHousePositions;                          // All houses, including the one above
     float mDoorOpenDistance = 3.0f; // Distance at which door opens
     
     // Scene management
     int mCurrentScene = 1; // Start in Scene 1 (outdoor)
     QVector3D mScene1PlayerPosition; // Save position when transitioning
     
-    // Indoor collectible
-    Collectible mIndoorCollectible = Collectible(QVector3D(2.0f, 0.0f, -2.0f)); // Special collectible inside the house
+    // Indoor collectibles - one special collectible per indoor room
+    QVector<Collectible> mIndoorCollectibles;
 
     // House buffers and memory
     VkBuffer mHouseWallsBuffer = VK_NULL_HANDLE;
     VkDeviceMemory mHouseWallsBufferMemory = VK_NULL_HANDLE;
-    VkBuffer mHouseDoorBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory mHouseDoorBufferMemory = VK_NULL_HANDLE;
+    RuntimeBufferHandle mDoorBuffer;                // Drawn
+    bool mDoorBufferOpen = false;                   // ... and which door it holds
+    RuntimeBufferHandle mDoorUploadBuffer;          // The next door, streaming in
+    StreamingUploader::Ticket mDoorUpload = 0;      // 0 when none is pending
+    bool mDoorUploadOpen = false;
     VkBuffer mHouseRoofBuffer = VK_NULL_HANDLE;
     VkDeviceMemory mHouseRoofBufferMemory = VK_NULL_HANDLE;
-    VkDescriptorSet mHouseDescriptorSet[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
-    VkDescriptorBufferInfo mHouseUniformBufferInfo[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
 
     // Indoor scene resources
     VkBuffer mIndoorWallsBuffer = VK_NULL_HANDLE;
     VkDeviceMemory mIndoorWallsBufferMemory = VK_NULL_HANDLE;
     VkBuffer mExitDoorBuffer = VK_NULL_HANDLE;
     VkDeviceMemory mExitDoorBufferMemory = VK_NULL_HANDLE;
-    VkDescriptorBufferInfo mIndoorUniformBufferInfo[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
-    VkDescriptorSet mIndoorDescriptorSet[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
     
     // Vulkan resources
     VkBuffer mBuffer = VK_NULL_HANDLE;
     VkDeviceMemory mBufferMemory = VK_NULL_HANDLE;
-    VkDescriptorBufferInfo mUniformBufferInfo[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
-    VkDescriptorBufferInfo mPlayerUniformBufferInfo[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
-    VkDescriptorBufferInfo mCollectibleUniformBufferInfo[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
-    
-    // Separate uniform buffer info for each NPC
-    VkDescriptorBufferInfo mNPCUniformBufferInfo1[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
-    VkDescriptorBufferInfo mNPCUniformBufferInfo2[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
-    VkDescriptorBufferInfo mNPCUniformBufferInfo3[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
-    
-    VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
-    VkDescriptorSetLayout mDescriptorSetLayout = VK_NULL_HANDLE;
-    VkDescriptorSet mDescriptorSet[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
-    VkDescriptorSet mPlayerDescriptorSet[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
-    VkDescriptorSet mCollectibleDescriptorSet[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
-    
-    // Separate descriptor sets for each NPC
-    VkDescriptorSet mNPCDescriptorSet1[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
-    VkDescriptorSet mNPCDescriptorSet2[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
-    VkDescriptorSet mNPCDescriptorSet3[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];
+    VkDescriptorBufferInfo mUniformBufferInfo[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT];   // Camera of each frame slot
+
+    // One descriptor set per frame slot for every object, see BindlessSet
+    BindlessSet mBindless;
+    TransformLayout mTransforms;
     
+    // Secondary command buffers: cached static scenes and the per-frame moving objects
+    VkCommandPool mSecondaryCommandPool = VK_NULL_HANDLE;
+    StaticScene mStaticScene[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT][STATIC_SCENE_COUNT];
+    VkCommandBuffer mDynamicCommandBuffer[QVulkanWindow::MAX_CONCURRENT_FRAME_COUNT] = {};
+    std::vector<VkCommandBuffer> mExecuteList;      // Everything the primary executes this frame
+
+    // Multi-threaded recording of the outdoor objects
+    ParallelRecorder mRecorder;
+    int mRecordThreads = 1;
+    int mPendingRecordThreads = 0;      // Switched at the start of the next frame (scaling benchmark)
+    QVector<int> mRecordScalingThreads;
+    QVector<double> mRecordScalingMs;
+    std::vector<RecordTask> mRecordTasks;
+    RecordCounters mWorkerCounters[ParallelRecorder::MAX_THREADS];
+    // Moving objects of the render thread and of each recording thread, refilled every frame
+    RenderQueue mRenderQueue;
+    RenderQueue mWorkerQueues[ParallelRecorder::MAX_THREADS];
+
     VkPipelineCache mPipelineCache = VK_NULL_HANDLE;
     VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
-    VkPipeline mPipeline = VK_NULL_HANDLE;
+    // color.vert and color.frag with every combination of features, see PipelineVariants
+    PipelineVariants mPipelines;
+    VkPipeline mScenePipeline = VK_NULL_HANDLE;     // The variant this frame is drawn with
+    bool mFog = false;
 
     // BUFFER RESOURCES
     VkBuffer mGroundBuffer = VK_NULL_HANDLE;
@@ -237,11 +503,70 @@ private:
     // CrateCube model resources for NPCs
     VkBuffer mCrateCubeBuffer = VK_NULL_HANDLE;
     VkDeviceMemory mCrateCubeBufferMemory = VK_NULL_HANDLE;
-    VkBuffer mCrateCubeIndexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory mCrateCubeIndexBufferMemory = VK_NULL_HANDLE;
-    uint32_t mCrateCubeIndexCount = 0;
 
     QVector<PatrolEnemy> mNPCs;
+
+    // Frustum culling - model space bounds of each mesh, world space spheres of every
+    // collectible and NPC, and the indices that survived this frame's culling
+    MeshBounds mCollectibleMeshBounds;
+    MeshBounds mNPCMeshBounds;
+    MeshBounds mHouseMeshBounds;
+    SphereBounds mCollectibleBounds;
+    SphereBounds mNPCBounds;
+    bool mNPCBoundsDirty = true;            // NPCs moved since their spheres were updated
+    Frustum mFrustum;
+    QMatrix4x4 mCullViewProjection;         // Camera the cached static scenes were culled with
+    std::vector<uint32_t> mVisibleCollectibles;
+    std::vector<uint32_t> mVisibleNPCs;
+    OcclusionBuffer mOcclusionBuffer;
+    bool mSoftwareOcclusion = false;
+
+    // Every mesh packed and optimized once at startup, its buffer holds the vertices and
+    // the indices. Collectibles, NPCs and house walls have levels of detail, every object
+    // keeps the level it was drawn with last, PackedMesh::select needs it for the hysteresis.
+    PackedMesh mGroundMesh;
+    PackedMesh mPlayerMesh;
+    PackedMesh mCollectibleMesh;
+    PackedMesh mNPCMesh;                    // The crate cube
+    PackedMesh mNPCFallbackMeshes[3];
+    PackedMesh mHouseWallsMesh;
+    PackedMesh mHouseDoorMesh;
+    PackedMesh mHouseDoorOpenMesh;
+    PackedMesh mHouseRoofMesh;
+    PackedMesh mIndoorWallsMesh;
+    PackedMesh mExitDoorMesh;
+    std::vector<uint8_t> mCollectibleLevels;
+    std::vector<uint8_t> mNPCLevels;
+    std::vector<uint8_t> mHouseLevels;
+    QVector3D mCullEye;                     // Camera position of the last culling
+    float mLodPixelsPerUnit = 0.0f;         // Pixels of one unit at distance 1 with the current projection
+
+    // Cells and portals: the outdoor world and the entrance house, joined by the door.
+    // cullOutdoorScene fills mVisibleCells, each with the volume it is seen through.
+    PortalCuller mPortals;
+    int mOutsideCell = -1;
+    int mHouseCell = -1;
+    int mDoorPortal = -1;
+    std::vector<PortalCuller::VisibleCell> mVisibleCells;
+
+    // Culling and drawing of collectibles and NPCs on the GPU instead
+    GpuCuller mGpuCuller;
+    HiZPyramid mHiZ;
+    uint32_t mHiZDepthGeneration = ~0u;     // Render graph generation the depth pyramid's depth view is from
+    // Offscreen scene target, only initialized when needsSceneTarget()
+    SceneUpscaler mUpscaler;
+    ResolutionController mResolution;
+    uint32_t mSceneTargetGeneration = ~0u;  // Render graph generation of the images in mUpscaler's framebuffer
+    QSize mSceneSize;                       // Drawn, the swap chain size without dynamic resolution
+    AntiAliasing mAntiAliasing = AntiAliasing::Off;
+    VkSampleCountFlagBits mSceneSamples = VK_SAMPLE_COUNT_1_BIT;   // Of the scene pass, window or offscreen target
+    bool mTemporalAAEnabled = false;
+    TemporalAA mTemporalAA;
+    int mTemporalAAFramesLeft = 0;  // Until the history has settled, frames are rendered for it alone
+    uint64_t mAntiAliasingBytes = 0;
+    bool mGpuCulling = false;
+    uint32_t mGpuCollectibleMesh = 0;
+    uint32_t mGpuNPCMesh = 0;
     
     // Overlay resources for game over screen
     VkPipeline mOverlayPipeline = VK_NULL_HANDLE;
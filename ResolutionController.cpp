@@ -0,0 +1,51 @@
+#include "ResolutionController.h"
+#include <QtGlobal>
+#include <cmath>
+
+void ResolutionController::setTargetMs(double ms)
+{
+    mTargetMs = qMax(0.0, ms);
+    reset();
+}
+
+void ResolutionController::reset()
+{
+    mSkip = 0;
+    mRawScale = MAX_SCALE;
+    mErrors[0] = mErrors[1] = 0.0;
+    mErrorCount = 0;
+    mScale = MAX_SCALE;
+}
+
+bool ResolutionController::update(double gpuMs)
+{
+    if (mTargetMs <= 0.0 || gpuMs <= 0.0)
+        return false;
+    if (mSkip > 0) {
+        mSkip--;
+        return false;
+    }
+
+    // Positive while there is time left, -1 at twice the target
+    const double error = qBound(-1.0, (mTargetMs - gpuMs) / mTargetMs, 1.0);
+    // The first frames have no history, their P and D terms are left out
+    const double previous = mErrorCount > 0 ? mErrors[0] : error;
+    const double beforePrevious = mErrorCount > 1 ? mErrors[1] : previous;
+    mRawScale += KP * (error - previous) + KI * error + KD * (error - 2.0 * previous + beforePrevious);
+    // Clamped, so it can't wind up beyond the range while the scale is at one end
+    mRawScale = qBound(double(MIN_SCALE), mRawScale, double(MAX_SCALE));
+    mErrors[1] = previous;
+    mErrors[0] = error;
+    mErrorCount = qMin(mErrorCount + 1, 2);
+
+    // A step once the raw scale is a whole step away - small jitter leaves the scale alone
+    if (std::fabs(mRawScale - mScale) < STEP && mRawScale > MIN_SCALE && mRawScale < MAX_SCALE)
+        return false;
+    const float steps = std::round(float(mRawScale - MIN_SCALE) / STEP);
+    const float scale = qBound(MIN_SCALE, MIN_SCALE + steps * STEP, MAX_SCALE);
+    if (scale == mScale)
+        return false;
+    mScale = scale;
+    mSkip = mLatency;
+    return true;
+}
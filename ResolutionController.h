@@ -0,0 +1,44 @@
+#pragma once
+
+// Scale of the scene resolution that holds a GPU frame time.
+//
+// A PID controller in velocity form: every measured frame moves the scale by the change of the
+// error (P), the error itself (I) and the change of that change (D). The error is the headroom
+// relative to the target, so the same gains work for any target. GPU time grows with the pixel
+// count, the square of the scale; the controller doesn't model that, the I term makes up for it.
+//
+// The scale that is applied follows in steps of STEP only, every step re-records the cached
+// scene commands. After a step the measurements still belong to frames drawn at the old scale
+// for a while - GPU timings come back concurrentFrameCount() frames late - so those are skipped.
+class ResolutionController
+{
+public:
+    static constexpr float MIN_SCALE = 0.5f;
+    static constexpr float MAX_SCALE = 1.0f;
+    static constexpr float STEP = 0.05f;
+
+    // Frame time to hold, 0 keeps the scale at MAX_SCALE
+    void setTargetMs(double ms);
+    double targetMs() const { return mTargetMs; }
+    // Frames between a step and the first measurement of a frame drawn with it
+    void setLatency(int frames) { mLatency = frames; }
+
+    // GPU time of the newest measured frame. Returns true when scale() changed.
+    bool update(double gpuMs);
+    float scale() const { return mScale; }
+    void reset();
+
+private:
+    // Gains, per frame
+    static constexpr double KP = 0.1;
+    static constexpr double KI = 0.02;
+    static constexpr double KD = 0.02;
+
+    double mTargetMs = 0.0;
+    int mLatency = 2;
+    int mSkip = 0;              // Measurements left from before the last step
+    double mRawScale = MAX_SCALE;
+    double mErrors[2] = {};     // Last error and the one before
+    int mErrorCount = 0;
+    float mScale = MAX_SCALE;
+};
@@ -0,0 +1,127 @@
+#include "SceneGenerator.h"
+#include <QRandomGenerator>
+#include <QtMath>
+
+SceneDescription SceneGenerator::defaultScene()
+{
+    SceneDescription scene;
+    scene.worldSize = 10.0f;
+
+    // Collectibles in a grid, high up so they are clearly visible on the ground plane
+    scene.collectibles = {
+        QVector3D(-6.0f, 1.5f, -6.0f),   // Top left
+        QVector3D( 0.0f, 1.5f, -6.0f),   // Top center
+        QVector3D( 6.0f, 1.5f, -6.0f),   // Top right
+        QVector3D(-6.0f, 1.5f,  6.0f),   // Bottom left
+        QVector3D( 0.0f, 1.5f,  6.0f),   // Bottom center
+        QVector3D( 6.0f, 1.5f,  6.0f)    // Bottom right
+    };
+
+    // Special collectible inside the house
+    scene.indoorCollectibles = { QVector3D(2.0f, 0.0f, -2.0f) };
+
+    // NPC 1: red, patrols horizontally across the top of the map
+    scene.npcs.append({ QVector3D(-8.0f, 2.0f, -5.0f), QVector3D(8.0f, 2.0f, -5.0f), 0.03f });
+    // NPC 2: green, patrols horizontally across the bottom of the map
+    scene.npcs.append({ QVector3D(-8.0f, 0.5f, 5.0f), QVector3D(8.0f, 0.5f, 5.0f), 0.04f });
+    // NPC 3: blue, patrols vertically along the right side
+    scene.npcs.append({ QVector3D(5.0f, 3.0f, -8.0f), QVector3D(5.0f, 3.0f, 8.0f), 0.05f });
+
+    scene.houses = { QVector3D(0.0f, 0.0f, -12.0f) };
+
+    return scene;
+}
+
+SceneDescription SceneGenerator::generate(const SceneConfig &config)
+{
+    SceneDescription scene;
+    scene.worldSize = qMax(config.worldSize, 5.0f);
+
+    // Own generator so the same seed always gives the same scene
+    QRandomGenerator rng(config.seed);
+    auto range = [&rng](float lo, float hi) {
+        return lo + float(rng.generateDouble()) * (hi - lo);
+    };
+
+    // Keep everything a little inside the edge of the ground plane
+    const float extent = scene.worldSize - 1.0f;
+
+    scene.collectibles.reserve(qMax(config.collectibleCount, 0));
+    for (int i = 0; i < config.collectibleCount; ++i)
+        scene.collectibles.append(QVector3D(range(-extent, extent), 1.5f, range(-extent, extent)));
+
+    scene.npcs.reserve(qMax(config.npcCount, 0));
+    for (int i = 0; i < config.npcCount; ++i) {
+        const QVector3D start(range(-extent, extent), range(0.5f, 3.0f), range(-extent, extent));
+
+        // Patrol a straight line of 4-16 units in a random direction, clamped to the world
+        const float angle = range(0.0f, 2.0f * float(M_PI));
+        const float length = range(4.0f, 16.0f);
+        QVector3D end = start + QVector3D(qCos(angle), 0.0f, qSin(angle)) * length;
+        end.setX(qBound(-extent, end.x(), extent));
+        end.setZ(qBound(-extent, end.z(), extent));
+
+        scene.npcs.append({ start, end, range(0.02f, 0.06f) });
+    }
+
+    // Houses are 6x6 units, keep them fully on the ground
+    const float houseExtent = qMax(extent - 3.0f, 0.0f);
+    scene.houses.reserve(qMax(config.houseCount, 1));
+    for (int i = 0; i < config.houseCount; ++i)
+        scene.houses.append(QVector3D(range(-houseExtent, houseExtent), 0.0f, range(-houseExtent, houseExtent)));
+    if (scene.houses.isEmpty())
+        scene.houses.append(QVector3D(0.0f, 0.0f, -houseExtent));   // The game needs one house to enter
+
+    // One collectible somewhere inside each room, away from the walls
+    const int roomCount = qMax(config.indoorRoomCount, 1);
+    const float roomExtent = ROOM_SIZE * 0.5f - 1.0f;
+    scene.indoorCollectibles.reserve(roomCount);
+    for (int room = 0; room < roomCount; ++room) {
+        const QVector3D offset(range(-roomExtent, roomExtent), 0.0f, range(-roomExtent, roomExtent));
+        scene.indoorCollectibles.append(roomCenter(room, roomCount) + offset);
+    }
+
+    return scene;
+}
+
+bool SceneGenerator::presetConfig(const QString &name, SceneConfig &config)
+{
+    // Presets keep the ratio between the entity types and scale the world
+    // so the density stays roughly the same
+    const QString preset = name.toLower();
+    if (preset == QLatin1String("1k")) {
+        config.collectibleCount = 600;
+        config.npcCount = 300;
+        config.houseCount = 50;
+        config.indoorRoomCount = 50;
+        config.worldSize = 150.0f;
+    } else if (preset == QLatin1String("100k")) {
+        config.collectibleCount = 60000;
+        config.npcCount = 30000;
+        config.houseCount = 5000;
+        config.indoorRoomCount = 5000;
+        config.worldSize = 1500.0f;
+    } else if (preset == QLatin1String("1m")) {
+        config.collectibleCount = 600000;
+        config.npcCount = 300000;
+        config.houseCount = 50000;
+        config.indoorRoomCount = 50000;
+        config.worldSize = 5000.0f;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QVector3D SceneGenerator::roomCenter(int room, int roomCount)
+{
+    // Rooms are laid out in a square grid centered on the origin
+    const int columns = qMax(1, qCeil(qSqrt(qreal(roomCount))));
+    const int rows = (roomCount + columns - 1) / columns;
+    const int column = room % columns;
+    const int row = room / columns;
+
+    return QVector3D((column - (columns - 1) * 0.5f) * ROOM_SPACING,
+                     0.0f,
+                     (row - (rows - 1) * 0.5f) * ROOM_SPACING);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QVector>
+#include <QVector3D>
+#include <QString>
+
+// Everything that populates a world, independent of how it is rendered.
+// RenderWindow and GameManager are both initialized from one of these.
+struct SceneDescription
+{
+    struct NPCPatrol {
+        QVector3D pointA;       // Start of the patrol route (also spawn position)
+        QVector3D pointB;       // End of the patrol route
+        float speed;            // Movement per frame
+    };
+
+    QVector<QVector3D> collectibles;        // Outdoor collectibles
+    QVector<QVector3D> indoorCollectibles;  // One collectible per indoor room
+    QVector<NPCPatrol> npcs;
+    QVector<QVector3D> houses;              // The first house is the one that can be entered
+    float worldSize = 10.0f;                // Half extent of the ground plane
+};
+
+// Knobs for the stress-scene generator
+struct SceneConfig
+{
+    int collectibleCount = 6;
+    int npcCount = 3;
+    int houseCount = 1;
+    int indoorRoomCount = 1;
+    float worldSize = 10.0f;
+    quint32 seed = 1;
+};
+
+class SceneGenerator
+{
+public:
+    // The hand-made scene the game has always shipped with:
+    // 6 outdoor collectibles, 1 indoor collectible, 3 NPCs and 1 house
+    static SceneDescription defaultScene();
+
+    // Random but reproducible scene - the same config (incl. seed) gives the same scene
+    static SceneDescription generate(const SceneConfig &config);
+
+    // Fills config with one of the scaling presets: "1k", "100k" or "1m" (total entities)
+    static bool presetConfig(const QString &name, SceneConfig &config);
+
+    // Size of one indoor room and the spacing between rooms in the indoor scene
+    static constexpr float ROOM_SIZE = 6.0f;
+    static constexpr float ROOM_SPACING = 8.0f;
+
+    // Centre of indoor room number 'room' when there are 'roomCount' rooms in total
+    static QVector3D roomCenter(int room, int roomCount);
+};
@@ -0,0 +1,400 @@
+#include "SceneUpscaler.h"
+#include <QVulkanFunctions>
+#include <QFile>
+#include <cmath>
+#include <cstring>
+#include "Log.h"
+
+// Push constants of upscale.frag
+struct UpscaleConstants {
+    float uvScale[2];       // renderSize / target size
+    float texelSize[2];     // 1 / target size
+    float sharpness;
+    int32_t edgeAA;
+};
+
+static bool hasStencil(VkFormat format)
+{
+    return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT
+        || format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_S8_UINT;
+}
+
+void SceneUpscaler::init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions, VkSampleCountFlagBits samples,
+                         const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache)
+{
+    mWindow = window;
+    mDeviceFunctions = deviceFunctions;
+    mSamples = samples;
+
+    // Bilinear, and clamped: the scene only covers part of the target, upscale.frag keeps inside it
+    VkSamplerCreateInfo samplerInfo;
+    memset(&samplerInfo, 0, sizeof(samplerInfo));
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    VkResult err = mDeviceFunctions->vkCreateSampler(mWindow->device(), &samplerInfo, nullptr, &mSampler);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create upscale sampler: %d", err);
+
+    // The framebuffer waits for setImages()
+    createRenderPass();
+    createDescriptorSets();
+    createPipeline(pipelineTemplate, pipelineCache);
+
+    LOG_INFO(Render, "Offscreen scene target: {}x MSAA, FXAA {}", int(mSamples), mEdgeAA ? "on" : "off");
+}
+
+void SceneUpscaler::release()
+{
+    if (!mWindow)
+        return;
+    VkDevice dev = mWindow->device();
+
+    if (mPipeline)
+        mDeviceFunctions->vkDestroyPipeline(dev, mPipeline, nullptr);
+    if (mPipelineLayout)
+        mDeviceFunctions->vkDestroyPipelineLayout(dev, mPipelineLayout, nullptr);
+    // Destroying the pool frees its sets
+    if (mDescriptorPool)
+        mDeviceFunctions->vkDestroyDescriptorPool(dev, mDescriptorPool, nullptr);
+    if (mSetLayout)
+        mDeviceFunctions->vkDestroyDescriptorSetLayout(dev, mSetLayout, nullptr);
+    if (mFramebuffer)
+        mDeviceFunctions->vkDestroyFramebuffer(dev, mFramebuffer, nullptr);
+    if (mRenderPass)
+        mDeviceFunctions->vkDestroyRenderPass(dev, mRenderPass, nullptr);
+    if (mSampler)
+        mDeviceFunctions->vkDestroySampler(dev, mSampler, nullptr);
+    mPipeline = VK_NULL_HANDLE;
+    mPipelineLayout = VK_NULL_HANDLE;
+    mDescriptorPool = VK_NULL_HANDLE;
+    for (VkDescriptorSet &set : mDescriptorSets)
+        set = VK_NULL_HANDLE;
+    mSetLayout = VK_NULL_HANDLE;
+    mFramebuffer = VK_NULL_HANDLE;
+    mRenderPass = VK_NULL_HANDLE;
+    mSampler = VK_NULL_HANDLE;
+    mSize = QSize();
+    mWindow = nullptr;
+}
+
+RenderGraph::ImageDesc SceneUpscaler::colorDesc() const
+{
+    RenderGraph::ImageDesc desc;
+    desc.format = mWindow->colorFormat();
+    desc.swapChainScale = 1.0f;
+    desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    desc.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    return desc;
+}
+
+RenderGraph::ImageDesc SceneUpscaler::depthDesc() const
+{
+    RenderGraph::ImageDesc desc;
+    desc.format = mWindow->depthStencilFormat();
+    desc.swapChainScale = 1.0f;
+    desc.samples = mSamples;
+    desc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    // Barriers on a combined format have to cover both aspects
+    desc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencil(desc.format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+    return desc;
+}
+
+RenderGraph::ImageDesc SceneUpscaler::msaaColorDesc() const
+{
+    RenderGraph::ImageDesc desc = colorDesc();
+    desc.samples = mSamples;
+    desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    return desc;
+}
+
+QSize SceneUpscaler::renderSize(const QSize &swapChainSize, float scale)
+{
+    return QSize(qMax(1, int(std::lround(swapChainSize.width() * scale))),
+                 qMax(1, int(std::lround(swapChainSize.height() * scale))));
+}
+
+void SceneUpscaler::setImages(VkImageView color, VkImageView depth, VkImageView msaaColor, const QSize &size)
+{
+    if (!isInitialized())
+        return;
+    VkDevice dev = mWindow->device();
+    mSize = size;
+
+    // Attachment order of QVulkanWindow: single-sample color, depth, then the multisampled color
+    const VkImageView attachments[3] = { color, depth, msaaColor };
+    if (mFramebuffer)
+        mDeviceFunctions->vkDestroyFramebuffer(dev, mFramebuffer, nullptr);
+    VkFramebufferCreateInfo framebufferInfo;
+    memset(&framebufferInfo, 0, sizeof(framebufferInfo));
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = mRenderPass;
+    framebufferInfo.attachmentCount = isMultisampled() ? 3 : 2;
+    framebufferInfo.pAttachments = attachments;
+    framebufferInfo.width = uint32_t(size.width());
+    framebufferInfo.height = uint32_t(size.height());
+    framebufferInfo.layers = 1;
+    VkResult err = mDeviceFunctions->vkCreateFramebuffer(dev, &framebufferInfo, nullptr, &mFramebuffer);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create scene target framebuffer: %d", err);
+
+    writeSource(SceneColor, color);
+}
+
+void SceneUpscaler::setHistory(VkImageView history0, VkImageView history1)
+{
+    if (!isInitialized())
+        return;
+    writeSource(History0, history0);
+    writeSource(History1, history1);
+}
+
+void SceneUpscaler::writeSource(Source source, VkImageView view)
+{
+    const VkDescriptorImageInfo info = { mSampler, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    VkWriteDescriptorSet write;
+    memset(&write, 0, sizeof(write));
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = mDescriptorSets[source];
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &info;
+    mDeviceFunctions->vkUpdateDescriptorSets(mWindow->device(), 1, &write, 0, nullptr);
+}
+
+void SceneUpscaler::upscale(VkCommandBuffer cb, const QSize &renderSize, const QSize &swapChainSize, Source source)
+{
+    if (!isInitialized() || !mFramebuffer)
+        return;
+
+    mDeviceFunctions->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipeline);
+    mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
+                                              &mDescriptorSets[source], 0, nullptr);
+    VkViewport viewport = {};
+    viewport.width = float(swapChainSize.width());
+    viewport.height = float(swapChainSize.height());
+    viewport.minDepth = 0;
+    viewport.maxDepth = 1;
+    mDeviceFunctions->vkCmdSetViewport(cb, 0, 1, &viewport);
+    VkRect2D scissor = {};
+    scissor.extent.width = uint32_t(swapChainSize.width());
+    scissor.extent.height = uint32_t(swapChainSize.height());
+    mDeviceFunctions->vkCmdSetScissor(cb, 0, 1, &scissor);
+
+    UpscaleConstants constants;
+    constants.uvScale[0] = float(renderSize.width()) / float(mSize.width());
+    constants.uvScale[1] = float(renderSize.height()) / float(mSize.height());
+    constants.texelSize[0] = 1.0f / float(mSize.width());
+    constants.texelSize[1] = 1.0f / float(mSize.height());
+    constants.sharpness = mSharpness;
+    constants.edgeAA = mEdgeAA ? 1 : 0;
+    mDeviceFunctions->vkCmdPushConstants(cb, mPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                                         sizeof(constants), &constants);
+    // One triangle that covers the screen, made up by upscale.vert
+    mDeviceFunctions->vkCmdDraw(cb, 3, 1, 0, 0);
+}
+
+void SceneUpscaler::createRenderPass()
+{
+    const bool msaa = isMultisampled();
+    const VkFormat colorFormat = mWindow->colorFormat();
+
+    // The layouts are the render graph's: it moves the images in and out of the attachment layouts
+    VkAttachmentDescription attachments[3];
+    memset(attachments, 0, sizeof(attachments));
+    attachments[0].format = colorFormat;
+    attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[0].loadOp = msaa ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    attachments[1].format = mWindow->depthStencilFormat();
+    attachments[1].samples = mSamples;
+    attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    attachments[2].format = colorFormat;
+    attachments[2].samples = mSamples;
+    attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[2].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[2].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[2].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    attachments[2].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    // With MSAA the multisampled color is drawn to and resolved into the single-sample one
+    VkAttachmentReference colorReference = { msaa ? 2u : 0u, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    VkAttachmentReference depthReference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+    VkAttachmentReference resolveReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    VkSubpassDescription subpass;
+    memset(&subpass, 0, sizeof(subpass));
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorReference;
+    subpass.pDepthStencilAttachment = &depthReference;
+    subpass.pResolveAttachments = msaa ? &resolveReference : nullptr;
+
+    // The dependencies of QVulkanWindow's render pass, for compatibility - the graph's barriers do the work
+    VkSubpassDependency dependencies[2];
+    memset(dependencies, 0, sizeof(dependencies));
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].dstSubpass = 0;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+                                  | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo;
+    memset(&renderPassInfo, 0, sizeof(renderPassInfo));
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = msaa ? 3 : 2;
+    renderPassInfo.pAttachments = attachments;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 2;
+    renderPassInfo.pDependencies = dependencies;
+    VkResult err = mDeviceFunctions->vkCreateRenderPass(mWindow->device(), &renderPassInfo, nullptr, &mRenderPass);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create scene target render pass: %d", err);
+}
+
+void SceneUpscaler::createPipeline(const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache)
+{
+    VkDevice dev = mWindow->device();
+
+    VkPushConstantRange pushConstants = { VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(UpscaleConstants) };
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo;
+    memset(&pipelineLayoutInfo, 0, sizeof(pipelineLayoutInfo));
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &mSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstants;
+    VkResult err = mDeviceFunctions->vkCreatePipelineLayout(dev, &pipelineLayoutInfo, nullptr, &mPipelineLayout);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create upscale pipeline layout: %d", err);
+
+    VkShaderModule vertShader = createShader(QStringLiteral(":/upscale_vert.spv"));
+    VkShaderModule fragShader = createShader(QStringLiteral(":/upscale_frag.spv"));
+    VkPipelineShaderStageCreateInfo stages[2];
+    memset(stages, 0, sizeof(stages));
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertShader;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragShader;
+    stages[1].pName = "main";
+
+    // The triangle comes from gl_VertexIndex
+    VkPipelineVertexInputStateCreateInfo vertexInput;
+    memset(&vertexInput, 0, sizeof(vertexInput));
+    vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    // Every pixel is written, whatever the depth buffer holds
+    VkPipelineDepthStencilStateCreateInfo ds;
+    memset(&ds, 0, sizeof(ds));
+    ds.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+
+    // The template has the target's samples, the default render pass those of the window
+    VkPipelineMultisampleStateCreateInfo ms;
+    memset(&ms, 0, sizeof(ms));
+    ms.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    ms.rasterizationSamples = mWindow->sampleCountFlagBits();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = pipelineTemplate;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = stages;
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pDepthStencilState = &ds;
+    pipelineInfo.pMultisampleState = &ms;
+    pipelineInfo.layout = mPipelineLayout;
+    pipelineInfo.renderPass = mWindow->defaultRenderPass();
+    pipelineInfo.subpass = 0;
+    err = mDeviceFunctions->vkCreateGraphicsPipelines(dev, pipelineCache, 1, &pipelineInfo, nullptr, &mPipeline);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create upscale pipeline: %d", err);
+
+    if (vertShader)
+        mDeviceFunctions->vkDestroyShaderModule(dev, vertShader, nullptr);
+    if (fragShader)
+        mDeviceFunctions->vkDestroyShaderModule(dev, fragShader, nullptr);
+}
+
+void SceneUpscaler::createDescriptorSets()
+{
+    VkDevice dev = mWindow->device();
+
+    VkDescriptorSetLayoutBinding binding = { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1,
+                                             VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+    VkDescriptorSetLayoutCreateInfo layoutInfo;
+    memset(&layoutInfo, 0, sizeof(layoutInfo));
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+    VkResult err = mDeviceFunctions->vkCreateDescriptorSetLayout(dev, &layoutInfo, nullptr, &mSetLayout);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create upscale descriptor set layout: %d", err);
+
+    VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SourceCount };
+    VkDescriptorPoolCreateInfo poolInfo;
+    memset(&poolInfo, 0, sizeof(poolInfo));
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = SourceCount;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    err = mDeviceFunctions->vkCreateDescriptorPool(dev, &poolInfo, nullptr, &mDescriptorPool);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create upscale descriptor pool: %d", err);
+
+    // Written by setImages() and setHistory(), the history sets stay unused without temporal AA
+    const VkDescriptorSetLayout layouts[SourceCount] = { mSetLayout, mSetLayout, mSetLayout };
+    VkDescriptorSetAllocateInfo allocInfo;
+    memset(&allocInfo, 0, sizeof(allocInfo));
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = mDescriptorPool;
+    allocInfo.descriptorSetCount = SourceCount;
+    allocInfo.pSetLayouts = layouts;
+    err = mDeviceFunctions->vkAllocateDescriptorSets(dev, &allocInfo, mDescriptorSets);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to allocate upscale descriptor sets: %d", err);
+}
+
+VkShaderModule SceneUpscaler::createShader(const QString &name)
+{
+    QFile file(name);
+    if (!file.open(QIODevice::ReadOnly))
+        qFatal("Failed to read shader %s", qPrintable(name));
+    const QByteArray blob = file.readAll();
+
+    VkShaderModuleCreateInfo shaderInfo;
+    memset(&shaderInfo, 0, sizeof(shaderInfo));
+    shaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderInfo.codeSize = size_t(blob.size());
+    shaderInfo.pCode = reinterpret_cast<const uint32_t *>(blob.constData());
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    VkResult err = mDeviceFunctions->vkCreateShaderModule(mWindow->device(), &shaderInfo, nullptr, &shaderModule);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create shader module %s: %d", qPrintable(name), err);
+    return shaderModule;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <QVulkanWindow>
+#include <QSize>
+#include <cstdint>
+#include "RenderGraph.h"
+
+// Offscreen target the scene is drawn into at a fraction of the swap chain size, and the pass
+// that scales it up into the swap chain. Post-process anti-aliasing uses the same target at
+// full size: FXAA is done by that pass, temporal AA reads the target in between.
+//
+// The target images are render graph transients the size of the swap chain. The scene only
+// covers their top left renderSize(), so a new scale needs no new images, just other viewports;
+// the graph creates them anew when the window is resized. renderPass() has the attachments,
+// subpass and dependencies of QVulkanWindow's default render pass, but the samples are the
+// target's: with MSAA only the target is multisampled, the window stays at one sample. The scene
+// pipelines and secondary command buffers are made for renderPass() while the target is in use.
+//
+// upscale() draws one triangle inside the default render pass, bilinear with optional FXAA and
+// sharpening. Whatever is drawn after it in that render pass, the overlay, is at native resolution.
+class SceneUpscaler
+{
+public:
+    // What upscale() reads: the target, or one of TemporalAA's history images
+    enum Source {
+        SceneColor,
+        History0,
+        History1,
+        SourceCount
+    };
+
+    // The target has samples, which the scene pipelines have to be made with. The upscale pipeline
+    // is pipelineTemplate with upscale.vert and upscale.frag, no vertex input, no depth test and
+    // the window's samples, for the default render pass.
+    void init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions, VkSampleCountFlagBits samples,
+              const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache);
+    void release();
+    bool isInitialized() const { return mPipeline != VK_NULL_HANDLE; }
+
+    // Target images, created by the render graph. The multisampled color only exists with MSAA,
+    // the scene is resolved into the color image then.
+    RenderGraph::ImageDesc colorDesc() const;
+    RenderGraph::ImageDesc depthDesc() const;
+    RenderGraph::ImageDesc msaaColorDesc() const;
+    bool isMultisampled() const { return mSamples != VK_SAMPLE_COUNT_1_BIT; }
+
+    // Points the framebuffer and the upscale at the graph's images. Call whenever the graph created
+    // them anew, which it only does once the device is idle. msaaColor may be null without MSAA.
+    void setImages(VkImageView color, VkImageView depth, VkImageView msaaColor, const QSize &size);
+    // TemporalAA's history images, the size of the target. Call whenever they are created anew.
+    void setHistory(VkImageView history0, VkImageView history1);
+
+    VkRenderPass renderPass() const { return mRenderPass; }
+    VkFramebuffer framebuffer() const { return mFramebuffer; }
+
+    // Part of the target the scene is drawn to at scale, at least 1x1
+    static QSize renderSize(const QSize &swapChainSize, float scale);
+
+    // 0 is plain bilinear, 1 the strongest sharpening
+    void setSharpness(float sharpness) { mSharpness = qBound(0.0f, sharpness, 1.0f); }
+    float sharpness() const { return mSharpness; }
+    // FXAA before the sharpening
+    void setEdgeAA(bool enabled) { mEdgeAA = enabled; }
+    bool edgeAA() const { return mEdgeAA; }
+
+    // Inside the default render pass: fills the swap chain with the renderSize part of source,
+    // which has to be in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    void upscale(VkCommandBuffer cb, const QSize &renderSize, const QSize &swapChainSize, Source source = SceneColor);
+
+private:
+    void createRenderPass();
+    void createPipeline(const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache);
+    void createDescriptorSets();
+    void writeSource(Source source, VkImageView view);
+    VkShaderModule createShader(const QString &name);
+
+    QVulkanWindow *mWindow = nullptr;
+    QVulkanDeviceFunctions *mDeviceFunctions = nullptr;
+    VkSampleCountFlagBits mSamples = VK_SAMPLE_COUNT_1_BIT;
+    float mSharpness = 0.0f;
+    bool mEdgeAA = false;
+
+    VkRenderPass mRenderPass = VK_NULL_HANDLE;
+    VkFramebuffer mFramebuffer = VK_NULL_HANDLE;
+    QSize mSize;                    // Of the target images
+
+    // The GPU works through the frames in order and every frame writes the target before the
+    // upscale reads it, so one target and one descriptor set per source serve all frame slots
+    VkSampler mSampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet mDescriptorSets[SourceCount] = {};
+    VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline mPipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,506 @@
+#include "StreamingUploader.h"
+#include <QVulkanFunctions>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "Log.h"
+#include "Trace.h"
+
+static const VkDeviceSize STAGING_SIZE = 16 * 1024 * 1024;
+static const VkDeviceSize STAGING_ALIGNMENT = 16;
+static const int BATCH_COUNT = 8;                       // In flight at most, the worker waits for more
+static const uint64_t RETIRE_TIMEOUT_NS = 1000000;      // Blocking waits give up after 1 ms to look for quit
+
+void StreamingUploader::init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions, const QueueInfo &queue)
+{
+    mWindow = window;
+    mDeviceFunctions = deviceFunctions;
+    VkDevice dev = mWindow->device();
+
+    // Another queue is only of use when it can wait for the graphics queue and the other way round
+    mAsync = queue.family != ~0u && queue.timelineSemaphores;
+    const uint32_t family = mAsync ? queue.family : mWindow->graphicsQueueFamilyIndex();
+    mFamilies[0] = mWindow->graphicsQueueFamilyIndex();
+    mFamilies[1] = family;
+    if (mAsync)
+        mDeviceFunctions->vkGetDeviceQueue(dev, family, queue.index, &mQueue);
+    else
+        mQueue = mWindow->graphicsQueue();
+
+    VkCommandPoolCreateInfo poolInfo;
+    memset(&poolInfo, 0, sizeof(poolInfo));
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = family;
+    VkResult err = mDeviceFunctions->vkCreateCommandPool(dev, &poolInfo, nullptr, &mCommandPool);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create upload command pool: %d", err);
+
+    VkCommandBuffer buffers[BATCH_COUNT];
+    VkCommandBufferAllocateInfo allocInfo;
+    memset(&allocInfo, 0, sizeof(allocInfo));
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = mCommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = BATCH_COUNT;
+    err = mDeviceFunctions->vkAllocateCommandBuffers(dev, &allocInfo, buffers);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to allocate upload command buffers: %d", err);
+
+    VkFenceCreateInfo fenceInfo;
+    memset(&fenceInfo, 0, sizeof(fenceInfo));
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    for (int i = 0; i < BATCH_COUNT; ++i) {
+        Batch batch;
+        batch.cb = buffers[i];
+        err = mDeviceFunctions->vkCreateFence(dev, &fenceInfo, nullptr, &batch.fence);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to create upload fence: %d", err);
+        mFreeBatches.push_back(batch);
+    }
+
+    if (mAsync) {
+        VkSemaphoreTypeCreateInfo typeInfo;
+        memset(&typeInfo, 0, sizeof(typeInfo));
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+        VkSemaphoreCreateInfo semaphoreInfo;
+        memset(&semaphoreInfo, 0, sizeof(semaphoreInfo));
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+        err = mDeviceFunctions->vkCreateSemaphore(dev, &semaphoreInfo, nullptr, &mUploadSemaphore);
+        if (err == VK_SUCCESS)
+            err = mDeviceFunctions->vkCreateSemaphore(dev, &semaphoreInfo, nullptr, &mFrameSemaphore);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to create upload timeline semaphore: %d", err);
+    }
+
+    createStaging(STAGING_SIZE);
+
+    mQuit = false;
+    mThread = std::thread(&StreamingUploader::workerLoop, this);
+
+    LOG_INFO(Vulkan, "Streaming uploads on {} (queue family {}), {} MiB staging",
+             mAsync ? "their own queue" : "the graphics queue", family, STAGING_SIZE / (1024 * 1024));
+}
+
+void StreamingUploader::release()
+{
+    if (!mWindow)
+        return;
+    VkDevice dev = mWindow->device();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWake.notify_all();
+    if (mThread.joinable())
+        mThread.join();
+
+    // Batches still waiting for the graphics queue were never submitted, their fences stay unsignalled
+    if (mAsync)
+        mDeviceFunctions->vkQueueWaitIdle(mQueue);
+    for (const Batch &batch : mInFlight)
+        mDeviceFunctions->vkDestroyFence(dev, batch.fence, nullptr);
+    for (const Batch &batch : mFreeBatches)
+        mDeviceFunctions->vkDestroyFence(dev, batch.fence, nullptr);
+    mInFlight.clear();
+    mFreeBatches.clear();
+    mReady.clear();
+    mPending.clear();
+
+    // Destroying the pool frees its command buffers
+    if (mCommandPool)
+        mDeviceFunctions->vkDestroyCommandPool(dev, mCommandPool, nullptr);
+    if (mUploadSemaphore)
+        mDeviceFunctions->vkDestroySemaphore(dev, mUploadSemaphore, nullptr);
+    if (mFrameSemaphore)
+        mDeviceFunctions->vkDestroySemaphore(dev, mFrameSemaphore, nullptr);
+    mCommandPool = VK_NULL_HANDLE;
+    mUploadSemaphore = VK_NULL_HANDLE;
+    mFrameSemaphore = VK_NULL_HANDLE;
+    mQueue = VK_NULL_HANDLE;
+
+    if (mStaging)
+        mDeviceFunctions->vkUnmapMemory(dev, mStagingMemory);
+    if (mStagingBuffer)
+        mDeviceFunctions->vkDestroyBuffer(dev, mStagingBuffer, nullptr);
+    if (mStagingMemory)
+        mDeviceFunctions->vkFreeMemory(dev, mStagingMemory, nullptr);
+    mStaging = nullptr;
+    mStagingBuffer = VK_NULL_HANDLE;
+    mStagingMemory = VK_NULL_HANDLE;
+    mStagingHead = mStagingTail = 0;
+
+    mBatchValue = 0;
+    mRecordedTicket = 0;
+    mNextTicket = 1;
+    mCompletedValue = 0;
+    mCompletedTicket = 0;
+    mCompletedBytes = 0;
+    mFrameValue = 0;
+    mWaitedValue = 0;
+    mFrameRequested = 0;
+    mUsableTicket = 0;
+    mWindow = nullptr;
+}
+
+void StreamingUploader::prepareBuffer(VkBufferCreateInfo &info) const
+{
+    info.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    // Concurrent sharing saves the queue family ownership transfers
+    if (mFamilies[0] != mFamilies[1]) {
+        info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        info.queueFamilyIndexCount = 2;
+        info.pQueueFamilyIndices = mFamilies;
+    }
+}
+
+StreamingUploader::Ticket StreamingUploader::upload(VkBuffer buffer, VkDeviceSize offset, std::vector<uint8_t> data)
+{
+    if (data.empty())
+        return 0;
+
+    Ticket ticket;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ticket = mNextTicket++;
+        // The next value beginFrame() signals comes after every frame recorded so far
+        const uint64_t afterFrame = mFrameValue.load(std::memory_order_relaxed) + 1;
+        mPending.push_back({ buffer, offset, std::move(data), 0, ticket, afterFrame });
+        if (afterFrame > mFrameRequested.load(std::memory_order_relaxed))
+            mFrameRequested.store(afterFrame, std::memory_order_relaxed);
+    }
+    mWake.notify_one();
+    // Its frame semaphore value, or the submit on the graphics queue, comes with the next frame
+    if (mFrameRequest)
+        mFrameRequest();
+    return ticket;
+}
+
+VkDeviceSize StreamingUploader::beginFrame()
+{
+    if (!mAsync)
+        return submitShared();
+
+    uint64_t completed;
+    Ticket ticket;
+    VkDeviceSize bytes;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        completed = mCompletedValue;
+        ticket = mCompletedTicket;
+        bytes = mCompletedBytes;
+        mCompletedBytes = 0;
+    }
+
+    // Only batches already done are waited for, so the wait never holds up the frame.
+    // The signal lets batches go that write what the frames before read.
+    const bool wait = completed > mWaitedValue;
+    const uint64_t frameValue = mFrameValue.load(std::memory_order_relaxed);
+    const bool signal = mFrameRequested.load(std::memory_order_relaxed) > frameValue;
+    if (wait || signal) {
+        const uint64_t signalValue = frameValue + 1;
+        VkTimelineSemaphoreSubmitInfo timelineInfo;
+        memset(&timelineInfo, 0, sizeof(timelineInfo));
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = wait ? 1 : 0;
+        timelineInfo.pWaitSemaphoreValues = &completed;
+        timelineInfo.signalSemaphoreValueCount = signal ? 1 : 0;
+        timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+        // No command buffers: the wait covers the commands submitted after it, the signal the ones before
+        const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkSubmitInfo submitInfo;
+        memset(&submitInfo, 0, sizeof(submitInfo));
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount = wait ? 1 : 0;
+        submitInfo.pWaitSemaphores = &mUploadSemaphore;
+        submitInfo.pWaitDstStageMask = &waitStage;
+        submitInfo.signalSemaphoreCount = signal ? 1 : 0;
+        submitInfo.pSignalSemaphores = &mFrameSemaphore;
+        VkResult err = mDeviceFunctions->vkQueueSubmit(mWindow->graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to submit upload wait: %d", err);
+
+        if (wait)
+            mWaitedValue = completed;
+        if (signal) {
+            // The worker records what waits for this value from now on
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mFrameValue.store(signalValue, std::memory_order_relaxed);
+            }
+            mWake.notify_one();
+        }
+    }
+    mUsableTicket.store(ticket, std::memory_order_release);
+    return bytes;
+}
+
+void StreamingUploader::wait(Ticket ticket)
+{
+    TRACE_SCOPE("StreamingUploader::wait");
+    while (!isComplete(ticket)) {
+        beginFrame();
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDone.wait_for(lock, std::chrono::milliseconds(1));
+    }
+}
+
+VkDeviceSize StreamingUploader::submitShared()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mReady.empty())
+        return 0;
+
+    // Ahead of the frame on the same queue, the barriers in the batches do the rest
+    VkDeviceSize bytes = 0;
+    for (const Batch &batch : mReady) {
+        VkSubmitInfo submitInfo;
+        memset(&submitInfo, 0, sizeof(submitInfo));
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch.cb;
+        VkResult err = mDeviceFunctions->vkQueueSubmit(mQueue, 1, &submitInfo, batch.fence);
+        if (err != VK_SUCCESS)
+            qFatal("Failed to submit upload batch: %d", err);
+        bytes += batch.bytes;
+    }
+    mUsableTicket.store(mReady.back().lastTicket, std::memory_order_release);
+    mReady.clear();
+    return bytes;
+}
+
+void StreamingUploader::workerLoop()
+{
+    TRACE_THREAD_NAME("Uploader");
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            const auto hasWork = [this] { return mQuit || canRecord(); };
+            // Batches in flight are polled, they have no way to wake the thread
+            if (mInFlight.empty())
+                mWake.wait(lock, hasWork);
+            else
+                mWake.wait_for(lock, std::chrono::milliseconds(1), hasWork);
+            if (mQuit)
+                return;
+        }
+        retire(false);
+        recordBatch();
+    }
+}
+
+bool StreamingUploader::canRecord() const
+{
+    // Requests come in frame order, the ones behind the front wait at least as long
+    if (mPending.empty())
+        return false;
+    return !mAsync || mPending.front().afterFrame <= mFrameValue.load(std::memory_order_relaxed);
+}
+
+bool StreamingUploader::recordBatch()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!canRecord())
+            return false;
+    }
+    // Every batch in flight, or the staging ring full: the oldest has to finish first
+    if (mFreeBatches.empty() || mStagingHead - mStagingTail + STAGING_ALIGNMENT > mStagingSize) {
+        retire(true);
+        if (mFreeBatches.empty())
+            return false;
+    }
+
+    TRACE_SCOPE("StreamingUploader::recordBatch");
+    Batch batch = mFreeBatches.back();
+    batch.afterFrame = 0;
+    batch.bytes = 0;
+
+    VkCommandBufferBeginInfo beginInfo;
+    memset(&beginInfo, 0, sizeof(beginInfo));
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VkResult err = mDeviceFunctions->vkBeginCommandBuffer(batch.cb, &beginInfo);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to begin upload command buffer: %d", err);
+
+    VkMemoryBarrier barrier;
+    memset(&barrier, 0, sizeof(barrier));
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    if (!mAsync) {
+        // On the graphics queue: after the frames that still read what gets overwritten
+        barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        mDeviceFunctions->vkCmdPipelineBarrier(batch.cb, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                               VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (canRecord()) {
+        // Only this thread pops, references to the front survive pushes of other threads
+        Request &request = mPending.front();
+        VkDeviceSize stagingOffset;
+        const VkDeviceSize size = allocateStaging(request.data.size() - request.copied, stagingOffset);
+        if (size == 0)
+            break;
+
+        lock.unlock();
+        memcpy(mStaging + stagingOffset, request.data.data() + request.copied, size);
+        VkBufferCopy region = { stagingOffset, request.offset + request.copied, size };
+        mDeviceFunctions->vkCmdCopyBuffer(batch.cb, mStagingBuffer, request.buffer, 1, &region);
+        lock.lock();
+
+        request.copied += size;
+        batch.bytes += size;
+        batch.afterFrame = std::max(batch.afterFrame, request.afterFrame);
+        if (request.copied == request.data.size()) {
+            mRecordedTicket = request.ticket;
+            mPending.pop_front();
+        }
+    }
+    lock.unlock();
+
+    if (!mAsync) {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        mDeviceFunctions->vkCmdPipelineBarrier(batch.cb, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                               VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+    err = mDeviceFunctions->vkEndCommandBuffer(batch.cb);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to end upload command buffer: %d", err);
+    // The ring was still full, the batch is begun again next time
+    if (batch.bytes == 0)
+        return false;
+
+    mFreeBatches.pop_back();
+    batch.value = ++mBatchValue;
+    batch.stagingEnd = mStagingHead;
+    batch.lastTicket = mRecordedTicket;
+    LOG_DEBUG(Vulkan, "Upload batch {}: {} KiB, requests up to {} complete", batch.value, batch.bytes / 1024,
+              batch.lastTicket);
+
+    if (mAsync) {
+        submitAsync(batch);
+    } else {
+        lock.lock();
+        mReady.push_back(batch);
+        lock.unlock();
+    }
+    mInFlight.push_back(batch);
+    return true;
+}
+
+void StreamingUploader::submitAsync(Batch &batch)
+{
+    VkTimelineSemaphoreSubmitInfo timelineInfo;
+    memset(&timelineInfo, 0, sizeof(timelineInfo));
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = 1;
+    timelineInfo.pWaitSemaphoreValues = &batch.afterFrame;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &batch.value;
+
+    // beginFrame() has submitted the signal of this value already, see canRecord()
+    const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    VkSubmitInfo submitInfo;
+    memset(&submitInfo, 0, sizeof(submitInfo));
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &mFrameSemaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.cb;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &mUploadSemaphore;
+    VkResult err = mDeviceFunctions->vkQueueSubmit(mQueue, 1, &submitInfo, batch.fence);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to submit upload batch: %d", err);
+}
+
+void StreamingUploader::retire(bool block)
+{
+    VkDevice dev = mWindow->device();
+    while (!mInFlight.empty()) {
+        const Batch &batch = mInFlight.front();
+        const VkResult status = block ? mDeviceFunctions->vkWaitForFences(dev, 1, &batch.fence, VK_TRUE, RETIRE_TIMEOUT_NS)
+                                      : mDeviceFunctions->vkGetFenceStatus(dev, batch.fence);
+        if (status != VK_SUCCESS)
+            break;
+        block = false;
+
+        mDeviceFunctions->vkResetFences(dev, 1, &batch.fence);
+        mStagingTail = batch.stagingEnd;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mCompletedValue = batch.value;
+            mCompletedTicket = batch.lastTicket;
+            mCompletedBytes += batch.bytes;
+        }
+        mFreeBatches.push_back(batch);
+        mInFlight.pop_front();
+        mDone.notify_all();
+    }
+}
+
+VkDeviceSize StreamingUploader::allocateStaging(VkDeviceSize size, VkDeviceSize &offset)
+{
+    const uint64_t position = (mStagingHead + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+    if (position >= mStagingTail + mStagingSize)
+        return 0;
+    offset = position % mStagingSize;
+    // Requests bigger than what is left go in pieces, a copy never wraps around the end
+    size = std::min({ size, mStagingSize - offset, mStagingTail + mStagingSize - position });
+    mStagingHead = position + size;
+    return size;
+}
+
+void StreamingUploader::createStaging(VkDeviceSize size)
+{
+    VkDevice dev = mWindow->device();
+
+    VkBufferCreateInfo bufferInfo;
+    memset(&bufferInfo, 0, sizeof(bufferInfo));
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    VkResult err = mDeviceFunctions->vkCreateBuffer(dev, &bufferInfo, nullptr, &mStagingBuffer);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create staging buffer: %d", err);
+
+    VkMemoryRequirements memReq;
+    mDeviceFunctions->vkGetBufferMemoryRequirements(dev, mStagingBuffer, &memReq);
+
+    // Host coherent as well, the copies need no flush
+    const uint32_t memoryIndex = mWindow->hostVisibleMemoryIndex();
+    if (!(memReq.memoryTypeBits & (1u << memoryIndex)))
+        qFatal("Staging buffer can not use memory type %u", memoryIndex);
+
+    VkMemoryAllocateInfo allocInfo;
+    memset(&allocInfo, 0, sizeof(allocInfo));
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReq.size;
+    allocInfo.memoryTypeIndex = memoryIndex;
+    err = mDeviceFunctions->vkAllocateMemory(dev, &allocInfo, nullptr, &mStagingMemory);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to allocate staging memory: %d", err);
+
+    err = mDeviceFunctions->vkBindBufferMemory(dev, mStagingBuffer, mStagingMemory, 0);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to bind staging memory: %d", err);
+
+    void *mapped;
+    err = mDeviceFunctions->vkMapMemory(dev, mStagingMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to map staging memory: %d", err);
+    mStaging = static_cast<uint8_t *>(mapped);
+    mStagingSize = size;
+    mStagingHead = mStagingTail = 0;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <QVulkanWindow>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Copies data into device-local buffers on a queue of its own, off the render thread.
+//
+// upload() may be called from any thread. A worker thread copies the requests into a
+// staging ring, records them as batches of vkCmdCopyBuffer and submits each batch to the
+// transfer queue. Completion is signalled on a timeline semaphore that the graphics queue
+// waits on in beginFrame(), once the batch is done, so rendering never waits for a copy.
+// Uploads into a buffer the GPU still draws from are safe as well: every batch waits on a
+// second timeline semaphore, which beginFrame() signals on the graphics queue behind the
+// frames recorded before the upload was requested. The worker only records a request once
+// that signal is submitted, so nothing on the transfer queue ever waits for a frame that may
+// not come, and a device wait idle can't hang on it. upload() asks for the frame instead.
+//
+// Without a queue of its own, or without timeline semaphores, the worker still records
+// the batches and beginFrame() submits them to the graphics queue ahead of the frame.
+// Queue order and the barriers in the batch synchronize them then.
+class StreamingUploader
+{
+public:
+    typedef uint64_t Ticket;       // 0 is no upload
+    // Asks for a frame, beginFrame() lets the uploads go. Called from the thread of upload().
+    typedef std::function<void()> FrameRequest;
+
+    // The queue VulkanWindow asked for while creating the device
+    struct QueueInfo {
+        uint32_t family = ~0u;      // ~0u: none, the graphics queue is used
+        uint32_t index = 0;
+        bool timelineSemaphores = false;
+    };
+
+    ~StreamingUploader() { release(); }
+
+    void init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions, const QueueInfo &queue);
+    void release();
+
+    bool isAsync() const { return mAsync; }
+    // Before the first upload
+    void setFrameRequest(FrameRequest request) { mFrameRequest = std::move(request); }
+
+    // Makes a buffer a valid destination: transfer usage, and shared with the transfer queue
+    // when that is of another family. The info must not outlive the uploader.
+    void prepareBuffer(VkBufferCreateInfo &info) const;
+
+    // Copies data to buffer at offset. Any thread.
+    Ticket upload(VkBuffer buffer, VkDeviceSize offset, std::vector<uint8_t> data);
+
+    // Render thread, before recording the frame: makes finished uploads usable by this frame
+    // and the ones after it. Returns the bytes that became usable.
+    VkDeviceSize beginFrame();
+    // Frames recorded from now on see the upload
+    bool isComplete(Ticket ticket) const { return ticket <= mUsableTicket.load(std::memory_order_acquire); }
+    // Render thread, blocks until the upload is complete - for loading, not for frames
+    void wait(Ticket ticket);
+
+private:
+    struct Request {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        std::vector<uint8_t> data;
+        VkDeviceSize copied;        // Bytes already in a batch
+        Ticket ticket;
+        uint64_t afterFrame;        // Frame semaphore value that covers the frames using the buffer
+    };
+    struct Batch {
+        VkCommandBuffer cb = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        uint64_t value = 0;         // Upload semaphore value signalled when done
+        uint64_t afterFrame = 0;
+        uint64_t stagingEnd = 0;    // Staging bytes freed when done
+        Ticket lastTicket = 0;      // Newest request fully in this or earlier batches
+        VkDeviceSize bytes = 0;
+    };
+
+    void workerLoop();
+    // Under mMutex: the front request may be recorded, its frame signal is submitted
+    bool canRecord() const;
+    // Worker: records pending requests into one batch, false when it had nothing to record
+    bool recordBatch();
+    void submitAsync(Batch &batch);
+    // Render thread: submits what the worker recorded for the graphics queue, returns its bytes
+    VkDeviceSize submitShared();
+    // Worker: frees the staging memory and batches of finished uploads
+    void retire(bool block);
+    // Contiguous staging range of at most size bytes, 0 bytes when the ring is full
+    VkDeviceSize allocateStaging(VkDeviceSize size, VkDeviceSize &offset);
+    void createStaging(VkDeviceSize size);
+
+    QVulkanWindow *mWindow = nullptr;
+    QVulkanDeviceFunctions *mDeviceFunctions = nullptr;
+    bool mAsync = false;
+    FrameRequest mFrameRequest;
+    uint32_t mFamilies[2] = {};     // Graphics and transfer, for concurrent sharing
+    VkQueue mQueue = VK_NULL_HANDLE;
+    VkCommandPool mCommandPool = VK_NULL_HANDLE;
+    VkSemaphore mUploadSemaphore = VK_NULL_HANDLE;  // Transfer -> graphics
+    VkSemaphore mFrameSemaphore = VK_NULL_HANDLE;   // Graphics -> transfer
+
+    // Staging ring, persistently mapped. Positions only grow, modulo the size is the offset.
+    VkBuffer mStagingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory mStagingMemory = VK_NULL_HANDLE;
+    uint8_t *mStaging = nullptr;
+    VkDeviceSize mStagingSize = 0;
+    uint64_t mStagingHead = 0;
+    uint64_t mStagingTail = 0;
+
+    // Worker only
+    std::vector<Batch> mFreeBatches;
+    std::deque<Batch> mInFlight;
+    uint64_t mBatchValue = 0;
+    Ticket mRecordedTicket = 0;
+
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+    bool mQuit = false;
+    // Under mMutex
+    std::deque<Request> mPending;
+    std::vector<Batch> mReady;      // Recorded for the graphics queue, not submitted yet
+    Ticket mNextTicket = 1;
+    uint64_t mCompletedValue = 0;   // Async: newest batch that is done
+    Ticket mCompletedTicket = 0;
+    VkDeviceSize mCompletedBytes = 0;
+
+    // Written by the render thread
+    std::atomic<uint64_t> mFrameValue{ 0 };     // Last value beginFrame() signalled on the frame semaphore, under mMutex
+    uint64_t mWaitedValue = 0;                  // Last upload value the graphics queue waited for
+    std::atomic<uint64_t> mFrameRequested{ 0 }; // Frame semaphore value the pending batches wait for
+    std::atomic<Ticket> mUsableTicket{ 0 };
+};
@@ -0,0 +1,432 @@
+#include "TemporalAA.h"
+#include <QVulkanFunctions>
+#include <QFile>
+#include <cstring>
+#include "Log.h"
+
+// Push constants of taa.frag
+struct TaaConstants {
+    float uvScale[2];       // renderSize / history size
+    float texelSize[2];     // 1 / history size
+    float blend;            // 1 ignores the history
+};
+
+// Radical inverse of index in base, the Halton sequence: well spread points for any count
+static float halton(int index, int base)
+{
+    float result = 0.0f;
+    float fraction = 1.0f;
+    while (index > 0) {
+        fraction /= float(base);
+        result += fraction * float(index % base);
+        index /= base;
+    }
+    return result;
+}
+
+void TemporalAA::init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions,
+                      const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache)
+{
+    mWindow = window;
+    mDeviceFunctions = deviceFunctions;
+
+    // Reads land on texel centres, linear filtering only matters at the clamped border
+    VkSamplerCreateInfo samplerInfo;
+    memset(&samplerInfo, 0, sizeof(samplerInfo));
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    VkResult err = mDeviceFunctions->vkCreateSampler(mWindow->device(), &samplerInfo, nullptr, &mSampler);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create temporal AA sampler: %d", err);
+
+    // The history images wait for resize()
+    createRenderPass();
+    createDescriptorSets();
+    createPipeline(pipelineTemplate, pipelineCache);
+    mCurrent = 0;
+    mPhase = 0;
+    mHistoryValid = false;
+
+    LOG_INFO(Render, "Temporal AA: {} jitter phases, new frames weighted {}", JITTER_PHASES, BLEND);
+}
+
+void TemporalAA::release()
+{
+    if (!mWindow)
+        return;
+    VkDevice dev = mWindow->device();
+
+    for (Image &image : mHistory)
+        destroyImage(image);
+    if (mPipeline)
+        mDeviceFunctions->vkDestroyPipeline(dev, mPipeline, nullptr);
+    if (mPipelineLayout)
+        mDeviceFunctions->vkDestroyPipelineLayout(dev, mPipelineLayout, nullptr);
+    // Destroying the pool frees its sets
+    if (mDescriptorPool)
+        mDeviceFunctions->vkDestroyDescriptorPool(dev, mDescriptorPool, nullptr);
+    if (mSetLayout)
+        mDeviceFunctions->vkDestroyDescriptorSetLayout(dev, mSetLayout, nullptr);
+    if (mRenderPass)
+        mDeviceFunctions->vkDestroyRenderPass(dev, mRenderPass, nullptr);
+    if (mSampler)
+        mDeviceFunctions->vkDestroySampler(dev, mSampler, nullptr);
+    mPipeline = VK_NULL_HANDLE;
+    mPipelineLayout = VK_NULL_HANDLE;
+    mDescriptorPool = VK_NULL_HANDLE;
+    mDescriptorSets[0] = mDescriptorSets[1] = VK_NULL_HANDLE;
+    mSetLayout = VK_NULL_HANDLE;
+    mRenderPass = VK_NULL_HANDLE;
+    mSampler = VK_NULL_HANDLE;
+    mSceneColor = VK_NULL_HANDLE;
+    mSize = QSize();
+    mHistoryBytes = 0;
+    mWindow = nullptr;
+}
+
+void TemporalAA::resize(const QSize &size)
+{
+    if (!isInitialized() || size == mSize)
+        return;
+
+    for (Image &image : mHistory)
+        destroyImage(image);
+    mSize = size;
+    mHistoryBytes = 0;
+    for (Image &image : mHistory)
+        createImage(image);
+    writeDescriptorSets();
+    mHistoryValid = false;
+}
+
+void TemporalAA::setSceneColor(VkImageView color)
+{
+    if (!isInitialized())
+        return;
+    mSceneColor = color;
+    writeDescriptorSets();
+}
+
+void TemporalAA::beginFrame()
+{
+    mCurrent = 1 - mCurrent;
+    mPhase = (mPhase + 1) % JITTER_PHASES;
+}
+
+QPointF TemporalAA::jitter(const QSize &renderSize) const
+{
+    // Halton starts at index 1, 0 would be the pixel corner every time. Within (-0.5, 0.5) pixels,
+    // and normalized device coordinates span two units across the drawn part of the target.
+    const float x = halton(mPhase + 1, 2) - 0.5f;
+    const float y = halton(mPhase + 1, 3) - 0.5f;
+    return QPointF(2.0 * x / renderSize.width(), 2.0 * y / renderSize.height());
+}
+
+void TemporalAA::resolve(VkCommandBuffer cb, const QSize &renderSize)
+{
+    const Image &target = mHistory[mCurrent];
+    if (!isInitialized() || !target.framebuffer || !mSceneColor)
+        return;
+
+    // The whole drawn part is written, what was there before doesn't matter
+    VkRenderPassBeginInfo rpBeginInfo;
+    memset(&rpBeginInfo, 0, sizeof(rpBeginInfo));
+    rpBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    rpBeginInfo.renderPass = mRenderPass;
+    rpBeginInfo.framebuffer = target.framebuffer;
+    rpBeginInfo.renderArea.extent.width = uint32_t(renderSize.width());
+    rpBeginInfo.renderArea.extent.height = uint32_t(renderSize.height());
+    mDeviceFunctions->vkCmdBeginRenderPass(cb, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    mDeviceFunctions->vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipeline);
+    mDeviceFunctions->vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
+                                              &mDescriptorSets[mCurrent], 0, nullptr);
+    VkViewport viewport = {};
+    viewport.width = float(renderSize.width());
+    viewport.height = float(renderSize.height());
+    viewport.minDepth = 0;
+    viewport.maxDepth = 1;
+    mDeviceFunctions->vkCmdSetViewport(cb, 0, 1, &viewport);
+    mDeviceFunctions->vkCmdSetScissor(cb, 0, 1, &rpBeginInfo.renderArea);
+
+    TaaConstants constants;
+    constants.uvScale[0] = float(renderSize.width()) / float(mSize.width());
+    constants.uvScale[1] = float(renderSize.height()) / float(mSize.height());
+    constants.texelSize[0] = 1.0f / float(mSize.width());
+    constants.texelSize[1] = 1.0f / float(mSize.height());
+    constants.blend = mHistoryValid ? BLEND : 1.0f;
+    mDeviceFunctions->vkCmdPushConstants(cb, mPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                                         sizeof(constants), &constants);
+    mDeviceFunctions->vkCmdDraw(cb, 3, 1, 0, 0);
+
+    mDeviceFunctions->vkCmdEndRenderPass(cb);
+    mHistoryValid = true;
+}
+
+void TemporalAA::createImage(Image &image)
+{
+    VkDevice dev = mWindow->device();
+    const VkFormat format = mWindow->colorFormat();
+
+    VkImageCreateInfo imageInfo;
+    memset(&imageInfo, 0, sizeof(imageInfo));
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = { uint32_t(mSize.width()), uint32_t(mSize.height()), 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkResult err = mDeviceFunctions->vkCreateImage(dev, &imageInfo, nullptr, &image.image);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create temporal AA history image: %d", err);
+
+    VkMemoryRequirements memReq;
+    mDeviceFunctions->vkGetImageMemoryRequirements(dev, image.image, &memReq);
+    // QVulkanWindow's device local type suits images too on all common drivers, otherwise take any allowed type
+    uint32_t memoryIndex = mWindow->deviceLocalMemoryIndex();
+    if (!(memReq.memoryTypeBits & (1u << memoryIndex))) {
+        memoryIndex = 0;
+        while (!(memReq.memoryTypeBits & (1u << memoryIndex)))
+            ++memoryIndex;
+    }
+
+    VkMemoryAllocateInfo allocInfo;
+    memset(&allocInfo, 0, sizeof(allocInfo));
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReq.size;
+    allocInfo.memoryTypeIndex = memoryIndex;
+    err = mDeviceFunctions->vkAllocateMemory(dev, &allocInfo, nullptr, &image.memory);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to allocate temporal AA history memory: %d", err);
+    err = mDeviceFunctions->vkBindImageMemory(dev, image.image, image.memory, 0);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to bind temporal AA history memory: %d", err);
+    mHistoryBytes += memReq.size;
+
+    VkImageViewCreateInfo viewInfo;
+    memset(&viewInfo, 0, sizeof(viewInfo));
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    err = mDeviceFunctions->vkCreateImageView(dev, &viewInfo, nullptr, &image.view);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create temporal AA history view: %d", err);
+
+    VkFramebufferCreateInfo framebufferInfo;
+    memset(&framebufferInfo, 0, sizeof(framebufferInfo));
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = mRenderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &image.view;
+    framebufferInfo.width = uint32_t(mSize.width());
+    framebufferInfo.height = uint32_t(mSize.height());
+    framebufferInfo.layers = 1;
+    err = mDeviceFunctions->vkCreateFramebuffer(dev, &framebufferInfo, nullptr, &image.framebuffer);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create temporal AA framebuffer: %d", err);
+}
+
+void TemporalAA::destroyImage(Image &image)
+{
+    VkDevice dev = mWindow->device();
+    if (image.framebuffer)
+        mDeviceFunctions->vkDestroyFramebuffer(dev, image.framebuffer, nullptr);
+    if (image.view)
+        mDeviceFunctions->vkDestroyImageView(dev, image.view, nullptr);
+    if (image.image)
+        mDeviceFunctions->vkDestroyImage(dev, image.image, nullptr);
+    if (image.memory)
+        mDeviceFunctions->vkFreeMemory(dev, image.memory, nullptr);
+    image = Image();
+}
+
+void TemporalAA::writeDescriptorSets()
+{
+    // Whatever isn't there yet is written by the call that brings it
+    VkDescriptorImageInfo infos[2][2];
+    VkWriteDescriptorSet writes[4];
+    uint32_t writeCount = 0;
+    for (int set = 0; set < 2; ++set) {
+        const VkImageView views[2] = { mSceneColor, mHistory[1 - set].view };
+        for (uint32_t binding = 0; binding < 2; ++binding) {
+            if (!views[binding])
+                continue;
+            infos[set][binding] = { mSampler, views[binding], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+            VkWriteDescriptorSet &write = writes[writeCount++];
+            memset(&write, 0, sizeof(write));
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = mDescriptorSets[set];
+            write.dstBinding = binding;
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write.pImageInfo = &infos[set][binding];
+        }
+    }
+    if (writeCount > 0)
+        mDeviceFunctions->vkUpdateDescriptorSets(mWindow->device(), writeCount, writes, 0, nullptr);
+}
+
+void TemporalAA::createRenderPass()
+{
+    // The render graph moves the history in and out of the attachment layout
+    VkAttachmentDescription attachment;
+    memset(&attachment, 0, sizeof(attachment));
+    attachment.format = mWindow->colorFormat();
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    VkSubpassDescription subpass;
+    memset(&subpass, 0, sizeof(subpass));
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorReference;
+
+    VkRenderPassCreateInfo renderPassInfo;
+    memset(&renderPassInfo, 0, sizeof(renderPassInfo));
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &attachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    VkResult err = mDeviceFunctions->vkCreateRenderPass(mWindow->device(), &renderPassInfo, nullptr, &mRenderPass);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create temporal AA render pass: %d", err);
+}
+
+void TemporalAA::createPipeline(const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache)
+{
+    VkDevice dev = mWindow->device();
+
+    VkPushConstantRange pushConstants = { VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(TaaConstants) };
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo;
+    memset(&pipelineLayoutInfo, 0, sizeof(pipelineLayoutInfo));
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &mSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstants;
+    VkResult err = mDeviceFunctions->vkCreatePipelineLayout(dev, &pipelineLayoutInfo, nullptr, &mPipelineLayout);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create temporal AA pipeline layout: %d", err);
+
+    VkShaderModule vertShader = createShader(QStringLiteral(":/upscale_vert.spv"));
+    VkShaderModule fragShader = createShader(QStringLiteral(":/taa_frag.spv"));
+    VkPipelineShaderStageCreateInfo stages[2];
+    memset(stages, 0, sizeof(stages));
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertShader;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragShader;
+    stages[1].pName = "main";
+
+    // The triangle comes from gl_VertexIndex
+    VkPipelineVertexInputStateCreateInfo vertexInput;
+    memset(&vertexInput, 0, sizeof(vertexInput));
+    vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    // The history is single-sampled whatever the scene uses
+    VkPipelineMultisampleStateCreateInfo ms;
+    memset(&ms, 0, sizeof(ms));
+    ms.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    ms.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = pipelineTemplate;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = stages;
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pMultisampleState = &ms;
+    // No depth attachment in the render pass
+    pipelineInfo.pDepthStencilState = nullptr;
+    pipelineInfo.layout = mPipelineLayout;
+    pipelineInfo.renderPass = mRenderPass;
+    pipelineInfo.subpass = 0;
+    err = mDeviceFunctions->vkCreateGraphicsPipelines(dev, pipelineCache, 1, &pipelineInfo, nullptr, &mPipeline);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create temporal AA pipeline: %d", err);
+
+    if (vertShader)
+        mDeviceFunctions->vkDestroyShaderModule(dev, vertShader, nullptr);
+    if (fragShader)
+        mDeviceFunctions->vkDestroyShaderModule(dev, fragShader, nullptr);
+}
+
+void TemporalAA::createDescriptorSets()
+{
+    VkDevice dev = mWindow->device();
+
+    // The new frame, and the history it is blended with
+    VkDescriptorSetLayoutBinding bindings[2] = {
+        { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+        { 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr }
+    };
+    VkDescriptorSetLayoutCreateInfo layoutInfo;
+    memset(&layoutInfo, 0, sizeof(layoutInfo));
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+    VkResult err = mDeviceFunctions->vkCreateDescriptorSetLayout(dev, &layoutInfo, nullptr, &mSetLayout);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create temporal AA descriptor set layout: %d", err);
+
+    VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 };
+    VkDescriptorPoolCreateInfo poolInfo;
+    memset(&poolInfo, 0, sizeof(poolInfo));
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 2;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    err = mDeviceFunctions->vkCreateDescriptorPool(dev, &poolInfo, nullptr, &mDescriptorPool);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create temporal AA descriptor pool: %d", err);
+
+    // Written by resize() and setSceneColor()
+    const VkDescriptorSetLayout layouts[2] = { mSetLayout, mSetLayout };
+    VkDescriptorSetAllocateInfo allocInfo;
+    memset(&allocInfo, 0, sizeof(allocInfo));
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = mDescriptorPool;
+    allocInfo.descriptorSetCount = 2;
+    allocInfo.pSetLayouts = layouts;
+    err = mDeviceFunctions->vkAllocateDescriptorSets(dev, &allocInfo, mDescriptorSets);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to allocate temporal AA descriptor sets: %d", err);
+}
+
+VkShaderModule TemporalAA::createShader(const QString &name)
+{
+    QFile file(name);
+    if (!file.open(QIODevice::ReadOnly))
+        qFatal("Failed to read shader %s", qPrintable(name));
+    const QByteArray blob = file.readAll();
+
+    VkShaderModuleCreateInfo shaderInfo;
+    memset(&shaderInfo, 0, sizeof(shaderInfo));
+    shaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderInfo.codeSize = size_t(blob.size());
+    shaderInfo.pCode = reinterpret_cast<const uint32_t *>(blob.constData());
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    VkResult err = mDeviceFunctions->vkCreateShaderModule(mWindow->device(), &shaderInfo, nullptr, &shaderModule);
+    if (err != VK_SUCCESS)
+        qFatal("Failed to create shader module %s: %d", qPrintable(name), err);
+    return shaderModule;
+}
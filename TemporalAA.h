@@ -0,0 +1,94 @@
+#pragma once
+
+#include <QVulkanWindow>
+#include <QPointF>
+#include <QSize>
+#include <cstdint>
+
+// Temporal anti-aliasing: every frame the projection is moved by a different fraction of a
+// pixel, and the frames are blended into a history image. Over JITTER_PHASES frames each pixel
+// collects samples from across its area, what MSAA would take as many samples per frame for.
+//
+// The camera follows no motion vectors, so the history isn't reprojected. Instead it is clamped
+// to the colors around the pixel in the new frame (neighbourhood clamping): what moved away can't
+// stay behind as a ghost longer than a frame or two, at the price of some flicker on thin edges.
+//
+// There are two history images the size of the swap chain, read and written in turns. The scene
+// covers their top left renderSize() like it covers the scene target, see SceneUpscaler.h.
+// The render graph tracks their layouts, they are imported by the caller.
+class TemporalAA
+{
+public:
+    static constexpr int JITTER_PHASES = 8;
+    // Weight of the new frame, the history keeps the rest
+    static constexpr float BLEND = 0.1f;
+    // Frames until a still image has settled: whole jitter cycles, after which the frame of the
+    // last change weighs (1 - BLEND)^32, about 3%
+    static constexpr int SETTLE_FRAMES = 4 * JITTER_PHASES;
+
+    // The resolve pipeline is pipelineTemplate with upscale.vert and taa.frag, single-sampled,
+    // without vertex input and depth. It draws into a render pass of its own.
+    void init(QVulkanWindow *window, QVulkanDeviceFunctions *deviceFunctions,
+              const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache);
+    void release();
+    bool isInitialized() const { return mPipeline != VK_NULL_HANDLE; }
+
+    // Creates the history images anew at the swap chain size. The device has to be idle.
+    void resize(const QSize &size);
+    // The scene target the resolve reads. Call whenever the render graph created it anew.
+    void setSceneColor(VkImageView color);
+
+    // Swaps the history images and moves on to the next jitter phase, once per frame
+    void beginFrame();
+    // Offset to add to the projected x and y (in normalized device coordinates) this frame
+    QPointF jitter(const QSize &renderSize) const;
+    // The next resolve starts over from the new frame: after a resize, a new scale, a new scene
+    void resetHistory() { mHistoryValid = false; }
+
+    // History image written this frame, and the one from the frame before
+    int current() const { return mCurrent; }
+    int previous() const { return 1 - mCurrent; }
+    VkImage historyImage(int index) const { return mHistory[index].image; }
+    VkImageView historyView(int index) const { return mHistory[index].view; }
+    VkDeviceSize historyBytes() const { return mHistoryBytes; }
+
+    // Outside any render pass: blends the scene color, in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    // like the previous history, into the current history, in VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+    void resolve(VkCommandBuffer cb, const QSize &renderSize);
+
+private:
+    struct Image {
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    };
+
+    void createImage(Image &image);
+    void destroyImage(Image &image);
+    void writeDescriptorSets();
+    void createRenderPass();
+    void createPipeline(const VkGraphicsPipelineCreateInfo &pipelineTemplate, VkPipelineCache pipelineCache);
+    void createDescriptorSets();
+    VkShaderModule createShader(const QString &name);
+
+    QVulkanWindow *mWindow = nullptr;
+    QVulkanDeviceFunctions *mDeviceFunctions = nullptr;
+
+    Image mHistory[2];
+    QSize mSize;                    // Of the history images
+    VkDeviceSize mHistoryBytes = 0;
+    VkImageView mSceneColor = VK_NULL_HANDLE;
+    int mCurrent = 0;
+    int mPhase = 0;
+    bool mHistoryValid = false;
+
+    VkSampler mSampler = VK_NULL_HANDLE;
+    VkRenderPass mRenderPass = VK_NULL_HANDLE;
+    // Set i reads the scene color and history 1 - i, for writing history i
+    VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet mDescriptorSets[2] = {};
+    VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline mPipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,392 @@
+#include "Trace.h"
+#include <QFile>
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct Event
+{
+    const char *name;
+    uint64_t beginNs;
+    uint64_t endNs;         // Same as beginNs for instant events
+    bool instant;
+};
+
+// Ring of the newest events of one thread.
+// Only the owning thread writes, so writing is a plain store plus one release store of the index.
+// A reader copies the events and then throws away the ones the writer could have overwritten meanwhile.
+struct ThreadBuffer
+{
+    static constexpr uint32_t CAPACITY = 1 << 15;   // Power of two
+
+    Event events[CAPACITY];
+    std::atomic<uint64_t> writeIndex{ 0 };
+    // The thread using the buffer and where its events start, both set under sRegistryMutex.
+    // A buffer is passed on when its thread exits, what came before is the previous thread's.
+    uint64_t threadId = 0;
+    uint64_t firstIndex = 0;
+    std::atomic<const char *> threadName{ nullptr };
+
+    // Open TRACE_BEGIN stages, only touched by the owning thread
+    static constexpr int MAX_DEPTH = 32;
+    const char *stageNames[MAX_DEPTH];
+    uint64_t stageBegins[MAX_DEPTH];
+    int depth = 0;
+
+    void push(const Event &event)
+    {
+        const uint64_t index = writeIndex.load(std::memory_order_relaxed);
+        events[index & (CAPACITY - 1)] = event;
+        writeIndex.store(index + 1, std::memory_order_release);
+    }
+
+    // Copies the events that are still intact, oldest first
+    std::vector<Event> snapshot() const
+    {
+        const uint64_t end = writeIndex.load(std::memory_order_acquire);
+        const uint64_t begin = std::max<uint64_t>(end > CAPACITY ? end - CAPACITY : 0, firstIndex);
+
+        std::vector<Event> copy;
+        copy.reserve(size_t(end - begin));
+        for (uint64_t i = begin; i < end; ++i)
+            copy.push_back(events[i & (CAPACITY - 1)]);
+
+        // The copies above must not move past the second read of the index. The writer may be
+        // in the middle of the slot at the new write index, CAPACITY behind it, so that one is
+        // thrown away along with everything older.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t endAfter = writeIndex.load(std::memory_order_relaxed);
+        const uint64_t firstValid = endAfter + 1 > CAPACITY ? endAfter + 1 - CAPACITY : 0;
+        if (firstValid > begin)
+            copy.erase(copy.begin(), copy.begin() + qMin<size_t>(size_t(firstValid - begin), copy.size()));
+        return copy;
+    }
+};
+
+// Buffers are registered once and never freed. The buffer of a thread that exited goes to
+// sFreeBuffers, a flush still reads its events until a new thread takes it over, so threads
+// that come and go (the recording threads after a new thread count) need no new ones.
+std::mutex sRegistryMutex;
+std::vector<ThreadBuffer *> sRegistry;
+std::vector<ThreadBuffer *> sFreeBuffers;
+std::atomic<uint64_t> sNextThreadId{ 1 };
+std::atomic<bool> sEnabled{ true };
+
+const std::chrono::steady_clock::time_point sEpoch = std::chrono::steady_clock::now();
+
+// Hands the thread's buffer back when the thread exits
+struct ThreadBufferOwner
+{
+    ThreadBuffer *buffer = nullptr;
+
+    ~ThreadBufferOwner()
+    {
+        if (!buffer)
+            return;
+        std::lock_guard<std::mutex> lock(sRegistryMutex);
+        sFreeBuffers.push_back(buffer);
+        buffer = nullptr;
+    }
+};
+
+ThreadBuffer *threadBuffer()
+{
+    thread_local ThreadBufferOwner owner;
+    if (!owner.buffer) {
+        std::lock_guard<std::mutex> lock(sRegistryMutex);
+        ThreadBuffer *buffer;
+        if (!sFreeBuffers.empty()) {
+            buffer = sFreeBuffers.back();
+            sFreeBuffers.pop_back();
+            // Only this thread writes from now on, the previous one's events are left behind
+            buffer->firstIndex = buffer->writeIndex.load(std::memory_order_relaxed);
+            buffer->threadName.store(nullptr, std::memory_order_relaxed);
+            buffer->depth = 0;
+        } else {
+            buffer = new ThreadBuffer;
+            sRegistry.push_back(buffer);
+        }
+        buffer->threadId = sNextThreadId.fetch_add(1, std::memory_order_relaxed);
+        owner.buffer = buffer;
+    }
+    return owner.buffer;
+}
+
+struct ThreadSnapshot
+{
+    uint64_t threadId;
+    const char *threadName;
+    std::vector<Event> events;
+};
+
+std::vector<ThreadSnapshot> snapshotAll()
+{
+    // Under the lock no buffer changes hands while it is copied
+    std::lock_guard<std::mutex> lock(sRegistryMutex);
+    std::vector<ThreadSnapshot> snapshots;
+    for (const ThreadBuffer *buffer : sRegistry)
+        snapshots.push_back({ buffer->threadId, buffer->threadName.load(std::memory_order_acquire), buffer->snapshot() });
+    return snapshots;
+}
+
+QByteArray jsonString(const char *text)
+{
+    QByteArray escaped = "\"";
+    for (const char *c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\')
+            escaped += '\\';
+        escaped += *c;
+    }
+    escaped += '"';
+    return escaped;
+}
+
+// Minimal protobuf writer for the few Perfetto messages we need
+void putVarint(QByteArray &out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out += char((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += char(value);
+}
+
+void putVarintField(QByteArray &out, uint32_t field, uint64_t value)
+{
+    putVarint(out, (uint64_t(field) << 3) | 0);
+    putVarint(out, value);
+}
+
+void putBytesField(QByteArray &out, uint32_t field, const QByteArray &bytes)
+{
+    putVarint(out, (uint64_t(field) << 3) | 2);
+    putVarint(out, uint64_t(bytes.size()));
+    out += bytes;
+}
+
+// Perfetto field numbers (perfetto/trace/trace_packet.proto and track_event/*.proto)
+enum : uint32_t {
+    TRACE_PACKET = 1,                           // Trace.packet
+    PACKET_TIMESTAMP = 8,                       // TracePacket.timestamp
+    PACKET_SEQUENCE_ID = 10,                    // TracePacket.trusted_packet_sequence_id
+    PACKET_TRACK_EVENT = 11,                    // TracePacket.track_event
+    PACKET_SEQUENCE_FLAGS = 13,                 // TracePacket.sequence_flags
+    PACKET_TRACK_DESCRIPTOR = 60,               // TracePacket.track_descriptor
+    TRACK_EVENT_TYPE = 9,                       // TrackEvent.type
+    TRACK_EVENT_TRACK_UUID = 11,                // TrackEvent.track_uuid
+    TRACK_EVENT_NAME = 23,                      // TrackEvent.name
+    TRACK_DESCRIPTOR_UUID = 1,                  // TrackDescriptor.uuid
+    TRACK_DESCRIPTOR_THREAD = 4,                // TrackDescriptor.thread
+    THREAD_PID = 1,                             // ThreadDescriptor.pid
+    THREAD_TID = 2,                             // ThreadDescriptor.tid
+    THREAD_NAME = 5,                            // ThreadDescriptor.thread_name
+    TYPE_SLICE_BEGIN = 1,
+    TYPE_SLICE_END = 2,
+    TYPE_INSTANT = 3,
+    SEQ_INCREMENTAL_STATE_CLEARED = 1
+};
+
+void putTrackEvent(QByteArray &trace, uint64_t sequenceId, uint64_t uuid, uint64_t timestamp,
+                   uint32_t type, const char *name)
+{
+    QByteArray event;
+    putVarintField(event, TRACK_EVENT_TYPE, type);
+    putVarintField(event, TRACK_EVENT_TRACK_UUID, uuid);
+    if (name)
+        putBytesField(event, TRACK_EVENT_NAME, QByteArray(name));
+
+    QByteArray packet;
+    putVarintField(packet, PACKET_TIMESTAMP, timestamp);
+    putVarintField(packet, PACKET_SEQUENCE_ID, sequenceId);
+    putBytesField(packet, PACKET_TRACK_EVENT, event);
+    putBytesField(trace, TRACE_PACKET, packet);
+}
+
+bool writeFile(const QString &fileName, const QByteArray &data)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Trace: could not write" << fileName;
+        return false;
+    }
+    file.write(data);
+    return true;
+}
+
+} // namespace
+
+uint64_t Trace::now()
+{
+    // Never 0, so 0 can mean "not recording" in Trace::Scope
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - sEpoch).count()) + 1;
+}
+
+void Trace::complete(const char *name, uint64_t beginNs, uint64_t endNs)
+{
+    threadBuffer()->push({ name, beginNs, endNs, false });
+}
+
+void Trace::instant(const char *name)
+{
+    if (!isEnabled())
+        return;
+    const uint64_t timestamp = now();
+    threadBuffer()->push({ name, timestamp, timestamp, true });
+}
+
+void Trace::begin(const char *name)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    if (buffer->depth < ThreadBuffer::MAX_DEPTH) {
+        buffer->stageNames[buffer->depth] = name;
+        buffer->stageBegins[buffer->depth] = isEnabled() ? now() : 0;
+    }
+    buffer->depth++;
+}
+
+void Trace::end()
+{
+    ThreadBuffer *buffer = threadBuffer();
+    if (buffer->depth == 0)
+        return;
+    buffer->depth--;
+    if (buffer->depth < ThreadBuffer::MAX_DEPTH && buffer->stageBegins[buffer->depth] != 0)
+        buffer->push({ buffer->stageNames[buffer->depth], buffer->stageBegins[buffer->depth], now(), false });
+}
+
+int Trace::stageDepth()
+{
+    return threadBuffer()->depth;
+}
+
+void Trace::endStagesAbove(int depth)
+{
+    while (threadBuffer()->depth > depth)
+        end();
+}
+
+void Trace::setThreadName(const char *name)
+{
+    threadBuffer()->threadName.store(name, std::memory_order_release);
+}
+
+void Trace::setEnabled(bool enabled)
+{
+    sEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Trace::isEnabled()
+{
+    return sEnabled.load(std::memory_order_relaxed);
+}
+
+bool Trace::writeChromeJson(const QString &fileName)
+{
+    const std::vector<ThreadSnapshot> threads = snapshotAll();
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    // Chrome trace event format, timestamps in microseconds
+    QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto append = [&json, &first](const QByteArray &line) {
+        if (!first)
+            json += ",\n";
+        json += line;
+        first = false;
+    };
+
+    size_t eventCount = 0;
+    for (const ThreadSnapshot &thread : threads) {
+        const QByteArray ids = QByteArray(",\"pid\":") + QByteArray::number(pid)
+                             + ",\"tid\":" + QByteArray::number(thread.threadId);
+        if (thread.threadName) {
+            append("{\"name\":\"thread_name\",\"ph\":\"M\"" + ids
+                   + ",\"args\":{\"name\":" + jsonString(thread.threadName) + "}}");
+        }
+        for (const Event &event : thread.events) {
+            QByteArray line = "{\"name\":" + jsonString(event.name) + ids
+                            + ",\"ts\":" + QByteArray::number(event.beginNs / 1000.0, 'f', 3);
+            if (event.instant)
+                line += ",\"ph\":\"i\",\"s\":\"t\"}";
+            else
+                line += ",\"ph\":\"X\",\"dur\":" + QByteArray::number((event.endNs - event.beginNs) / 1000.0, 'f', 3) + "}";
+            append(line);
+        }
+        eventCount += thread.events.size();
+    }
+    json += "\n]}\n";
+
+    qDebug() << "Trace: wrote" << eventCount << "events to" << fileName;
+    return writeFile(fileName, json);
+}
+
+bool Trace::writePerfetto(const QString &fileName)
+{
+    const std::vector<ThreadSnapshot> threads = snapshotAll();
+    const uint64_t pid = uint64_t(QCoreApplication::applicationPid());
+
+    // One track and one packet sequence per thread. Slices become begin/end pairs,
+    // which nest correctly because each thread's events are well formed scopes.
+    QByteArray trace;
+    size_t eventCount = 0;
+    for (const ThreadSnapshot &thread : threads) {
+        const uint64_t uuid = thread.threadId;
+        const uint64_t sequenceId = thread.threadId;
+
+        QByteArray threadDescriptor;
+        putVarintField(threadDescriptor, THREAD_PID, pid);
+        putVarintField(threadDescriptor, THREAD_TID, thread.threadId);
+        if (thread.threadName)
+            putBytesField(threadDescriptor, THREAD_NAME, QByteArray(thread.threadName));
+
+        QByteArray trackDescriptor;
+        putVarintField(trackDescriptor, TRACK_DESCRIPTOR_UUID, uuid);
+        putBytesField(trackDescriptor, TRACK_DESCRIPTOR_THREAD, threadDescriptor);
+
+        QByteArray packet;
+        putVarintField(packet, PACKET_SEQUENCE_ID, sequenceId);
+        putVarintField(packet, PACKET_SEQUENCE_FLAGS, SEQ_INCREMENTAL_STATE_CLEARED);
+        putBytesField(packet, PACKET_TRACK_DESCRIPTOR, trackDescriptor);
+        putBytesField(trace, TRACE_PACKET, packet);
+
+        // Scopes are recorded when they end, so inner slices come before outer ones.
+        // Turn them into begin/end markers sorted by time, ends before begins at equal times.
+        // pairTime is the other end of the slice, used to keep outer slices around inner ones
+        struct Marker { uint64_t time; uint64_t pairTime; uint32_t type; const char *name; };
+        std::vector<Marker> markers;
+        markers.reserve(thread.events.size() * 2);
+        for (const Event &event : thread.events) {
+            if (event.instant) {
+                markers.push_back({ event.beginNs, event.beginNs, TYPE_INSTANT, event.name });
+            } else {
+                markers.push_back({ event.beginNs, event.endNs, TYPE_SLICE_BEGIN, event.name });
+                markers.push_back({ event.endNs, event.beginNs, TYPE_SLICE_END, nullptr });
+            }
+        }
+        std::stable_sort(markers.begin(), markers.end(), [](const Marker &a, const Marker &b) {
+            if (a.time != b.time)
+                return a.time < b.time;
+            const bool aEnd = a.type == TYPE_SLICE_END;
+            const bool bEnd = b.type == TYPE_SLICE_END;
+            if (aEnd != bEnd)
+                return aEnd;
+            // Two begins: the one ending later is the outer slice. Two ends: the one that began later is the inner slice.
+            return a.pairTime > b.pairTime;
+        });
+
+        for (const Marker &marker : markers)
+            putTrackEvent(trace, sequenceId, uuid, marker.time, marker.type, marker.name);
+        eventCount += thread.events.size();
+    }
+
+    qDebug() << "Trace: wrote" << eventCount << "events to" << fileName;
+    return writeFile(fileName, trace);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QString>
+#include <cstdint>
+
+// Timeline tracing that can be viewed in chrome://tracing or ui.perfetto.dev.
+//
+//   TRACE_SCOPE("startNextFrame");       // Marks the rest of the enclosing block
+//   TRACE_BEGIN("upload"); ... TRACE_END();   // For stages inside one long function
+//   TRACE_SCOPE_STAGED("initResources");  // Like TRACE_SCOPE, also closes stages left open by an early return
+//   TRACE_INSTANT("scene change");
+//
+// Names must be string literals (only the pointer is stored).
+// Every thread writes into its own lock-free ring buffer, so the newest events
+// are always kept and can be flushed to a file at any time (F9 in the game).
+// Built without QTVK_ENABLE_TRACE the macros expand to nothing.
+
+namespace Trace
+{
+    // Nanoseconds since the first trace call of the process
+    uint64_t now();
+
+    // Records one finished slice or an instant event on the calling thread
+    void complete(const char *name, uint64_t beginNs, uint64_t endNs);
+    void instant(const char *name);
+
+    // Stack of open TRACE_BEGIN stages on the calling thread
+    void begin(const char *name);
+    void end();
+    int stageDepth();
+    void endStagesAbove(int depth);
+
+    // Name shown for the calling thread in the viewer
+    void setThreadName(const char *name);
+
+    // Recording can be paused at runtime, the macros then only test a flag
+    void setEnabled(bool enabled);
+    bool isEnabled();
+
+    // Write everything that is still in the ring buffers of all threads
+    bool writeChromeJson(const QString &fileName);
+    bool writePerfetto(const QString &fileName);
+
+    // Marks the lifetime of a C++ scope
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name) : mName(name), mBegin(isEnabled() ? now() : 0) {}
+        ~Scope()
+        {
+            if (mBegin != 0)
+                complete(mName, mBegin, now());
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *mName;
+        uint64_t mBegin;
+    };
+
+    // Scope for functions using TRACE_BEGIN/TRACE_END that may return in the middle of a stage
+    class StagedScope : public Scope
+    {
+    public:
+        explicit StagedScope(const char *name) : Scope(name), mDepth(stageDepth()) {}
+        ~StagedScope() { endStagesAbove(mDepth); }
+
+    private:
+        int mDepth;
+    };
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef QTVK_ENABLE_TRACE
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_SCOPE_STAGED(name) Trace::StagedScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_BEGIN(name) Trace::begin(name)
+#define TRACE_END() Trace::end()
+#define TRACE_INSTANT(name) Trace::instant(name)
+#define TRACE_THREAD_NAME(name) Trace::setThreadName(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_STAGED(name) ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END() ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
@@ -0,0 +1,59 @@
+#include "VertexFormat.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void VertexAttribute::Float3::write(const float *source, uint8_t *destination)
+{
+    memcpy(destination, source, size);
+}
+
+void VertexAttribute::Half4::write(const float *source, uint8_t *destination)
+{
+    const uint16_t half[4] = { toHalf(source[0]), toHalf(source[1]), toHalf(source[2]), toHalf(1.0f) };
+    memcpy(destination, half, size);
+}
+
+void VertexAttribute::Unorm8x4::write(const float *source, uint8_t *destination)
+{
+    for (int i = 0; i < 3; ++i) {
+        const float value = std::min(std::max(source[i], 0.0f), 1.0f);
+        destination[i] = uint8_t(std::lround(value * 255.0f));
+    }
+    destination[3] = 255;
+}
+
+uint16_t VertexAttribute::toHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t exponentBits = (bits >> 23) & 0xffu;
+    uint32_t mantissa = bits & 0x7fffffu;
+
+    if (exponentBits == 0xffu)
+        return uint16_t(sign | 0x7c00u | (mantissa ? 0x200u : 0u));     // Infinity stays, NaN stays NaN
+    const int exponent = int(exponentBits) - 127 + 15;
+    if (exponent >= 31)
+        return uint16_t(sign | 0x7c00u);                                // Too large, infinity
+    if (exponent <= 0) {
+        // Subnormal half, or zero when even that is too small
+        if (exponent < -10)
+            return uint16_t(sign);
+        mantissa |= 0x800000u;
+        const int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1u);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1u)))
+            half++;
+        return uint16_t(sign | half);
+    }
+
+    // Round to nearest even. A carry out of the mantissa steps the exponent up, which is right.
+    uint32_t half = (uint32_t(exponent) << 10) | (mantissa >> 13);
+    const uint32_t rest = mantissa & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+        half++;
+    return uint16_t(sign | half);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QVulkanWindow>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Encodings of one vertex attribute. Each takes its components from the X, Y, Z, R, G, B
+// floats of the sources and writes size bytes of format.
+namespace VertexAttribute {
+
+struct Float3
+{
+    static constexpr VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+    static constexpr uint32_t size = 3 * sizeof(float);
+    static constexpr size_t components = 3;
+    static void write(const float *source, uint8_t *destination);
+};
+
+// Three half floats and w = 1
+struct Half4
+{
+    static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr uint32_t size = 4 * sizeof(uint16_t);
+    static constexpr size_t components = 3;
+    static void write(const float *source, uint8_t *destination);
+};
+
+// Three values clamped to 0..1 in bytes and alpha = 1
+struct Unorm8x4
+{
+    static constexpr VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    static constexpr uint32_t size = 4;
+    static constexpr size_t components = 3;
+    static void write(const float *source, uint8_t *destination);
+};
+
+// Round to nearest even, out of range values become infinity
+uint16_t toHalf(float value);
+
+} // namespace VertexAttribute
+
+// Layout of a vertex made of the given attributes one after another, at locations 0, 1, ...
+// Stride, formats and offsets are known at compile time, so the vertex input state of
+// a pipeline and the code packing the vertices can't disagree.
+template <typename... Attributes>
+struct VertexFormat
+{
+    static constexpr uint32_t attributeCount = uint32_t(sizeof...(Attributes));
+    static constexpr uint32_t stride = (Attributes::size + ...);
+    // Floats of one source vertex
+    static constexpr size_t sourceFloats = (Attributes::components + ...);
+
+    static constexpr VkVertexInputBindingDescription binding(uint32_t binding,
+                                                             VkVertexInputRate rate = VK_VERTEX_INPUT_RATE_VERTEX)
+    {
+        return { binding, stride, rate };
+    }
+
+    static constexpr std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> attributes(uint32_t binding)
+    {
+        const VkFormat formats[] = { Attributes::format... };
+        const uint32_t sizes[] = { Attributes::size... };
+        std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> result = {};
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < attributeCount; ++i) {
+            result[i] = { i, binding, formats[i], offset };
+            offset += sizes[i];
+        }
+        return result;
+    }
+
+    static constexpr uint32_t offset(uint32_t location) { return attributes(0)[location].offset; }
+
+    // One source vertex of sourceFloats into stride bytes
+    static void pack(const float *source, void *destination)
+    {
+        uint8_t *bytes = static_cast<uint8_t *>(destination);
+        ((Attributes::write(source, bytes), source += Attributes::components, bytes += Attributes::size), ...);
+    }
+};
+
+// X, Y, Z, R, G, B in floats, as the meshes are written and the CPU side culling reads them
+using SourceVertexFormat = VertexFormat<VertexAttribute::Float3, VertexAttribute::Float3>;
+// What the pipelines read, see PackedVertex
+using PackedVertexFormat = VertexFormat<VertexAttribute::Half4, VertexAttribute::Unorm8x4>;
@@ -2,12 +2,33 @@
 #include "RenderWindow.h"
 #include <QKeyEvent>
 #include <QCoreApplication>
-#include <QDebug>
 #include <QTimer>
+#include <cstring>
+#include "Log.h"
+#include "Trace.h"
 
-VulkanWindow::VulkanWindow() : mRenderWindow(nullptr)
+// The streaming uploads' queue goes after the graphics work
+static const float TRANSFER_QUEUE_PRIORITY = 0.5f;
+static const float GRAPHICS_AND_TRANSFER_PRIORITIES[2] = { 1.0f, TRANSFER_QUEUE_PRIORITY };
+
+VulkanWindow::VulkanWindow() : mRenderWindow(nullptr), mFrameScheduler(new FrameScheduler(this))
 {
     setTitle("Cube Collection Game - 0/6 collected");
+
+    // VRAM use for the Performance tab, the count variant of the GPU culling's
+    // indirect draw, timeline semaphores for the streaming uploads - Qt only enables the ones the driver has
+    setDeviceExtensions({ "VK_EXT_memory_budget", "VK_KHR_draw_indirect_count", "VK_KHR_timeline_semaphore" });
+
+    // A queue for the streaming uploads next to the graphics queue
+    setQueueCreateInfoModifier([this](const VkQueueFamilyProperties *properties, uint32_t queueFamilyCount,
+                                      QList<VkDeviceQueueCreateInfo> &createInfos) {
+        addTransferQueue(properties, queueFamilyCount, createInfos);
+    });
+#if QT_VERSION >= QT_VERSION_CHECK(6, 7, 0)
+    setEnabledFeaturesModifier([this](VkPhysicalDeviceFeatures2 &features) {
+        enableTimelineSemaphores(features);
+    });
+#endif
     
     connect(&mUpdateTimer, &QTimer::timeout, this, &VulkanWindow::updateUI);
     mUpdateTimer.start(500); // Update every 500ms
@@ -15,10 +36,112 @@ VulkanWindow::VulkanWindow() : mRenderWindow(nullptr)
 
 QVulkanWindowRenderer* VulkanWindow::createRenderer()
 {
-    mRenderWindow = new RenderWindow(this, true);
+    mRenderWindow = new RenderWindow(this, mAntiAliasing, mScene);
+    mRenderWindow->startBenchmark(mBenchmarkFrames);
+    mRenderWindow->setRecordThreads(mRecordThreads);
+    mRenderWindow->setGpuCulling(mGpuCulling);
+    mRenderWindow->setSoftwareOcclusion(mSoftwareOcclusion);
+    mRenderWindow->setFog(mFog);
+    mRenderWindow->setDynamicResolution(mDynamicResolutionMs);
+    mRenderWindow->setUpscaleSharpness(mUpscaleSharpness);
+    mRenderWindow->setTemporalAA(mTemporalAA);
+    if (mBenchmarkFrames > 0)
+        mRenderWindow->setRecordScaling(mRecordScaling);
+    mRenderWindow->setFrameStatsRing(&mFrameStatsRing);
+    mRenderWindow->setFrameScheduler(mFrameScheduler);
+    // Qt creates the renderer before the device, the modifiers fill this in afterwards
+    mRenderWindow->setTransferQueue(&mTransferQueue);
+    // The benchmark measures every frame, it must never be throttled
+    mFrameScheduler->setContinuous(mBenchmarkFrames > 0);
     return mRenderWindow;
 }
 
+void VulkanWindow::addTransferQueue(const VkQueueFamilyProperties *properties, uint32_t queueFamilyCount,
+                                    QList<VkDeviceQueueCreateInfo> &createInfos)
+{
+    const bool timelineSemaphores = mTransferQueue.timelineSemaphores;
+    mTransferQueue = StreamingUploader::QueueInfo();
+    mTransferQueue.timelineSemaphores = timelineSemaphores;
+    if (createInfos.isEmpty())
+        return;
+
+    // Qt asks for the graphics queue first. A family that can only copy is the DMA engine,
+    // it runs beside graphics and compute.
+    VkDeviceQueueCreateInfo &graphicsInfo = createInfos.first();
+    for (uint32_t family = 0; family < queueFamilyCount; ++family) {
+        const VkQueueFlags flags = properties[family].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+                && properties[family].queueCount > 0) {
+            VkDeviceQueueCreateInfo transferInfo;
+            memset(&transferInfo, 0, sizeof(transferInfo));
+            transferInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            transferInfo.queueFamilyIndex = family;
+            transferInfo.queueCount = 1;
+            transferInfo.pQueuePriorities = &TRANSFER_QUEUE_PRIORITY;
+            createInfos.append(transferInfo);
+            mTransferQueue.family = family;
+            LOG_INFO(Vulkan, "Streaming uploads get transfer queue family {}", family);
+            return;
+        }
+    }
+
+    // Otherwise a second queue of the graphics family, if it has one
+    if (graphicsInfo.queueCount == 1 && properties[graphicsInfo.queueFamilyIndex].queueCount > 1) {
+        graphicsInfo.queueCount = 2;
+        graphicsInfo.pQueuePriorities = GRAPHICS_AND_TRANSFER_PRIORITIES;
+        mTransferQueue.family = graphicsInfo.queueFamilyIndex;
+        mTransferQueue.index = 1;
+        LOG_INFO(Vulkan, "Streaming uploads get the second queue of graphics family {}", graphicsInfo.queueFamilyIndex);
+    }
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 7, 0)
+void VulkanWindow::enableTimelineSemaphores(VkPhysicalDeviceFeatures2 &features)
+{
+    mTransferQueue.timelineSemaphores = false;
+
+    // From VK_KHR_timeline_semaphore, the instance is created for Vulkan 1.0
+    const QByteArray extension = QByteArrayLiteral("VK_KHR_timeline_semaphore");
+    if (!supportedDeviceExtensions().contains(extension))
+        return;
+    auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(
+                vulkanInstance()->getInstanceProcAddr("vkGetPhysicalDeviceFeatures2KHR"));
+    if (!getFeatures2)
+        return;
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures supported;
+    memset(&supported, 0, sizeof(supported));
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    VkPhysicalDeviceFeatures2 query;
+    memset(&query, 0, sizeof(query));
+    query.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    query.pNext = &supported;
+    getFeatures2(physicalDevice(), &query);
+    if (!supported.timelineSemaphore)
+        return;
+
+    // Qt may have chained the Vulkan 1.2 features already, those must not be chained twice
+    for (auto *next = static_cast<VkBaseOutStructure *>(features.pNext); next; next = next->pNext) {
+        if (next->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES) {
+            reinterpret_cast<VkPhysicalDeviceVulkan12Features *>(next)->timelineSemaphore = VK_TRUE;
+            mTransferQueue.timelineSemaphores = true;
+            return;
+        }
+        if (next->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES) {
+            reinterpret_cast<VkPhysicalDeviceTimelineSemaphoreFeatures *>(next)->timelineSemaphore = VK_TRUE;
+            mTransferQueue.timelineSemaphores = true;
+            return;
+        }
+    }
+    memset(&mTimelineFeatures, 0, sizeof(mTimelineFeatures));
+    mTimelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    mTimelineFeatures.timelineSemaphore = VK_TRUE;
+    mTimelineFeatures.pNext = features.pNext;
+    features.pNext = &mTimelineFeatures;
+    mTransferQueue.timelineSemaphores = true;
+}
+#endif
+
 void VulkanWindow::updateUI()
 {
     if (mRenderWindow) {
@@ -38,20 +161,13 @@ void VulkanWindow::updateGameStatus(GameStatus status)
     case GameStatus::Lost:
         setTitle("!!! YOU LOSE !!! Enemy collision! Press R to restart");
         
-        qDebug() << "\n*******************************************";
-        qDebug() << "***    GAME OVER - ENEMY COLLISION     ***";
-        qDebug() << "***      Press R to restart game       ***";
-        qDebug() << "*******************************************\n";
+        LOG_INFO(Game, "GAME OVER - enemy collision. Press R to restart the game");
         
         break;
     case GameStatus::Won:
         setTitle("YOU WIN! All collectibles gathered! Congratulations!");
         
-        qDebug() << "\n*******************************************";
-        qDebug() << "***            VICTORY!                 ***";
-        qDebug() << "*** All collectibles have been gathered ***";
-        qDebug() << "***        CONGRATULATIONS!             ***";
-        qDebug() << "*******************************************\n";
+        LOG_INFO(Game, "VICTORY! All collectibles have been gathered, congratulations!");
         
         break;
     case GameStatus::Playing:
@@ -108,6 +224,23 @@ void VulkanWindow::keyPressEvent(QKeyEvent *e)
             mRenderWindow->tryExitHouse();
         }
         break;
+    case Qt::Key_P:
+        // Pause/continue the NPCs - a paused scene with no input renders nothing
+        if (mRenderWindow) {
+            mRenderWindow->setNPCsPaused(!mRenderWindow->areNPCsPaused());
+        }
+        break;
+    case Qt::Key_F:
+        // Fog on/off - the first time its pipeline variant may still be compiling
+        if (mRenderWindow) {
+            mRenderWindow->setFog(!mRenderWindow->isFogEnabled());
+        }
+        break;
+    case Qt::Key_F9:
+        // Dump the trace ring buffers - open in chrome://tracing or ui.perfetto.dev
+        Trace::writeChromeJson("trace.json");
+        Trace::writePerfetto("trace.perfetto-trace");
+        break;
     case Qt::Key_Escape:
         QCoreApplication::quit();
         break;
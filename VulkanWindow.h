@@ -2,6 +2,11 @@
 
 #include <QVulkanWindow>
 #include <QTimer>
+#include "SceneGenerator.h"
+#include "FrameStatsRing.h"
+#include "FrameScheduler.h"
+#include "StreamingUploader.h"
+#include "AntiAliasing.h"
 
 class RenderWindow;
 
@@ -19,6 +24,34 @@ public:
     VulkanWindow();
 
     QVulkanWindowRenderer* createRenderer() override;
+
+    // World the renderer is created with - call before the window is shown
+    void setSceneDescription(const SceneDescription &scene) { mScene = scene; }
+    // Run a fixed number of frames, print timing statistics and quit (0 = normal game)
+    void setBenchmarkFrames(int frames) { mBenchmarkFrames = frames; }
+    // Threads recording command buffers for big scenes
+    void setRecordThreads(int threads) { mRecordThreads = threads; }
+    // Cull and draw collectibles and NPCs on the GPU
+    void setGpuCulling(bool enabled) { mGpuCulling = enabled; }
+    // Hide objects behind houses with a CPU occlusion buffer
+    void setSoftwareOcclusion(bool enabled) { mSoftwareOcclusion = enabled; }
+    // Distance fog outdoors, F toggles it while running
+    void setFog(bool enabled) { mFog = enabled; }
+    // Scene resolution that holds this GPU frame time, scaled up to the window (0 = off)
+    void setDynamicResolution(double targetMs) { mDynamicResolutionMs = targetMs; }
+    // Sharpening of the upscale with dynamic resolution, 0 to 1
+    void setUpscaleSharpness(float sharpness) { mUpscaleSharpness = sharpness; }
+    // Anti-aliasing mode, and temporal accumulation on top of it - call before the window is shown
+    void setAntiAliasing(AntiAliasing mode) { mAntiAliasing = mode; }
+    void setTemporalAA(bool enabled) { mTemporalAA = enabled; }
+    // Benchmark once per thread count and print how recording time scales
+    void setRecordScaling(const QVector<int> &threadCounts) { mRecordScaling = threadCounts; }
+
+    // Per-frame statistics written by the renderer, read by the Performance tab
+    const FrameStatsRing *frameStatsRing() const { return &mFrameStatsRing; }
+
+    // Decides when frames are rendered - idle and background frame rates are set here
+    FrameScheduler *frameScheduler() const { return mFrameScheduler; }
     
     // Game status enum
     enum class GameStatus {
@@ -37,8 +70,30 @@ private slots:
     void updateUI();
 
 private:
+    // Device creation hooks: the streaming uploads' queue and the timeline semaphores they sync with
+    void addTransferQueue(const VkQueueFamilyProperties *properties, uint32_t queueFamilyCount,
+                          QList<VkDeviceQueueCreateInfo> &createInfos);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 7, 0)
+    void enableTimelineSemaphores(VkPhysicalDeviceFeatures2 &features);
+#endif
+
     RenderWindow* mRenderWindow; // Add a pointer to the renderer
     QTimer mUpdateTimer;         // Timer for UI updates
+    SceneDescription mScene = SceneGenerator::defaultScene();
+    int mBenchmarkFrames = 0;
+    int mRecordThreads = 1;
+    bool mGpuCulling = false;
+    bool mSoftwareOcclusion = false;
+    bool mFog = false;
+    double mDynamicResolutionMs = 0.0;
+    float mUpscaleSharpness = 0.0f;
+    AntiAliasing mAntiAliasing = AntiAliasing::Msaa4;
+    bool mTemporalAA = false;
+    QVector<int> mRecordScaling;
+    FrameStatsRing mFrameStatsRing;
+    FrameScheduler *mFrameScheduler;    // Child QObject of this window
+    StreamingUploader::QueueInfo mTransferQueue;
+    VkPhysicalDeviceTimelineSemaphoreFeatures mTimelineFeatures;    // Chained into the device create info
 
 protected:
     //The QVulkanWindow is a QWindow that we inherit from and have these functions
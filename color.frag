@@ -1,10 +1,23 @@
 #version 440
 
+// Features of the pipeline variant, see PipelineVariants.h. Constants, so the
+// branches of the variants without a feature are compiled away.
+layout(constant_id = 0) const bool FOG = false;
+
 layout(location = 0) in vec3 v_color;
+layout(location = 1) in float v_depth;
 
 layout(location = 0) out vec4 fragColor;
 
+// The clear color, so the fog ends where the background starts
+const vec3 FOG_COLOR = vec3(0.0, 1.0, 0.0);
+const float FOG_START = 30.0;
+const float FOG_END = 90.0;
+
 void main()
 {
-    fragColor = vec4(v_color, 1.0);
+    vec3 color = v_color;
+    if (FOG)
+        color = mix(color, FOG_COLOR, clamp((v_depth - FOG_START) / (FOG_END - FOG_START), 0.0, 1.0));
+    fragColor = vec4(color, 1.0);
 }
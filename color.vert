@@ -1,18 +1,37 @@
 #version 440
 
+// Packed vertices (see MeshOptimizer.h): the position comes in as half floats with w = 1,
+// the color as unorm8, the vertex input converts both to float
 layout(location = 0) in vec4 position;
 layout(location = 1) in vec3 color;
 
 layout(location = 0) out vec3 v_color;
+// Distance in front of the camera, for the fog
+layout(location = 1) out float v_depth;
 
+// The bindless set (see BindlessSet.h): camera, every object's model matrix and every material
 layout(std140, binding = 0) uniform buf {
-    mat4 mvp;
+    mat4 viewProjection;
 } ubuf;
 
+layout(std430, binding = 1) readonly buffer Transforms { mat4 transforms[]; };
+
+struct Material {
+    vec4 tint;
+};
+layout(std430, binding = 2) readonly buffer Materials { Material materials[]; };
+
+// Rows of the object being drawn
+layout(push_constant) uniform ObjectConstants {
+    uint transform;
+    uint material;
+} object;
+
 out gl_PerVertex { vec4 gl_Position; };
 
 void main()
 {
-    v_color = color;
-    gl_Position = ubuf.mvp * position;
+    v_color = color * materials[object.material].tint.rgb;
+    gl_Position = ubuf.viewProjection * transforms[object.transform] * position;
+    v_depth = gl_Position.w;
 }
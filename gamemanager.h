@@ -5,6 +5,7 @@
 #include <QVector3D>
 #include <QVector>
 #include <QPair>
+#include "SceneGenerator.h"
 
 // Forward declarations
 class RenderWindow;
@@ -42,12 +43,15 @@ class GameManager : public QObject
 
 public:
     explicit GameManager(RenderWindow* renderWindow);
+    // Builds the game state from a scene description instead of random positions
+    GameManager(RenderWindow* renderWindow, const SceneDescription& scene);
     ~GameManager();
 
     // Scene management
     void initializeScenes();
     void switchToScene2();
     void switchToScene1();
+    void loadScene(const SceneDescription& scene);
 
     // Game state
     bool isGameOver() const { return mGameOver; }
@@ -71,7 +75,7 @@ public:
     const QVector<NPC>& getNPCs() const { return mNPCs; }
     bool isDoorOpen() const { return mDoorOpen; }
     int getCollectedPickups() const { return mCollectedPickups; }
-    int getTotalPickups() const { return mPickups.size(); }
+    int getTotalPickups() const { return mPickups.size() + mHousePickups.size(); }
     const QVector3D& getHousePosition() const { return mHousePosition; }
     const QVector3D& getDoorPosition() const { return mDoorPosition; }
 
@@ -90,8 +94,8 @@ private:
     QVector3D mDoorPosition;
     float mDoorOpenDistance;
 
-    // Scene 2 elements
-    Pickup mHousePickup;
+    // Scene 2 elements - one pickup per indoor room
+    QVector<Pickup> mHousePickups;
 
     // Helper functions
     void initializeScene1();
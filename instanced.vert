@@ -0,0 +1,37 @@
+#version 440
+
+// Vertex shader of the GPU culled instances (see GpuCuller.h).
+// gl_InstanceIndex counts from the mesh's firstInstance, which is where its
+// range of the visible list starts.
+
+// Packed vertices like in color.vert, half float position and unorm8 color
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec3 color;
+
+layout(location = 0) out vec3 v_color;
+layout(location = 1) out float v_depth;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 viewProjection;
+} ubuf;
+
+struct Instance {
+    vec4 positionScale;     // xyz position, w uniform scale
+    uint mesh;
+    uint pad0;
+    uint pad1;
+    uint pad2;
+};
+
+layout(std430, binding = 1) readonly buffer Instances { Instance instances[]; };
+layout(std430, binding = 2) readonly buffer Visible { uint visibleIndices[]; };
+
+out gl_PerVertex { vec4 gl_Position; };
+
+void main()
+{
+    Instance instance = instances[visibleIndices[gl_InstanceIndex]];
+    v_color = color;
+    gl_Position = ubuf.viewProjection * vec4(position.xyz * instance.positionScale.w + instance.positionScale.xyz, 1.0);
+    v_depth = gl_Position.w;
+}
@@ -4,37 +4,93 @@
 #include <QLibraryInfo>
 #include <QLoggingCategory>
 #include <QPointer>
+#include <QCommandLineParser>
+#include <QThread>
 #include "MainWindow.h"
 #include "VulkanWindow.h"
+#include "SceneGenerator.h"
+#include "AntiAliasing.h"
+#include "ParallelRecorder.h"
+#include "Trace.h"
+#include "Log.h"
 
 Q_LOGGING_CATEGORY(lcVk, "qt.vulkan")
 
 static QPointer<QPlainTextEdit> messageLogWidget;
 static QtMessageHandler oldMessageHandler{ nullptr };
 
-//Logger system from Qt. Nice to print out messages directly to our program
+//Logger system from Qt. Messages go through our asynchronous log (Log.h),
+//which writes them to stderr and to the log widget in batches
 static void messageHandler(QtMsgType msgType, const QMessageLogContext &logContext, const QString &text)
 {
-    if (!messageLogWidget.isNull())
-        messageLogWidget->appendPlainText(text);
-    if (oldMessageHandler)
-        oldMessageHandler(msgType, logContext, text);
+    Log::Level level = Log::Level::Debug;
+    switch (msgType) {
+    case QtDebugMsg:    level = Log::Level::Debug; break;
+    case QtInfoMsg:     level = Log::Level::Info; break;
+    case QtWarningMsg:  level = Log::Level::Warning; break;
+    case QtCriticalMsg: level = Log::Level::Error; break;
+    case QtFatalMsg:
+        //qFatal aborts right after this - write out what is queued and let Qt print the message
+        Log::writeText(Log::Level::Error, Log::Category::Qt, text);
+        Log::flush();
+        if (oldMessageHandler)
+            oldMessageHandler(msgType, logContext, text);
+        return;
+    }
+    Log::writeText(level, Log::Category::Qt, text);
 }
 
 int main(int argc, char *argv[])
 {
     //Makes a Qt application
     QApplication app(argc, argv);
+    TRACE_THREAD_NAME("main");
+    Log::start();
+
+    //Command line options - lets us generate bigger scenes for stress testing
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Cube Collection Game");
+    parser.addHelpOption();
+    QCommandLineOption presetOption("preset", "Stress scene preset: 1k, 100k or 1m entities.", "name");
+    QCommandLineOption collectiblesOption("collectibles", "Number of outdoor collectibles.", "count");
+    QCommandLineOption npcsOption("npcs", "Number of patrolling NPCs.", "count");
+    QCommandLineOption housesOption("houses", "Number of houses.", "count");
+    QCommandLineOption roomsOption("rooms", "Number of indoor rooms.", "count");
+    QCommandLineOption worldSizeOption("world-size", "Half extent of the ground plane.", "size");
+    QCommandLineOption seedOption("seed", "Seed for the scene generator.", "seed");
+    QCommandLineOption benchmarkOption("benchmark-frames", "Render this many frames, print timings and quit.", "frames");
+    QCommandLineOption idleFpsOption("idle-fps", "Frame rate while nothing changes (0 = none, default 2).", "fps");
+    QCommandLineOption unfocusedFpsOption("unfocused-fps", "Frame rate in the background (0 = pause, default 10).", "fps");
+    QCommandLineOption recordThreadsOption("record-threads", "Threads recording command buffers (default: cores, at most 8).", "count");
+    QCommandLineOption recordScalingOption("benchmark-record-threads",
+                                           "With --benchmark-frames: run once per thread count, e.g. 1,2,4,8.", "list");
+    QCommandLineOption gpuCullingOption("gpu-culling", "Cull and draw collectibles and NPCs with a compute pass and indirect draws.");
+    QCommandLineOption softwareOcclusionOption("software-occlusion",
+                                               "Skip collectibles and NPCs hidden behind houses, tested on the CPU.");
+    QCommandLineOption fogOption("fog", "Distance fog outdoors (toggle with F).");
+    QCommandLineOption dynamicResolutionOption("dynamic-resolution",
+                                               "Draw the scene at the resolution that holds this GPU frame time, scaled up to the window.", "ms");
+    QCommandLineOption sharpenOption("sharpen", "With --dynamic-resolution: sharpening of the upscale, 0 to 1 (default 0).", "amount");
+    QCommandLineOption aaOption("aa", "Anti-aliasing: off, msaa2, msaa4, msaa8 or fxaa (default msaa4).", "mode");
+    QCommandLineOption taaOption("taa", "Temporal anti-aliasing: jittered frames accumulated, on top of --aa.");
+    parser.addOptions({ presetOption, collectiblesOption, npcsOption, housesOption, roomsOption,
+                        worldSizeOption, seedOption, benchmarkOption, idleFpsOption, unfocusedFpsOption,
+                        recordThreadsOption, recordScalingOption, gpuCullingOption, softwareOcclusionOption,
+                        fogOption, dynamicResolutionOption, sharpenOption, aaOption, taaOption });
+    parser.process(app);
 
     //Logger setup
     messageLogWidget = new QPlainTextEdit(QLatin1String(QLibraryInfo::build()) + QLatin1Char('\n'));
     messageLogWidget->setReadOnly(true);
+    Log::attachWidget(messageLogWidget.data());
     oldMessageHandler = qInstallMessageHandler(messageHandler);
     QLoggingCategory::setFilterRules(QStringLiteral("qt.vulkan=true"));
 
     //Qt wrapper for the actual Vulkan Instance
     QVulkanInstance inst;
     inst.setLayers({ "VK_LAYER_KHRONOS_validation" });
+    //Needed to read the VRAM budget on Vulkan 1.0 drivers, ignored if not supported
+    inst.setExtensions({ "VK_KHR_get_physical_device_properties2" });
 
     if (!inst.create())
         qFatal("Failed to create Vulkan instance: %d", inst.errorCode());
@@ -44,6 +100,60 @@ int main(int argc, char *argv[])
     //It needs the Vulkan instance
     vulkanWindow->setVulkanInstance(&inst);
 
+    //Without any scene options we keep the original hand-made scene
+    const bool generateScene = parser.isSet(presetOption) || parser.isSet(collectiblesOption)
+                            || parser.isSet(npcsOption) || parser.isSet(housesOption)
+                            || parser.isSet(roomsOption) || parser.isSet(worldSizeOption)
+                            || parser.isSet(seedOption);
+    if (generateScene) {
+        SceneConfig config;
+        if (parser.isSet(presetOption) && !SceneGenerator::presetConfig(parser.value(presetOption), config))
+            qWarning() << "Unknown scene preset" << parser.value(presetOption) << "- using the defaults";
+        //Single counts override the preset
+        if (parser.isSet(collectiblesOption))
+            config.collectibleCount = parser.value(collectiblesOption).toInt();
+        if (parser.isSet(npcsOption))
+            config.npcCount = parser.value(npcsOption).toInt();
+        if (parser.isSet(housesOption))
+            config.houseCount = parser.value(housesOption).toInt();
+        if (parser.isSet(roomsOption))
+            config.indoorRoomCount = parser.value(roomsOption).toInt();
+        if (parser.isSet(worldSizeOption))
+            config.worldSize = parser.value(worldSizeOption).toFloat();
+        if (parser.isSet(seedOption))
+            config.seed = parser.value(seedOption).toUInt();
+        vulkanWindow->setSceneDescription(SceneGenerator::generate(config));
+    }
+    if (parser.isSet(benchmarkOption))
+        vulkanWindow->setBenchmarkFrames(parser.value(benchmarkOption).toInt());
+    vulkanWindow->setRecordThreads(parser.isSet(recordThreadsOption) ? parser.value(recordThreadsOption).toInt()
+                                                                     : qMin(QThread::idealThreadCount(), 8));
+    if (parser.isSet(recordScalingOption)) {
+        QVector<int> threadCounts;
+        for (const QString &count : parser.value(recordScalingOption).split(',', Qt::SkipEmptyParts))
+            threadCounts.append(qBound(1, count.trimmed().toInt(), ParallelRecorder::MAX_THREADS));
+        vulkanWindow->setRecordScaling(threadCounts);
+    }
+    vulkanWindow->setGpuCulling(parser.isSet(gpuCullingOption));
+    vulkanWindow->setSoftwareOcclusion(parser.isSet(softwareOcclusionOption));
+    vulkanWindow->setFog(parser.isSet(fogOption));
+    if (parser.isSet(dynamicResolutionOption))
+        vulkanWindow->setDynamicResolution(parser.value(dynamicResolutionOption).toDouble());
+    if (parser.isSet(sharpenOption))
+        vulkanWindow->setUpscaleSharpness(parser.value(sharpenOption).toFloat());
+    if (parser.isSet(aaOption)) {
+        AntiAliasing mode;
+        if (antiAliasingFromName(parser.value(aaOption), mode))
+            vulkanWindow->setAntiAliasing(mode);
+        else
+            qWarning() << "Unknown anti-aliasing mode" << parser.value(aaOption) << "- using msaa4";
+    }
+    vulkanWindow->setTemporalAA(parser.isSet(taaOption));
+    if (parser.isSet(idleFpsOption))
+        vulkanWindow->frameScheduler()->setIdleFps(parser.value(idleFpsOption).toInt());
+    if (parser.isSet(unfocusedFpsOption))
+        vulkanWindow->frameScheduler()->setUnfocusedFps(parser.value(unfocusedFpsOption).toInt());
+
     //Main window of our program, that takes our VulkanWindow and logger as input
     MainWindow mainWindow(vulkanWindow, messageLogWidget.data());
 
@@ -53,5 +163,7 @@ int main(int argc, char *argv[])
     mainWindow.show();
 
     //app.exec() runs the rest of the program
-    return app.exec();
+    const int result = app.exec();
+    Log::shutdown();
+    return result;
 }
@@ -0,0 +1,48 @@
+#version 450
+
+// Temporal anti-aliasing resolve, see TemporalAA.h.
+// The new frame was drawn with a sub-pixel jitter; blended into the history over several frames
+// every pixel averages samples from across its area. The history is clamped to the range of the
+// new frame's 3x3 neighbourhood first, so whatever moved doesn't leave a trail.
+
+layout(location = 0) in vec2 v_uv;
+
+layout(location = 0) out vec4 fragColor;
+
+layout(binding = 0) uniform sampler2D current;
+layout(binding = 1) uniform sampler2D history;
+
+layout(push_constant) uniform Resolve {
+    vec2 uvScale;       // Drawn part of the target
+    vec2 texelSize;
+    float blend;        // Weight of the new frame, 1 ignores the history
+} resolve;
+
+void main()
+{
+    // The viewport covers the drawn part, so uv lands on the texel centres of both images
+    vec2 uv = v_uv * resolve.uvScale;
+    vec3 color = texture(current, uv).rgb;
+
+    // Right after a reset the history holds anything, NaNs included - mix() would keep those
+    if (resolve.blend >= 1.0) {
+        fragColor = vec4(color, 1.0);
+        return;
+    }
+
+    vec2 low = 0.5 * resolve.texelSize;
+    vec2 high = resolve.uvScale - low;
+    vec3 lowest = color;
+    vec3 highest = color;
+    for (int y = -1; y <= 1; ++y) {
+        for (int x = -1; x <= 1; ++x) {
+            if (x == 0 && y == 0)
+                continue;
+            vec3 neighbour = texture(current, clamp(uv + vec2(x, y) * resolve.texelSize, low, high)).rgb;
+            lowest = min(lowest, neighbour);
+            highest = max(highest, neighbour);
+        }
+    }
+    vec3 previous = clamp(texture(history, uv).rgb, lowest, highest);
+    fragColor = vec4(mix(previous, color, resolve.blend), 1.0);
+}
@@ -0,0 +1,86 @@
+#version 450
+
+// The scene target scaled up to the swap chain, see SceneUpscaler.h.
+// Bilinear from the part of the target the scene was drawn to. With edgeAA the edges are
+// smoothed first (FXAA, see AntiAliasing.h). With sharpness above 0 the difference to the four
+// neighbours is added back, which restores some of the edges the lower resolution and the
+// filtering soften.
+
+layout(location = 0) in vec2 v_uv;
+
+layout(location = 0) out vec4 fragColor;
+
+layout(binding = 0) uniform sampler2D scene;
+
+layout(push_constant) uniform Upscale {
+    vec2 uvScale;       // Drawn part of the target
+    vec2 texelSize;
+    float sharpness;
+    int edgeAA;
+} upscale;
+
+// Contrast below either threshold is left alone: dark noise and flat areas aren't edges
+const float EDGE_THRESHOLD = 1.0 / 8.0;
+const float EDGE_THRESHOLD_MIN = 1.0 / 32.0;
+// Keep the blend direction finite along almost flat gradients, and at most this many texels long
+const float REDUCE_MUL = 1.0 / 8.0;
+const float REDUCE_MIN = 1.0 / 128.0;
+const float SPAN_MAX = 8.0;
+
+float luma(vec3 color)
+{
+    return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+vec3 fetch(vec2 uv, vec2 low, vec2 high)
+{
+    return texture(scene, clamp(uv, low, high)).rgb;
+}
+
+// FXAA: the luma of the four diagonal neighbours gives the direction across the edge, the
+// pixel is blended along the edge with two or four bilinear taps - four unless that
+// overshoots the neighbourhood, which means the wider taps reached across another edge
+vec3 fxaa(vec2 uv, vec2 low, vec2 high)
+{
+    vec2 texel = upscale.texelSize;
+    vec3 middle = fetch(uv, low, high);
+    float lumaM = luma(middle);
+    float lumaNW = luma(fetch(uv + vec2(-1.0, -1.0) * texel, low, high));
+    float lumaNE = luma(fetch(uv + vec2(1.0, -1.0) * texel, low, high));
+    float lumaSW = luma(fetch(uv + vec2(-1.0, 1.0) * texel, low, high));
+    float lumaSE = luma(fetch(uv + vec2(1.0, 1.0) * texel, low, high));
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    if (lumaMax - lumaMin < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD))
+        return middle;
+
+    vec2 direction = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float reduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * REDUCE_MUL, REDUCE_MIN);
+    float scale = 1.0 / (min(abs(direction.x), abs(direction.y)) + reduce);
+    direction = clamp(direction * scale, -SPAN_MAX, SPAN_MAX) * texel;
+
+    vec3 near = 0.5 * (fetch(uv + direction * (1.0 / 3.0 - 0.5), low, high)
+                     + fetch(uv + direction * (2.0 / 3.0 - 0.5), low, high));
+    vec3 wide = 0.5 * near + 0.25 * (fetch(uv - direction * 0.5, low, high)
+                                   + fetch(uv + direction * 0.5, low, high));
+    float lumaWide = luma(wide);
+    return lumaWide < lumaMin || lumaWide > lumaMax ? near : wide;
+}
+
+void main()
+{
+    // Half a texel inside the drawn part, so the filter never reaches what is outside it
+    vec2 low = 0.5 * upscale.texelSize;
+    vec2 high = upscale.uvScale - low;
+    vec2 uv = clamp(v_uv * upscale.uvScale, low, high);
+    vec3 color = upscale.edgeAA != 0 ? fxaa(uv, low, high) : texture(scene, uv).rgb;
+
+    if (upscale.sharpness > 0.0) {
+        vec3 neighbours = fetch(uv + vec2(upscale.texelSize.x, 0.0), low, high)
+                        + fetch(uv - vec2(upscale.texelSize.x, 0.0), low, high)
+                        + fetch(uv + vec2(0.0, upscale.texelSize.y), low, high)
+                        + fetch(uv - vec2(0.0, upscale.texelSize.y), low, high);
+        color = clamp(color + upscale.sharpness * (color - 0.25 * neighbours), 0.0, 1.0);
+    }
+    fragColor = vec4(color, 1.0);
+}
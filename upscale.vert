@@ -0,0 +1,12 @@
+#version 450
+
+// One triangle that covers the screen, see SceneUpscaler.h.
+// uv runs from 0 to 1 across the screen, the parts of the triangle outside are clipped.
+
+layout(location = 0) out vec2 v_uv;
+
+void main()
+{
+    v_uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(v_uv * 2.0 - 1.0, 0.0, 1.0);
+}